@@ -0,0 +1,270 @@
+#include <iostream>
+#include <vector>
+
+#include "harness.h"
+#include "model/changes.h"
+#include "model/client-model.h"
+#include "model/focus-cycle.h"
+#include "model/screen.h"
+
+const unsigned long long max_desktops = 5;
+const int border_width = 2;
+
+/// The numbers of clients that each benchmark is run with
+const unsigned long client_counts[] = {10, 100, 1000, 10000};
+const int num_client_counts = sizeof(client_counts) / sizeof(client_counts[0]);
+
+/// The numbers of screens that update_screens is run with
+const unsigned long screen_counts[] = {1, 4, 16, 64};
+const int num_screen_counts = sizeof(screen_counts) / sizeof(screen_counts[0]);
+
+/**
+ * Gets how many times to repeat an operation whose cost grows with the size
+ * of the problem, so that the larger sizes don't take forever.
+ */
+int repeats_for(unsigned long size)
+{
+    return size >= 1000 ? 2 : 2000 / size;
+}
+
+/**
+ * Builds a grid of screens, each of which is 1024x768.
+ * @param count How many screens to make (the grid is as square as possible).
+ * @param offset How far to shift the whole grid to the right.
+ */
+void make_screens(unsigned long count, int offset, std::vector<Box> &screens)
+{
+    unsigned long columns = 1;
+    while (columns * columns < count)
+        columns++;
+
+    screens.clear();
+    for (unsigned long screen = 0; screen < count; screen++)
+    {
+        int x = (screen % columns) * 1024 + offset;
+        int y = (screen / columns) * 768;
+        screens.push_back(Box(x, y, 1024, 768));
+    }
+}
+
+/**
+ * A ClientModel on a single screen, like the one that SmallWM would have.
+ */
+struct ClientModelBench
+{
+    ClientModelBench() :
+        model(changes, manager, max_desktops, border_width)
+    {
+        std::vector<Box> screens;
+        make_screens(1, 0, screens);
+        manager.rebuild_graph(screens);
+    }
+
+    /**
+     * Adds a client, and throws away the changes it caused.
+     */
+    void add(Window client)
+    {
+        Dimension2D location((client * 37) % 1000, (client * 53) % 700);
+        model.add_client(client, IS_VISIBLE, location, Dimension2D(100, 100), true);
+        changes.flush();
+    }
+
+    /**
+     * Adds clients, with IDs from 1 to count.
+     */
+    void populate(unsigned long count)
+    {
+        for (Window client = 1; client <= count; client++)
+            add(client);
+    }
+
+    CrtManager manager;
+    ChangeStream changes;
+    ClientModel model;
+};
+
+void bench_add_client(BenchSuite &suite, unsigned long count)
+{
+    ClientModelBench bench;
+
+    suite.start();
+    bench.populate(count);
+    suite.stop("add_client", count, count);
+}
+
+void bench_remove_client(BenchSuite &suite, unsigned long count)
+{
+    ClientModelBench bench;
+    bench.populate(count);
+
+    suite.start();
+    for (Window client = 1; client <= count; client++)
+    {
+        bench.model.remove_client(client);
+        bench.changes.flush();
+    }
+    suite.stop("remove_client", count, count);
+}
+
+void bench_next_desktop(BenchSuite &suite, unsigned long count)
+{
+    ClientModelBench bench;
+    bench.populate(count);
+
+    int repeats = repeats_for(count);
+
+    suite.start();
+    for (int repeat = 0; repeat < repeats; repeat++)
+    {
+        bench.model.next_desktop();
+        bench.changes.flush();
+    }
+    suite.stop("next_desktop", count, repeats);
+}
+
+void bench_toggle_stick(BenchSuite &suite, unsigned long count)
+{
+    ClientModelBench bench;
+    bench.populate(count);
+
+    suite.start();
+    for (Window client = 1; client <= count; client++)
+    {
+        bench.model.toggle_stick(client);
+        bench.changes.flush();
+        bench.model.toggle_stick(client);
+        bench.changes.flush();
+    }
+    suite.stop("toggle_stick", count, count * 2);
+}
+
+void bench_layer_changes(BenchSuite &suite, unsigned long count)
+{
+    ClientModelBench bench;
+    bench.populate(count);
+
+    suite.start();
+    for (Window client = 1; client <= count; client++)
+    {
+        bench.model.up_layer(client);
+        bench.changes.flush();
+        bench.model.down_layer(client);
+        bench.changes.flush();
+        bench.model.set_layer(client, MIN_LAYER + client % (MAX_LAYER - MIN_LAYER));
+        bench.changes.flush();
+    }
+    suite.stop("layer_changes", count, count * 3);
+}
+
+void bench_visible_in_layer_order(BenchSuite &suite, unsigned long count)
+{
+    ClientModelBench bench;
+    bench.populate(count);
+
+    std::vector<Window> visible;
+    int repeats = repeats_for(count);
+
+    suite.start();
+    for (int repeat = 0; repeat < repeats; repeat++)
+    {
+        visible.clear();
+        bench.model.get_visible_in_layer_order(visible);
+    }
+    suite.stop("get_visible_in_layer_order", count, repeats);
+}
+
+void bench_update_screens(BenchSuite &suite, unsigned long screen_count)
+{
+    ClientModelBench bench;
+    bench.populate(1000);
+
+    // Switching between two layouts makes sure that every update actually
+    // moves some clients onto different screens
+    std::vector<Box> layouts[2];
+    make_screens(screen_count, 0, layouts[0]);
+    make_screens(screen_count, 512, layouts[1]);
+    int repeats = repeats_for(screen_count);
+
+    suite.start();
+    for (int repeat = 0; repeat < repeats; repeat++)
+    {
+        bench.model.update_screens(layouts[repeat % 2]);
+        bench.changes.flush();
+    }
+    suite.stop("update_screens", screen_count, repeats);
+}
+
+void bench_focus_cycle(BenchSuite &suite, unsigned long count)
+{
+    FocusCycle cycle;
+
+    suite.start();
+    for (Window client = 1; client <= count; client++)
+        cycle.add(client);
+    suite.stop("focus_cycle_add", count, count);
+
+    suite.start();
+    for (unsigned long step = 0; step < count; step++)
+        cycle.forward();
+    for (unsigned long step = 0; step < count; step++)
+        cycle.backward();
+    suite.stop("focus_cycle_forward_backward", count, count * 2);
+
+    suite.start();
+    for (Window client = 1; client <= count; client++)
+        cycle.set(client);
+    suite.stop("focus_cycle_set", count, count);
+
+    suite.start();
+    for (Window client = 1; client <= count; client++)
+        cycle.remove(client, true);
+    suite.stop("focus_cycle_remove", count, count);
+}
+
+int main(int argc, char **argv)
+{
+    BenchSuite suite("client-model");
+    if (!suite.parse_args(argc, argv))
+        return 1;
+
+    typedef void (*ClientBench)(BenchSuite&, unsigned long);
+    struct
+    {
+        const char *name;
+        ClientBench bench;
+        unsigned long max_count;
+    } client_benches[] = {
+        { "add_client", bench_add_client, 10000 },
+        { "remove_client", bench_remove_client, 10000 },
+        { "next_desktop", bench_next_desktop, 10000 },
+        { "toggle_stick", bench_toggle_stick, 10000 },
+        { "layer_changes", bench_layer_changes, 10000 },
+        { "get_visible_in_layer_order", bench_visible_in_layer_order, 10000 },
+        { "focus_cycle", bench_focus_cycle, 10000 },
+    };
+    int num_client_benches = sizeof(client_benches) / sizeof(client_benches[0]);
+
+    for (int bench = 0; bench < num_client_benches; bench++)
+    {
+        if (!suite.enabled(client_benches[bench].name))
+            continue;
+
+        for (int count = 0; count < num_client_counts; count++)
+        {
+            if (client_counts[count] <= client_benches[bench].max_count)
+                client_benches[bench].bench(suite, client_counts[count]);
+        }
+    }
+
+    if (suite.enabled("update_screens"))
+    {
+        for (int count = 0; count < num_screen_counts; count++)
+            bench_update_screens(suite, screen_counts[count]);
+    }
+
+    suite.report(std::cerr);
+    suite.dump(std::cout);
+    std::cout << "\n";
+    return 0;
+}
@@ -0,0 +1,177 @@
+/** @file */
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <new>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "harness.h"
+#include "stats.h"
+
+/// How many times operator new has been called, over the whole process
+static uint64_t allocation_count = 0;
+
+/*
+ * Every allocation goes through these, so that the benchmarks can report how
+ * many allocations each operation needs.
+ */
+void *operator new(std::size_t size)
+{
+    allocation_count++;
+
+    void *memory = std::malloc(size == 0 ? 1 : size);
+    if (!memory)
+        throw std::bad_alloc();
+
+    return memory;
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    std::free(memory);
+}
+
+/**
+ * Gets how many times operator new has been called so far.
+ */
+uint64_t bench_allocations()
+{
+    return allocation_count;
+}
+
+/**
+ * Gets the largest resident set size that the process has had so far.
+ */
+long bench_peak_rss_kb()
+{
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+/**
+ * Reads the command line options, which are:
+ *
+ *  - -f FILTER Only run benchmarks whose names contain FILTER
+ *
+ * @return false if the options are invalid (a usage message is printed).
+ */
+bool BenchSuite::parse_args(int argc, char **argv)
+{
+    int option;
+    while ((option = getopt(argc, argv, "f:")) != -1)
+    {
+        switch (option)
+        {
+        case 'f':
+            m_filter = optarg;
+            break;
+        default:
+            std::fprintf(stderr, "Usage: %s [-f FILTER]\n", argv[0]);
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * Checks whether a benchmark should be run.
+ */
+bool BenchSuite::enabled(const std::string &name) const
+{
+    return name.find(m_filter) != std::string::npos;
+}
+
+/**
+ * Starts timing the operations of a benchmark.
+ */
+void BenchSuite::start()
+{
+    m_start_allocations = bench_allocations();
+    m_start_ns = monotonic_ns();
+}
+
+/**
+ * Stops timing the operations of a benchmark, and records its results.
+ * @param name The name of the benchmark.
+ * @param size The size of the problem that the benchmark worked on.
+ * @param ops How many operations were done since start().
+ */
+void BenchSuite::stop(const std::string &name, unsigned long size, uint64_t ops)
+{
+    uint64_t end_ns = monotonic_ns();
+
+    BenchResult result;
+    result.name = name;
+    result.size = size;
+    result.ops = ops;
+    result.elapsed_ns = end_ns - m_start_ns;
+    result.allocations = bench_allocations() - m_start_allocations;
+    result.peak_rss_kb = bench_peak_rss_kb();
+    m_results.push_back(result);
+}
+
+/**
+ * Prints out the results as a table, for people to read.
+ */
+void BenchSuite::report(std::ostream &out) const
+{
+    out << std::left << std::setw(32) << "benchmark" << std::right
+        << std::setw(8) << "size"
+        << std::setw(14) << "ns/op"
+        << std::setw(14) << "allocs/op"
+        << std::setw(14) << "peak rss kb" << "\n";
+
+    for (std::vector<BenchResult>::const_iterator result = m_results.begin();
+            result != m_results.end();
+            result++)
+    {
+        double ops = result->ops > 0 ? result->ops : 1;
+        out << std::left << std::setw(32) << result->name << std::right
+            << std::setw(8) << result->size
+            << std::setw(14) << std::fixed << std::setprecision(1)
+                << result->elapsed_ns / ops
+            << std::setw(14) << std::setprecision(2)
+                << result->allocations / ops
+            << std::setw(14) << result->peak_rss_kb << "\n";
+    }
+}
+
+/**
+ * Writes out the results as a JSON object.
+ */
+void BenchSuite::dump(std::ostream &out) const
+{
+    out << "{\"version\":1,\"suite\":\"" << m_suite << "\",\"benchmarks\":[";
+
+    for (std::vector<BenchResult>::const_iterator result = m_results.begin();
+            result != m_results.end();
+            result++)
+    {
+        if (result != m_results.begin())
+            out << ",";
+
+        double ops = result->ops > 0 ? result->ops : 1;
+        out << "{\"name\":\"" << result->name << "\""
+            << ",\"size\":" << result->size
+            << ",\"ops\":" << result->ops
+            << ",\"elapsed_ns\":" << result->elapsed_ns
+            << ",\"ns_per_op\":" << result->elapsed_ns / ops
+            << ",\"allocs_per_op\":" << result->allocations / ops
+            << ",\"peak_rss_kb\":" << result->peak_rss_kb << "}";
+    }
+
+    out << "],\"peak_rss_kb\":" << bench_peak_rss_kb() << "}";
+}
@@ -0,0 +1,77 @@
+/** @file */
+#ifndef __SMALLWM_BENCH_HARNESS__
+#define __SMALLWM_BENCH_HARNESS__
+
+#include <ostream>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+/**
+ * The measurements taken from one run of a benchmark.
+ */
+struct BenchResult
+{
+    /// The name of the benchmark
+    std::string name;
+
+    /// The size of the problem (usually, how many clients there were)
+    unsigned long size;
+
+    /// How many operations were timed
+    uint64_t ops;
+
+    /// How long all of the operations took
+    uint64_t elapsed_ns;
+
+    /// How many times operator new was called during the operations
+    uint64_t allocations;
+
+    /// The peak resident set size of the process, after the operations
+    long peak_rss_kb;
+};
+
+/**
+ * Runs a group of benchmarks, and collects their results so that they can be
+ * printed out as JSON and compared across commits.
+ *
+ * Each benchmark does its setup, and then wraps the operations it wants to
+ * measure between start() and stop().
+ */
+class BenchSuite
+{
+public:
+    BenchSuite(const std::string &suite) :
+        m_suite(suite), m_start_ns(0), m_start_allocations(0)
+    {};
+
+    bool parse_args(int, char**);
+    bool enabled(const std::string&) const;
+
+    void start();
+    void stop(const std::string&, unsigned long, uint64_t);
+
+    void report(std::ostream&) const;
+    void dump(std::ostream&) const;
+
+private:
+    /// The name of this group of benchmarks
+    std::string m_suite;
+
+    /// Only the benchmarks whose names contain this are run
+    std::string m_filter;
+
+    /// When the current benchmark started
+    uint64_t m_start_ns;
+
+    /// The number of allocations when the current benchmark started
+    uint64_t m_start_allocations;
+
+    /// The results of the benchmarks which have finished
+    std::vector<BenchResult> m_results;
+};
+
+uint64_t bench_allocations();
+long bench_peak_rss_kb();
+
+#endif
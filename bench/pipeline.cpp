@@ -0,0 +1,149 @@
+#include <fstream>
+#include <iostream>
+#include <vector>
+
+#include "harness.h"
+#include "clientmodel-events.h"
+#include "configparse.h"
+#include "deferred-work.h"
+#include "event-stream.h"
+#include "ewmh.h"
+#include "fake/fake-launcher.h"
+#include "fake/fake-xdata.h"
+#include "grab-manager.h"
+#include "logging/logging.h"
+#include "logging/stream.h"
+#include "mirrored-xdata.h"
+#include "model/changes.h"
+#include "model/client-model.h"
+#include "model/screen.h"
+#include "model/x-model.h"
+#include "stats.h"
+#include "trace.h"
+#include "x-events.h"
+
+/// The numbers of clients on each desktop that the benchmarks are run with
+const unsigned long client_counts[] = {10, 100, 1000};
+const int num_client_counts = sizeof(client_counts) / sizeof(client_counts[0]);
+
+/**
+ * The whole of SmallWM, running on the fake X server - this is put together
+ * in the same way that smallwm.cpp does it.
+ */
+struct PipelineBench
+{
+    PipelineBench() :
+        null_stream("/dev/null"), logger(null_stream), xdata(stats),
+        clients(changes, crt_manager, config.num_desktops, config.border_width),
+        trace(xdata), mirrored_xdata(xdata, xmodel, stats),
+        grabs(mirrored_xdata),
+        ewmh(mirrored_xdata, clients, FAKE_ROOT, config.num_desktops),
+        x_events(config, stats, trace, mirrored_xdata, grabs, work, launcher,
+                 clients, xmodel),
+        client_events(config, logger, stats, changes, mirrored_xdata, grabs,
+                      work, ewmh, events, clients, xmodel)
+    {
+        xdata.select_input(FAKE_ROOT,
+                           PointerMotionMask |
+                           StructureNotifyMask |
+                           SubstructureNotifyMask |
+                           SubstructureRedirectMask);
+
+        std::vector<Box> screens;
+        xdata.get_screen_boxes(screens);
+        crt_manager.rebuild_graph(screens);
+    }
+
+    /**
+     * Handles events until the fake server has nothing left to send.
+     */
+    void run()
+    {
+        client_events.handle_queued_changes();
+        while (xdata.has_events() || !work.empty())
+        {
+            if (xdata.has_events())
+                x_events.step();
+            client_events.handle_queued_changes();
+        }
+    }
+
+    /**
+     * Maps new clients onto the current desktop.
+     */
+    void populate(unsigned long count)
+    {
+        for (unsigned long client = 0; client < count; client++)
+        {
+            FakeWindow desc;
+            desc.x = (client * 37) % 1000;
+            desc.y = (client * 53) % 700;
+            desc.width = 100;
+            desc.height = 100;
+
+            xdata.client_map(xdata.create_client(desc));
+            run();
+        }
+    }
+
+    /**
+     * Presses a hotkey, and lets SmallWM handle everything that follows.
+     */
+    void press(KeySym key)
+    {
+        xdata.press_key(key, xdata.primary_mod_flag, None);
+        run();
+    }
+
+    std::ofstream null_stream;
+    StreamLog logger;
+    WMConfig config;
+    Stats stats;
+    FakeXData xdata;
+    CrtManager crt_manager;
+    ChangeStream changes;
+    ClientModel clients;
+    XModel xmodel;
+    TraceWriter trace;
+    MirroredXData mirrored_xdata;
+    GrabManager grabs;
+    DeferredWork work;
+    FakeLauncher launcher;
+    EwmhPublisher ewmh;
+    EventStream events;
+    XEvents x_events;
+    ClientModelEvents client_events;
+};
+
+void bench_desktop_switch(BenchSuite &suite, unsigned long count)
+{
+    PipelineBench bench;
+    bench.populate(count);
+    bench.press(XK_period);
+    bench.populate(count);
+
+    int repeats = count >= 1000 ? 20 : 200;
+
+    suite.start();
+    for (int repeat = 0; repeat < repeats; repeat++)
+        bench.press(repeat % 2 == 0 ? XK_comma : XK_period);
+    suite.stop("desktop_switch", count, repeats);
+}
+
+int main(int argc, char **argv)
+{
+    BenchSuite suite("pipeline");
+    if (!suite.parse_args(argc, argv))
+        return 1;
+
+    if (suite.enabled("desktop_switch"))
+    {
+        for (int count = 0; count < num_client_counts; count++)
+            bench_desktop_switch(suite, client_counts[count]);
+    }
+
+    suite.report(std::cerr);
+    suite.dump(std::cout);
+    std::cout << "\n";
+    return 0;
+}
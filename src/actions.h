@@ -17,7 +17,9 @@ const unsigned int ACT_STICK = 1 << 0,
     /// Moves a client in the Y direction
     ACT_MOVE_Y = 1 << 5,
     /// Packs the window into a corner, and manages location/size automatically
-    ACT_PACK = 1 << 6;
+    ACT_PACK = 1 << 6,
+    /// Keeps the window from being focused automatically
+    ACT_NOFOCUS = 1 << 7;
 
 /**
  * A grouping of class actions which are applied to all clients of a particular class.
@@ -32,6 +34,47 @@ struct ClassActions
         pack_corner(PACK_NORTHWEST), pack_priority(0)
     {}
 
+    /**
+     * Applies another set of actions on top of this one. Anything that the
+     * other actions set replaces what is set here, and xpos/ypos and packing
+     * still exclude each other.
+     */
+    void merge(const ClassActions &other)
+    {
+        actions |= other.actions & (ACT_STICK | ACT_MAXIMIZE | ACT_NOFOCUS);
+
+        if (other.actions & ACT_SETLAYER)
+        {
+            actions |= ACT_SETLAYER;
+            layer = other.layer;
+        }
+
+        if (other.actions & ACT_SNAP)
+        {
+            actions |= ACT_SNAP;
+            snap = other.snap;
+        }
+
+        if (other.actions & ACT_MOVE_X)
+        {
+            actions = (actions | ACT_MOVE_X) & ~ACT_PACK;
+            relative_x = other.relative_x;
+        }
+
+        if (other.actions & ACT_MOVE_Y)
+        {
+            actions = (actions | ACT_MOVE_Y) & ~ACT_PACK;
+            relative_y = other.relative_y;
+        }
+
+        if (other.actions & ACT_PACK)
+        {
+            actions = (actions | ACT_PACK) & ~(ACT_MOVE_X | ACT_MOVE_Y);
+            pack_corner = other.pack_corner;
+            pack_priority = other.pack_priority;
+        }
+    }
+
     /// All the actions which are applied; the flags are the values of ACT_*.
     unsigned int actions;
 
@@ -16,7 +16,8 @@ void ClientModelEvents::map_all(const std::vector<Window> &windows)
 
 /**
  * Unmaps all the windows in the given window list, and unfocuses any that might
- * be focused.
+ * be focused. The windows are unmapped together, so that substructure events
+ * are only turned off once for all of them.
  */
 void ClientModelEvents::unmap_unfocus_all(const std::vector<Window> &windows)
 {
@@ -26,42 +27,72 @@ void ClientModelEvents::unmap_unfocus_all(const std::vector<Window> &windows)
     {
         m_xmodel.set_effect(*win, EXPECT_UNMAP);
         m_clients.unfocus_if_focused(*win);
-        m_xdata.unmap_win(*win);
     }
+
+    m_xdata.unmap_wins(windows);
 }
 
 /**
- * Raises a client first, and then puts all its children above it.
+ * Raises a client first, and then puts all its children above it. The
+ * windows are added to the stacking order, in the order they were raised.
  */
-void ClientModelEvents::raise_family(Window client)
+void ClientModelEvents::raise_family(Window client,
+        std::vector<Window> &stacking)
 {
     std::vector<Window> children;
     m_clients.get_children_of(client, children);
 
     m_xdata.raise(client);
+    stacking.push_back(client);
     for (std::vector<Window>::iterator win = children.begin();
          win != children.end();
          win++)
     {
         m_xdata.raise(*win);
+        stacking.push_back(*win);
     }
 }
 
 /**
  * Handles all the currently queued change events, returning when the
- * ClientModel change list is exhausted.
+ * ClientModel change list is exhausted and all the deferred work is done.
+ *
+ * Some deferred work (like repacking) causes more changes, so those are
+ * handled before the next task is run. Each task runs at most once - if a
+ * later task asks for one that already ran, it is run by the next call.
  */
 void ClientModelEvents::handle_queued_changes()
 {
-    m_should_relayer = false;
-    m_should_reposition_icons = false;
+    m_work.schedule(DEFER_FLUSH_GRABS);
+
+    handle_current_changes();
 
+    DeferredTask task;
+    while (m_work.pop(task))
+    {
+        run_deferred_task(task);
+        handle_current_changes();
+    }
+
+    m_work.end_batch();
+}
+
+/**
+ * Dispatches each of the changes that are currently in the change stream.
+ */
+void ClientModelEvents::handle_current_changes()
+{
     while ((m_change = m_changes.get_next()) != 0)
     {
+        m_ewmh.observe(*m_change);
+        m_events.observe(*m_change);
+
         if (m_change->is_layer_change())
             handle_layer_change();
         else if (m_change->is_focus_change())
             handle_focus_change();
+        else if (m_change->is_focus_preview_change())
+            handle_focus_preview_change();
         else if (m_change->is_client_desktop_change())
             handle_client_desktop_change();
         else if (m_change->is_current_desktop_change())
@@ -82,20 +113,44 @@ void ClientModelEvents::handle_queued_changes()
         delete m_change;
     }
 
-    if (m_should_relayer)
-        do_relayer();
+    if (m_ewmh.is_dirty())
+        m_work.schedule(DEFER_PUBLISH_EWMH);
+}
 
-    if (m_should_reposition_icons)
+/**
+ * Does a piece of follow-up work that was put off until the end of the batch.
+ */
+void ClientModelEvents::run_deferred_task(const DeferredTask &task)
+{
+    switch (task.type)
+    {
+    case DEFER_REPACK_CORNER:
+        m_clients.repack_corner(static_cast<PackCorner>(task.arg));
+        break;
+    case DEFER_RELAYER:
+        do_relayer();
+        break;
+    case DEFER_REPOSITION_ICONS:
         reposition_icons();
+        break;
+    case DEFER_FLUSH_GRABS:
+        m_grabs.flush();
+        break;
+    case DEFER_PUBLISH_EWMH:
+        m_ewmh.publish();
+        break;
+    }
 }
 
 /**
- * Sets a flag so that relayering occurs later - this avoid relayering on
- * every ChangeLayer event.
+ * Schedules a relayering for later - this avoids relayering on every
+ * ChangeLayer event.
  */
 void ClientModelEvents::handle_layer_change()
 {
-    m_should_relayer = true;
+    StatsTimer timer(m_stats, SH_LAYER_CHANGE);
+
+    m_work.schedule(DEFER_RELAYER);
 }
 
 /**
@@ -106,6 +161,8 @@ void ClientModelEvents::handle_layer_change()
  */
 void ClientModelEvents::handle_focus_change()
 {
+    StatsTimer timer(m_stats, SH_FOCUS_CHANGE);
+
     const ChangeFocus *change_event = dynamic_cast<const ChangeFocus*>(m_change);
 
     // First, unfocus whatever the model says is foucsed. Note that the
@@ -117,7 +174,7 @@ void ClientModelEvents::handle_focus_change()
         // Since this window will possibly be focused later, capture the clicks
         // going to it so we know when it needs to be focused again
         m_xdata.set_border_color(unfocused_client, X_WHITE);
-        m_xdata.grab_mouse(unfocused_client);
+        m_grabs.grab_mouse(unfocused_client);
     }
 
     Window focused_client = change_event->next_focus;
@@ -128,7 +185,7 @@ void ClientModelEvents::handle_focus_change()
         if (focused_client != None && m_xdata.set_input_focus(focused_client))
         {
             m_xdata.set_border_color(focused_client, X_BLACK);
-            m_xdata.ungrab_mouse(focused_client);
+            m_grabs.ungrab_mouse(focused_client);
         }
         else
         {
@@ -136,7 +193,7 @@ void ClientModelEvents::handle_focus_change()
 
             // Also, make sure to apply the grab to the window
             m_xdata.set_border_color(focused_client, X_WHITE);
-            m_xdata.grab_mouse(focused_client);
+            m_grabs.grab_mouse(focused_client);
         }
     }
     else
@@ -144,7 +201,43 @@ void ClientModelEvents::handle_focus_change()
 
     // Since the focus probably changed, go ahead and shuffle windows around to
     // ensure that the focused window is on top
-    m_should_relayer = true;
+    m_work.schedule(DEFER_RELAYER);
+}
+
+/**
+ * Moves the highlighted border to the window that the user is previewing
+ * while cycling through the focus history (or back to the focused window,
+ * once they're done).
+ *
+ * Nothing is focused, raised or ungrabbed here - that only happens once,
+ * when the cycle is over and the previewed window is actually focused.
+ */
+void ClientModelEvents::handle_focus_preview_change()
+{
+    StatsTimer timer(m_stats, SH_FOCUS_PREVIEW_CHANGE);
+
+    const ChangeFocusPreview *change_event =
+        dynamic_cast<const ChangeFocusPreview*>(m_change);
+
+    Window focused = m_clients.get_focused();
+    Window old_highlight = change_event->prev_preview;
+    if (old_highlight == None)
+        old_highlight = focused;
+
+    Window new_highlight = change_event->next_preview;
+    if (new_highlight == None)
+        new_highlight = focused;
+
+    if (old_highlight == new_highlight)
+        return;
+
+    if (m_clients.is_client(old_highlight) ||
+            m_clients.is_child(old_highlight))
+        m_xdata.set_border_color(old_highlight, X_WHITE);
+
+    if (m_clients.is_client(new_highlight) ||
+            m_clients.is_child(new_highlight))
+        m_xdata.set_border_color(new_highlight, X_BLACK);
 }
 
 /**
@@ -172,51 +265,59 @@ void ClientModelEvents::handle_focus_change()
  */
 void ClientModelEvents::handle_client_desktop_change()
 {
+    StatsTimer timer(m_stats, SH_CLIENT_DESKTOP_CHANGE);
+
     const ChangeClientDesktop *change = dynamic_cast<const ChangeClientDesktop*>(m_change);
 
-    Desktop *old_desktop = change->prev_desktop;
-    Desktop *new_desktop = change->next_desktop;
+    Desktop old_desktop = change->prev_desktop;
+    Desktop new_desktop = change->next_desktop;
     Window client = change->window;
 
-    // The previous desktop can be NULL if this client has been freshly mapped
-    if (!old_desktop)
+    switch (old_desktop.kind())
+    {
+    case DK_NONE:
+        // There is no previous desktop if this client has been freshly mapped
         handle_new_client_desktop_change(new_desktop, client);
-    else if (old_desktop->is_user_desktop())
+        break;
+    case DK_USER:
         handle_client_change_from_user_desktop(old_desktop, new_desktop,
                                                client);
-    else if (old_desktop->is_all_desktop())
+        break;
+    case DK_ALL:
         handle_client_change_from_all_desktop(old_desktop, new_desktop,
                                               client);
-    else if (old_desktop->is_icon_desktop())
+        break;
+    case DK_ICON:
         handle_client_change_from_icon_desktop(old_desktop, new_desktop,
                                                client);
-    else if (old_desktop->is_moving_desktop())
+        break;
+    case DK_MOVING:
         handle_client_change_from_moving_desktop(old_desktop, new_desktop,
                                                  client);
-    else if (old_desktop->is_resizing_desktop())
+        break;
+    case DK_RESIZING:
         handle_client_change_from_resizing_desktop(old_desktop, new_desktop,
                                                    client);
-    else
-        m_logger.log(LOG_WARNING) <<
-            "Unanticipated switch by " << client << " from " <<
-            old_desktop  << " to " << new_desktop << Log::endl;
+        break;
+    }
 }
 
 /**
  * Sets the desktop of a newly created client.
  *
  * In this state, the only possibilities are either a UserDesktop or an
- * IconDesktop if the window starts out minimized.
+ * IconDesktop if the window starts out minimized - or, for clients that are
+ * restored after a restart, the AllDesktops if the client was stuck.
  */
-void ClientModelEvents::handle_new_client_desktop_change(Desktop *new_desktop, Window client)
+void ClientModelEvents::handle_new_client_desktop_change(Desktop new_desktop, Window client)
 {
-    if (new_desktop->is_user_desktop())
+    if (new_desktop.is_user_desktop() || new_desktop.is_all_desktop())
     {
         bool will_be_visible = m_clients.is_visible_desktop(new_desktop);
         if (will_be_visible)
-            m_should_relayer = true;
+            m_work.schedule(DEFER_RELAYER);
     }
-    else if (new_desktop->is_icon_desktop())
+    else if (new_desktop.is_icon_desktop())
         register_new_icon(client, true);
     else
     {
@@ -240,14 +341,14 @@ void ClientModelEvents::handle_new_client_desktop_change(Desktop *new_desktop, W
  * since user desktops are the starting point for every window.
  */
 void ClientModelEvents::handle_client_change_from_user_desktop(
-                        Desktop *old_desktop,
-                        Desktop *new_desktop,
+                        Desktop old_desktop,
+                        Desktop new_desktop,
                         Window client)
 {
     std::vector<Window> children;
     m_clients.get_children_of(client, children);
 
-    if (new_desktop->is_user_desktop())
+    if (new_desktop.is_user_desktop())
     {
         bool is_currently_visible = m_clients.is_visible_desktop(old_desktop);
         bool will_be_visible = m_clients.is_visible_desktop(new_desktop);
@@ -267,7 +368,7 @@ void ClientModelEvents::handle_client_change_from_user_desktop(
             m_clients.focus(client);
 
             map_all(children);
-            m_should_relayer = true;
+            m_work.schedule(DEFER_RELAYER);
         }
         else if (!is_currently_visible && !will_be_visible)
         {
@@ -285,7 +386,7 @@ void ClientModelEvents::handle_client_change_from_user_desktop(
              * somehow break that invariant.
              */
     }
-    else if (new_desktop->is_all_desktop())
+    else if (new_desktop.is_all_desktop())
     {
         bool is_visible = m_clients.is_visible_desktop(old_desktop);
 
@@ -296,10 +397,10 @@ void ClientModelEvents::handle_client_change_from_user_desktop(
             m_clients.focus(client);
 
             map_all(children);
-            m_should_relayer = true;
+            m_work.schedule(DEFER_RELAYER);
         }
     }
-    else if (new_desktop->is_icon_desktop())
+    else if (new_desktop.is_icon_desktop())
     {
         bool is_visible = m_clients.is_visible_desktop(old_desktop);
         if (is_visible)
@@ -307,12 +408,12 @@ void ClientModelEvents::handle_client_change_from_user_desktop(
 
         register_new_icon(client, is_visible);
     }
-    else if (new_desktop->is_moving_desktop())
+    else if (new_desktop.is_moving_desktop())
     {
         unmap_unfocus_all(children);
         start_moving(client);
     }
-    else if (new_desktop->is_resizing_desktop())
+    else if (new_desktop.is_resizing_desktop())
     {
         unmap_unfocus_all(children);
         start_resizing(client);
@@ -328,14 +429,14 @@ void ClientModelEvents::handle_client_change_from_user_desktop(
  * desktop as well.
  */
 void ClientModelEvents::handle_client_change_from_all_desktop(
-                        Desktop *old_desktop,
-                        Desktop *new_desktop,
+                        Desktop old_desktop,
+                        Desktop new_desktop,
                         Window client)
 {
     std::vector<Window> children;
     m_clients.get_children_of(client, children);
 
-    if (new_desktop->is_user_desktop())
+    if (new_desktop.is_user_desktop())
     {
         bool will_be_visible = m_clients.is_visible_desktop(new_desktop);
 
@@ -346,20 +447,20 @@ void ClientModelEvents::handle_client_change_from_all_desktop(
             m_xdata.unmap_win(client);
 
             unmap_unfocus_all(children);
-            m_should_relayer = true;
+            m_work.schedule(DEFER_RELAYER);
         }
     }
-    else if (new_desktop->is_icon_desktop())
+    else if (new_desktop.is_icon_desktop())
     {
         unmap_unfocus_all(children);
         register_new_icon(client, true);
     }
-    else if (new_desktop->is_moving_desktop())
+    else if (new_desktop.is_moving_desktop())
     {
         unmap_unfocus_all(children);
         start_moving(client);
     }
-    else if (new_desktop->is_resizing_desktop())
+    else if (new_desktop.is_resizing_desktop())
     {
         unmap_unfocus_all(children);
         start_resizing(client);
@@ -372,16 +473,16 @@ void ClientModelEvents::handle_client_change_from_all_desktop(
  * is a user desktop.
  */
 void ClientModelEvents::handle_client_change_from_icon_desktop(
-                        Desktop *old_desktop,
-                        Desktop *new_desktop,
+                        Desktop old_desktop,
+                        Desktop new_desktop,
                         Window client)
 {
     std::vector<Window> children;
     m_clients.get_children_of(client, children);
 
-    if (new_desktop->is_user_desktop() || new_desktop->is_all_desktop())
+    if (new_desktop.is_user_desktop() || new_desktop.is_all_desktop())
     {
-        // Get the relevant icon information, and destroy it
+        // Get the relevant icon information, and get rid of it
         Icon *icon = m_xmodel.find_icon_from_client(client);
 
         if (!icon)
@@ -390,11 +491,7 @@ void ClientModelEvents::handle_client_change_from_icon_desktop(
                 "that is not currently iconified." << Log::endl;
         else
         {
-            m_xdata.destroy_win(icon->icon);
-            m_xmodel.unregister_icon(icon);
-
-            delete icon->gc;
-            delete icon;
+            release_icon(icon);
 
             bool will_be_visible = m_clients.is_visible_desktop(new_desktop);
 
@@ -406,7 +503,7 @@ void ClientModelEvents::handle_client_change_from_icon_desktop(
 
                 map_all(children);
             }
-            m_should_reposition_icons = true;
+            m_work.schedule(DEFER_REPOSITION_ICONS);
         }
     }
 }
@@ -416,30 +513,27 @@ void ClientModelEvents::handle_client_change_from_icon_desktop(
  * of desktop. The only supported target desktop is a user desktop.
  */
 void ClientModelEvents::handle_client_change_from_moving_desktop(
-                        Desktop *old_desktop,
-                        Desktop *new_desktop,
+                        Desktop old_desktop,
+                        Desktop new_desktop,
                         Window client)
 {
     std::vector<Window> children;
     m_clients.get_children_of(client, children);
 
-    if (new_desktop->is_user_desktop() || new_desktop->is_all_desktop())
+    if (new_desktop.is_user_desktop() || new_desktop.is_all_desktop())
     {
-        Window placeholder = m_xmodel.get_move_resize_placeholder();
-        if (placeholder == None)
+        if (m_xmodel.get_move_resize_client() != client)
             m_logger.log(LOG_ERR) <<
                 "Tried to stop moving a client (" << client << ") "
                 "that is not currently moving." << Log::endl;
         else
         {
-            XWindowAttributes placeholder_attr;
-            m_xdata.get_attributes(placeholder, placeholder_attr);
-            m_xdata.move_window(client, placeholder_attr.x,
-                                placeholder_attr.y);
+            // The outline (if any) has to be erased before the client moves,
+            // or moving the client would leave pieces of it behind
+            Box geometry = m_xmodel.get_move_resize_geometry();
+            end_drag();
 
-            m_xdata.stop_confining_pointer();
-            m_xdata.destroy_win(placeholder);
-            m_xmodel.exit_move_resize();
+            m_xdata.move_window(client, geometry.x, geometry.y);
 
             bool will_be_visible = m_clients.is_visible_desktop(new_desktop);
             if (will_be_visible)
@@ -449,7 +543,7 @@ void ClientModelEvents::handle_client_change_from_moving_desktop(
                 m_clients.focus(client);
 
                 map_all(children);
-                m_should_relayer = true;
+                m_work.schedule(DEFER_RELAYER);
             }
         }
     }
@@ -461,30 +555,25 @@ void ClientModelEvents::handle_client_change_from_moving_desktop(
  * user desktops are supported targets).
  */
 void ClientModelEvents::handle_client_change_from_resizing_desktop(
-                        Desktop *old_desktop,
-                        Desktop *new_desktop,
+                        Desktop old_desktop,
+                        Desktop new_desktop,
                         Window client)
 {
     std::vector<Window> children;
     m_clients.get_children_of(client, children);
 
-    if (new_desktop->is_user_desktop() || new_desktop->is_all_desktop())
+    if (new_desktop.is_user_desktop() || new_desktop.is_all_desktop())
     {
-        Window placeholder = m_xmodel.get_move_resize_placeholder();
-        if (placeholder == None)
+        if (m_xmodel.get_move_resize_client() != client)
             m_logger.log(LOG_ERR) <<
                 "Tried to stop resizing a client (" << client << ") "
                 "that is not currently resizing." << Log::endl;
         else
         {
-            XWindowAttributes placeholder_attr;
-            m_xdata.get_attributes(placeholder, placeholder_attr);
-            m_xdata.resize_window(client, placeholder_attr.width,
-                                  placeholder_attr.height);
+            Box geometry = m_xmodel.get_move_resize_geometry();
+            end_drag();
 
-            m_xdata.stop_confining_pointer();
-            m_xdata.destroy_win(placeholder);
-            m_xmodel.exit_move_resize();
+            m_xdata.resize_window(client, geometry.width, geometry.height);
 
             bool will_be_visible = m_clients.is_visible_desktop(new_desktop);
             if (will_be_visible)
@@ -494,7 +583,7 @@ void ClientModelEvents::handle_client_change_from_resizing_desktop(
                 m_clients.focus(client);
 
                 map_all(children);
-                m_should_relayer = true;
+                m_work.schedule(DEFER_RELAYER);
             }
         }
     }
@@ -507,76 +596,44 @@ void ClientModelEvents::handle_client_change_from_resizing_desktop(
  */
 void ClientModelEvents::handle_current_desktop_change()
 {
-    const ChangeCurrentDesktop *change = dynamic_cast<const ChangeCurrentDesktop*>(m_change);
-
-    std::vector<Window> old_desktop_list;
-    std::vector<Window> new_desktop_list;
-    m_clients.get_clients_of(change->prev_desktop, old_desktop_list);
-    m_clients.get_clients_of(change->next_desktop, new_desktop_list);
+    StatsTimer timer(m_stats, SH_CURRENT_DESKTOP_CHANGE);
 
-    // The output size will have, at most, the size of its largest input
-    size_t max_output_size = std::max(old_desktop_list.size(),
-        new_desktop_list.size());
-
-    // std::set_difference requires sorted inputs
-    std::sort(old_desktop_list.begin(), old_desktop_list.end());
-    std::sort(new_desktop_list.begin(), new_desktop_list.end());
+    const ChangeCurrentDesktop *change = dynamic_cast<const ChangeCurrentDesktop*>(m_change);
 
     std::vector<Window> to_make_invisible;
     std::vector<Window> to_make_visible;
-
-    // Fill out all of the output vectors to the length of the input iterators,
-    // so that std::set_difference has somewhere to put the data
-    to_make_invisible.resize(max_output_size, None);
-    to_make_visible.resize(max_output_size, None);
-
-    // The old -> new set difference will produce the list of windows
-    // which are on the old desktop, but not this one - these need to be
-    // hidden
-    std::set_difference(
-        old_desktop_list.begin(), old_desktop_list.end(),
-        new_desktop_list.begin(), new_desktop_list.end(),
-        to_make_invisible.begin());
-
-    for (std::vector<Window>::iterator to_hide = to_make_invisible.begin();
-            /* The extra check that the iterator is not None is necessary,
-             * since the vector was padded with None when it was resized.
-             */
-            to_hide != to_make_invisible.end() && *to_hide != None;
-            to_hide++)
+    m_clients.get_desktop_diff(change->prev_desktop, change->next_desktop,
+                               to_make_invisible, to_make_visible);
+
+    // Children go along with their parents, so collect everything that has
+    // to change before sending any requests
+    std::vector<Window> to_hide;
+    std::vector<Window> to_show;
+    for (std::vector<Window>::iterator client = to_make_invisible.begin();
+            client != to_make_invisible.end();
+            client++)
     {
-        m_xmodel.set_effect(*to_hide, EXPECT_UNMAP);
-        m_xdata.unmap_win(*to_hide);
-
-        std::vector<Window> children;
-        m_clients.get_children_of(*to_hide, children);
-        unmap_unfocus_all(children);
+        to_hide.push_back(*client);
+        m_clients.get_children_of(*client, to_hide);
     }
 
-    // The new -> old set difference will produce the list of windows which
-    // are on the new desktop, but not on the old - these need to be made
-    // visible
-    std::set_difference(
-        new_desktop_list.begin(), new_desktop_list.end(),
-        old_desktop_list.begin(), old_desktop_list.end(),
-        to_make_visible.begin());
-
-    for (std::vector<Window>::iterator to_show = to_make_visible.begin();
-            to_show != to_make_visible.end() && *to_show != None;
-            to_show++)
+    for (std::vector<Window>::iterator client = to_make_visible.begin();
+            client != to_make_visible.end();
+            client++)
     {
-        m_xmodel.set_effect(*to_show, EXPECT_MAP);
-        m_xdata.map_win(*to_show);
-
-        std::vector<Window> children;
-        m_clients.get_children_of(*to_show, children);
-        map_all(children);
+        to_show.push_back(*client);
+        m_clients.get_children_of(*client, to_show);
     }
 
+    // The new desktop is mapped before the old one is unmapped, so that the
+    // root window doesn't show through between the two
+    map_all(to_show);
+    unmap_unfocus_all(to_hide);
+
     // Since we've made some windows visible and some others invisible, we've
     // invalidated the previous stacking order, so restack everything according
     // to what is now visible
-    m_should_relayer = true;
+    m_work.schedule(DEFER_RELAYER);
 }
 
 /**
@@ -584,6 +641,8 @@ void ClientModelEvents::handle_current_desktop_change()
  */
 void ClientModelEvents::handle_screen_change()
 {
+    StatsTimer timer(m_stats, SH_SCREEN_CHANGE);
+
     const ChangeScreen *change = dynamic_cast<const ChangeScreen*>(m_change);
 
     Window client = change->window;
@@ -636,6 +695,8 @@ void ClientModelEvents::handle_screen_change()
  */
 void ClientModelEvents::handle_mode_change()
 {
+    StatsTimer timer(m_stats, SH_MODE_CHANGE);
+
     const ChangeCPSMode *change = dynamic_cast<const ChangeCPSMode*>(m_change);
 
     // Floating doesn't impose any position or size requirements on the window
@@ -650,6 +711,8 @@ void ClientModelEvents::handle_mode_change()
  */
 void ClientModelEvents::handle_location_change()
 {
+    StatsTimer timer(m_stats, SH_LOCATION_CHANGE);
+
     const ChangeLocation *change = dynamic_cast<const ChangeLocation*>(m_change);
 
     m_xdata.move_window(change->window, change->x, change->y);
@@ -660,6 +723,8 @@ void ClientModelEvents::handle_location_change()
  */
 void ClientModelEvents::handle_size_change()
 {
+    StatsTimer timer(m_stats, SH_SIZE_CHANGE);
+
     const ChangeSize *change = dynamic_cast<const ChangeSize *>(m_change);
 
     m_xdata.resize_window(change->window, change->w, change->h);
@@ -674,39 +739,33 @@ void ClientModelEvents::handle_size_change()
  */
 void ClientModelEvents::handle_destroy_change()
 {
+    StatsTimer timer(m_stats, SH_DESTROY_CHANGE);
+
     const DestroyChange *change = dynamic_cast<const DestroyChange*>(m_change);
     Window destroyed_window = change->window;
-    Desktop *old_desktop = change->desktop;
+    Desktop old_desktop = change->desktop;
 
-    if (old_desktop->is_icon_desktop() || old_desktop->is_moving_desktop() ||
-        old_desktop->is_resizing_desktop())
+    if (old_desktop.is_icon_desktop() || old_desktop.is_moving_desktop() ||
+        old_desktop.is_resizing_desktop())
     {
         // Note that we don't apply any changes in the client model, since the
         // desktop of the client (and its layer, etc.) are not stored any more.
         //
         // All we have to do is clean up the state left over in m_xmodel.
-        if (old_desktop->is_icon_desktop())
+        if (old_desktop.is_icon_desktop())
         {
             Icon *old_icon = m_xmodel.find_icon_from_client(destroyed_window);
-            m_xmodel.unregister_icon(old_icon);
-
-            m_xdata.destroy_win(old_icon->icon);
-            delete old_icon->gc;
-            delete old_icon;
+            release_icon(old_icon);
 
             // Since we won't be changing the ClientModel, and thus issuing a
             // ClientDesktopChange, we have to the work that it does
-            m_should_reposition_icons = true;
+            m_work.schedule(DEFER_REPOSITION_ICONS);
 
         }
-        else if (old_desktop->is_moving_desktop() ||
-                 old_desktop->is_resizing_desktop())
+        else if (old_desktop.is_moving_desktop() ||
+                 old_desktop.is_resizing_desktop())
         {
-            Window placeholder = m_xmodel.get_move_resize_placeholder();
-
-            m_xdata.stop_confining_pointer();
-            m_xdata.destroy_win(placeholder);
-            m_xmodel.exit_move_resize();
+            end_drag();
         }
     }
 }
@@ -721,16 +780,30 @@ void ClientModelEvents::handle_destroy_change()
  */
 void ClientModelEvents::register_new_icon(Window client, bool do_unmap)
 {
-    Window icon_window = m_xdata.create_window(true);
-    m_xdata.select_input(icon_window,
-        ButtonPressMask | ButtonReleaseMask | ExposureMask);
+    Icon *the_icon = m_xmodel.reuse_icon(client);
+    if (the_icon)
+    {
+        // Every icon window is set up the same way, so the only thing left
+        // over from the old icon is its contents - those are cleared when
+        // the window is mapped, and redrawn on the Expose that follows
+        m_stats.add_count(SC_ICON_POOL_HIT, 1);
+        m_xdata.map_win(the_icon->icon);
+    }
+    else
+    {
+        m_stats.add_count(SC_ICON_POOL_MISS, 1);
 
-    m_xdata.resize_window(icon_window, m_config.icon_width,
-                          m_config.icon_height);
-    m_xdata.map_win(icon_window);
+        Window icon_window = m_xdata.create_window(true);
+        m_xdata.select_input(icon_window,
+            ButtonPressMask | ButtonReleaseMask | ExposureMask);
 
-    XGC *gc = m_xdata.create_gc(icon_window);
-    Icon *the_icon = new Icon(client, icon_window, gc);
+        m_xdata.resize_window(icon_window, m_config.icon_width,
+                              m_config.icon_height);
+        m_xdata.map_win(icon_window);
+
+        XGC *gc = m_xdata.create_gc(icon_window);
+        the_icon = m_xmodel.create_icon(client, icon_window, gc);
+    }
 
     m_clients.unfocus_if_focused(client);
 
@@ -742,61 +815,163 @@ void ClientModelEvents::register_new_icon(Window client, bool do_unmap)
 
     m_xmodel.register_icon(the_icon);
 
-    m_should_reposition_icons = true;
+    m_work.schedule(DEFER_REPOSITION_ICONS);
 }
 
 /**
- * Creates and configures a placeholder window, used for moving/resizing a
- * client.
+ * Gets rid of an icon once its client is no longer iconified. The icon's
+ * window is kept around for the next client to be iconified, unless there
+ * are enough of those already.
  *
- * @param client The client to create the placeholder for.
- * @return The placeholder window.
+ * @param icon The icon to get rid of.
  */
-Window ClientModelEvents::create_placeholder(Window client)
+void ClientModelEvents::release_icon(Icon *icon)
 {
-    XWindowAttributes client_attrs;
-    m_xdata.get_attributes(client, client_attrs);
+    m_xmodel.unregister_icon(icon);
+
+    if (m_xmodel.recycle_icon(icon))
+        m_xdata.unmap_win(icon->icon);
+    else
+    {
+        m_xdata.destroy_win(icon->icon);
+        m_xmodel.destroy_icon(icon);
+    }
+}
 
+/**
+ * Gets the placeholder window, used for moving/resizing a client. The
+ * placeholder is created the first time that it is needed, and is reused
+ * after that.
+ */
+Window ClientModelEvents::get_placeholder()
+{
     // The placeholder should be ignored (create_window(true)) because it
     // is not an actual client, but an internal window that doesn't need
     // to be managed
-    Window placeholder = m_xdata.create_window(true);
-    m_xdata.move_window(placeholder, client_attrs.x, client_attrs.y);
-    m_xdata.resize_window(placeholder, client_attrs.width,
-                          client_attrs.height);
-
-    // With the window in place, show it and make sure that the cursor is
-    // glued to it, to make sure that all of the movements are captured
-    m_xdata.map_win(placeholder);
-    m_xdata.confine_pointer(placeholder);
-
-    // Since we need the placeholder to move up, go ahead and schedule a
-    // relayering
-    m_should_relayer = true;
+    Window placeholder = m_xmodel.get_placeholder();
+    if (placeholder == None)
+    {
+        placeholder = m_xdata.create_window(true);
+        m_xmodel.set_placeholder(placeholder);
+    }
 
     return placeholder;
 }
 
 /**
- * Handles the necessary work to start moving a client.
+ * Starts moving or resizing a client, showing the client in whatever way the
+ * configured drag mode calls for.
  *
- * @param client The client window to start moving.
+ * @param client The client to start moving/resizing.
+ * @param state Whether the client is being moved or resized.
  */
-void ClientModelEvents::start_moving(Window client)
+void ClientModelEvents::begin_drag(Window client, MoveResizeState state)
 {
-    Window placeholder = create_placeholder(client);
+    Dimension pointer_x, pointer_y;
+    m_xdata.get_pointer_location(pointer_x, pointer_y);
+    Dimension2D pointer(pointer_x, pointer_y);
+
+    Window placeholder = None;
+    if (m_config.drag_mode == DRAG_PLACEHOLDER)
+        placeholder = get_placeholder();
+
+    if (state == MR_MOVE)
+        m_xmodel.enter_move(client, placeholder, pointer);
+    else
+        m_xmodel.enter_resize(client, placeholder, pointer);
+
+    // The model already knows where the client is, so there's no need to ask
+    // the server
+    Dimension2D location = m_clients.get_location(client);
+    Dimension2D size = m_clients.get_size(client);
+    Box geometry(DIM2D_X(location), DIM2D_Y(location),
+                 DIM2D_WIDTH(size), DIM2D_HEIGHT(size));
+    m_xmodel.set_move_resize_geometry(geometry);
 
-    // The placeholder needed the client's position and size - now that the
-    // placeholder is open, we can hide the client
-    m_xmodel.set_effect(client, EXPECT_UNMAP);
     m_clients.unfocus_if_focused(client);
-    m_xdata.unmap_win(client);
 
-    Dimension pointer_x, pointer_y;
-    m_xdata.get_pointer_location(pointer_x, pointer_y);
+    switch (m_config.drag_mode)
+    {
+    case DRAG_PLACEHOLDER:
+        m_xdata.move_resize_window(placeholder, geometry.x, geometry.y,
+                                   geometry.width, geometry.height);
+
+        // With the window in place, show it and make sure that the cursor is
+        // glued to it, to make sure that all of the movements are captured
+        m_xdata.map_win(placeholder);
+        m_xdata.confine_pointer(placeholder);
+
+        // The placeholder is covering the client now, so the client can be
+        // hidden
+        m_xmodel.set_effect(client, EXPECT_UNMAP);
+        m_xdata.unmap_win(client);
+
+        // Since we need the placeholder to move up, go ahead and schedule a
+        // relayering
+        m_work.schedule(DEFER_RELAYER);
+        break;
+    case DRAG_OUTLINE:
+        // The client stays where it is, and only the outline follows the
+        // pointer
+        m_xdata.confine_pointer(client);
+        m_xdata.draw_outline(geometry);
+        m_xmodel.set_move_resize_outline(geometry);
+        break;
+    case DRAG_OPAQUE:
+        m_xdata.confine_pointer(client);
+
+        // Clients like terminals can only be certain sizes, so resizing them
+        // live should stick to those sizes
+        if (state == MR_RESIZE)
+        {
+            XSizeHints hints;
+            m_xdata.get_size_hints(client, hints);
 
-    m_xmodel.enter_move(client, placeholder, Dimension2D(pointer_x,
-                                                         pointer_y));
+            Dimension2D base(0, 0), increment(1, 1);
+            if (hints.flags & PBaseSize)
+                base = Dimension2D(hints.base_width, hints.base_height);
+            if (hints.flags & PResizeInc)
+                increment = Dimension2D(hints.width_inc, hints.height_inc);
+
+            m_xmodel.set_move_resize_increments(base, increment);
+        }
+
+        m_work.schedule(DEFER_RELAYER);
+        break;
+    }
+}
+
+/**
+ * Stops moving or resizing a client, cleaning up whatever was used to show
+ * the client while it was being dragged.
+ */
+void ClientModelEvents::end_drag()
+{
+    m_xdata.stop_confining_pointer();
+
+    Box outline;
+    if (m_xmodel.get_move_resize_outline(outline))
+    {
+        m_xdata.draw_outline(outline);
+        m_xmodel.clear_move_resize_outline();
+    }
+
+    // The placeholder is kept around (unmapped) for the next move/resize
+    Window placeholder = m_xmodel.get_move_resize_placeholder();
+    if (placeholder != None)
+        m_xdata.unmap_win(placeholder);
+
+    m_xmodel.exit_move_resize();
+}
+
+/**
+ * Handles the necessary work to start moving a client.
+ *
+ * @param client The client window to start moving.
+ */
+void ClientModelEvents::start_moving(Window client)
+{
+    begin_drag(client, MR_MOVE);
 }
 
 /**
@@ -806,19 +981,7 @@ void ClientModelEvents::start_moving(Window client)
  */
 void ClientModelEvents::start_resizing(Window client)
 {
-    Window placeholder = create_placeholder(client);
-
-    // The placeholder needed the client's position and size - now that the
-    // placeholder is open, we can hide the client
-    m_xmodel.set_effect(client, EXPECT_UNMAP);
-    m_clients.unfocus_if_focused(client);
-    m_xdata.unmap_win(client);
-
-    Dimension pointer_x, pointer_y;
-    m_xdata.get_pointer_location(pointer_x, pointer_y);
-
-    m_xmodel.enter_resize(client, placeholder, Dimension2D(pointer_x,
-                                                           pointer_y));
+    begin_drag(client, MR_RESIZE);
 }
 
 /**
@@ -845,6 +1008,8 @@ void ClientModelEvents::do_relayer()
     if (focused_window != None)
         focused_layer = m_clients.find_layer(focused_window);
 
+    std::vector<Window> stacking;
+
     for (std::vector<Window>::iterator client_iter = ordered_windows.begin();
             client_iter != ordered_windows.end();
             client_iter++)
@@ -863,7 +1028,7 @@ void ClientModelEvents::do_relayer()
         if (focused_window != None &&
             current_layer > focused_layer)
         {
-            raise_family(focused_window);
+            raise_family(focused_window, stacking);
 
             // Make sure to erase the focused client, so that we don't raise
             // it more than once
@@ -871,13 +1036,15 @@ void ClientModelEvents::do_relayer()
         }
 
         if (current_client != focused_window)
-            raise_family(current_client);
+            raise_family(current_client, stacking);
     }
 
     // If we haven't cleared the focused window, then we need to raise it before
     // moving on
     if (focused_window != None)
-        raise_family(focused_window);
+        raise_family(focused_window, stacking);
+
+    m_ewmh.set_stacking(stacking);
 
     // Now, raise all the icons since they should always be above all other
     // windows so they aren't obscured
@@ -892,10 +1059,14 @@ void ClientModelEvents::do_relayer()
         m_xdata.raise(icon_win);
     }
 
-    // Don't obscure the placeholder, since the user is actively working with it
+    // Don't obscure the placeholder (or the client itself, when it is being
+    // dragged opaquely), since the user is actively working with it
     Window placeholder_win = m_xmodel.get_move_resize_placeholder();
     if (placeholder_win != None)
         m_xdata.raise(placeholder_win);
+    else if (m_config.drag_mode == DRAG_OPAQUE &&
+             m_xmodel.get_move_resize_client() != None)
+        m_xdata.raise(m_xmodel.get_move_resize_client());
 }
 
 /**
@@ -992,6 +1163,8 @@ void ClientModelEvents::update_location_size_for_cps(Window client, ClientPosSca
  */
 void ClientModelEvents::handle_unmap_change()
 {
+    StatsTimer timer(m_stats, SH_UNMAP_CHANGE);
+
     const UnmapChange *change_event = dynamic_cast<const UnmapChange*>(m_change);
 
     std::vector<Window> children;
@@ -10,7 +10,12 @@
 #include "model/x-model.h"
 #include "configparse.h"
 #include "common.h"
+#include "deferred-work.h"
+#include "event-stream.h"
+#include "ewmh.h"
+#include "grab-manager.h"
 #include "logging/logging.h"
+#include "stats.h"
 #include "utils.h"
 #include "xdata.h"
 
@@ -24,18 +29,24 @@
 class ClientModelEvents
 {
 public:
-    ClientModelEvents(WMConfig &config, Log &logger, ChangeStream &changes,
-        XData &xdata, ClientModel &clients, XModel &xmodel) :
-        m_config(config), m_xdata(xdata), m_clients(clients), m_xmodel(xmodel),
-        m_changes(changes), m_logger(logger),
-        m_change(0), m_should_relayer(false), m_should_reposition_icons(false)
+    ClientModelEvents(WMConfig &config, Log &logger, Stats &stats,
+        ChangeStream &changes, XData &xdata, GrabManager &grabs,
+        DeferredWork &work, EwmhPublisher &ewmh, EventStream &events,
+        ClientModel &clients, XModel &xmodel) :
+        m_config(config), m_xdata(xdata), m_grabs(grabs), m_work(work),
+        m_ewmh(ewmh), m_events(events), m_clients(clients), m_xmodel(xmodel),
+        m_changes(changes), m_logger(logger), m_stats(stats),
+        m_change(0)
     {};
 
     void handle_queued_changes();
 
 private:
     void register_new_icon(Window, bool);
-    Window create_placeholder(Window);
+    void release_icon(Icon*);
+    Window get_placeholder();
+    void begin_drag(Window, MoveResizeState);
+    void end_drag();
     void start_moving(Window);
     void start_resizing(Window);
     void do_relayer();
@@ -43,8 +54,12 @@ private:
     void update_focus_cycle();
     void update_location_size_for_cps(Window, ClientPosScale);
 
+    void handle_current_changes();
+    void run_deferred_task(const DeferredTask&);
+
     void handle_layer_change();
     void handle_focus_change();
+    void handle_focus_preview_change();
     void handle_client_desktop_change();
     void handle_current_desktop_change();
     void handle_screen_change();
@@ -54,16 +69,16 @@ private:
     void handle_destroy_change();
     void handle_unmap_change();
 
-    void handle_new_client_desktop_change(Desktop* const, Window);
-    void handle_client_change_from_user_desktop(Desktop* const, Desktop* const, Window);
-    void handle_client_change_from_all_desktop(Desktop* const, Desktop* const, Window);
-    void handle_client_change_from_icon_desktop(Desktop* const, Desktop* const, Window);
-    void handle_client_change_from_moving_desktop(Desktop* const, Desktop* const, Window);
-    void handle_client_change_from_resizing_desktop(Desktop* const, Desktop* const, Window);
+    void handle_new_client_desktop_change(Desktop, Window);
+    void handle_client_change_from_user_desktop(Desktop, Desktop, Window);
+    void handle_client_change_from_all_desktop(Desktop, Desktop, Window);
+    void handle_client_change_from_icon_desktop(Desktop, Desktop, Window);
+    void handle_client_change_from_moving_desktop(Desktop, Desktop, Window);
+    void handle_client_change_from_resizing_desktop(Desktop, Desktop, Window);
 
     void map_all(const std::vector<Window>&);
     void unmap_unfocus_all(const std::vector<Window>&);
-    void raise_family(Window);
+    void raise_family(Window, std::vector<Window>&);
 
     /// The stream of changes to read from
     ChangeStream &m_changes;
@@ -77,6 +92,22 @@ private:
     /// The data required to interface with Xlib
     XData &m_xdata;
 
+    /** The click grabs on each client, which are sent once all the changes
+     * have been handled */
+    GrabManager &m_grabs;
+
+    /** The follow-up work (like relayering) which is put off until all the
+     * changes have been handled, so that it is only done once per batch
+     * instead of once for every change that asks for it. */
+    DeferredWork &m_work;
+
+    /** The EWMH properties on the root window, which are kept up to date with
+     * the changes */
+    EwmhPublisher &m_ewmh;
+
+    /// The events which are sent to subscribers of the control socket
+    EventStream &m_events;
+
     /// The data model which stores the clients and data about them
     ClientModel &m_clients;
 
@@ -87,14 +118,8 @@ private:
     /// The event handler's logger
     Log &m_logger;
 
-    /** Whether or not to relayer the visible windows - this allows this class
-     * to avoid restacking windows on every `ChangeLayer`, and instead only do
-     * it once at the end of `handle_queued_changes`. */
-    bool m_should_relayer;
+    /// Where the latency of each change handler is recorded
+    Stats &m_stats;
 
-    /** Similar to `m_should_relayer`, this indicates whether the change handler
-     * should reposition all the icon windows at the end of `handle_queued_changes`.
-     */
-    bool m_should_reposition_icons;
 };
 #endif
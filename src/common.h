@@ -138,4 +138,14 @@ enum ClientPosScale
     CPS_SPLIT_BOTTOM,
     CPS_MAX, //< The window takes up the entire viewable area
 };
+
+/// The name of each ClientPosScale, for the dumps and the control socket
+const char * const CPS_NAMES[] = {
+    "floating",
+    "split-left",
+    "split-right",
+    "split-top",
+    "split-bottom",
+    "max",
+};
 #endif
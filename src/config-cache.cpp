@@ -0,0 +1,444 @@
+/** @file */
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "config-cache.h"
+#include "varint.h"
+
+static const char CACHE_MAGIC[8] = {'S', 'W', 'M', 'C', 'A', 'C', 'H', 'E'};
+
+/**
+ * Finds the modification time, size and hash of an open configuration file.
+ * This reads the whole file, so it has to be rewound before parsing it.
+ *
+ * @return true if the file could be read, false otherwise.
+ */
+bool ConfigSource::read(FILE *file)
+{
+    struct stat info;
+    if (fstat(fileno(file), &info) != 0)
+        return false;
+
+    mtime_sec = info.st_mtim.tv_sec;
+    mtime_nsec = info.st_mtim.tv_nsec;
+    size = info.st_size;
+
+    hash = 14695981039346656037ULL;
+    char buffer[4096];
+    size_t count;
+    while ((count = fread(buffer, 1, sizeof(buffer), file)) > 0)
+    {
+        for (size_t idx = 0; idx < count; idx++)
+        {
+            hash ^= static_cast<unsigned char>(buffer[idx]);
+            hash *= 1099511628211ULL;
+        }
+    }
+
+    return !ferror(file);
+}
+
+/**
+ * Writes out a cache of a configuration.
+ *
+ * @param filename Where to store the cache.
+ * @param source The configuration file that the configuration came from.
+ * @param config The parsed configuration.
+ * @return true if the cache was written, false otherwise.
+ */
+bool ConfigCacheWriter::write(const std::string &filename,
+        const ConfigSource &source, const WMConfig &config)
+{
+    m_buffer.clear();
+    m_buffer.append(CACHE_MAGIC, sizeof(CACHE_MAGIC));
+    write_uint(CONFIG_CACHE_VERSION);
+
+    write_uint(source.mtime_sec);
+    write_uint(source.mtime_nsec);
+    write_uint(source.size);
+    write_uint(source.hash);
+
+    write_uint(config.hotkey);
+    write_uint(config.drag_mode);
+    write_uint(config.drag_refresh_rate);
+    write_uint(config.cycle_mode);
+    write_uint(config.log_mask);
+    write_string(config.log_file);
+    write_string(config.shell);
+    write_uint(config.num_desktops);
+    write_uint(config.icon_width);
+    write_uint(config.icon_height);
+    write_uint(config.border_width);
+    write_uint(config.show_icons);
+    write_uint(config.launch_helper);
+    write_string(config.dump_file);
+    write_string(config.trace_file);
+    write_string(config.control_socket);
+
+    const KeyboardConfig &keys = config.key_commands;
+    write_uint(keys.action_to_binding.size());
+    for (std::map<KeyboardAction, KeyBinding>::const_iterator binding =
+             keys.action_to_binding.begin();
+         binding != keys.action_to_binding.end();
+         binding++)
+    {
+        write_uint(binding->first);
+        write_uint(binding->second.first);
+        write_uint(binding->second.second);
+    }
+
+    write_uint(keys.binding_to_action.size());
+    for (std::map<KeyBinding, KeyboardAction>::const_iterator binding =
+             keys.binding_to_action.begin();
+         binding != keys.binding_to_action.end();
+         binding++)
+    {
+        write_uint(binding->first.first);
+        write_uint(binding->first.second);
+        write_uint(binding->second);
+    }
+
+    write_uint(keys.launch_bindings.size());
+    for (std::map<KeyBinding, std::string>::const_iterator binding =
+             keys.launch_bindings.begin();
+         binding != keys.launch_bindings.end();
+         binding++)
+    {
+        write_uint(binding->first.first);
+        write_uint(binding->first.second);
+        write_string(binding->second);
+    }
+
+    write_uint(config.classactions.size());
+    for (std::map<std::string, ClassActions>::const_iterator action =
+             config.classactions.begin();
+         action != config.classactions.end();
+         action++)
+    {
+        write_string(action->first);
+        write_actions(action->second);
+    }
+
+    write_uint(config.window_rules.size());
+    for (std::vector<WindowRule>::const_iterator rule =
+             config.window_rules.begin();
+         rule != config.window_rules.end();
+         rule++)
+    {
+        write_uint(rule->literal);
+        write_uint(rule->patterns.size());
+        for (std::vector<std::pair<RuleField, std::string> >::const_iterator
+                 pattern = rule->patterns.begin();
+             pattern != rule->patterns.end();
+             pattern++)
+        {
+            write_uint(pattern->first);
+            write_string(pattern->second);
+        }
+
+        write_actions(rule->actions);
+    }
+
+    // Writing into a temporary file and renaming it means that another
+    // SmallWM starting up at the same time sees either the old cache or the
+    // new one, and never a mix of both
+    std::string temp_filename = filename + ".tmp";
+    int fd = open(temp_filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd == -1)
+        return false;
+
+    const char *data = m_buffer.data();
+    size_t remaining = m_buffer.size();
+    while (remaining > 0)
+    {
+        ssize_t written = ::write(fd, data, remaining);
+        if (written <= 0)
+        {
+            close(fd);
+            unlink(temp_filename.c_str());
+            return false;
+        }
+
+        data += written;
+        remaining -= written;
+    }
+
+    close(fd);
+    if (rename(temp_filename.c_str(), filename.c_str()) != 0)
+    {
+        unlink(temp_filename.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Writes out a set of class actions.
+ */
+void ConfigCacheWriter::write_actions(const ClassActions &action)
+{
+    write_uint(action.actions);
+    write_uint(action.snap);
+    write_uint(action.layer);
+    write_double(action.relative_x);
+    write_double(action.relative_y);
+    write_uint(action.pack_corner);
+    write_uint(action.pack_priority);
+}
+
+/**
+ * Writes an unsigned integer as a LEB128 varint.
+ */
+void ConfigCacheWriter::write_uint(uint64_t value)
+{
+    append_varint(m_buffer, value);
+}
+
+/**
+ * Writes a double, by storing its bits as an unsigned integer.
+ */
+void ConfigCacheWriter::write_double(double value)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    write_uint(bits);
+}
+
+/**
+ * Writes a length-prefixed string.
+ */
+void ConfigCacheWriter::write_string(const std::string &text)
+{
+    write_uint(text.size());
+    m_buffer.append(text);
+}
+
+/**
+ * Reads a configuration from a cache, if the cache was built from the given
+ * configuration file.
+ *
+ * @param filename The cache to read.
+ * @param source The configuration file which is being loaded.
+ * @param[out] config Where to store the configuration. If the cache can't be
+ *                    used, this may be partially filled in.
+ * @return true if the cache was valid and up to date, false otherwise.
+ */
+bool ConfigCacheReader::read(const std::string &filename,
+        const ConfigSource &source, WMConfig &config)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    size_t size = info.st_size;
+    void *mapping = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (mapping == MAP_FAILED)
+        return false;
+
+    m_pos = static_cast<const unsigned char*>(mapping);
+    m_end = m_pos + size;
+    bool is_valid = read_config(source, config);
+
+    munmap(mapping, size);
+    m_pos = 0;
+    m_end = 0;
+    return is_valid;
+}
+
+/**
+ * Decodes the contents of the cache.
+ */
+bool ConfigCacheReader::read_config(const ConfigSource &source,
+        WMConfig &config)
+{
+    if (static_cast<size_t>(m_end - m_pos) < sizeof(CACHE_MAGIC) ||
+            std::memcmp(m_pos, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0)
+        return false;
+    m_pos += sizeof(CACHE_MAGIC);
+
+    uint64_t version;
+    if (!read_uint(version) || version != CONFIG_CACHE_VERSION)
+        return false;
+
+    ConfigSource cached;
+    if (!read_uint(cached.mtime_sec) || !read_uint(cached.mtime_nsec) ||
+            !read_uint(cached.size) || !read_uint(cached.hash))
+        return false;
+
+    if (!(cached == source))
+        return false;
+
+    uint64_t show_icons, launch_helper;
+    if (!read_as(config.hotkey) ||
+            !read_as(config.drag_mode) ||
+            !read_as(config.drag_refresh_rate) ||
+            !read_as(config.cycle_mode) ||
+            !read_as(config.log_mask) ||
+            !read_string(config.log_file) ||
+            !read_string(config.shell) ||
+            !read_as(config.num_desktops) ||
+            !read_as(config.icon_width) ||
+            !read_as(config.icon_height) ||
+            !read_as(config.border_width) ||
+            !read_uint(show_icons) ||
+            !read_uint(launch_helper) ||
+            !read_string(config.dump_file) ||
+            !read_string(config.trace_file) ||
+            !read_string(config.control_socket))
+        return false;
+    config.show_icons = show_icons != 0;
+    config.launch_helper = launch_helper != 0;
+
+    KeyboardConfig &keys = config.key_commands;
+    keys.action_to_binding.clear();
+    keys.binding_to_action.clear();
+    keys.launch_bindings.clear();
+
+    uint64_t count;
+    if (!read_uint(count))
+        return false;
+
+    for (uint64_t idx = 0; idx < count; idx++)
+    {
+        KeyboardAction action;
+        KeyBinding binding;
+        if (!read_as(action) || !read_as(binding.first) ||
+                !read_as(binding.second))
+            return false;
+
+        keys.action_to_binding[action] = binding;
+    }
+
+    if (!read_uint(count))
+        return false;
+
+    for (uint64_t idx = 0; idx < count; idx++)
+    {
+        KeyBinding binding;
+        KeyboardAction action;
+        if (!read_as(binding.first) || !read_as(binding.second) ||
+                !read_as(action))
+            return false;
+
+        keys.binding_to_action[binding] = action;
+    }
+
+    if (!read_uint(count))
+        return false;
+
+    for (uint64_t idx = 0; idx < count; idx++)
+    {
+        KeyBinding binding;
+        std::string command;
+        if (!read_as(binding.first) || !read_as(binding.second) ||
+                !read_string(command))
+            return false;
+
+        keys.launch_bindings[binding] = command;
+    }
+
+    if (!read_uint(count))
+        return false;
+
+    for (uint64_t idx = 0; idx < count; idx++)
+    {
+        std::string win_class;
+        ClassActions action;
+        if (!read_string(win_class) || !read_actions(action))
+            return false;
+
+        config.classactions[win_class] = action;
+    }
+
+    if (!read_uint(count))
+        return false;
+
+    for (uint64_t idx = 0; idx < count; idx++)
+    {
+        WindowRule rule;
+        uint64_t num_patterns;
+        if (!read_as(rule.literal) || !read_uint(num_patterns))
+            return false;
+
+        for (uint64_t pattern = 0; pattern < num_patterns; pattern++)
+        {
+            uint64_t field;
+            std::string text;
+            if (!read_uint(field) || field >= RF_COUNT || !read_string(text))
+                return false;
+
+            rule.patterns.push_back(
+                std::make_pair(static_cast<RuleField>(field), text));
+        }
+
+        if (!read_actions(rule.actions))
+            return false;
+
+        config.window_rules.push_back(rule);
+    }
+
+    // Anything left over means that the cache isn't what we think it is
+    return m_pos == m_end;
+}
+
+/**
+ * Reads a set of class actions.
+ */
+bool ConfigCacheReader::read_actions(ClassActions &action)
+{
+    return read_as(action.actions) &&
+        read_as(action.snap) &&
+        read_as(action.layer) &&
+        read_double(action.relative_x) &&
+        read_double(action.relative_y) &&
+        read_as(action.pack_corner) &&
+        read_as(action.pack_priority);
+}
+
+/**
+ * Reads a LEB128 varint.
+ */
+bool ConfigCacheReader::read_uint(uint64_t &value)
+{
+    return decode_varint(m_pos, m_end, value);
+}
+
+/**
+ * Reads a double which was stored as an unsigned integer.
+ */
+bool ConfigCacheReader::read_double(double &value)
+{
+    uint64_t bits;
+    if (!read_uint(bits))
+        return false;
+
+    std::memcpy(&value, &bits, sizeof(value));
+    return true;
+}
+
+/**
+ * Reads a length-prefixed string, which is copied out of the mapping.
+ */
+bool ConfigCacheReader::read_string(std::string &text)
+{
+    uint64_t size;
+    if (!read_uint(size) || size > static_cast<uint64_t>(m_end - m_pos))
+        return false;
+
+    text.assign(reinterpret_cast<const char*>(m_pos), size);
+    m_pos += size;
+    return true;
+}
@@ -0,0 +1,110 @@
+/** @file */
+#ifndef __SMALLWM_CONFIG_CACHE__
+#define __SMALLWM_CONFIG_CACHE__
+
+#include <cstdio>
+#include <stdint.h>
+#include <string>
+
+#include "actions.h"
+#include "configparse.h"
+#include "window-rules.h"
+
+/** The version of the cache format, which is stored in each cache's header.
+ * This has to change whenever WMConfig, or the way it is parsed, changes -
+ * otherwise an old cache would be loaded as if it were still up to date. */
+const uint64_t CONFIG_CACHE_VERSION = 5;
+
+/**
+ * Identifies a single version of a configuration file. A cache is only used
+ * if the file it was built from has the same modification time, size and
+ * contents as the file being loaded.
+ */
+struct ConfigSource
+{
+    ConfigSource() :
+        mtime_sec(0), mtime_nsec(0), size(0), hash(0)
+    {}
+
+    bool read(FILE*);
+
+    bool operator==(const ConfigSource &other) const
+    {
+        return mtime_sec == other.mtime_sec &&
+            mtime_nsec == other.mtime_nsec &&
+            size == other.size &&
+            hash == other.hash;
+    }
+
+    uint64_t mtime_sec, mtime_nsec;
+    uint64_t size;
+
+    /// The FNV-1a hash of the file's contents
+    uint64_t hash;
+};
+
+/**
+ * Writes a parsed WMConfig out to a cache file, so that the next load() of the
+ * same configuration file doesn't have to parse it.
+ *
+ * The cache is a header (identifying the format and the ConfigSource it was
+ * built from) followed by every field of the WMConfig, encoded as LEB128
+ * varints and length-prefixed strings in the same way as traces. It is
+ * written to a temporary file and renamed into place, so that a reader never
+ * sees a half-written cache.
+ */
+class ConfigCacheWriter
+{
+public:
+    bool write(const std::string&, const ConfigSource&, const WMConfig&);
+
+private:
+    void write_actions(const ClassActions&);
+    void write_uint(uint64_t);
+    void write_double(double);
+    void write_string(const std::string&);
+
+    /// The contents of the cache, which are written out all at once
+    std::string m_buffer;
+};
+
+/**
+ * Reads back the caches written by ConfigCacheWriter. The cache is mapped
+ * into memory and decoded in place, rather than being read through a stream.
+ */
+class ConfigCacheReader
+{
+public:
+    ConfigCacheReader() :
+        m_pos(0), m_end(0)
+    {}
+
+    bool read(const std::string&, const ConfigSource&, WMConfig&);
+
+private:
+    bool read_config(const ConfigSource&, WMConfig&);
+    bool read_actions(ClassActions&);
+    bool read_uint(uint64_t&);
+    bool read_double(double&);
+    bool read_string(std::string&);
+
+    /// Reads an unsigned integer into a field of some other type
+    template <typename T>
+    bool read_as(T &value)
+    {
+        uint64_t raw;
+        if (!read_uint(raw))
+            return false;
+
+        value = static_cast<T>(raw);
+        return true;
+    }
+
+    /// The next byte to decode, within the mapped cache
+    const unsigned char *m_pos;
+
+    /// The end of the mapped cache
+    const unsigned char *m_end;
+};
+
+#endif
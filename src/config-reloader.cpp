@@ -0,0 +1,129 @@
+/** @file */
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "config-reloader.h"
+#include "utils.h"
+
+ConfigReloader::ConfigReloader() :
+    m_requested(0), m_finished(false), m_result(0)
+{
+    m_wakeup[0] = -1;
+    m_wakeup[1] = -1;
+
+    // Neither end should ever block - the signal handler can't wait for the
+    // event loop to drain the pipe, and the event loop can't wait for a
+    // wakeup that isn't coming
+    if (pipe(m_wakeup) == 0)
+    {
+        for (int end = 0; end < 2; end++)
+        {
+            fcntl(m_wakeup[end], F_SETFL,
+                  fcntl(m_wakeup[end], F_GETFL) | O_NONBLOCK);
+            fcntl(m_wakeup[end], F_SETFD, FD_CLOEXEC);
+        }
+    }
+}
+
+ConfigReloader::~ConfigReloader()
+{
+    if (m_worker.joinable())
+        m_worker.join();
+
+    delete m_result;
+
+    if (m_wakeup[0] != -1)
+    {
+        close(m_wakeup[0]);
+        close(m_wakeup[1]);
+    }
+}
+
+/**
+ * Asks for the configuration file to be read again. This only sets a flag and
+ * writes to a pipe, so that it is safe to call from a signal handler.
+ */
+void ConfigReloader::request()
+{
+    m_requested = 1;
+    wake();
+}
+
+/**
+ * Starts any reload that was requested, and collects any reload that has
+ * finished. This should be called from the event loop whenever wakeup_fd()
+ * is readable.
+ *
+ * @return A newly read configuration (which the caller has to delete), or
+ *         NULL if there isn't a new configuration yet.
+ */
+WMConfig *ConfigReloader::poll()
+{
+    char buffer[64];
+    while (read(m_wakeup[0], buffer, sizeof(buffer)) > 0);
+
+    WMConfig *result = 0;
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        if (m_finished)
+        {
+            result = m_result;
+            m_result = 0;
+            m_finished = false;
+        }
+    }
+
+    if (result)
+        m_worker.join();
+
+    if (m_requested && !m_worker.joinable())
+    {
+        m_requested = 0;
+        m_worker = start_thread_without_signals(&ConfigReloader::run, this);
+    }
+
+    return result;
+}
+
+/**
+ * Reads the configuration file into a new WMConfig.
+ */
+WMConfig *ConfigReloader::parse()
+{
+    WMConfig *config = new WMConfig();
+    config->load();
+    return config;
+}
+
+/**
+ * Parses the configuration file, and hands the result back to the event
+ * loop. This runs on the worker thread.
+ */
+void ConfigReloader::run()
+{
+    WMConfig *config = parse();
+
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_result = config;
+        m_finished = true;
+    }
+
+    wake();
+}
+
+/**
+ * Makes wakeup_fd() readable.
+ */
+void ConfigReloader::wake()
+{
+    // If the pipe is full, then the event loop hasn't gotten around to
+    // draining it yet - it will be woken up either way, so it doesn't matter
+    // whether the write went through
+    int saved_errno = errno;
+    char byte = 0;
+    ssize_t written = write(m_wakeup[1], &byte, 1);
+    static_cast<void>(written);
+    errno = saved_errno;
+}
@@ -0,0 +1,61 @@
+/** @file */
+#ifndef __SMALLWM_CONFIG_RELOADER__
+#define __SMALLWM_CONFIG_RELOADER__
+
+#include <csignal>
+#include <mutex>
+#include <thread>
+
+#include "configparse.h"
+
+/**
+ * Reads the configuration file again when asked to (by SIGHUP), without
+ * holding up the event loop.
+ *
+ * The file is parsed into a new WMConfig on a separate thread. When that is
+ * done, a byte is written to a pipe - the event loop waits on the read end of
+ * the pipe alongside the X connection, wakes up, and picks up the new
+ * configuration from poll(). Requests that come in while a file is being
+ * parsed are merged together, and handled once the current parse finishes.
+ */
+class ConfigReloader
+{
+public:
+    ConfigReloader();
+    virtual ~ConfigReloader();
+
+    void request();
+    WMConfig *poll();
+
+    /// The file descriptor which becomes readable when poll() has work to do
+    int wakeup_fd() const
+    { return m_wakeup[0]; }
+
+protected:
+    virtual WMConfig *parse();
+
+private:
+    void run();
+    void wake();
+
+    /// The read and write ends of the pipe used to wake up the event loop
+    int m_wakeup[2];
+
+    /** Whether a reload has been requested, but not started - this is set by
+     * the signal handler */
+    volatile sig_atomic_t m_requested;
+
+    /// The thread doing the parsing, if one has been started
+    std::thread m_worker;
+
+    /// Protects m_finished and m_result, which the worker thread writes
+    std::mutex m_lock;
+
+    /// Whether the worker has finished, and is waiting to be joined
+    bool m_finished;
+
+    /// The configuration that the worker read
+    WMConfig *m_result;
+};
+
+#endif
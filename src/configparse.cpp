@@ -1,8 +1,11 @@
 /** @file */
 #include "configparse.h"
+#include "config-cache.h"
 
 /**
- * Loads a configuration file and parses it.
+ * Loads a configuration file and parses it. If the file hasn't changed since
+ * it was last parsed, then the parsed version is loaded from the cache
+ * instead.
  */
 void WMConfig::load()
 {
@@ -11,9 +14,42 @@ void WMConfig::load()
     reset();
 
     std::string config_path = get_config_path();
-    const char *c_filename = const_cast<const char*>(config_path.c_str());
+    FILE *config_file = std::fopen(config_path.c_str(), "r");
+    if (!config_file)
+    {
+        compile_rules();
+        return;
+    }
+
+    std::string cache_path = get_cache_path();
+    ConfigSource source;
+    bool has_source = source.read(config_file);
+
+    if (has_source)
+    {
+        ConfigCacheReader cache;
+        if (cache.read(cache_path, source, *this))
+        {
+            std::fclose(config_file);
+            compile_rules();
+            return;
+        }
+
+        // The cache may have gotten partway through before finding out that
+        // it was invalid
+        reset();
+    }
+
+    std::rewind(config_file);
+    ini_parse_file(config_file, &WMConfig::config_parser, this);
+    std::fclose(config_file);
+    compile_rules();
 
-    ini_parse(c_filename, &WMConfig::config_parser, this);
+    if (has_source)
+    {
+        ConfigCacheWriter cache;
+        cache.write(cache_path, source, *this);
+    }
 }
 
 /**
@@ -27,13 +63,21 @@ void WMConfig::reset()
     icon_height = 20;
     border_width = 4;
     show_icons = true;
+    launch_helper = false;
     log_mask = LOG_UPTO(LOG_WARNING);
     hotkey = HK_MOUSE;
+    drag_mode = DRAG_PLACEHOLDER;
+    drag_refresh_rate = 60;
+    cycle_mode = CYCLE_ORDER;
     log_file = "syslog";
     dump_file = "/dev/null";
+    trace_file = "";
+    control_socket = "";
 
     key_commands.reset();
     classactions.clear();
+    window_rules.clear();
+    rules.clear();
 }
 
 /**
@@ -47,6 +91,224 @@ std::string WMConfig::get_config_path() const
     return homedir;
 }
 
+/**
+ * Gets the path to the cache of the parsed configuration file, which is kept
+ * next to the configuration file itself.
+ */
+std::string WMConfig::get_cache_path() const
+{
+    return get_config_path() + ".cache";
+}
+
+/**
+ * Parses a comma-separated list of class actions.
+ *
+ * @param value The text of the actions.
+ * @param[out] action Where the parsed actions are stored.
+ */
+void WMConfig::parse_actions(const std::string &value, ClassActions &action)
+{
+    // Make sure not to butcher the value inside the contained string, to
+    // make sure that the destructor doesn't do anything weird
+    char *copied_value = strdup(value.c_str());
+
+    // All the configuration options are separated by commas
+    char *option = strtok(copied_value, ",");
+
+    // Catch an empty configuration setting (which returns NULL) before it
+    // gets into the loop below, which will cause a crash
+    if (!option)
+    {
+        free(copied_value);
+        return;
+    }
+
+    // The configuration values are stripped of spaces
+    char *stripped;
+    int opt_length;
+    do
+    {
+        opt_length = std::strlen(option);
+
+        stripped = new char[opt_length + 1];
+        strip_string(option, " \n\r\t", stripped);
+
+        if (!strcmp(stripped, "stick"))
+        {
+            action.actions |= ACT_STICK;
+        }
+        else if (!strcmp(stripped, "maximize"))
+        {
+            action.actions |= ACT_MAXIMIZE;
+        }
+        else if (!strcmp(stripped, "snap:left"))
+        {
+            action.actions |= ACT_SNAP;
+            action.snap = DIR_LEFT;
+        }
+        else if (!strcmp(stripped, "snap:right"))
+        {
+            action.actions |= ACT_SNAP;
+            action.snap = DIR_RIGHT;
+        }
+        else if (!strcmp(stripped, "snap:top"))
+        {
+            action.actions |= ACT_SNAP;
+            action.snap = DIR_TOP;
+        }
+        else if (!strcmp(stripped, "snap:bottom"))
+        {
+            action.actions |= ACT_SNAP;
+            action.snap = DIR_BOTTOM;
+        }
+        else if (!strncmp(stripped, "layer:", 6))
+        {
+            Layer layer = strtoul(stripped + 6, NULL, 0);
+            if (layer >= MIN_LAYER && layer <= MAX_LAYER)
+            {
+                action.actions |= ACT_SETLAYER;
+                action.layer = layer;
+            }
+        }
+        else if (!strncmp(stripped, "xpos:", 5))
+        {
+            double relative_x = strtod(stripped + 5, NULL) / 100.0;
+            if (relative_x > 0.0 && relative_x < 1.0)
+            {
+                action.actions |= ACT_MOVE_X;
+                action.relative_x = relative_x;
+
+                // Since this overrides packing, disable it
+                action.actions &= ~ACT_PACK;
+            }
+        }
+        else if (!strncmp(stripped, "ypos:", 5))
+        {
+            double relative_y = strtod(stripped + 5, NULL) / 100.0;
+            if (relative_y > 0.0 && relative_y < 1.0)
+            {
+                action.actions |= ACT_MOVE_Y;
+                action.relative_y = relative_y;
+
+                // Since this overrides packing, disable it
+                action.actions &= ~ACT_PACK;
+            }
+        }
+        else if (!strcmp(stripped, "nofocus"))
+        {
+            action.actions |= ACT_NOFOCUS;
+        }
+        else if (!strncmp(stripped, "pack:", 5))
+        {
+            bool is_valid = true;
+            if (!strncmp(stripped + 5, "NW", 2))
+                action.pack_corner = PACK_NORTHWEST;
+            else if (!strncmp(stripped + 5, "NE", 2))
+                action.pack_corner = PACK_NORTHEAST;
+            else if (!strncmp(stripped + 5, "SW", 2))
+                action.pack_corner = PACK_SOUTHWEST;
+            else if (!strncmp(stripped + 5, "SE", 2))
+                action.pack_corner = PACK_SOUTHEAST;
+            else
+                is_valid = false;
+
+            if (is_valid)
+            {
+                action.actions |= ACT_PACK;
+                action.pack_priority = try_parse_ulong(stripped + 7, action.pack_corner);
+
+                // Since this overrides xpos/ypos, get rid of those
+                action.actions &= ~ACT_MOVE_X;
+                action.actions &= ~ACT_MOVE_Y;
+            }
+        }
+
+        delete[] stripped;
+    } while (option = strtok(NULL, ","));
+
+    free(copied_value);
+}
+
+/**
+ * Parses a window rule, which is a list of 'field:pattern' matchers separated
+ * by spaces, followed by '->' and the list of actions to apply.
+ *
+ * @param value The text of the rule.
+ * @param[out] rule The parsed rule.
+ * @return Whether or not the rule is valid.
+ */
+bool WMConfig::parse_rule(const std::string &value, WindowRule &rule)
+{
+    size_t arrow = value.find("->");
+    if (arrow == std::string::npos)
+        return false;
+
+    std::istringstream matchers(value.substr(0, arrow));
+    std::string matcher;
+    while (matchers >> matcher)
+    {
+        size_t colon = matcher.find(':');
+        if (colon == std::string::npos)
+            return false;
+
+        std::string field = matcher.substr(0, colon);
+        std::string pattern = matcher.substr(colon + 1);
+
+        RuleField rule_field;
+        if (field == std::string("class"))
+            rule_field = RF_CLASS;
+        else if (field == std::string("instance"))
+            rule_field = RF_INSTANCE;
+        else if (field == std::string("title"))
+            rule_field = RF_TITLE;
+        else if (field == std::string("role"))
+            rule_field = RF_ROLE;
+        else if (field == std::string("type"))
+            rule_field = RF_TYPE;
+        else
+            return false;
+
+        rule.patterns.push_back(std::make_pair(rule_field, pattern));
+    }
+
+    // A rule without any patterns would apply to every window, which is
+    // almost certainly a mistake
+    if (rule.patterns.empty())
+        return false;
+
+    parse_actions(value.substr(arrow + 2), rule.actions);
+    return true;
+}
+
+/**
+ * Builds the window rules out of the [actions] and [rules] sections. The
+ * [actions] section comes first, so that the more specific [rules] can
+ * override it.
+ */
+void WMConfig::compile_rules()
+{
+    rules.clear();
+
+    for (std::map<std::string, ClassActions>::iterator action =
+             classactions.begin();
+         action != classactions.end();
+         action++)
+    {
+        WindowRule rule;
+        rule.literal = true;
+        rule.patterns.push_back(std::make_pair(RF_CLASS, action->first));
+        rule.actions = action->second;
+        rules.add_rule(rule);
+    }
+
+    for (std::vector<WindowRule>::iterator rule = window_rules.begin();
+         rule != window_rules.end();
+         rule++)
+        rules.add_rule(*rule);
+
+    rules.compile();
+}
+
 /**
  * A callback for the inih library, which handles a singular key-value pair.
  *
@@ -96,6 +358,28 @@ int WMConfig::config_parser(void *user, const char *c_section,
             else
                 self->hotkey = HK_MOUSE;
         }
+        else if (name == std::string("drag-mode"))
+        {
+            if (value == std::string("outline"))
+                self->drag_mode = DRAG_OUTLINE;
+            else if (value == std::string("opaque"))
+                self->drag_mode = DRAG_OPAQUE;
+            else
+                self->drag_mode = DRAG_PLACEHOLDER;
+        }
+        else if (name == std::string("drag-refresh-rate"))
+        {
+            unsigned long old_value = self->drag_refresh_rate;
+            self->drag_refresh_rate =
+                try_parse_ulong_nonzero(value.c_str(), old_value);
+        }
+        else if (name == std::string("cycle-mode"))
+        {
+            if (value == std::string("recent"))
+                self->cycle_mode = CYCLE_RECENT;
+            else
+                self->cycle_mode = CYCLE_ORDER;
+        }
         else if (name == std::string("shell"))
         {
             if (value.size() > 0)
@@ -133,136 +417,39 @@ int WMConfig::config_parser(void *user, const char *c_section,
             if (value.size() > 0)
                 self->dump_file = value;
         }
+        else if (name == std::string("trace-file"))
+        {
+            self->trace_file = value;
+        }
+        else if (name == std::string("control-socket"))
+        {
+            self->control_socket = value;
+        }
+        else if (name == std::string("launch-helper"))
+        {
+            bool old_value = self->launch_helper;
+            self->launch_helper =
+                try_parse_ulong(value.c_str(),
+                     static_cast<unsigned long>(old_value)) != 0;
+        }
     }
 
     else if (section == std::string("actions"))
     {
         ClassActions action;
-
-        // Make sure not to butcher the value inside the contained string, to
-        // make sure that the destructor doesn't do anything weird
-        char *copied_value = strdup(value.c_str());
-
-        // All the configuration options are separated by commas
-        char *option = strtok(copied_value, ",");
-
-        // Catch an empty configuration setting (which returns NULL) before it
-        // gets into the loop below, which will cause a crash. However, we still
-        // have to assign the empty ClassAction, so we can't just return here.
-        if (!option)
-            goto finish_actions;
-
-        // The configuration values are stripped of spaces
-        char *stripped;
-        int opt_length;
-        do
-        {
-            opt_length = std::strlen(option);
-
-            stripped = new char[opt_length];
-            strip_string(option, " \n\r\t", stripped);
-
-            if (!strcmp(stripped, "stick"))
-            {
-                action.actions |= ACT_STICK;
-            }
-            else if (!strcmp(stripped, "maximize"))
-            {
-                action.actions |= ACT_MAXIMIZE;
-            }
-            else if (!strcmp(stripped, "snap:left"))
-            {
-                action.actions |= ACT_SNAP;
-                action.snap = DIR_LEFT;
-            }
-            else if (!strcmp(stripped, "snap:right"))
-            {
-                action.actions |= ACT_SNAP;
-                action.snap = DIR_RIGHT;
-            }
-            else if (!strcmp(stripped, "snap:top"))
-            {
-                action.actions |= ACT_SNAP;
-                action.snap = DIR_TOP;
-            }
-            else if (!strcmp(stripped, "snap:bottom"))
-            {
-                action.actions |= ACT_SNAP;
-                action.snap = DIR_BOTTOM;
-            }
-            else if (!strncmp(stripped, "layer:", 6))
-            {
-                Layer layer = strtoul(stripped + 6, NULL, 0);
-                if (layer >= MIN_LAYER && layer <= MAX_LAYER)
-                {
-                    action.actions |= ACT_SETLAYER;
-                    action.layer = layer;
-                }
-            }
-            else if (!strncmp(stripped, "xpos:", 5))
-            {
-                double relative_x = strtod(stripped + 5, NULL) / 100.0;
-                if (relative_x > 0.0 && relative_x < 1.0)
-                {
-                    action.actions |= ACT_MOVE_X;
-                    action.relative_x = relative_x;
-
-                    // Since this overrides packing, disable it
-                    action.actions &= ~ACT_PACK;
-                }
-            }
-            else if (!strncmp(stripped, "ypos:", 5))
-            {
-                double relative_y = strtod(stripped + 5, NULL) / 100.0;
-                if (relative_y > 0.0 && relative_y < 1.0)
-                {
-                    action.actions |= ACT_MOVE_Y;
-                    action.relative_y = relative_y;
-
-                    // Since this overrides packing, disable it
-                    action.actions &= ~ACT_PACK;
-                }
-            }
-            else if (!strcmp(stripped, "nofocus"))
-            {
-                // This looks different, because it is not an action, but a
-                // persistent setting which is respected in multiple places
-                self->no_autofocus.push_back(name);
-            }
-            else if (!strncmp(stripped, "pack:", 5))
-            {
-                bool is_valid = true;
-                if (!strncmp(stripped + 5, "NW", 2))
-                    action.pack_corner = PACK_NORTHWEST;
-                else if (!strncmp(stripped + 5, "NE", 2))
-                    action.pack_corner = PACK_NORTHEAST;
-                else if (!strncmp(stripped + 5, "SW", 2))
-                    action.pack_corner = PACK_SOUTHWEST;
-                else if (!strncmp(stripped + 5, "SE", 2))
-                    action.pack_corner = PACK_SOUTHEAST;
-                else
-                    is_valid = false;
-
-                if (is_valid)
-                {
-                    action.actions |= ACT_PACK;
-                    action.pack_priority = try_parse_ulong(stripped + 7, action.pack_corner);
-
-                    // Since this overrides xpos/ypos, get rid of those
-                    action.actions &= ~ACT_MOVE_X;
-                    action.actions &= ~ACT_MOVE_Y;
-                }
-            }
-
-            delete[] stripped;
-        } while (option = strtok(NULL, ","));
-
-
-finish_actions:
-        free(copied_value);
+        parse_actions(value, action);
         self->classactions[name] = action;
     }
 
+    // Each rule is given as 'name = field:pattern ... -> actions', where the
+    // name is only there to keep the rules apart
+    else if (section == std::string("rules"))
+    {
+        WindowRule rule;
+        if (parse_rule(value, rule))
+            self->window_rules.push_back(rule);
+    }
+
     // All of the keyboard bindings are handled here - see configparse.h, and
     // more specifically KeyboardConfig.
     else if (section == std::string("keyboard"))
@@ -284,7 +471,10 @@ finish_actions:
         KeyBinding binding(key, uses_secondary_action);
 
         // If this new binding is in use by another entry, then fail
-        if (kb_config.binding_to_action[binding] != INVALID_ACTION)
+        std::map<KeyBinding, KeyboardAction>::iterator existing =
+            kb_config.binding_to_action.find(binding);
+        if (existing != kb_config.binding_to_action.end() &&
+                existing->second != INVALID_ACTION)
             return 0;
 
         // If an old binding exists for this action, then remove it
@@ -296,5 +486,23 @@ finish_actions:
         kb_config.binding_to_action[binding] = action;
     }
 
+    // The name is the key (with the same '!' prefix as in the [keyboard]
+    // section), and the value is the command it runs
+    else if (section == std::string("launch"))
+    {
+        bool uses_secondary_action = (name[0] == '!');
+
+        std::string key_value = name;
+        if (uses_secondary_action)
+            key_value.erase(0, 1);
+
+        KeySym key = XStringToKeysym(key_value.c_str());
+        if (key == NoSymbol || value.empty())
+            return 0;
+
+        KeyBinding binding(key, uses_secondary_action);
+        self->key_commands.launch_bindings[binding] = value;
+    }
+
     return 0;
 }
@@ -2,9 +2,11 @@
 #ifndef __SMALLWM_CONFIG__
 #define __SMALLWM_CONFIG__
 
+#include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <map>
+#include <sstream>
 #include <string>
 #include <utility>
 #include <vector>
@@ -13,6 +15,7 @@
 #include "actions.h"
 #include "common.h"
 #include "utils.h"
+#include "window-rules.h"
 
 /**
  * The different default keyboard shortcuts.
@@ -31,7 +34,7 @@ enum KeyboardAction
     LAYER_ABOVE, LAYER_BELOW, LAYER_TOP, LAYER_BOTTOM,
     LAYER_1, LAYER_2, LAYER_3, LAYER_4, LAYER_5, LAYER_6, LAYER_7, LAYER_8, LAYER_9,
     CYCLE_FOCUS, CYCLE_FOCUS_BACK,
-    EXIT_WM
+    EXIT_WM, RESTART_WM
 };
 
 /**
@@ -70,6 +73,7 @@ struct KeyboardConfig
     {
         action_to_binding.clear();
         binding_to_action.clear();
+        launch_bindings.clear();
 
         DefaultShortcut shortcuts[] = {
             { CLIENT_NEXT_DESKTOP, "client-next-desktop", XK_bracketright, false },
@@ -105,6 +109,7 @@ struct KeyboardConfig
             { CYCLE_FOCUS, "cycle-focus", XK_Tab, false },
             { CYCLE_FOCUS_BACK, "cycle-focus-back", XK_Tab, true },
             { EXIT_WM, "exit", XK_Escape, false },
+            { RESTART_WM, "restart", XK_Escape, true },
         };
 
         int num_shortcuts = sizeof(shortcuts) / sizeof(shortcuts[0]);
@@ -132,6 +137,10 @@ struct KeyboardConfig
 
     /// A reverse mapping between KeyBindings and KeyboardActions
     std::map<KeyBinding, KeyboardAction> binding_to_action;
+
+    /** The commands run by the keys in the [launch] section. Keys which are
+     * also bound to an action run the action instead. */
+    std::map<KeyBinding, std::string> launch_bindings;
 };
 
 /**
@@ -143,6 +152,25 @@ enum HotkeyType
     HK_MOUSE //< Hotkeys apply to the window the mouse cursor is on
 };
 
+/**
+ * What the user sees while moving or resizing a window.
+ */
+enum DragMode
+{
+    DRAG_PLACEHOLDER, //< The client is hidden, and a blank window is dragged
+    DRAG_OUTLINE, //< An outline of the client is drawn onto the root window
+    DRAG_OPAQUE //< The client itself is moved or resized as the pointer moves
+};
+
+/**
+ * Which order the focus cycling keys go through the windows in.
+ */
+enum FocusCycleMode
+{
+    CYCLE_ORDER, //< Windows are cycled in the order they were mapped
+    CYCLE_RECENT //< Windows are cycled from the most recently focused, while the modifier is held
+};
+
 /**
  * Reads and manages configuration options in the SmallWM configure option.
  */
@@ -159,6 +187,16 @@ public:
     /// The current hotkey mode
     HotkeyType hotkey;
 
+    /// How windows are shown while they are being moved or resized
+    DragMode drag_mode;
+
+    /** How many times per second a window being dragged in the opaque mode
+     * is updated */
+    unsigned long drag_refresh_rate;
+
+    /// How the focus cycling keys pick the next window
+    FocusCycleMode cycle_mode;
+
     /// The minimum message level to send to syslog
     int log_mask;
 
@@ -185,19 +223,39 @@ public:
     /// Handles all the configured class actions.
     std::map<std::string, ClassActions> classactions;
 
-    /// All of the X11 classes which should not be focusable by default
-    std::vector<std::string> no_autofocus;
+    /// The rules from the [rules] section, in the order they were given
+    std::vector<WindowRule> window_rules;
+
+    /** The rules from both the [actions] and [rules] sections, which are
+     * checked against each new window */
+    WindowRules rules;
 
     /// Whether or not to show images inside icons for hidden windows
     bool show_icons;
 
+    /** Whether programs are launched by a helper process, which is started
+     * along with SmallWM, instead of by SmallWM itself */
+    bool launch_helper;
+
     /// The filename to dump the current state to when SIGUSR1 is received
     std::string dump_file;
 
+    /// The filename to record X events into, or empty to disable recording
+    std::string trace_file;
+
+    /** The path of the socket that other programs can control SmallWM
+     * through, or empty to disable the socket */
+    std::string control_socket;
+
 protected:
     virtual std::string get_config_path() const;
+    virtual std::string get_cache_path() const;
 
 private:
+    void compile_rules();
+
+    static void parse_actions(const std::string&, ClassActions&);
+    static bool parse_rule(const std::string&, WindowRule&);
     static int config_parser(void *user, const char *c_section, const char *c_name, const char *c_value);
 };
 
@@ -0,0 +1,441 @@
+/** @file */
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "control.h"
+#include "state-dump.h"
+
+/**
+ * Whether a keyboard action applies to a single window, rather than to the
+ * window manager as a whole.
+ */
+static bool action_needs_window(KeyboardAction action)
+{
+    switch (action)
+    {
+    case NEXT_DESKTOP:
+    case PREV_DESKTOP:
+    case CYCLE_FOCUS:
+    case CYCLE_FOCUS_BACK:
+    case EXIT_WM:
+    case RESTART_WM:
+        return false;
+    default:
+        return true;
+    }
+}
+
+/**
+ * Starts listening for connections. If there is a socket left over from an
+ * earlier SmallWM, then it is replaced.
+ *
+ * @param path Where to bind the socket.
+ * @return true if the socket is listening, false otherwise.
+ */
+bool ControlServer::open(const std::string &path)
+{
+    close();
+
+    struct sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+        return false;
+    std::strcpy(address.sun_path, path.c_str());
+
+    struct stat existing;
+    if (lstat(path.c_str(), &existing) == 0 && S_ISSOCK(existing.st_mode))
+        unlink(path.c_str());
+
+    m_listener = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC,
+                        0);
+    if (m_listener == -1)
+        return false;
+
+    // Anybody who can connect can control SmallWM, so only the user running
+    // it gets to
+    mode_t old_umask = umask(077);
+    int status = bind(m_listener,
+                      reinterpret_cast<struct sockaddr*>(&address),
+                      sizeof(address));
+    umask(old_umask);
+
+    if (status == -1 || listen(m_listener, SOMAXCONN) == -1)
+    {
+        ::close(m_listener);
+        m_listener = -1;
+        return false;
+    }
+
+    m_path = path;
+    return true;
+}
+
+/**
+ * Disconnects everybody, and removes the socket.
+ */
+void ControlServer::close()
+{
+    while (!m_connections.empty())
+        close_connection(m_connections.begin()->first);
+
+    if (m_listener != -1)
+    {
+        ::close(m_listener);
+        unlink(m_path.c_str());
+        m_listener = -1;
+    }
+}
+
+/**
+ * Adds the sockets that the event loop should wait on.
+ */
+void ControlServer::get_poll_fds(std::vector<struct pollfd> &fds) const
+{
+    if (m_listener == -1)
+        return;
+
+    struct pollfd listener;
+    listener.fd = m_listener;
+    listener.events = POLLIN;
+    listener.revents = 0;
+    fds.push_back(listener);
+
+    for (std::map<int, ControlConnection>::const_iterator conn =
+             m_connections.begin();
+         conn != m_connections.end();
+         conn++)
+    {
+        struct pollfd connection;
+        connection.fd = conn->first;
+        connection.events = 0;
+        connection.revents = 0;
+
+        if (!conn->second.closing)
+            connection.events |= POLLIN;
+        if (!conn->second.output.empty() || m_events.has_pending(conn->first))
+            connection.events |= POLLOUT;
+
+        fds.push_back(connection);
+    }
+}
+
+/**
+ * Accepts new connections, and runs the requests of any connection which
+ * has sent some.
+ *
+ * @param fds The sockets from get_poll_fds(), after they have been polled.
+ */
+void ControlServer::handle(const std::vector<struct pollfd> &fds)
+{
+    for (std::vector<struct pollfd>::const_iterator fd = fds.begin();
+         fd != fds.end();
+         fd++)
+    {
+        if (fd->revents == 0)
+            continue;
+
+        if (fd->fd == m_listener)
+        {
+            accept_connections();
+            continue;
+        }
+
+        std::map<int, ControlConnection>::iterator conn =
+            m_connections.find(fd->fd);
+        if (conn == m_connections.end())
+            continue;
+
+        ControlConnection &connection = conn->second;
+        if ((fd->revents & (POLLIN | POLLHUP | POLLERR)) &&
+                !connection.closing &&
+                !read_requests(connection))
+        {
+            close_connection(fd->fd);
+            continue;
+        }
+
+        if (!flush(connection) ||
+                (connection.closing && connection.output.empty()))
+            close_connection(fd->fd);
+    }
+}
+
+/**
+ * Runs every command in a request.
+ *
+ * @param id Which connection sent the request.
+ * @param request The text of the request, without the trailing newline.
+ * @param[out] output Where the responses are appended, one line each.
+ */
+void ControlServer::execute(int id, const std::string &request,
+        std::string &output)
+{
+    std::ostringstream responses;
+
+    std::string::size_type start = 0;
+    while (start <= request.size())
+    {
+        std::string::size_type end = request.find(';', start);
+        if (end == std::string::npos)
+            end = request.size();
+
+        std::istringstream words(request.substr(start, end - start));
+        std::string command, argument, extra;
+        words >> command >> argument >> extra;
+
+        if (!command.empty())
+        {
+            if (!extra.empty())
+                responses << "error too many arguments to '" <<
+                    command << "'";
+            else
+                run_command(id, command, argument, responses);
+
+            responses << "\n";
+        }
+
+        start = end + 1;
+    }
+
+    output += responses.str();
+}
+
+/**
+ * Accepts everybody who is waiting to connect.
+ */
+void ControlServer::accept_connections()
+{
+    while (true)
+    {
+        int fd = accept4(m_listener, NULL, NULL,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1)
+            break;
+
+        m_connections[fd].fd = fd;
+    }
+}
+
+/**
+ * Reads whatever a connection has sent, and runs every complete request.
+ *
+ * @return false if the connection has to be dropped, true otherwise.
+ */
+bool ControlServer::read_requests(ControlConnection &connection)
+{
+    char buffer[4096];
+    while (true)
+    {
+        ssize_t count = recv(connection.fd, buffer, sizeof(buffer), 0);
+        if (count > 0)
+        {
+            connection.input.append(buffer, count);
+            continue;
+        }
+
+        if (count == 0)
+            connection.closing = true;
+        else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            return false;
+
+        break;
+    }
+
+    std::string::size_type start = 0;
+    std::string::size_type newline;
+    while ((newline = connection.input.find('\n', start)) !=
+            std::string::npos)
+    {
+        execute(connection.fd,
+                connection.input.substr(start, newline - start),
+                connection.output);
+        start = newline + 1;
+    }
+
+    connection.input.erase(0, start);
+
+    // Anything this long isn't a real request, and a client which doesn't
+    // read its responses can't be allowed to use up memory forever
+    return connection.input.size() <= CONTROL_MAX_REQUEST &&
+        connection.output.size() <= CONTROL_MAX_PENDING;
+}
+
+/**
+ * Sends as much of the pending output as the connection will take, followed
+ * by any events that the connection is subscribed to.
+ *
+ * @return false if the connection has to be dropped, true otherwise.
+ */
+bool ControlServer::flush(ControlConnection &connection)
+{
+    // Events are only taken once everything before them has been sent, so
+    // that they stay in the EventStream (which limits how many can pile up)
+    // while the other end isn't reading
+    if (connection.output.empty())
+        m_events.take(connection.fd, connection.output);
+
+    while (!connection.output.empty())
+    {
+        ssize_t count = send(connection.fd, connection.output.data(),
+                             connection.output.size(), MSG_NOSIGNAL);
+        if (count == -1)
+            return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+
+        connection.output.erase(0, count);
+        if (connection.output.empty())
+            m_events.take(connection.fd, connection.output);
+    }
+
+    return true;
+}
+
+/**
+ * Disconnects a single connection.
+ */
+void ControlServer::close_connection(int fd)
+{
+    m_events.unsubscribe(fd);
+    ::close(fd);
+    m_connections.erase(fd);
+}
+
+/**
+ * Runs a single command - either a query, a keyboard action, or a change to
+ * the connection's subscription.
+ *
+ * @param id Which connection sent the command.
+ * @param command The name of the command.
+ * @param argument The window (or the kinds of events, when subscribing), or
+ *                 empty if none was given.
+ * @param[out] output Where the response is written (without a newline).
+ */
+void ControlServer::run_command(int id, const std::string &command,
+        const std::string &argument, std::ostream &output)
+{
+    if (command == "subscribe")
+    {
+        unsigned int mask = EV_ALL;
+        if (!argument.empty() && !EventStream::parse_kinds(argument, mask))
+        {
+            output << "error invalid events '" << argument << "'";
+            return;
+        }
+
+        m_events.subscribe(id, mask);
+        output << "ok";
+        return;
+    }
+    else if (command == "unsubscribe")
+    {
+        m_events.unsubscribe(id);
+        output << "ok";
+        return;
+    }
+
+    // Windows can be given in either decimal or hex (with a leading 0x)
+    Window window = m_clients.get_focused();
+    if (!argument.empty())
+    {
+        window = try_parse_ulong(argument.c_str(), None);
+        if (window == None)
+        {
+            output << "error invalid window '" << argument << "'";
+            return;
+        }
+    }
+
+    if (command == "focused")
+    {
+        output << "ok ";
+        if (m_clients.get_focused() == None)
+            output << "null";
+        else
+            output << m_clients.get_focused();
+    }
+    else if (command == "desktops")
+    {
+        output << "ok {\"current\":" << m_clients.get_current_desktop()
+               << ",\"count\":" << m_config.num_desktops << "}";
+    }
+    else if (command == "clients")
+    {
+        std::vector<Window> windows;
+        m_clients.get_all_clients(windows);
+
+        output << "ok [";
+        bool is_first = true;
+        for (std::vector<Window>::iterator client = windows.begin();
+             client != windows.end();
+             client++)
+        {
+            if (!m_clients.is_client(*client))
+                continue;
+
+            if (!is_first)
+                output << ",";
+            output << *client;
+            is_first = false;
+        }
+        output << "]";
+    }
+    else if (command == "client")
+    {
+        if (!m_clients.is_client(window))
+        {
+            output << "error not a client";
+            return;
+        }
+
+        ClientState state;
+        m_clients.get_client_state(window, state);
+        output << "ok ";
+        write_client_json(output, state);
+    }
+    else if (command == "screens")
+    {
+        std::vector<Box> screens;
+        m_crt_manager.get_screen_boxes(screens);
+
+        output << "ok [";
+        for (std::vector<Box>::iterator box = screens.begin();
+             box != screens.end();
+             box++)
+        {
+            if (box != screens.begin())
+                output << ",";
+            write_box_json(output, *box);
+        }
+        output << "]";
+    }
+    else
+    {
+        std::map<std::string, KeyboardAction>::iterator action =
+            m_config.key_commands.action_names.find(command);
+        if (action == m_config.key_commands.action_names.end())
+        {
+            output << "error unknown command '" << command << "'";
+            return;
+        }
+
+        // Closing works on children too, since they're windows of their own
+        bool is_valid = m_clients.is_client(window) ||
+            ((action->second == REQUEST_CLOSE ||
+              action->second == FORCE_CLOSE) &&
+             m_clients.is_child(window));
+
+        if (action_needs_window(action->second) && !is_valid)
+        {
+            output << "error not a client";
+            return;
+        }
+
+        m_x_events.run_action(action->second, window);
+        output << "ok";
+    }
+}
@@ -0,0 +1,124 @@
+/** @file */
+#ifndef __SMALLWM_CONTROL__
+#define __SMALLWM_CONTROL__
+
+#include <map>
+#include <ostream>
+#include <poll.h>
+#include <string>
+#include <vector>
+
+#include "model/client-model.h"
+#include "model/screen.h"
+#include "configparse.h"
+#include "common.h"
+#include "event-stream.h"
+#include "utils.h"
+#include "x-events.h"
+
+/// The longest request line that a connection can send
+const size_t CONTROL_MAX_REQUEST = 4096;
+
+/** The most responses that can be waiting to be sent to a connection, before
+ * the connection is dropped */
+const size_t CONTROL_MAX_PENDING = 65536;
+
+/**
+ * A program which is connected to the control socket.
+ */
+struct ControlConnection
+{
+    ControlConnection() :
+        fd(-1), closing(false)
+    {}
+
+    /// The connected socket
+    int fd;
+
+    /// What has been read, but isn't a complete request yet
+    std::string input;
+
+    /// The responses which haven't been sent yet
+    std::string output;
+
+    /** Whether the other end has stopped sending, so that the connection
+     * should be closed once the output has been sent */
+    bool closing;
+};
+
+/**
+ * Lets other programs control SmallWM through a Unix domain socket, without
+ * going through the X server.
+ *
+ * Requests are lines of text, each of which has one or more commands
+ * separated by semicolons. Each command gets one line in response, which is
+ * either "ok" (followed by the answer, for queries) or "error" followed by
+ * the reason. Commands are either:
+ *
+ *  - The name of any keyboard action (as used in the [keyboard] section),
+ *    optionally followed by the window it applies to. Without a window, the
+ *    focused window is used.
+ *  - A query - "focused", "desktops", "clients", "client [window]" or
+ *    "screens" - whose answer is written as JSON.
+ *  - "subscribe [kinds]", which starts sending the connection events from
+ *    the EventStream (either all of them, or only the kinds given, separated
+ *    by commas), or "unsubscribe", which stops them.
+ *
+ * Everything that arrives while the event loop is asleep is run before the
+ * changes are handled, so that a batch of commands costs one pass.
+ */
+class ControlServer
+{
+public:
+    ControlServer(WMConfig &config, XEvents &x_events, ClientModel &clients,
+            CrtManager &crt_manager, EventStream &events) :
+        m_config(config), m_x_events(x_events), m_clients(clients),
+        m_crt_manager(crt_manager), m_events(events), m_listener(-1)
+    {}
+
+    ~ControlServer()
+    { close(); }
+
+    bool open(const std::string&);
+    void close();
+
+    void get_poll_fds(std::vector<struct pollfd>&) const;
+    void handle(const std::vector<struct pollfd>&);
+
+    void execute(int, const std::string&, std::string&);
+
+private:
+    void accept_connections();
+    bool read_requests(ControlConnection&);
+    bool flush(ControlConnection&);
+    void close_connection(int);
+
+    void run_command(int, const std::string&, const std::string&,
+            std::ostream&);
+
+    /// Where the names of the keyboard actions come from
+    WMConfig &m_config;
+
+    /// Where the keyboard actions are carried out
+    XEvents &m_x_events;
+
+    /// The data model which the queries are answered from
+    ClientModel &m_clients;
+
+    /// The screens which the queries are answered from
+    CrtManager &m_crt_manager;
+
+    /// Where the events for subscribed connections come from
+    EventStream &m_events;
+
+    /// The socket which accepts new connections, or -1 if it isn't open
+    int m_listener;
+
+    /// Where the listening socket is bound
+    std::string m_path;
+
+    /// The programs which are connected, by their sockets
+    std::map<int, ControlConnection> m_connections;
+};
+
+#endif
@@ -0,0 +1,69 @@
+/** @file */
+#include "deferred-work.h"
+
+/**
+ * Schedules a task to run at the end of the current batch, if it isn't
+ * already scheduled. If it already ran in this batch, it runs in the next one.
+ */
+void DeferredWork::schedule(DeferredTaskType type, int arg)
+{
+    DeferredTask task(type, arg);
+    if (m_ran.count(task) > 0)
+        m_next_batch.insert(task);
+    else
+        m_tasks.insert(task);
+}
+
+/**
+ * Checks whether or not a task is waiting to be run, in this batch or the
+ * next.
+ */
+bool DeferredWork::is_scheduled(DeferredTaskType type, int arg) const
+{
+    DeferredTask task(type, arg);
+    return m_tasks.count(task) > 0 || m_next_batch.count(task) > 0;
+}
+
+/**
+ * Checks whether or not there are no tasks waiting to be run.
+ */
+bool DeferredWork::empty() const
+{
+    return m_tasks.empty() && m_next_batch.empty();
+}
+
+/**
+ * Removes the task which should be run next, returning false if there are no
+ * tasks left.
+ */
+bool DeferredWork::pop(DeferredTask &task)
+{
+    if (m_tasks.empty())
+        return false;
+
+    task = *m_tasks.begin();
+    m_tasks.erase(m_tasks.begin());
+    m_ran.insert(task);
+    return true;
+}
+
+/**
+ * Finishes the current batch. Any tasks which were held back, because they
+ * had already run in it, are queued up for the next one.
+ */
+void DeferredWork::end_batch()
+{
+    m_ran.clear();
+    m_tasks.insert(m_next_batch.begin(), m_next_batch.end());
+    m_next_batch.clear();
+}
+
+/**
+ * Drops all the tasks which are waiting to be run.
+ */
+void DeferredWork::clear()
+{
+    m_tasks.clear();
+    m_ran.clear();
+    m_next_batch.clear();
+}
@@ -0,0 +1,91 @@
+/** @file */
+#ifndef __SMALLWM_DEFERRED_WORK__
+#define __SMALLWM_DEFERRED_WORK__
+
+#include <set>
+
+#include "common.h"
+
+/**
+ * The kinds of follow-up work which can be put off until the end of a batch
+ * of changes. They are run in the order that they are listed here.
+ */
+enum DeferredTaskType
+{
+    DEFER_REPACK_CORNER, ///< Repacks one corner (the argument is the PackCorner)
+    DEFER_RELAYER, ///< Restacks the visible windows
+    DEFER_REPOSITION_ICONS, ///< Moves all the icons into place
+    DEFER_FLUSH_GRABS, ///< Sends any changed grabs to the X server
+    DEFER_PUBLISH_EWMH ///< Writes out any EWMH properties that changed
+};
+
+/**
+ * A single piece of deferred work - two tasks with the same type and argument
+ * do the same thing, so only one of them has to be run.
+ */
+struct DeferredTask
+{
+    DeferredTask() :
+        type(DEFER_REPACK_CORNER), arg(0)
+    {}
+
+    DeferredTask(DeferredTaskType _type, int _arg) :
+        type(_type), arg(_arg)
+    {}
+
+    bool operator<(const DeferredTask &other) const
+    {
+        if (type != other.type)
+            return type < other.type;
+        return arg < other.arg;
+    }
+
+    bool operator==(const DeferredTask &other) const
+    {
+        return type == other.type && arg == other.arg;
+    }
+
+    /// What kind of work this is
+    DeferredTaskType type;
+
+    /// What the work applies to, for those kinds of work which need it
+    int arg;
+};
+
+/**
+ * Collects the expensive follow-up work that handling events and changes
+ * asks for, so that it can be done once when the batch is finished, instead
+ * of once for every request.
+ *
+ * Scheduling a task which is already pending doesn't do anything, and tasks
+ * come out in priority order (see DeferredTaskType) no matter which order they
+ * were scheduled in.
+ *
+ * Each task runs at most once per batch. Running a task can schedule one that
+ * has already come out in this batch (repositioning the icons changes the
+ * layers, which asks for another relayer) - that task is held back until
+ * end_batch() is called, and comes out in the next batch instead.
+ */
+class DeferredWork
+{
+public:
+    void schedule(DeferredTaskType, int arg=0);
+    bool is_scheduled(DeferredTaskType, int arg=0) const;
+
+    bool empty() const;
+    bool pop(DeferredTask&);
+    void end_batch();
+    void clear();
+
+private:
+    /// The tasks which haven't run yet, in the order they will run in
+    std::set<DeferredTask> m_tasks;
+
+    /// The tasks which have come out during this batch
+    std::set<DeferredTask> m_ran;
+
+    /// The tasks which were scheduled again after running in this batch
+    std::set<DeferredTask> m_next_batch;
+};
+
+#endif
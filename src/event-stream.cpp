@@ -0,0 +1,253 @@
+/** @file */
+#include <sstream>
+
+#include "event-stream.h"
+
+/**
+ * The name of each kind of event, both in the events themselves and when
+ * subscribing. These are in the same order as the bits of EventKind.
+ */
+static const char * const EVENT_NAMES[] = {
+    "focus",
+    "current-desktop",
+    "client-desktop",
+    "layer",
+    "mode",
+    "screen",
+    "destroy",
+};
+
+/**
+ * Writes where a client is - either the number of its desktop, or what kind
+ * of virtual desktop it is on.
+ */
+static void write_desktop(std::ostream &output, Desktop desktop)
+{
+    switch (desktop.kind())
+    {
+    case DK_NONE:
+        output << "null";
+        break;
+    case DK_USER:
+        output << desktop.index();
+        break;
+    case DK_ALL:
+        output << "all";
+        break;
+    case DK_ICON:
+        output << "icon";
+        break;
+    case DK_MOVING:
+        output << "moving";
+        break;
+    case DK_RESIZING:
+        output << "resizing";
+        break;
+    }
+}
+
+/**
+ * Turns a change into an event, and hands it to everybody who wants it.
+ * Changes which aren't interesting to subscribers are ignored.
+ */
+void EventStream::observe(const Change &change)
+{
+    if (m_subscribers.empty())
+        return;
+
+    std::ostringstream event;
+    EventKind kind;
+
+    if (change.is_focus_change())
+    {
+        const ChangeFocus &focus_change =
+            dynamic_cast<const ChangeFocus&>(change);
+
+        kind = EV_FOCUS;
+        if (focus_change.next_focus == None)
+            event << "null";
+        else
+            event << focus_change.next_focus;
+    }
+    else if (change.is_current_desktop_change())
+    {
+        const ChangeCurrentDesktop &desktop_change =
+            dynamic_cast<const ChangeCurrentDesktop&>(change);
+
+        kind = EV_CURRENT_DESKTOP;
+        write_desktop(event, desktop_change.next_desktop);
+    }
+    else if (change.is_client_desktop_change())
+    {
+        const ChangeClientDesktop &desktop_change =
+            dynamic_cast<const ChangeClientDesktop&>(change);
+
+        kind = EV_CLIENT_DESKTOP;
+        event << desktop_change.window << " ";
+        write_desktop(event, desktop_change.next_desktop);
+    }
+    else if (change.is_layer_change())
+    {
+        const ChangeLayer &layer_change =
+            dynamic_cast<const ChangeLayer&>(change);
+
+        kind = EV_LAYER;
+        event << layer_change.window << " " <<
+            static_cast<int>(layer_change.layer);
+    }
+    else if (change.is_mode_change())
+    {
+        const ChangeCPSMode &mode_change =
+            dynamic_cast<const ChangeCPSMode&>(change);
+
+        kind = EV_MODE;
+        event << mode_change.window << " " << CPS_NAMES[mode_change.mode];
+    }
+    else if (change.is_screen_change())
+    {
+        const ChangeScreen &screen_change =
+            dynamic_cast<const ChangeScreen&>(change);
+
+        kind = EV_SCREEN;
+        event << screen_change.window << " " <<
+            screen_change.bounds.x << " " << screen_change.bounds.y << " " <<
+            screen_change.bounds.width << " " << screen_change.bounds.height;
+    }
+    else if (change.is_destroy_change())
+    {
+        const DestroyChange &destroy_change =
+            dynamic_cast<const DestroyChange&>(change);
+
+        kind = EV_DESTROY;
+        event << destroy_change.window;
+    }
+    else
+        return;
+
+    publish(kind, event.str());
+}
+
+/**
+ * Starts sending events to a subscriber, or changes which events an existing
+ * subscriber gets.
+ *
+ * @param id Who the events are for.
+ * @param mask Which kinds of events to send (the values of EventKind).
+ */
+void EventStream::subscribe(int id, unsigned int mask)
+{
+    m_subscribers[id].mask = mask;
+}
+
+/**
+ * Stops sending events to a subscriber, and throws away any that weren't
+ * taken.
+ */
+void EventStream::unsubscribe(int id)
+{
+    m_subscribers.erase(id);
+}
+
+/**
+ * Whether a subscriber has any events waiting for it.
+ */
+bool EventStream::has_pending(int id) const
+{
+    std::map<int, EventSubscriber>::const_iterator subscriber =
+        m_subscribers.find(id);
+    if (subscriber == m_subscribers.end())
+        return false;
+
+    return !subscriber->second.pending.empty() ||
+        subscriber->second.overflowed;
+}
+
+/**
+ * Takes all of the events waiting for a subscriber, which makes room for
+ * new ones.
+ *
+ * @param id Who the events are for.
+ * @param[out] output Where the events are appended.
+ */
+void EventStream::take(int id, std::string &output)
+{
+    std::map<int, EventSubscriber>::iterator subscriber =
+        m_subscribers.find(id);
+    if (subscriber == m_subscribers.end())
+        return;
+
+    output += subscriber->second.pending;
+    subscriber->second.pending.clear();
+
+    if (subscriber->second.overflowed)
+    {
+        output += "event overflow\n";
+        subscriber->second.overflowed = false;
+    }
+}
+
+/**
+ * Reads a list of event names, separated by commas.
+ *
+ * @param text The names of the events.
+ * @param[out] mask The kinds of events that were named.
+ * @return true if every name was valid, false otherwise.
+ */
+bool EventStream::parse_kinds(const std::string &text, unsigned int &mask)
+{
+    const int num_names = sizeof(EVENT_NAMES) / sizeof(EVENT_NAMES[0]);
+
+    mask = 0;
+    std::string::size_type start = 0;
+    while (start <= text.size())
+    {
+        std::string::size_type end = text.find(',', start);
+        if (end == std::string::npos)
+            end = text.size();
+
+        std::string name = text.substr(start, end - start);
+        int kind = 0;
+        while (kind < num_names && name != EVENT_NAMES[kind])
+            kind++;
+
+        if (kind == num_names)
+            return false;
+
+        mask |= 1 << kind;
+        start = end + 1;
+    }
+
+    return true;
+}
+
+/**
+ * Adds an event to the buffer of everybody who wants it, unless their buffer
+ * is already full.
+ */
+void EventStream::publish(EventKind kind, const std::string &text)
+{
+    int index = 0;
+    while ((1 << index) != kind)
+        index++;
+
+    std::string line =
+        std::string("event ") + EVENT_NAMES[index] + " " + text + "\n";
+
+    for (std::map<int, EventSubscriber>::iterator subscriber =
+             m_subscribers.begin();
+         subscriber != m_subscribers.end();
+         subscriber++)
+    {
+        EventSubscriber &state = subscriber->second;
+        if (!(state.mask & kind) || state.overflowed)
+            continue;
+
+        // Once an event has been lost, the rest are thrown away too until the
+        // subscriber has caught up - otherwise, it would be left with gaps
+        // that it can't see
+        if (state.pending.size() + line.size() > EVENT_MAX_PENDING)
+            state.overflowed = true;
+        else
+            state.pending += line;
+    }
+}
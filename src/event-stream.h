@@ -0,0 +1,81 @@
+/** @file */
+#ifndef __SMALLWM_EVENT_STREAM__
+#define __SMALLWM_EVENT_STREAM__
+
+#include <map>
+#include <string>
+
+#include "model/changes.h"
+#include "common.h"
+
+/**
+ * The kinds of events that can be subscribed to. Each subscriber picks the
+ * kinds it wants with a mask of these.
+ */
+enum EventKind
+{
+    EV_FOCUS = 1 << 0, //< The focus moved to another window (or none)
+    EV_CURRENT_DESKTOP = 1 << 1, //< A different desktop is visible
+    EV_CLIENT_DESKTOP = 1 << 2, //< A client was added, or changed desktops
+    EV_LAYER = 1 << 3, //< A client changed layers
+    EV_MODE = 1 << 4, //< A client was maximized, snapped or made floating
+    EV_SCREEN = 1 << 5, //< A client moved to a different screen
+    EV_DESTROY = 1 << 6, //< A client went away
+    EV_ALL = (1 << 7) - 1
+};
+
+/** The most events (in bytes) that can be waiting for a subscriber, before
+ * newer events are thrown away */
+const size_t EVENT_MAX_PENDING = 16384;
+
+/**
+ * The events waiting to be sent to a single subscriber.
+ */
+struct EventSubscriber
+{
+    EventSubscriber() :
+        mask(0), overflowed(false)
+    {}
+
+    /// Which kinds of events the subscriber wants (the values of EventKind)
+    unsigned int mask;
+
+    /// The events which haven't been taken yet, one per line
+    std::string pending;
+
+    /// Whether any events were thrown away since the last take()
+    bool overflowed;
+};
+
+/**
+ * Turns the changes that the ClientModel produces into a stream of events,
+ * which other programs can subscribe to (through the control socket) instead
+ * of polling.
+ *
+ * Each event is one line, like "event focus 1234" or "event layer 1234 9".
+ * Every subscriber has its own buffer, which is only allowed to grow so far
+ * - once it is full, new events are thrown away until the subscriber catches
+ * up, and then an "event overflow" line tells it that it missed some. This
+ * way, a subscriber that stops reading can't hold up the window manager.
+ */
+class EventStream
+{
+public:
+    void observe(const Change&);
+
+    void subscribe(int, unsigned int);
+    void unsubscribe(int);
+
+    bool has_pending(int) const;
+    void take(int, std::string&);
+
+    static bool parse_kinds(const std::string&, unsigned int&);
+
+private:
+    void publish(EventKind, const std::string&);
+
+    /// Everybody who is subscribed, by the ID they subscribed with
+    std::map<int, EventSubscriber> m_subscribers;
+};
+
+#endif
@@ -0,0 +1,204 @@
+/** @file */
+#include "ewmh.h"
+
+/// The atoms of the properties, in the same order as EwmhProperty
+static const KnownAtom PROPERTY_ATOMS[EWMH_COUNT] = {
+    ATOM_NET_SUPPORTED,
+    ATOM_NET_CLIENT_LIST,
+    ATOM_NET_CLIENT_LIST_STACKING,
+    ATOM_NET_NUMBER_OF_DESKTOPS,
+    ATOM_NET_CURRENT_DESKTOP,
+    ATOM_NET_ACTIVE_WINDOW,
+    ATOM_NET_WORKAREA,
+};
+
+EwmhPublisher::EwmhPublisher(XData &xdata, ClientModel &clients, Window root,
+        unsigned long long num_desktops) :
+    m_xdata(xdata), m_clients(clients), m_root(root),
+    m_num_desktops(num_desktops), m_current_desktop(0), m_active(None),
+    m_dirty(true)
+{
+    for (int prop = 0; prop < EWMH_COUNT; prop++)
+        m_is_published[prop] = false;
+}
+
+/**
+ * Updates the state that is published, based upon a change from the
+ * ClientModel.
+ */
+void EwmhPublisher::observe(const Change &change)
+{
+    if (change.is_client_desktop_change())
+    {
+        const ChangeClientDesktop &desktop_change =
+            dynamic_cast<const ChangeClientDesktop&>(change);
+
+        // Clients moving between desktops may become hidden, which changes
+        // where they are in the stacking list
+        if (!desktop_change.prev_desktop.is_valid())
+            add_client(desktop_change.window);
+        m_dirty = true;
+    }
+    else if (change.is_child_add_change())
+    {
+        const ChildAddChange &child_change =
+            dynamic_cast<const ChildAddChange&>(change);
+        add_client(child_change.child);
+    }
+    else if (change.is_child_remove_change())
+    {
+        const ChildRemoveChange &child_change =
+            dynamic_cast<const ChildRemoveChange&>(change);
+        remove_client(child_change.child);
+    }
+    else if (change.is_destroy_change())
+    {
+        const DestroyChange &destroy_change =
+            dynamic_cast<const DestroyChange&>(change);
+        remove_client(destroy_change.window);
+    }
+    else if (change.is_focus_change())
+    {
+        const ChangeFocus &focus_change =
+            dynamic_cast<const ChangeFocus&>(change);
+        m_active = focus_change.next_focus;
+        m_dirty = true;
+    }
+    else if (change.is_current_desktop_change())
+    {
+        const ChangeCurrentDesktop &desktop_change =
+            dynamic_cast<const ChangeCurrentDesktop&>(change);
+
+        if (desktop_change.next_desktop.is_user_desktop())
+            m_current_desktop = desktop_change.next_desktop.index();
+        m_dirty = true;
+    }
+    else if (change.is_screen_change())
+        m_dirty = true;
+}
+
+/**
+ * Records the order of the visible windows after they have been restacked.
+ *
+ * @param stacking The visible windows, from bottom to top.
+ */
+void EwmhPublisher::set_stacking(const std::vector<Window> &stacking)
+{
+    if (stacking == m_stacking)
+        return;
+
+    m_stacking = stacking;
+    m_dirty = true;
+}
+
+/**
+ * Writes out every property whose contents have changed since the last time
+ * they were published.
+ */
+void EwmhPublisher::publish()
+{
+    if (!m_dirty)
+        return;
+
+    std::vector<long> value;
+
+    for (int prop = 0; prop < EWMH_COUNT; prop++)
+        value.push_back(m_xdata.get_atom(PROPERTY_ATOMS[prop]));
+    update(EWMH_SUPPORTED, XA_ATOM, value);
+
+    value.assign(m_client_list.begin(), m_client_list.end());
+    update(EWMH_CLIENT_LIST, XA_WINDOW, value);
+
+    // Windows which aren't visible aren't stacked by SmallWM, so they go
+    // underneath all the visible ones
+    std::set<Window> stacked(m_stacking.begin(), m_stacking.end());
+    value.clear();
+    for (std::vector<Window>::iterator client = m_client_list.begin();
+         client != m_client_list.end();
+         client++)
+    {
+        if (stacked.count(*client) == 0)
+            value.push_back(*client);
+    }
+
+    for (std::vector<Window>::iterator client = m_stacking.begin();
+         client != m_stacking.end();
+         client++)
+    {
+        if (m_known_clients.count(*client) > 0)
+            value.push_back(*client);
+    }
+    update(EWMH_CLIENT_LIST_STACKING, XA_WINDOW, value);
+
+    value.assign(1, m_num_desktops);
+    update(EWMH_NUMBER_OF_DESKTOPS, XA_CARDINAL, value);
+
+    value.assign(1, m_current_desktop);
+    update(EWMH_CURRENT_DESKTOP, XA_CARDINAL, value);
+
+    value.assign(1, m_active);
+    update(EWMH_ACTIVE_WINDOW, XA_WINDOW, value);
+
+    // SmallWM doesn't reserve any space for panels, so every desktop can use
+    // the whole of the main screen
+    const Box &screen = m_clients.get_root_screen();
+    value.clear();
+    for (unsigned long long desktop = 0; desktop < m_num_desktops; desktop++)
+    {
+        value.push_back(screen.x);
+        value.push_back(screen.y);
+        value.push_back(screen.width);
+        value.push_back(screen.height);
+    }
+    update(EWMH_WORKAREA, XA_CARDINAL, value);
+
+    m_dirty = false;
+}
+
+/**
+ * Adds a new window to the end of the client list.
+ */
+void EwmhPublisher::add_client(Window client)
+{
+    if (m_known_clients.count(client) > 0)
+        return;
+
+    m_known_clients.insert(client);
+    m_client_list.push_back(client);
+    m_dirty = true;
+}
+
+/**
+ * Removes a window from the client list.
+ */
+void EwmhPublisher::remove_client(Window client)
+{
+    if (m_known_clients.count(client) == 0)
+        return;
+
+    m_known_clients.erase(client);
+    m_client_list.erase(
+        std::find(m_client_list.begin(), m_client_list.end(), client));
+
+    if (m_active == client)
+        m_active = None;
+    m_dirty = true;
+}
+
+/**
+ * Writes a property to the root window, unless it already has the given
+ * contents.
+ */
+void EwmhPublisher::update(EwmhProperty prop, Atom type,
+        const std::vector<long> &value)
+{
+    if (m_is_published[prop] && m_published[prop] == value)
+        return;
+
+    m_is_published[prop] = true;
+    m_published[prop] = value;
+
+    // Format 32 properties are passed to Xlib as an array of longs
+    m_xdata.change_property(m_root, PROPERTY_ATOMS[prop], type,
+        reinterpret_cast<const unsigned char*>(value.data()), value.size());
+}
@@ -0,0 +1,95 @@
+/** @file */
+#ifndef __SMALLWM_EWMH__
+#define __SMALLWM_EWMH__
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+#include "model/changes.h"
+#include "model/client-model.h"
+#include "common.h"
+#include "xdata.h"
+
+/**
+ * The EWMH properties which are published on the root window.
+ */
+enum EwmhProperty
+{
+    EWMH_SUPPORTED, ///< Which of these properties are published
+    EWMH_CLIENT_LIST, ///< Every managed window, in the order they were mapped
+    EWMH_CLIENT_LIST_STACKING, ///< Every managed window, from bottom to top
+    EWMH_NUMBER_OF_DESKTOPS, ///< How many user desktops there are
+    EWMH_CURRENT_DESKTOP, ///< The index of the visible desktop
+    EWMH_ACTIVE_WINDOW, ///< The focused window, or None
+    EWMH_WORKAREA, ///< The usable area of each desktop
+    EWMH_COUNT
+};
+
+/**
+ * Publishes the state of the window manager on the root window, using the
+ * properties defined by EWMH, so that panels and pagers can read it instead
+ * of having to work it out for themselves.
+ *
+ * The state is kept here, and updated from the changes that the ClientModel
+ * produces. Nothing is sent to the X server until publish() is called (once
+ * per batch of changes), and even then only the properties whose contents
+ * differ from what was last published are written.
+ */
+class EwmhPublisher
+{
+public:
+    EwmhPublisher(XData &xdata, ClientModel &clients, Window root,
+            unsigned long long num_desktops);
+
+    void observe(const Change&);
+    void set_stacking(const std::vector<Window>&);
+
+    bool is_dirty() const
+    { return m_dirty; }
+    void publish();
+
+private:
+    void add_client(Window);
+    void remove_client(Window);
+    void update(EwmhProperty, Atom, const std::vector<long>&);
+
+    /// Where the properties are written
+    XData &m_xdata;
+
+    /// Where the work area comes from
+    ClientModel &m_clients;
+
+    /// The window that the properties are written to
+    Window m_root;
+
+    /// How many user desktops there are
+    unsigned long long m_num_desktops;
+
+    /// The index of the user desktop which is currently visible
+    unsigned long long m_current_desktop;
+
+    /// The window which currently has the focus
+    Window m_active;
+
+    /// Every managed window, in the order they were first mapped
+    std::vector<Window> m_client_list;
+
+    /// The same windows as m_client_list, for quick lookup
+    std::set<Window> m_known_clients;
+
+    /** The visible windows, from the bottom of the stack to the top, as they
+     * were last restacked */
+    std::vector<Window> m_stacking;
+
+    /// Whether anything may have changed since the last publish()
+    bool m_dirty;
+
+    /// The contents of each property, as they were last written
+    std::vector<long> m_published[EWMH_COUNT];
+
+    /// Whether each property has been written at all
+    bool m_is_published[EWMH_COUNT];
+};
+
+#endif
@@ -0,0 +1,27 @@
+/** @file */
+#ifndef __SMALLWM_FAKE_LAUNCHER__
+#define __SMALLWM_FAKE_LAUNCHER__
+
+#include <string>
+#include <vector>
+
+#include "launcher.h"
+
+/**
+ * A launcher which only remembers what it was asked to start, so that the
+ * tests and the trace replay don't start any real programs.
+ */
+class FakeLauncher : public Launcher
+{
+public:
+    bool launch(const std::string &command)
+    {
+        launched.push_back(command);
+        return true;
+    }
+
+    /// Every command that was launched, oldest first
+    std::vector<std::string> launched;
+};
+
+#endif
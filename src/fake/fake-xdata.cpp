@@ -0,0 +1,1245 @@
+/** @file */
+#include "fake/fake-xdata.h"
+
+/// The first ID given out to windows created on the fake server
+static const Window FIRST_FAKE_WINDOW = 0x100;
+
+/// The first keycode given out by press_key (X never uses keycodes below 8)
+static const int FIRST_FAKE_KEYCODE = 8;
+
+/**
+ * Counts the requests sent while clearing the window.
+ */
+void FakeGC::clear()
+{
+    m_stats.add_requests(SR_GC_CLEAR, 1);
+}
+
+/**
+ * Counts the requests sent while drawing a string.
+ */
+void FakeGC::draw_string(Dimension x, Dimension y, const std::string &text)
+{
+    if (text.size() == 0)
+        return;
+
+    m_stats.add_requests(SR_GC_DRAW_STRING, 1);
+}
+
+/**
+ * Counts the requests sent while copying a pixmap. The fake server has no
+ * pixmaps, so this never copies anything.
+ */
+Dimension2D FakeGC::copy_pixmap(Drawable pixmap, Dimension x, Dimension y)
+{
+    m_stats.add_round_trips(SR_GC_COPY_PIXMAP, 1);
+    m_stats.add_requests(SR_GC_COPY_PIXMAP, 1);
+    return Dimension2D(0, 0);
+}
+
+/**
+ * Creates a fake server with a single 1024x768 screen, and nothing on it but
+ * the root window.
+ */
+FakeXData::FakeXData(Stats &stats) :
+    m_stats(stats), m_total_requests(0), m_total_round_trips(0),
+    m_focus(None), m_confined(None), m_keyboard_grabbed(false),
+    m_pointer_x(0), m_pointer_y(0),
+    m_next_window(FIRST_FAKE_WINDOW), m_next_keycode(FIRST_FAKE_KEYCODE)
+{
+    // The XRandR offset is normally chosen by the server - anything past the
+    // core events will do
+    randr_event_offset = LASTEvent;
+
+    primary_mod_flag = Mod4Mask;
+    secondary_mod_flag = ControlMask;
+    num_mod_flag = Mod2Mask;
+    caps_mod_flag = LockMask;
+    scroll_mod_flag = 0;
+
+    FakeWindow root;
+    root.mapped = true;
+    m_windows[FAKE_ROOT] = root;
+
+    std::vector<Box> screens;
+    screens.push_back(Box(0, 0, 1024, 768));
+    set_screens(screens);
+}
+
+/**
+ * Finds the state of a window.
+ * @return The window, or NULL if it doesn't exist.
+ */
+const FakeWindow *FakeXData::find_window(Window window) const
+{
+    std::map<Window, FakeWindow>::const_iterator iter = m_windows.find(window);
+    if (iter == m_windows.end())
+        return NULL;
+
+    return &iter->second;
+}
+
+/**
+ * Gets the top-level windows, from the bottom of the stack to the top.
+ */
+void FakeXData::get_stacking(std::vector<Window> &windows) const
+{
+    windows = m_stacking;
+}
+
+/**
+ * Checks whether a keyboard hotkey has been grabbed.
+ */
+bool FakeXData::has_hotkey(KeySym key, bool use_secondary_action) const
+{
+    return m_hotkeys.count(std::make_pair(key, use_secondary_action)) > 0;
+}
+
+/**
+ * Checks whether a mouse button has been grabbed with add_hotkey_mouse.
+ */
+bool FakeXData::has_hotkey_mouse(unsigned int button) const
+{
+    return m_mouse_hotkeys.count(button) > 0;
+}
+
+/**
+ * Resets the total number of requests and round trips to zero. (The
+ * per-method counts in the Stats are left alone.)
+ */
+void FakeXData::reset_totals()
+{
+    m_total_requests = 0;
+    m_total_round_trips = 0;
+}
+
+/**
+ * Creates an unmapped top-level window, as a client would.
+ * @param desc The initial state of the window.
+ * @return The ID of the new window.
+ */
+Window FakeXData::create_client(const FakeWindow &desc)
+{
+    Window window = allocate_window();
+    add_window(window, desc);
+    return window;
+}
+
+/**
+ * Maps a window on behalf of its client. If the WM is redirecting the root's
+ * substructure, then this only asks the WM to map the window.
+ */
+void FakeXData::client_map(Window window)
+{
+    FakeWindow *state = lookup(window);
+    if (!state || state->mapped)
+        return;
+
+    if (is_redirected(window))
+    {
+        XEvent event;
+        std::memset(&event, 0, sizeof(event));
+        event.type = MapRequest;
+        event.xmaprequest.parent = FAKE_ROOT;
+        event.xmaprequest.window = window;
+        queue_event(event);
+    }
+    else
+    {
+        set_mapped(window, true);
+        notify(MapNotify, window);
+    }
+}
+
+/**
+ * Unmaps a window on behalf of its client.
+ */
+void FakeXData::client_unmap(Window window)
+{
+    FakeWindow *state = lookup(window);
+    if (!state || !state->mapped)
+        return;
+
+    set_mapped(window, false);
+    notify(UnmapNotify, window);
+}
+
+/**
+ * Moves and resizes a window on behalf of its client. If the WM is
+ * redirecting the root's substructure, then this only asks the WM to
+ * configure the window.
+ */
+void FakeXData::client_configure(Window window, int x, int y,
+        Dimension width, Dimension height)
+{
+    FakeWindow *state = lookup(window);
+    if (!state)
+        return;
+
+    XEvent event;
+    std::memset(&event, 0, sizeof(event));
+    event.type = ConfigureRequest;
+    event.xconfigurerequest.parent = FAKE_ROOT;
+    event.xconfigurerequest.window = window;
+    event.xconfigurerequest.x = x;
+    event.xconfigurerequest.y = y;
+    event.xconfigurerequest.width = width;
+    event.xconfigurerequest.height = height;
+    event.xconfigurerequest.value_mask = CWX | CWY | CWWidth | CWHeight;
+
+    if (is_redirected(window))
+        queue_event(event);
+    else
+        forward_configure_request(event, 0);
+}
+
+/**
+ * Destroys a window on behalf of its client.
+ */
+void FakeXData::client_destroy(Window window)
+{
+    FakeWindow *state = lookup(window);
+    if (!state)
+        return;
+
+    if (state->mapped)
+    {
+        set_mapped(window, false);
+        notify(UnmapNotify, window);
+    }
+
+    remove_window(window);
+    notify(DestroyNotify, window);
+}
+
+/**
+ * Presses a key while the pointer is over a window.
+ * @param key The key to press.
+ * @param state The modifiers which are held down.
+ * @param subwindow The window under the pointer, or None.
+ */
+void FakeXData::press_key(KeySym key, unsigned int state, Window subwindow)
+{
+    queue_key_event(KeyPress, key, state, subwindow);
+}
+
+/**
+ * Releases a key while the pointer is over a window.
+ * @param key The key to release.
+ * @param state The modifiers which were held down, before the release.
+ * @param subwindow The window under the pointer, or None.
+ */
+void FakeXData::release_key(KeySym key, unsigned int state, Window subwindow)
+{
+    queue_key_event(KeyRelease, key, state, subwindow);
+}
+
+/**
+ * Queues a key event on the root, giving the key a keycode if it doesn't have
+ * one yet.
+ */
+void FakeXData::queue_key_event(int type, KeySym key, unsigned int state,
+        Window subwindow)
+{
+    if (m_keycodes.count(key) == 0)
+    {
+        int keycode = m_next_keycode++;
+        m_keycodes[key] = keycode;
+        m_keysyms[keycode] = key;
+    }
+
+    XEvent event;
+    std::memset(&event, 0, sizeof(event));
+    event.type = type;
+    event.xkey.window = FAKE_ROOT;
+    event.xkey.root = FAKE_ROOT;
+    event.xkey.subwindow = subwindow;
+    event.xkey.x_root = m_pointer_x;
+    event.xkey.y_root = m_pointer_y;
+    event.xkey.state = state;
+    event.xkey.keycode = m_keycodes[key];
+    queue_event(event);
+}
+
+/**
+ * Presses a mouse button.
+ * @param button The button to press.
+ * @param state The modifiers which are held down.
+ * @param window The window which receives the event.
+ * @param subwindow The child of that window under the pointer, or None.
+ */
+void FakeXData::press_button(unsigned int button, unsigned int state,
+        Window window, Window subwindow)
+{
+    XEvent event;
+    std::memset(&event, 0, sizeof(event));
+    event.type = ButtonPress;
+    event.xbutton.window = window;
+    event.xbutton.root = FAKE_ROOT;
+    event.xbutton.subwindow = subwindow;
+    event.xbutton.x_root = m_pointer_x;
+    event.xbutton.y_root = m_pointer_y;
+    event.xbutton.state = state;
+    event.xbutton.button = button;
+    queue_event(event);
+}
+
+/**
+ * Releases a mouse button over a window.
+ */
+void FakeXData::release_button(unsigned int button, unsigned int state,
+        Window window)
+{
+    XEvent event;
+    std::memset(&event, 0, sizeof(event));
+    event.type = ButtonRelease;
+    event.xbutton.window = window;
+    event.xbutton.root = FAKE_ROOT;
+    event.xbutton.x_root = m_pointer_x;
+    event.xbutton.y_root = m_pointer_y;
+    event.xbutton.state = state;
+    event.xbutton.button = button;
+    queue_event(event);
+}
+
+/**
+ * Moves the pointer. The motion is reported to the window the pointer is
+ * confined to, or to the root otherwise.
+ */
+void FakeXData::move_pointer(int x, int y)
+{
+    set_pointer(x, y);
+
+    XEvent event;
+    std::memset(&event, 0, sizeof(event));
+    event.type = MotionNotify;
+    event.xmotion.window = m_confined != None ? m_confined : FAKE_ROOT;
+    event.xmotion.root = FAKE_ROOT;
+    event.xmotion.x_root = x;
+    event.xmotion.y_root = y;
+    queue_event(event);
+}
+
+/**
+ * Changes the screen layout, and sends out an XRandR notification.
+ */
+void FakeXData::change_screens(const std::vector<Box> &screens)
+{
+    set_screens(screens);
+
+    XEvent event;
+    std::memset(&event, 0, sizeof(event));
+    event.type = randr_event_offset + RRNotify;
+    queue_event(event);
+}
+
+/**
+ * Gives every key that has been pressed a new keycode, and sends out a
+ * MappingNotify, like xmodmap would.
+ */
+void FakeXData::change_keyboard_mapping()
+{
+    int first_keycode = m_next_keycode;
+
+    m_keysyms.clear();
+    for (std::map<KeySym, int>::iterator key = m_keycodes.begin();
+            key != m_keycodes.end();
+            key++)
+    {
+        key->second = m_next_keycode++;
+        m_keysyms[key->second] = key->first;
+    }
+
+    XEvent event;
+    std::memset(&event, 0, sizeof(event));
+    event.type = MappingNotify;
+    event.xmapping.request = MappingKeyboard;
+    event.xmapping.first_keycode = first_keycode;
+    event.xmapping.count = m_next_keycode - first_keycode;
+    queue_event(event);
+}
+
+/**
+ * Adds an event to the end of the queue.
+ */
+void FakeXData::queue_event(const XEvent &event)
+{
+    m_events.push_back(event);
+}
+
+XGC *FakeXData::create_gc(Window window)
+{
+    count(SR_CREATE_GC, 1);
+    return new FakeGC(m_stats);
+}
+
+/**
+ * Creates a new top-level window, which is unmapped and stacked on top.
+ * @param ignore Whether SmallWM should ignore the window.
+ */
+Window FakeXData::create_window(bool ignore)
+{
+    Window window = allocate_window();
+
+    FakeWindow desc;
+    desc.x = -1;
+    desc.y = -1;
+    desc.border_width = 1;
+    add_window(window, desc);
+    count(SR_CREATE_WINDOW, 1);
+
+    if (ignore)
+    {
+        XSetWindowAttributes attr;
+        attr.override_redirect = true;
+        set_attributes(window, attr, CWOverrideRedirect);
+    }
+
+    return window;
+}
+
+/**
+ * Gets one of the known atoms - these are numbered after the atoms which are
+ * predefined by the protocol, like a real server would do.
+ */
+Atom FakeXData::get_atom(KnownAtom atom)
+{
+    return XA_LAST_PREDEFINED + 1 + atom;
+}
+
+/**
+ * Sets a property on a window. Like XlibData, this assumes that the property
+ * is made up of 32-bit values, which are passed in as longs.
+ */
+void FakeXData::change_property(Window window, KnownAtom prop,
+        Atom type, const unsigned char *value, size_t elems)
+{
+    count(SR_CHANGE_PROPERTY, 1);
+
+    FakeWindow *state = lookup(window);
+    if (!state)
+        return;
+
+    const long *values = reinterpret_cast<const long*>(value);
+    state->properties[ATOM_NAMES[prop]].assign(values, values + elems);
+}
+
+/**
+ * Gets the next event from the queue. Since nothing can happen on the fake
+ * server while SmallWM is waiting, this produces an empty event (which
+ * XEvents ignores) when the queue is empty.
+ */
+void FakeXData::next_event(XEvent &event)
+{
+    if (m_events.empty())
+    {
+        count_round_trip(SR_NEXT_EVENT, 1);
+        std::memset(&event, 0, sizeof(event));
+        return;
+    }
+
+    event = m_events.front();
+    m_events.pop_front();
+}
+
+/**
+ * Waits for an event, or for one of the other file descriptors to become
+ * ready, in the same way as XlibData. The fake server has no connection to
+ * wait on, so if no events are queued, this blocks until one of the other
+ * file descriptors is ready.
+ *
+ * @return Whether an event can be read by next_event().
+ */
+bool FakeXData::wait_for_event(std::vector<struct pollfd> &others)
+{
+    poll_fds(-1, has_events(), others);
+    return has_events();
+}
+
+/**
+ * Takes every queued event of the given type out of the queue, and stores
+ * the last one.
+ */
+void FakeXData::get_latest_event(XEvent &data, int type)
+{
+    std::deque<XEvent>::iterator event = m_events.begin();
+    while (event != m_events.end())
+    {
+        if (event->type == type)
+        {
+            data = *event;
+            event = m_events.erase(event);
+        }
+        else
+            event++;
+    }
+}
+
+void FakeXData::add_hotkey(KeySym key, bool use_secondary_action)
+{
+    int lock_mods = (num_mod_flag != 0) + (caps_mod_flag != 0) +
+        (scroll_mod_flag != 0);
+    count(SR_ADD_HOTKEY, 1 << lock_mods);
+
+    m_hotkeys.insert(std::make_pair(key, use_secondary_action));
+}
+
+void FakeXData::remove_hotkey(KeySym key, bool use_secondary_action)
+{
+    int lock_mods = (num_mod_flag != 0) + (caps_mod_flag != 0) +
+        (scroll_mod_flag != 0);
+    count(SR_REMOVE_HOTKEY, 1 << lock_mods);
+
+    m_hotkeys.erase(std::make_pair(key, use_secondary_action));
+}
+
+void FakeXData::add_hotkey_mouse(unsigned int button)
+{
+    int lock_mods = (num_mod_flag != 0) + (caps_mod_flag != 0) +
+        (scroll_mod_flag != 0);
+    count(SR_ADD_HOTKEY_MOUSE, 1 << lock_mods);
+
+    m_mouse_hotkeys.insert(button);
+}
+
+void FakeXData::remove_hotkey_mouse(unsigned int button)
+{
+    int lock_mods = (num_mod_flag != 0) + (caps_mod_flag != 0) +
+        (scroll_mod_flag != 0);
+    count(SR_REMOVE_HOTKEY_MOUSE, 1 << lock_mods);
+
+    m_mouse_hotkeys.erase(button);
+}
+
+void FakeXData::clear_hotkeys()
+{
+    count(SR_CLEAR_HOTKEYS, 1);
+    m_hotkeys.clear();
+}
+
+void FakeXData::confine_pointer(Window window)
+{
+    if (m_confined == None)
+    {
+        count_round_trip(SR_CONFINE_POINTER, 1);
+        m_confined = window;
+    }
+}
+
+void FakeXData::stop_confining_pointer()
+{
+    if (m_confined != None)
+    {
+        count(SR_STOP_CONFINING_POINTER, 1);
+        m_confined = None;
+    }
+}
+
+void FakeXData::grab_mouse(Window window)
+{
+    count(SR_GRAB_MOUSE, 1);
+
+    FakeWindow *state = lookup(window);
+    if (state)
+        state->click_grabbed = true;
+}
+
+void FakeXData::ungrab_mouse(Window window)
+{
+    count(SR_UNGRAB_MOUSE, 1);
+
+    FakeWindow *state = lookup(window);
+    if (state)
+        state->click_grabbed = false;
+}
+
+bool FakeXData::grab_keyboard()
+{
+    count_round_trip(SR_GRAB_KEYBOARD, 1);
+
+    // Nobody else is running on the fake server, so the grab always works
+    m_keyboard_grabbed = true;
+    return true;
+}
+
+void FakeXData::ungrab_keyboard()
+{
+    count(SR_UNGRAB_KEYBOARD, 1);
+    m_keyboard_grabbed = false;
+}
+
+void FakeXData::select_input(Window window, long mask)
+{
+    count(SR_SELECT_INPUT, 1);
+
+    FakeWindow *state = lookup(window);
+    if (state)
+        state->event_mask = mask;
+}
+
+void FakeXData::get_windows(std::vector<Window> &windows)
+{
+    count_round_trip(SR_GET_WINDOWS, 1);
+    windows.insert(windows.end(), m_stacking.begin(), m_stacking.end());
+}
+
+void FakeXData::get_pointer_location(Dimension &x, Dimension &y)
+{
+    count_round_trip(SR_GET_POINTER_LOCATION, 1);
+    x = m_pointer_x;
+    y = m_pointer_y;
+}
+
+Window FakeXData::get_input_focus()
+{
+    count_round_trip(SR_GET_INPUT_FOCUS, 1);
+    return m_focus;
+}
+
+/**
+ * Changes the focus. Like a real server, the focus can only be given to a
+ * window which exists and is viewable - otherwise, it doesn't change.
+ */
+bool FakeXData::set_input_focus(Window window)
+{
+    count(SR_SET_INPUT_FOCUS, 1);
+
+    if (window == None)
+        window = FAKE_ROOT;
+
+    FakeWindow *state = lookup(window);
+    if (state && state->mapped)
+        m_focus = window;
+
+    return get_input_focus() == window;
+}
+
+/**
+ * Maps a window, which notifies SmallWM (it doesn't disable substructure
+ * events for this).
+ */
+void FakeXData::map_win(Window window)
+{
+    count(SR_MAP_WIN, 1);
+
+    FakeWindow *state = lookup(window);
+    if (!state || state->mapped)
+        return;
+
+    set_mapped(window, true);
+    notify(MapNotify, window);
+
+    if (state->event_mask & ExposureMask)
+    {
+        XEvent event;
+        std::memset(&event, 0, sizeof(event));
+        event.type = Expose;
+        event.xexpose.window = window;
+        event.xexpose.width = state->width;
+        event.xexpose.height = state->height;
+        queue_event(event);
+    }
+}
+
+/**
+ * Unmaps a window. Like XlibData, this doesn't produce an UnmapNotify, since
+ * substructure events are disabled while the window is unmapped.
+ */
+void FakeXData::unmap_win(Window window)
+{
+    count(SR_SUBSTRUCTURE_EVENTS, 1);
+    count(SR_UNMAP_WIN, 1);
+    count(SR_SUBSTRUCTURE_EVENTS, 1);
+
+    set_mapped(window, false);
+}
+
+/**
+ * Unmaps several windows, turning substructure events off and on once for all
+ * of them (like XlibData).
+ */
+void FakeXData::unmap_wins(const std::vector<Window> &windows)
+{
+    if (windows.empty())
+        return;
+
+    count(SR_SUBSTRUCTURE_EVENTS, 1);
+    for (std::vector<Window>::const_iterator window = windows.begin();
+         window != windows.end();
+         window++)
+    {
+        count(SR_UNMAP_WIN, 1);
+        set_mapped(*window, false);
+    }
+    count(SR_SUBSTRUCTURE_EVENTS, 1);
+}
+
+/**
+ * Asks a window to close. The fake clients never close on their own, so this
+ * only marks the window - the test code can close it with client_destroy.
+ */
+void FakeXData::request_close(Window window)
+{
+    count(SR_REQUEST_CLOSE, 1);
+
+    FakeWindow *state = lookup(window);
+    if (state)
+        state->close_requested = true;
+}
+
+void FakeXData::destroy_win(Window window)
+{
+    count(SR_DESTROY_WIN, 1);
+
+    FakeWindow *state = lookup(window);
+    if (!state)
+        return;
+
+    if (state->mapped)
+    {
+        set_mapped(window, false);
+        notify(UnmapNotify, window);
+    }
+
+    remove_window(window);
+    notify(DestroyNotify, window);
+}
+
+void FakeXData::get_attributes(Window window, XWindowAttributes &attr)
+{
+    count_round_trip(SR_GET_ATTRIBUTES, 2);
+
+    std::memset(&attr, 0, sizeof(attr));
+
+    FakeWindow *state = lookup(window);
+    if (!state)
+    {
+        attr.c_class = InputOutput;
+        attr.map_state = IsUnmapped;
+        return;
+    }
+
+    attr.x = state->x;
+    attr.y = state->y;
+    attr.width = state->width;
+    attr.height = state->height;
+    attr.border_width = state->border_width;
+    attr.override_redirect = state->override_redirect;
+    attr.c_class = state->input_only ? InputOnly : InputOutput;
+    attr.map_state = state->mapped ? IsViewable : IsUnmapped;
+    attr.your_event_mask = state->event_mask;
+    attr.root = FAKE_ROOT;
+}
+
+void FakeXData::set_attributes(Window window, XSetWindowAttributes &attr,
+        unsigned long attrmask)
+{
+    count(SR_SET_ATTRIBUTES, 1);
+
+    FakeWindow *state = lookup(window);
+    if (state && (attrmask & CWOverrideRedirect))
+        state->override_redirect = attr.override_redirect;
+}
+
+bool FakeXData::is_mapped(Window window)
+{
+    XWindowAttributes attrs;
+    get_attributes(window, attrs);
+    return attrs.map_state != IsUnmapped;
+}
+
+void FakeXData::set_border_color(Window window, MonoColor color)
+{
+    count(SR_SET_BORDER_COLOR, 1);
+
+    FakeWindow *state = lookup(window);
+    if (state)
+        state->border_color = color;
+}
+
+/**
+ * Changes the width of a window's border. XlibData leaves substructure events
+ * enabled while doing this, so SmallWM gets a ConfigureNotify for it.
+ */
+void FakeXData::set_border_width(Window window, Dimension size)
+{
+    count(SR_SET_BORDER_WIDTH, 1);
+
+    FakeWindow *state = lookup(window);
+    if (!state)
+        return;
+
+    state->border_width = size;
+    notify_configure(window);
+}
+
+void FakeXData::move_window(Window window, Dimension x, Dimension y)
+{
+    count(SR_SUBSTRUCTURE_EVENTS, 1);
+    count(SR_MOVE_WINDOW, 1);
+    count(SR_SUBSTRUCTURE_EVENTS, 1);
+
+    FakeWindow *state = lookup(window);
+    if (state)
+    {
+        state->x = x;
+        state->y = y;
+    }
+}
+
+void FakeXData::resize_window(Window window, Dimension width, Dimension height)
+{
+    count(SR_SUBSTRUCTURE_EVENTS, 1);
+    count(SR_RESIZE_WINDOW, 1);
+    count(SR_SUBSTRUCTURE_EVENTS, 1);
+
+    FakeWindow *state = lookup(window);
+    if (state)
+    {
+        state->width = width;
+        state->height = height;
+    }
+}
+
+void FakeXData::move_resize_window(Window window, Dimension x, Dimension y,
+        Dimension width, Dimension height)
+{
+    count(SR_SUBSTRUCTURE_EVENTS, 1);
+    count(SR_MOVE_RESIZE_WINDOW, 1);
+    count(SR_SUBSTRUCTURE_EVENTS, 1);
+
+    FakeWindow *state = lookup(window);
+    if (state)
+    {
+        state->x = x;
+        state->y = y;
+        state->width = width;
+        state->height = height;
+    }
+}
+
+void FakeXData::raise(Window window)
+{
+    count(SR_SUBSTRUCTURE_EVENTS, 1);
+    count(SR_RAISE, 1);
+    count(SR_SUBSTRUCTURE_EVENTS, 1);
+
+    std::vector<Window>::iterator position =
+        std::find(m_stacking.begin(), m_stacking.end(), window);
+    if (position == m_stacking.end())
+        return;
+
+    m_stacking.erase(position);
+    m_stacking.push_back(window);
+}
+
+/**
+ * Stacks the given windows in top-to-bottom order. Like XRestackWindows, the
+ * first window keeps its place in the stack, and every other window is put
+ * directly below the window before it.
+ */
+void FakeXData::restack(const std::vector<Window> &windows)
+{
+    count(SR_SUBSTRUCTURE_EVENTS, 1);
+    if (windows.size() > 1)
+        count(SR_RESTACK, windows.size() - 1);
+    count(SR_SUBSTRUCTURE_EVENTS, 1);
+
+    for (size_t idx = 1; idx < windows.size(); idx++)
+    {
+        std::vector<Window>::iterator position =
+            std::find(m_stacking.begin(), m_stacking.end(), windows[idx]);
+        if (position == m_stacking.end())
+            continue;
+
+        m_stacking.erase(position);
+
+        std::vector<Window>::iterator above =
+            std::find(m_stacking.begin(), m_stacking.end(), windows[idx - 1]);
+        m_stacking.insert(above, windows[idx]);
+    }
+}
+
+void FakeXData::draw_outline(const Box &box)
+{
+    count(SR_DRAW_OUTLINE, 1);
+
+    std::vector<Box>::iterator existing =
+        std::find(m_outlines.begin(), m_outlines.end(), box);
+    if (existing != m_outlines.end())
+        m_outlines.erase(existing);
+    else
+        m_outlines.push_back(box);
+}
+
+bool FakeXData::get_wm_hints(Window window, XWMHints &hints)
+{
+    count_round_trip(SR_GET_WM_HINTS, 1);
+
+    FakeWindow *state = lookup(window);
+    if (!state || state->hint_flags == 0)
+        return false;
+
+    std::memset(&hints, 0, sizeof(hints));
+    hints.flags = state->hint_flags;
+    hints.initial_state = state->initial_state;
+    hints.input = state->input;
+    return true;
+}
+
+void FakeXData::get_size_hints(Window window, XSizeHints &hints)
+{
+    count_round_trip(SR_GET_SIZE_HINTS, 1);
+    std::memset(&hints, 0, sizeof(hints));
+
+    FakeWindow *state = lookup(window);
+    if (!state)
+        return;
+
+    if (state->base_width > 0 || state->base_height > 0)
+    {
+        hints.flags |= PBaseSize;
+        hints.base_width = state->base_width;
+        hints.base_height = state->base_height;
+    }
+
+    if (state->width_inc > 0 || state->height_inc > 0)
+    {
+        hints.flags |= PResizeInc;
+        hints.width_inc = state->width_inc;
+        hints.height_inc = state->height_inc;
+    }
+}
+
+Window FakeXData::get_transient_hint(Window window)
+{
+    count_round_trip(SR_GET_TRANSIENT_HINT, 1);
+
+    FakeWindow *state = lookup(window);
+    return state ? state->transient_for : None;
+}
+
+void FakeXData::get_icon_name(Window window, std::string &name)
+{
+    count_round_trip(SR_GET_ICON_NAME, 1);
+
+    FakeWindow *state = lookup(window);
+    if (state)
+        name = state->icon_name;
+    else
+        name.clear();
+}
+
+void FakeXData::get_class(Window window, std::string &xclass)
+{
+    count_round_trip(SR_GET_CLASS, 1);
+
+    FakeWindow *state = lookup(window);
+    if (state)
+        xclass = state->win_class;
+    else
+        xclass.clear();
+}
+
+void FakeXData::get_instance(Window window, std::string &instance)
+{
+    count_round_trip(SR_GET_INSTANCE, 1);
+
+    FakeWindow *state = lookup(window);
+    if (state)
+        instance = state->instance;
+    else
+        instance.clear();
+}
+
+void FakeXData::get_title(Window window, std::string &title)
+{
+    count_round_trip(SR_GET_TITLE, 1);
+
+    FakeWindow *state = lookup(window);
+    if (state)
+        title = state->title;
+    else
+        title.clear();
+}
+
+void FakeXData::get_role(Window window, std::string &role)
+{
+    count_round_trip(SR_GET_ROLE, 1);
+
+    FakeWindow *state = lookup(window);
+    if (state)
+        role = state->role;
+    else
+        role.clear();
+}
+
+/**
+ * Gets the type of a window - windows without a type are normal windows, as
+ * they are in XlibData.
+ */
+void FakeXData::get_window_type(Window window, std::string &type)
+{
+    count_round_trip(SR_GET_WINDOW_TYPE, 1);
+
+    FakeWindow *state = lookup(window);
+    if (state && !state->window_type.empty())
+        type = state->window_type;
+    else
+        type = "normal";
+}
+
+void FakeXData::get_screen_boxes(std::vector<Box> &boxes)
+{
+    count_round_trip(SR_GET_SCREEN_BOXES, 1 + m_screens.size());
+    boxes = m_screens;
+}
+
+/**
+ * Gets the keysym that press_key gave a keycode to. Like XlibData, this uses
+ * a local copy of the keyboard mapping, so no requests are counted.
+ */
+KeySym FakeXData::get_keysym(int keycode)
+{
+    std::map<int, KeySym>::iterator key = m_keysyms.find(keycode);
+    return key == m_keysyms.end() ? NoSymbol : key->second;
+}
+
+/**
+ * Checks whether a key is one of the Super keys, which the fake server
+ * always binds to the primary modifier.
+ */
+bool FakeXData::is_primary_modifier(int keycode)
+{
+    KeySym sym = get_keysym(keycode);
+    return sym == XK_Super_L || sym == XK_Super_R;
+}
+
+/**
+ * The keycodes given out by press_key never change, so there is never
+ * anything to refresh.
+ */
+void FakeXData::refresh_keyboard_mapping(XEvent &event)
+{
+}
+
+/**
+ * Applies (part of) a configure request, and notifies SmallWM of the change.
+ */
+void FakeXData::forward_configure_request(XEvent &event, unsigned int allowed_flags)
+{
+    count(SR_FORWARD_CONFIGURE_REQUEST, 1);
+
+    FakeWindow *state = lookup(event.xconfigurerequest.window);
+    if (!state)
+        return;
+
+    unsigned int flags = event.xconfigurerequest.value_mask;
+    if (allowed_flags != 0)
+        flags &= allowed_flags;
+
+    if (flags & CWX)
+        state->x = event.xconfigurerequest.x;
+    if (flags & CWY)
+        state->y = event.xconfigurerequest.y;
+    if (flags & CWWidth)
+        state->width = event.xconfigurerequest.width;
+    if (flags & CWHeight)
+        state->height = event.xconfigurerequest.height;
+    if (flags & CWBorderWidth)
+        state->border_width = event.xconfigurerequest.border_width;
+
+    notify_configure(event.xconfigurerequest.window);
+}
+
+void FakeXData::forward_circulate_request(XEvent &event)
+{
+    count(SR_FORWARD_CIRCULATE_REQUEST, 1);
+}
+
+/**
+ * Gets an ID for a new window.
+ */
+Window FakeXData::allocate_window()
+{
+    while (m_windows.count(m_next_window) > 0)
+        m_next_window++;
+
+    return m_next_window++;
+}
+
+/**
+ * Records that some requests were made.
+ */
+void FakeXData::count(StatsRequest request, unsigned int requests)
+{
+    m_stats.add_requests(request, requests);
+    m_total_requests += requests;
+}
+
+/**
+ * Records that some requests were made, each of which needed a reply.
+ */
+void FakeXData::count_round_trip(StatsRequest request, unsigned int requests)
+{
+    m_stats.add_round_trips(request, requests);
+    m_total_round_trips += requests;
+}
+
+/**
+ * Finds the state of a window, which can be changed.
+ * @return The window, or NULL if it doesn't exist.
+ */
+FakeWindow *FakeXData::lookup(Window window)
+{
+    std::map<Window, FakeWindow>::iterator iter = m_windows.find(window);
+    if (iter == m_windows.end())
+        return NULL;
+
+    return &iter->second;
+}
+
+/**
+ * Adds (or replaces) a top-level window, without sending any events. New
+ * windows are stacked on top.
+ */
+void FakeXData::add_window(Window window, const FakeWindow &desc)
+{
+    if (m_windows.count(window) == 0)
+        m_stacking.push_back(window);
+
+    m_windows[window] = desc;
+}
+
+/**
+ * Removes a window, without sending any events.
+ */
+void FakeXData::remove_window(Window window)
+{
+    m_windows.erase(window);
+
+    std::vector<Window>::iterator position =
+        std::find(m_stacking.begin(), m_stacking.end(), window);
+    if (position != m_stacking.end())
+        m_stacking.erase(position);
+
+    // The focus reverts to nothing, since SmallWM uses RevertToNone
+    if (m_focus == window)
+        m_focus = None;
+
+    if (m_confined == window)
+        m_confined = None;
+}
+
+/**
+ * Changes whether a window is mapped, without sending any events.
+ */
+void FakeXData::set_mapped(Window window, bool mapped)
+{
+    FakeWindow *state = lookup(window);
+    if (!state)
+        return;
+
+    state->mapped = mapped;
+
+    // Like with destroyed windows, unmapped windows lose the focus
+    if (!mapped && m_focus == window)
+        m_focus = None;
+}
+
+/**
+ * Changes the screen layout, without sending any events. The root window
+ * covers the bounding box of all the screens.
+ */
+void FakeXData::set_screens(const std::vector<Box> &screens)
+{
+    m_screens = screens;
+
+    int right = 0, bottom = 0;
+    for (std::vector<Box>::const_iterator box = screens.begin();
+            box != screens.end();
+            box++)
+    {
+        right = std::max(right, box->x + static_cast<int>(box->width));
+        bottom = std::max(bottom, box->y + static_cast<int>(box->height));
+    }
+
+    FakeWindow &root = m_windows[FAKE_ROOT];
+    root.width = right;
+    root.height = bottom;
+}
+
+/**
+ * Moves the pointer, without sending any events.
+ */
+void FakeXData::set_pointer(int x, int y)
+{
+    m_pointer_x = x;
+    m_pointer_y = y;
+}
+
+/**
+ * Sends a Map, Unmap or DestroyNotify about a window to the root, if the root
+ * has selected substructure events.
+ */
+void FakeXData::notify(int type, Window window)
+{
+    if (!(m_windows[FAKE_ROOT].event_mask & SubstructureNotifyMask))
+        return;
+
+    XEvent event;
+    std::memset(&event, 0, sizeof(event));
+    event.type = type;
+
+    switch (type)
+    {
+    case MapNotify:
+        event.xmap.event = FAKE_ROOT;
+        event.xmap.window = window;
+        break;
+    case UnmapNotify:
+        event.xunmap.event = FAKE_ROOT;
+        event.xunmap.window = window;
+        break;
+    case DestroyNotify:
+        event.xdestroywindow.event = FAKE_ROOT;
+        event.xdestroywindow.window = window;
+        break;
+    }
+
+    queue_event(event);
+}
+
+/**
+ * Sends a ConfigureNotify with the current geometry of a window to the root,
+ * if the root has selected substructure events.
+ */
+void FakeXData::notify_configure(Window window)
+{
+    FakeWindow *state = lookup(window);
+    if (!state || !(m_windows[FAKE_ROOT].event_mask & SubstructureNotifyMask))
+        return;
+
+    XEvent event;
+    std::memset(&event, 0, sizeof(event));
+    event.type = ConfigureNotify;
+    event.xconfigure.event = FAKE_ROOT;
+    event.xconfigure.window = window;
+    event.xconfigure.x = state->x;
+    event.xconfigure.y = state->y;
+    event.xconfigure.width = state->width;
+    event.xconfigure.height = state->height;
+    event.xconfigure.border_width = state->border_width;
+    event.xconfigure.override_redirect = state->override_redirect;
+    queue_event(event);
+}
+
+/**
+ * Checks whether map and configure requests for a window go to the WM.
+ */
+bool FakeXData::is_redirected(Window window)
+{
+    FakeWindow *state = lookup(window);
+    return state && !state->override_redirect &&
+        (m_windows[FAKE_ROOT].event_mask & SubstructureRedirectMask);
+}
@@ -0,0 +1,303 @@
+/** @file */
+#ifndef __SMALLWM_FAKE_XDATA__
+#define __SMALLWM_FAKE_XDATA__
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "stats.h"
+#include "xdata.h"
+
+/// The ID of the root window on the fake server
+const Window FAKE_ROOT = 1;
+
+/**
+ * The state that the fake server keeps about each window.
+ */
+struct FakeWindow
+{
+    FakeWindow() :
+        x(0), y(0), width(1), height(1), border_width(0),
+        border_color(X_BLACK), mapped(false), override_redirect(false),
+        input_only(false), event_mask(NoEventMask), click_grabbed(false),
+        transient_for(None), hint_flags(0), initial_state(NormalState),
+        input(true), base_width(0), base_height(0), width_inc(0),
+        height_inc(0), close_requested(false)
+    {}
+
+    /// The window's position, relative to the root
+    int x, y;
+
+    /// The window's size (not including its border)
+    Dimension width, height;
+
+    /// The width and color of the window's border
+    Dimension border_width;
+    MonoColor border_color;
+
+    /// Whether the window has been mapped
+    bool mapped;
+
+    /// Whether the window asked not to be managed
+    bool override_redirect;
+
+    /// Whether the window is InputOnly
+    bool input_only;
+
+    /// The events which have been selected on this window
+    long event_mask;
+
+    /// Whether clicks on this window are grabbed by grab_mouse
+    bool click_grabbed;
+
+    /// The window this is a dialog for, or None
+    Window transient_for;
+
+    /// The flags, initial state and input hint from the window's WM_HINTS
+    long hint_flags;
+    int initial_state;
+    bool input;
+
+    /** The base size and resize increments from the window's
+     * WM_NORMAL_HINTS, or 0 if the window doesn't have them */
+    Dimension base_width, base_height;
+    Dimension width_inc, height_inc;
+
+    /// The window's WM_CLASS (both parts) and WM_ICON_NAME
+    std::string win_class;
+    std::string instance;
+    std::string icon_name;
+
+    /** The window's WM_NAME, WM_WINDOW_ROLE and _NET_WM_WINDOW_TYPE (as it
+     * is reported by get_window_type) */
+    std::string title;
+    std::string role;
+    std::string window_type;
+
+    /// Whether the WM has asked this window to close
+    bool close_requested;
+
+    /// The (32-bit) properties which the WM has set on this window, by name
+    std::map<std::string, std::vector<long> > properties;
+};
+
+/**
+ * A graphics context which only counts the requests that would be sent.
+ */
+class FakeGC : public XGC
+{
+public:
+    FakeGC(Stats &stats) :
+        m_stats(stats)
+    {};
+
+    void clear();
+    void draw_string(Dimension, Dimension, const std::string&);
+    Dimension2D copy_pixmap(Drawable, Dimension, Dimension);
+
+private:
+    /// Where to count the requests made while drawing
+    Stats &m_stats;
+};
+
+/**
+ * An in-memory X server, which keeps track of a tree of windows (their
+ * geometry, stacking order and map state), the input focus, grabs and a queue
+ * of pending events.
+ *
+ * This runs the whole of SmallWM without a display, which is used for
+ * end-to-end tests and benchmarks. Test code plays the part of the clients
+ * and the user, by calling the client_* and input methods, which queue up the
+ * same events that a real X server would send.
+ *
+ * Every request is counted into the given Stats, using the same counters that
+ * XlibData uses, so that the cost of an operation can be measured.
+ */
+class FakeXData : public XData
+{
+public:
+    FakeXData(Stats &stats);
+
+    // Inspecting the server's state
+    const FakeWindow *find_window(Window) const;
+    void get_stacking(std::vector<Window>&) const;
+    Window get_confined() const
+    { return m_confined; }
+    bool is_keyboard_grabbed() const
+    { return m_keyboard_grabbed; }
+    const std::vector<Box> &get_outlines() const
+    { return m_outlines; }
+    bool has_hotkey(KeySym, bool) const;
+    bool has_hotkey_mouse(unsigned int) const;
+    bool has_events() const
+    { return !m_events.empty(); }
+
+    uint64_t total_requests() const
+    { return m_total_requests; }
+    uint64_t total_round_trips() const
+    { return m_total_round_trips; }
+    void reset_totals();
+
+    // Acting as the clients and the user
+    Window create_client(const FakeWindow&);
+    void client_map(Window);
+    void client_unmap(Window);
+    void client_configure(Window, int, int, Dimension, Dimension);
+    void client_destroy(Window);
+
+    void press_key(KeySym, unsigned int, Window);
+    void release_key(KeySym, unsigned int, Window);
+    void press_button(unsigned int, unsigned int, Window, Window);
+    void release_button(unsigned int, unsigned int, Window);
+    void move_pointer(int, int);
+    void change_screens(const std::vector<Box>&);
+    void change_keyboard_mapping();
+
+    virtual void queue_event(const XEvent&);
+
+    // The XData interface
+    XGC *create_gc(Window);
+    Window create_window(bool);
+
+    Atom get_atom(KnownAtom);
+    void change_property(Window, KnownAtom, Atom,
+            const unsigned char*, size_t);
+
+    void next_event(XEvent&);
+    bool wait_for_event(std::vector<struct pollfd>&);
+    void get_latest_event(XEvent&, int);
+
+    void add_hotkey(KeySym, bool);
+    void remove_hotkey(KeySym, bool);
+    void add_hotkey_mouse(unsigned int);
+    void remove_hotkey_mouse(unsigned int);
+    void clear_hotkeys();
+
+    void confine_pointer(Window);
+    void stop_confining_pointer();
+    void grab_mouse(Window);
+    void ungrab_mouse(Window);
+    bool grab_keyboard();
+    void ungrab_keyboard();
+
+    void select_input(Window, long);
+
+    void get_windows(std::vector<Window>&);
+    void get_pointer_location(Dimension&, Dimension&);
+
+    Window get_input_focus();
+    bool set_input_focus(Window);
+
+    void map_win(Window);
+    void unmap_win(Window);
+    void unmap_wins(const std::vector<Window>&);
+    void request_close(Window);
+    void destroy_win(Window);
+
+    void get_attributes(Window, XWindowAttributes&);
+    void set_attributes(Window, XSetWindowAttributes&,
+        unsigned long);
+    bool is_mapped(Window);
+    void set_border_color(Window, MonoColor);
+    void set_border_width(Window, Dimension);
+
+    void move_window(Window, Dimension, Dimension);
+    void resize_window(Window, Dimension, Dimension);
+    void move_resize_window(Window, Dimension, Dimension, Dimension, Dimension);
+    void raise(Window);
+    void restack(const std::vector<Window>&);
+    void draw_outline(const Box&);
+
+    bool get_wm_hints(Window, XWMHints&);
+    void get_size_hints(Window, XSizeHints&);
+    Window get_transient_hint(Window);
+    void get_icon_name(Window, std::string&);
+    void get_class(Window, std::string&);
+    void get_instance(Window, std::string&);
+    void get_title(Window, std::string&);
+    void get_role(Window, std::string&);
+    void get_window_type(Window, std::string&);
+
+    void get_screen_boxes(std::vector<Box>&);
+
+    KeySym get_keysym(int);
+    bool is_primary_modifier(int);
+    void refresh_keyboard_mapping(XEvent&);
+
+    void forward_configure_request(XEvent&, unsigned int);
+    void forward_circulate_request(XEvent&);
+
+protected:
+    virtual Window allocate_window();
+    virtual void count(StatsRequest, unsigned int);
+    virtual void count_round_trip(StatsRequest, unsigned int);
+
+    FakeWindow *lookup(Window);
+    void add_window(Window, const FakeWindow&);
+    void remove_window(Window);
+    void set_mapped(Window, bool);
+    void set_screens(const std::vector<Box>&);
+    void set_pointer(int, int);
+
+private:
+    void queue_key_event(int, KeySym, unsigned int, Window);
+    void notify(int, Window);
+    void notify_configure(Window);
+    bool is_redirected(Window);
+
+    /// Where the requests are counted
+    Stats &m_stats;
+
+    /// The total number of requests and round trips since the last reset
+    uint64_t m_total_requests;
+    uint64_t m_total_round_trips;
+
+    /// Every window on the server, including the root
+    std::map<Window, FakeWindow> m_windows;
+
+    /// The children of the root, from the bottom of the stack to the top
+    std::vector<Window> m_stacking;
+
+    /// The events which haven't been read yet
+    std::deque<XEvent> m_events;
+
+    /// The current screen layout
+    std::vector<Box> m_screens;
+
+    /// The keycodes given out to keysyms by press_key, in both directions
+    std::map<int, KeySym> m_keysyms;
+    std::map<KeySym, int> m_keycodes;
+
+    /// The key and mouse hotkeys which have been grabbed
+    std::set<std::pair<KeySym, bool> > m_hotkeys;
+    std::set<unsigned int> m_mouse_hotkeys;
+
+    /// The window which has the input focus, or None
+    Window m_focus;
+
+    /// The window the pointer is confined to, or None
+    Window m_confined;
+
+    /// Whether the keyboard is grabbed by SmallWM
+    bool m_keyboard_grabbed;
+
+    /** The outlines which are drawn on the root - since they are drawn with
+     * XOR, drawing an outline a second time erases it */
+    std::vector<Box> m_outlines;
+
+    /// Where the pointer is, relative to the root
+    int m_pointer_x, m_pointer_y;
+
+    /// The ID to give to the next window that is created
+    Window m_next_window;
+
+    /// The keycode to give to the next key that needs one
+    int m_next_keycode;
+};
+
+#endif
@@ -0,0 +1,163 @@
+/** @file */
+#include "grab-manager.h"
+
+/**
+ * Asks for a keyboard hotkey to be grabbed at the next flush().
+ * @param key The key to bind.
+ * @param use_secondary_action Whether the binding uses the secondary modifier.
+ */
+void GrabManager::add_hotkey(KeySym key, bool use_secondary_action)
+{
+    m_hotkeys.insert(KeyBinding(key, use_secondary_action));
+}
+
+/**
+ * Asks for a keyboard hotkey to be released at the next flush().
+ * @param key The key to unbind.
+ * @param use_secondary_action Whether the binding uses the secondary modifier.
+ */
+void GrabManager::remove_hotkey(KeySym key, bool use_secondary_action)
+{
+    m_hotkeys.erase(KeyBinding(key, use_secondary_action));
+}
+
+/**
+ * Asks for a mouse hotkey to be grabbed at the next flush().
+ * @param button The button to bind.
+ */
+void GrabManager::add_hotkey_mouse(unsigned int button)
+{
+    m_mouse_hotkeys.insert(button);
+}
+
+/**
+ * Asks for a mouse hotkey to be released at the next flush().
+ * @param button The button to unbind.
+ */
+void GrabManager::remove_hotkey_mouse(unsigned int button)
+{
+    m_mouse_hotkeys.erase(button);
+}
+
+/**
+ * Releases every keyboard hotkey, so that they are all grabbed again at the
+ * next flush(). This is necessary when the keyboard mapping changes, since
+ * the existing grabs may refer to the wrong keycodes.
+ */
+void GrabManager::reset_hotkeys()
+{
+    m_xdata.clear_hotkeys();
+    m_installed_hotkeys.clear();
+}
+
+/**
+ * Asks for the clicks going to a window to be grabbed at the next flush().
+ * @param window The window to intercept clicks from.
+ */
+void GrabManager::grab_mouse(Window window)
+{
+    m_pending_mouse_grabs[window] = true;
+}
+
+/**
+ * Asks for the clicks going to a window to be released at the next flush().
+ * @param window The window to stop intercepting clicks from.
+ */
+void GrabManager::ungrab_mouse(Window window)
+{
+    m_pending_mouse_grabs[window] = false;
+}
+
+/**
+ * Forgets about a window which has been destroyed, along with its grabs.
+ * Its ID may be reused by the server later, and the new window won't have any
+ * grabs on it.
+ * @param window The window that was destroyed.
+ */
+void GrabManager::forget_window(Window window)
+{
+    m_pending_mouse_grabs.erase(window);
+    m_installed_mouse_grabs.erase(window);
+}
+
+/**
+ * Checks whether or not a window's clicks will be grabbed, once any pending
+ * changes are flushed.
+ */
+bool GrabManager::is_mouse_grabbed(Window window) const
+{
+    std::map<Window, bool>::const_iterator pending =
+        m_pending_mouse_grabs.find(window);
+    if (pending != m_pending_mouse_grabs.end())
+        return pending->second;
+
+    return m_installed_mouse_grabs.count(window) > 0;
+}
+
+/**
+ * Sends the requests needed to make the installed grabs match the wanted
+ * grabs. Grabs which are already installed are not sent again.
+ */
+void GrabManager::flush()
+{
+    for (std::set<KeyBinding>::iterator hotkey = m_installed_hotkeys.begin();
+            hotkey != m_installed_hotkeys.end();
+            /* The iterator is advanced in the loop */)
+    {
+        if (m_hotkeys.count(*hotkey) == 0)
+        {
+            m_xdata.remove_hotkey(hotkey->first, hotkey->second);
+            m_installed_hotkeys.erase(hotkey++);
+        }
+        else
+            hotkey++;
+    }
+
+    for (std::set<KeyBinding>::iterator hotkey = m_hotkeys.begin();
+            hotkey != m_hotkeys.end();
+            hotkey++)
+    {
+        if (m_installed_hotkeys.insert(*hotkey).second)
+            m_xdata.add_hotkey(hotkey->first, hotkey->second);
+    }
+
+    for (std::set<unsigned int>::iterator button = m_installed_mouse_hotkeys.begin();
+            button != m_installed_mouse_hotkeys.end();
+            /* The iterator is advanced in the loop */)
+    {
+        if (m_mouse_hotkeys.count(*button) == 0)
+        {
+            m_xdata.remove_hotkey_mouse(*button);
+            m_installed_mouse_hotkeys.erase(button++);
+        }
+        else
+            button++;
+    }
+
+    for (std::set<unsigned int>::iterator button = m_mouse_hotkeys.begin();
+            button != m_mouse_hotkeys.end();
+            button++)
+    {
+        if (m_installed_mouse_hotkeys.insert(*button).second)
+            m_xdata.add_hotkey_mouse(*button);
+    }
+
+    for (std::map<Window, bool>::iterator grab = m_pending_mouse_grabs.begin();
+            grab != m_pending_mouse_grabs.end();
+            grab++)
+    {
+        bool is_installed = m_installed_mouse_grabs.count(grab->first) > 0;
+        if (grab->second && !is_installed)
+        {
+            m_xdata.grab_mouse(grab->first);
+            m_installed_mouse_grabs.insert(grab->first);
+        }
+        else if (!grab->second && is_installed)
+        {
+            m_xdata.ungrab_mouse(grab->first);
+            m_installed_mouse_grabs.erase(grab->first);
+        }
+    }
+
+    m_pending_mouse_grabs.clear();
+}
@@ -0,0 +1,62 @@
+/** @file */
+#ifndef __SMALLWM_GRAB_MANAGER__
+#define __SMALLWM_GRAB_MANAGER__
+
+#include <map>
+#include <set>
+
+#include "configparse.h"
+#include "common.h"
+#include "xdata.h"
+
+/**
+ * Keeps track of the passive grabs that SmallWM wants - the keyboard and
+ * mouse hotkeys on the root window, and the click grabs on unfocused clients
+ * - and the grabs which are actually installed on the X server.
+ *
+ * Callers describe the grabs they want, and flush() sends the difference
+ * between the two as a single batch. This means that a window whose grab
+ * state didn't change (say, a window that was unfocused and then refocused
+ * while handling the same set of changes) doesn't cost any requests.
+ */
+class GrabManager
+{
+public:
+    GrabManager(XData &xdata) :
+        m_xdata(xdata)
+    {};
+
+    void add_hotkey(KeySym, bool);
+    void remove_hotkey(KeySym, bool);
+    void add_hotkey_mouse(unsigned int);
+    void remove_hotkey_mouse(unsigned int);
+    void reset_hotkeys();
+
+    void grab_mouse(Window);
+    void ungrab_mouse(Window);
+    void forget_window(Window);
+    bool is_mouse_grabbed(Window) const;
+
+    void flush();
+
+private:
+    /// The interface to the X server, where the grabs are installed
+    XData &m_xdata;
+
+    /// The keyboard hotkeys that should be grabbed, and that are grabbed
+    std::set<KeyBinding> m_hotkeys;
+    std::set<KeyBinding> m_installed_hotkeys;
+
+    /// The mouse hotkeys that should be grabbed, and that are grabbed
+    std::set<unsigned int> m_mouse_hotkeys;
+    std::set<unsigned int> m_installed_mouse_hotkeys;
+
+    /** The windows whose click grab should change at the next flush(), and
+     * whether or not they should be grabbed */
+    std::map<Window, bool> m_pending_mouse_grabs;
+
+    /// The windows whose clicks are currently grabbed
+    std::set<Window> m_installed_mouse_grabs;
+};
+
+#endif
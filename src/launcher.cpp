@@ -0,0 +1,236 @@
+/** @file */
+#include <cctype>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <fcntl.h>
+#include <sstream>
+#include <spawn.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "launcher.h"
+
+extern char **environ;
+
+/// The characters which mean the same thing to the shell as they do to us
+static const char *PLAIN_CHARACTERS = "-_./,:@%+= \t";
+
+Launcher::~Launcher()
+{
+    // The helper stops once it sees that its socket has been closed
+    if (m_helper != -1)
+        close(m_helper);
+}
+
+/**
+ * Starts the helper process, which launches programs from then on.
+ *
+ * @param executable The SmallWM binary, which is run as the helper.
+ * @return true if the helper was started, false otherwise.
+ */
+bool Launcher::start_helper(const std::string &executable)
+{
+    // Messages on a SOCK_SEQPACKET socket keep their boundaries, so each
+    // command arrives at the helper in one piece
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds) == -1)
+        return false;
+
+    std::vector<std::string> args;
+    args.push_back(executable);
+    args.push_back("--launch-helper");
+
+    pid_t helper = spawn_argv(executable.c_str(), args, fds[1]);
+    close(fds[1]);
+
+    if (helper == -1)
+    {
+        close(fds[0]);
+        return false;
+    }
+
+    m_helper = fds[0];
+    return true;
+}
+
+/**
+ * Starts a program, either through the helper or (if there is no helper, or
+ * it can't take the command right now) directly.
+ *
+ * @param command The command to run, in the syntax of /bin/sh.
+ * @return true if the program was started (or handed to the helper), false
+ *         otherwise.
+ */
+bool Launcher::launch(const std::string &command)
+{
+    if (command.empty())
+        return false;
+
+    if (m_helper != -1 && command.size() < LAUNCH_MAX_COMMAND)
+    {
+        ssize_t sent = send(m_helper, command.data(), command.size(),
+                            MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent == static_cast<ssize_t>(command.size()))
+            return true;
+
+        // A helper that is only busy can be used again later, but one which
+        // has gone away can't
+        if (errno != EAGAIN && errno != EWOULDBLOCK)
+        {
+            close(m_helper);
+            m_helper = -1;
+        }
+    }
+
+    return spawn(command) != -1;
+}
+
+/**
+ * Starts a program, without going through the shell unless the command
+ * needs it.
+ *
+ * @param command The command to run, in the syntax of /bin/sh.
+ * @return The process ID of the program (or of the shell running it), or -1
+ *         if it couldn't be started.
+ */
+pid_t Launcher::spawn(const std::string &command)
+{
+    std::vector<std::string> args;
+    if (split_command(command, args))
+    {
+        pid_t pid = spawn_argv(args[0].c_str(), args, -1);
+        if (pid != -1)
+            return pid;
+
+        // Shell builtins and functions look like programs, but can't be
+        // found on the PATH - let the shell figure those out
+    }
+
+    // The 'exec' keeps /bin/sh from sticking around to wait for the program
+    args.clear();
+    args.push_back("/bin/sh");
+    args.push_back("-c");
+    args.push_back("exec " + command);
+    return spawn_argv("/bin/sh", args, -1);
+}
+
+/**
+ * Splits a command into a program and its arguments, if that can be done
+ * without the shell.
+ *
+ * @param command The command to split.
+ * @param[out] args The program followed by its arguments.
+ * @return true if the command is only words separated by spaces, false if
+ *         the shell has to interpret it.
+ */
+bool Launcher::split_command(const std::string &command,
+        std::vector<std::string> &args)
+{
+    args.clear();
+    for (std::string::const_iterator character = command.begin();
+         character != command.end();
+         character++)
+    {
+        if (!std::isalnum(static_cast<unsigned char>(*character)) &&
+                !std::strchr(PLAIN_CHARACTERS, *character))
+            return false;
+    }
+
+    std::istringstream words(command);
+    std::string word;
+    while (words >> word)
+        args.push_back(word);
+
+    // Something like 'LANG=C xterm' sets a variable, which the shell has to
+    // take care of
+    return !args.empty() && args[0].find('=') == std::string::npos;
+}
+
+/**
+ * Runs the helper, which starts a program for every command that SmallWM
+ * sends it. This is the whole of the helper process.
+ *
+ * @param input The socket that commands arrive on (the helper's stdin).
+ * @return The exit code of the helper.
+ */
+int Launcher::run_helper(int input)
+{
+    // The socket is moved off of stdin, onto a descriptor that is closed in
+    // every program the helper starts - otherwise, any program that read its
+    // stdin would take commands meant for the helper
+    int commands = fcntl(input, F_DUPFD_CLOEXEC, STDERR_FILENO + 1);
+    if (commands == -1)
+        return 1;
+    close(input);
+
+    // Programs are never waited for, so they're reaped automatically
+    signal(SIGCHLD, SIG_IGN);
+
+    char buffer[LAUNCH_MAX_COMMAND];
+    while (true)
+    {
+        ssize_t count = recv(commands, buffer, sizeof(buffer), 0);
+        if (count == 0)
+            return 0;
+
+        if (count < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return 1;
+        }
+
+        spawn(std::string(buffer, count));
+    }
+}
+
+/**
+ * Starts a program with posix_spawn. The program gets the default handlers
+ * for every signal that SmallWM ignores, and none of them blocked.
+ *
+ * @param file The program to run - it is searched for on the PATH if it
+ *             doesn't contain a '/'.
+ * @param args The arguments to the program, including argv[0].
+ * @param input The program's standard input, or -1 for /dev/null.
+ * @return The process ID of the program, or -1 if it couldn't be started.
+ */
+pid_t Launcher::spawn_argv(const char *file,
+        const std::vector<std::string> &args, int input)
+{
+    std::vector<char*> argv;
+    for (std::vector<std::string>::const_iterator arg = args.begin();
+         arg != args.end();
+         arg++)
+        argv.push_back(const_cast<char*>(arg->c_str()));
+    argv.push_back(NULL);
+
+    sigset_t default_signals, no_signals;
+    sigemptyset(&default_signals);
+    sigaddset(&default_signals, SIGCHLD);
+    sigaddset(&default_signals, SIGPIPE);
+    sigemptyset(&no_signals);
+
+    posix_spawnattr_t attrs;
+    posix_spawnattr_init(&attrs);
+    posix_spawnattr_setsigdefault(&attrs, &default_signals);
+    posix_spawnattr_setsigmask(&attrs, &no_signals);
+    posix_spawnattr_setflags(&attrs,
+                             POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (input != -1)
+        posix_spawn_file_actions_adddup2(&actions, input, STDIN_FILENO);
+    else
+        posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null",
+                                         O_RDONLY, 0);
+
+    pid_t pid;
+    int status = posix_spawnp(&pid, file, &actions, &attrs, &argv[0],
+                              environ);
+
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attrs);
+    return status == 0 ? pid : -1;
+}
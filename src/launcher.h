@@ -0,0 +1,48 @@
+/** @file */
+#ifndef __SMALLWM_LAUNCHER__
+#define __SMALLWM_LAUNCHER__
+
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+/// The longest command that can be sent to the launch helper
+const size_t LAUNCH_MAX_COMMAND = 4096;
+
+/**
+ * Starts programs on behalf of the window manager.
+ *
+ * Programs are started with posix_spawn, which (unlike fork) doesn't have to
+ * copy SmallWM's page tables. Commands which are only a program and its
+ * arguments are run directly, and anything that needs the shell to make
+ * sense of it (quotes, variables, pipes and so on) goes through /bin/sh.
+ *
+ * Optionally, a helper process can be started along with SmallWM - once it
+ * has been, commands are sent to it over a socket and it starts the
+ * programs instead, so that SmallWM itself never has to spawn anything.
+ */
+class Launcher
+{
+public:
+    Launcher() :
+        m_helper(-1)
+    {}
+
+    virtual ~Launcher();
+
+    bool start_helper(const std::string&);
+    virtual bool launch(const std::string&);
+
+    static pid_t spawn(const std::string&);
+    static bool split_command(const std::string&, std::vector<std::string>&);
+    static int run_helper(int);
+
+private:
+    static pid_t spawn_argv(const char*, const std::vector<std::string>&,
+            int);
+
+    /// SmallWM's end of the socket to the helper, or -1 if there is none
+    int m_helper;
+};
+
+#endif
@@ -0,0 +1,266 @@
+/** @file */
+#include "mirrored-xdata.h"
+
+/**
+ * Creates a new window, which is known to be unmapped.
+ */
+Window MirroredXData::create_window(bool ignore)
+{
+    Window window = m_xdata.create_window(ignore);
+
+    m_xmodel.forget_mirror(window);
+    m_xmodel.get_mirror(window).map_state = MIRROR_UNMAPPED;
+    return window;
+}
+
+/**
+ * Gets the next event, and updates the mirrored state of whatever window the
+ * event is about.
+ */
+void MirroredXData::next_event(XEvent &event)
+{
+    m_xdata.next_event(event);
+
+    switch (event.type)
+    {
+    case MapNotify:
+        observe_map_event(event.xmap.window, MIRROR_MAPPED);
+        break;
+    case UnmapNotify:
+        observe_map_event(event.xunmap.window, MIRROR_UNMAPPED);
+        break;
+    case MapRequest:
+    {
+        // Only unmapped windows can ask to be mapped
+        WindowMirror &mirror = m_xmodel.get_mirror(event.xmaprequest.window);
+        if (mirror.pending_map_events == 0)
+            mirror.map_state = MIRROR_UNMAPPED;
+        break;
+    }
+    case ConfigureNotify:
+    {
+        WindowMirror &mirror = m_xmodel.get_mirror(event.xconfigure.window);
+        if (mirror.has_border_width &&
+                mirror.border_width != event.xconfigure.border_width)
+            mirror.has_border_width = false;
+        break;
+    }
+    case DestroyNotify:
+        m_xmodel.forget_mirror(event.xdestroywindow.window);
+        break;
+    }
+}
+
+/**
+ * Maps a window, unless it is already mapped.
+ */
+void MirroredXData::map_win(Window window)
+{
+    WindowMirror &mirror = m_xmodel.get_mirror(window);
+    if (mirror.map_state == MIRROR_MAPPED)
+    {
+        m_stats.add_suppressed(SR_MAP_WIN, 1);
+
+        // The server won't send a MapNotify for this, so there's nothing for
+        // the caller to expect
+        if (mirror.pending_map_events == 0)
+            m_xmodel.clear_effect(window, EXPECT_MAP);
+        return;
+    }
+
+    // If the window's state isn't known, then the map may not change
+    // anything, and thus there's no telling whether a MapNotify will come
+    if (mirror.map_state == MIRROR_UNMAPPED)
+        mirror.pending_map_events++;
+
+    mirror.map_state = MIRROR_MAPPED;
+    m_xdata.map_win(window);
+}
+
+/**
+ * Unmaps a window, unless it is already unmapped.
+ */
+void MirroredXData::unmap_win(Window window)
+{
+    if (mirror_unmap(window))
+        m_xdata.unmap_win(window);
+}
+
+/**
+ * Unmaps several windows, leaving out any that are already unmapped.
+ */
+void MirroredXData::unmap_wins(const std::vector<Window> &windows)
+{
+    std::vector<Window> to_unmap;
+    for (std::vector<Window>::const_iterator window = windows.begin();
+         window != windows.end();
+         window++)
+    {
+        if (mirror_unmap(*window))
+            to_unmap.push_back(*window);
+    }
+
+    m_xdata.unmap_wins(to_unmap);
+}
+
+/**
+ * Destroys a window, and forgets about its state.
+ */
+void MirroredXData::destroy_win(Window window)
+{
+    m_xdata.destroy_win(window);
+    m_xmodel.forget_mirror(window);
+}
+
+/**
+ * Gets the attributes of a window, and remembers its map state and border
+ * width.
+ */
+void MirroredXData::get_attributes(Window window, XWindowAttributes &attrs)
+{
+    m_xdata.get_attributes(window, attrs);
+
+    WindowMirror &mirror = m_xmodel.get_mirror(window);
+    if (mirror.pending_map_events == 0)
+        mirror.map_state =
+            attrs.map_state == IsUnmapped ? MIRROR_UNMAPPED : MIRROR_MAPPED;
+
+    mirror.has_border_width = true;
+    mirror.border_width = attrs.border_width;
+}
+
+/**
+ * Checks whether a window is mapped, and remembers the answer.
+ */
+bool MirroredXData::is_mapped(Window window)
+{
+    bool mapped = m_xdata.is_mapped(window);
+
+    WindowMirror &mirror = m_xmodel.get_mirror(window);
+    if (mirror.pending_map_events == 0)
+        mirror.map_state = mapped ? MIRROR_MAPPED : MIRROR_UNMAPPED;
+
+    return mapped;
+}
+
+/**
+ * Sets the color of a window's border, unless it already has that color.
+ */
+void MirroredXData::set_border_color(Window window, MonoColor color)
+{
+    WindowMirror &mirror = m_xmodel.get_mirror(window);
+    if (mirror.has_border_color && mirror.border_color == color)
+    {
+        m_stats.add_suppressed(SR_SET_BORDER_COLOR, 1);
+        return;
+    }
+
+    mirror.has_border_color = true;
+    mirror.border_color = color;
+    m_xdata.set_border_color(window, color);
+}
+
+/**
+ * Sets the width of a window's border, unless it already has that width.
+ */
+void MirroredXData::set_border_width(Window window, Dimension size)
+{
+    WindowMirror &mirror = m_xmodel.get_mirror(window);
+    if (mirror.has_border_width && mirror.border_width == size)
+    {
+        m_stats.add_suppressed(SR_SET_BORDER_WIDTH, 1);
+        return;
+    }
+
+    mirror.has_border_width = true;
+    mirror.border_width = size;
+    m_xdata.set_border_width(window, size);
+}
+
+/**
+ * Reloads the keyboard mapping, and picks up any modifiers that changed.
+ */
+void MirroredXData::refresh_keyboard_mapping(XEvent &event)
+{
+    m_xdata.refresh_keyboard_mapping(event);
+    copy_flags();
+}
+
+/**
+ * Applies a configure request, keeping track of the window's new border width
+ * if the request changes it.
+ */
+void MirroredXData::forward_configure_request(XEvent &event,
+        unsigned int allowed_flags)
+{
+    m_xdata.forward_configure_request(event, allowed_flags);
+
+    unsigned int changes_flag = event.xconfigurerequest.value_mask;
+    if (allowed_flags != 0)
+        changes_flag &= allowed_flags;
+
+    if (changes_flag & CWBorderWidth)
+    {
+        WindowMirror &mirror = m_xmodel.get_mirror(event.xconfigurerequest.window);
+        mirror.has_border_width = true;
+        mirror.border_width = event.xconfigurerequest.border_width;
+    }
+}
+
+/**
+ * Copies the modifier flags and the XRandR event offset from the XData that
+ * this wraps, since XEvents reads them directly.
+ */
+void MirroredXData::copy_flags()
+{
+    randr_event_offset = m_xdata.randr_event_offset;
+    primary_mod_flag = m_xdata.primary_mod_flag;
+    secondary_mod_flag = m_xdata.secondary_mod_flag;
+    num_mod_flag = m_xdata.num_mod_flag;
+    caps_mod_flag = m_xdata.caps_mod_flag;
+    scroll_mod_flag = m_xdata.scroll_mod_flag;
+}
+
+/**
+ * Records that a window is about to be unmapped.
+ *
+ * @return true if the window has to be unmapped, false if it already is.
+ */
+bool MirroredXData::mirror_unmap(Window window)
+{
+    WindowMirror &mirror = m_xmodel.get_mirror(window);
+    if (mirror.map_state == MIRROR_UNMAPPED)
+    {
+        m_stats.add_suppressed(SR_UNMAP_WIN, 1);
+
+        if (mirror.pending_map_events == 0)
+            m_xmodel.clear_effect(window, EXPECT_UNMAP);
+        return false;
+    }
+
+    // SmallWM's own unmaps never come back as UnmapNotify events (the
+    // substructure events are turned off around them), so there's nothing
+    // to wait for
+    mirror.map_state = MIRROR_UNMAPPED;
+    return true;
+}
+
+/**
+ * Updates a window's map state after a MapNotify or UnmapNotify. While any
+ * MapNotify events for SmallWM's own maps are on their way, the mirror
+ * already has a newer state than the event; otherwise, a client changed the
+ * window itself.
+ */
+void MirroredXData::observe_map_event(Window window, MirrorMapState state)
+{
+    WindowMirror &mirror = m_xmodel.get_mirror(window);
+    if (mirror.pending_map_events > 0)
+    {
+        // Only maps are counted - an UnmapNotify seen now came from before
+        // the map, and is out of date
+        if (state == MIRROR_MAPPED)
+            mirror.pending_map_events--;
+    }
+    else
+        mirror.map_state = state;
+}
@@ -0,0 +1,159 @@
+/** @file */
+#ifndef __SMALLWM_MIRRORED_XDATA__
+#define __SMALLWM_MIRRORED_XDATA__
+
+#include "model/x-model.h"
+#include "common.h"
+#include "stats.h"
+#include "xdata.h"
+
+/**
+ * Sits in front of another XData, and skips requests that wouldn't change
+ * anything on the server - mapping a window which is already mapped, or
+ * setting a border to the color it already has.
+ *
+ * The state of each window is mirrored in the XModel. It is updated by the
+ * requests that go through here, and by the events that SmallWM reads, so
+ * that changes made by clients themselves (like unmapping their own windows)
+ * are picked up. Whenever the state of a window isn't known, requests are
+ * always sent.
+ *
+ * Every request that is skipped is counted as suppressed in the Stats.
+ */
+class MirroredXData : public XData
+{
+public:
+    MirroredXData(XData &xdata, XModel &xmodel, Stats &stats) :
+        m_xdata(xdata), m_xmodel(xmodel), m_stats(stats)
+    {
+        copy_flags();
+    };
+
+    XGC *create_gc(Window window)
+    { return m_xdata.create_gc(window); }
+    Window create_window(bool ignore);
+
+    Atom get_atom(KnownAtom atom)
+    { return m_xdata.get_atom(atom); }
+    void change_property(Window window, KnownAtom prop, Atom type,
+            const unsigned char *data, size_t elems)
+    { m_xdata.change_property(window, prop, type, data, elems); }
+
+    void next_event(XEvent&);
+    void get_latest_event(XEvent &event, int type)
+    { m_xdata.get_latest_event(event, type); }
+
+    void add_hotkey(KeySym key, bool use_secondary_action)
+    { m_xdata.add_hotkey(key, use_secondary_action); }
+    void remove_hotkey(KeySym key, bool use_secondary_action)
+    { m_xdata.remove_hotkey(key, use_secondary_action); }
+    void add_hotkey_mouse(unsigned int button)
+    { m_xdata.add_hotkey_mouse(button); }
+    void remove_hotkey_mouse(unsigned int button)
+    { m_xdata.remove_hotkey_mouse(button); }
+    void clear_hotkeys()
+    { m_xdata.clear_hotkeys(); }
+
+    void confine_pointer(Window window)
+    { m_xdata.confine_pointer(window); }
+    void stop_confining_pointer()
+    { m_xdata.stop_confining_pointer(); }
+    void grab_mouse(Window window)
+    { m_xdata.grab_mouse(window); }
+    void ungrab_mouse(Window window)
+    { m_xdata.ungrab_mouse(window); }
+    bool grab_keyboard()
+    { return m_xdata.grab_keyboard(); }
+    void ungrab_keyboard()
+    { m_xdata.ungrab_keyboard(); }
+
+    void select_input(Window window, long mask)
+    { m_xdata.select_input(window, mask); }
+
+    void get_windows(std::vector<Window> &windows)
+    { m_xdata.get_windows(windows); }
+    void get_pointer_location(Dimension &x, Dimension &y)
+    { m_xdata.get_pointer_location(x, y); }
+
+    Window get_input_focus()
+    { return m_xdata.get_input_focus(); }
+    bool set_input_focus(Window window)
+    { return m_xdata.set_input_focus(window); }
+
+    void map_win(Window);
+    void unmap_win(Window);
+    void unmap_wins(const std::vector<Window>&);
+    void request_close(Window window)
+    { m_xdata.request_close(window); }
+    void destroy_win(Window);
+
+    void get_attributes(Window, XWindowAttributes&);
+    void set_attributes(Window window, XSetWindowAttributes &attrs,
+        unsigned long attrmask)
+    { m_xdata.set_attributes(window, attrs, attrmask); }
+    bool is_mapped(Window);
+    void set_border_color(Window, MonoColor);
+    void set_border_width(Window, Dimension);
+
+    void move_window(Window window, Dimension x, Dimension y)
+    { m_xdata.move_window(window, x, y); }
+    void resize_window(Window window, Dimension width, Dimension height)
+    { m_xdata.resize_window(window, width, height); }
+    void move_resize_window(Window window, Dimension x, Dimension y,
+            Dimension width, Dimension height)
+    { m_xdata.move_resize_window(window, x, y, width, height); }
+    void raise(Window window)
+    { m_xdata.raise(window); }
+    void restack(const std::vector<Window> &windows)
+    { m_xdata.restack(windows); }
+    void draw_outline(const Box &box)
+    { m_xdata.draw_outline(box); }
+
+    bool get_wm_hints(Window window, XWMHints &hints)
+    { return m_xdata.get_wm_hints(window, hints); }
+    void get_size_hints(Window window, XSizeHints &hints)
+    { m_xdata.get_size_hints(window, hints); }
+    Window get_transient_hint(Window window)
+    { return m_xdata.get_transient_hint(window); }
+    void get_icon_name(Window window, std::string &name)
+    { m_xdata.get_icon_name(window, name); }
+    void get_class(Window window, std::string &name)
+    { m_xdata.get_class(window, name); }
+    void get_instance(Window window, std::string &name)
+    { m_xdata.get_instance(window, name); }
+    void get_title(Window window, std::string &title)
+    { m_xdata.get_title(window, title); }
+    void get_role(Window window, std::string &role)
+    { m_xdata.get_role(window, role); }
+    void get_window_type(Window window, std::string &type)
+    { m_xdata.get_window_type(window, type); }
+
+    void get_screen_boxes(std::vector<Box> &boxes)
+    { m_xdata.get_screen_boxes(boxes); }
+
+    KeySym get_keysym(int keycode)
+    { return m_xdata.get_keysym(keycode); }
+    bool is_primary_modifier(int keycode)
+    { return m_xdata.is_primary_modifier(keycode); }
+    void refresh_keyboard_mapping(XEvent&);
+
+    void forward_configure_request(XEvent&, unsigned int);
+    void forward_circulate_request(XEvent &event)
+    { m_xdata.forward_circulate_request(event); }
+
+private:
+    void copy_flags();
+    bool mirror_unmap(Window);
+    void observe_map_event(Window, MirrorMapState);
+
+    /// The XData which actually sends the requests
+    XData &m_xdata;
+
+    /// Where the state of each window is mirrored
+    XModel &m_xmodel;
+
+    /// Where the skipped requests are counted
+    Stats &m_stats;
+};
+
+#endif
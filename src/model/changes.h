@@ -29,6 +29,9 @@ struct Change
     virtual bool is_focus_change() const
     { return false; }
 
+    virtual bool is_focus_preview_change() const
+    { return false; }
+
     virtual bool is_client_desktop_change() const
     { return false; }
 
@@ -131,10 +134,50 @@ static std::ostream &operator<<(std::ostream &out, const ChangeFocus &change)
     return out;
 }
 
+/**
+ * Indicates that a different window is being shown as the one that will be
+ * focused, while the user is still cycling through the focus history. The
+ * input focus itself doesn't move until the cycle is over.
+ */
+struct ChangeFocusPreview : Change
+{
+    ChangeFocusPreview(Window old_preview, Window new_preview) :
+        prev_preview(old_preview), next_preview(new_preview)
+    {};
+
+    bool is_focus_preview_change() const
+    { return true; }
+
+    virtual bool operator==(const Change &other) const
+    {
+        if (!other.is_focus_preview_change())
+            return false;
+
+        const ChangeFocusPreview &cast_other =
+            dynamic_cast<const ChangeFocusPreview&>(other);
+        return (cast_other.prev_preview == prev_preview &&
+                cast_other.next_preview == next_preview);
+    }
+
+    /// The window that was previewed before, or None if this starts a cycle
+    const Window prev_preview;
+
+    /// The window that is previewed now, or None if the cycle is over
+    const Window next_preview;
+};
+
+static std::ostream &operator<<(std::ostream &out,
+        const ChangeFocusPreview &change)
+{
+    out << "[ChangeFocusPreview Window<" << change.prev_preview <<
+        "> ==> Window<" << change.next_preview << ">]";
+    return out;
+}
+
 /// Indicates a change in the desktop of a client
 struct ChangeClientDesktop : Change
 {
-    ChangeClientDesktop(Window win, Desktop *old_desktop, Desktop *new_desktop) :
+    ChangeClientDesktop(Window win, Desktop old_desktop, Desktop new_desktop) :
         window(win), prev_desktop(old_desktop), next_desktop(new_desktop)
     {};
 
@@ -147,48 +190,29 @@ struct ChangeClientDesktop : Change
             return false;
 
         const ChangeClientDesktop &cast_other = dynamic_cast<const ChangeClientDesktop&>(other);
-
-        // This is important - the way that desktop equality is checked below
-        // is that either:
-        //
-        // (1) Both 'prev_desktop' members are NULL OR
-        // (2) Both derefences 'prev_desktop' members are equal.
-        //
-        // If one or the other is NULL, but not both, proceeding onto (2) would
-        // cause the program to crash. We want to avoid that outcome, so the
-        // possibility of either being NULL without them both being NULL is
-        // handled here.
-        if ((cast_other.prev_desktop == 0 && prev_desktop != 0) ||
-                (cast_other.prev_desktop != 0 && prev_desktop == 0))
-            return false;
-
-        if ((cast_other.next_desktop == 0 && next_desktop != 0) ||
-                (cast_other.next_desktop != 0 && next_desktop == 0))
-            return false;
-
         return (cast_other.window == window &&
-                (cast_other.prev_desktop == prev_desktop ||
-                 *cast_other.prev_desktop == *prev_desktop) &&
-                (cast_other.next_desktop == next_desktop ||
-                 *cast_other.next_desktop == *next_desktop));
+                cast_other.prev_desktop == prev_desktop &&
+                cast_other.next_desktop == next_desktop);
     }
 
     const Window window;
-    Desktop * const prev_desktop;
-    Desktop * const next_desktop;
+
+    /// The desktop the client was on, which is DK_NONE for new clients
+    const Desktop prev_desktop;
+    const Desktop next_desktop;
 };
 
 static std::ostream &operator<<(std::ostream &out, const ChangeClientDesktop &change)
 {
     out << "[ChangeClientDesktop Window<" << change.window << "> Desktop("
-        << *change.prev_desktop << "-->" << *change.next_desktop <<  ")]";
+        << change.prev_desktop << "-->" << change.next_desktop <<  ")]";
     return out;
 }
 
 /// Indicates a change in the currently visible desktop
 struct ChangeCurrentDesktop : Change
 {
-    ChangeCurrentDesktop(Desktop * const old_desktop, Desktop * const new_desktop) :
+    ChangeCurrentDesktop(Desktop old_desktop, Desktop new_desktop) :
         prev_desktop(old_desktop), next_desktop(new_desktop)
     {};
 
@@ -202,29 +226,18 @@ struct ChangeCurrentDesktop : Change
 
         const ChangeCurrentDesktop &cast_other =
             dynamic_cast<const ChangeCurrentDesktop&>(other);
-
-        if ((cast_other.prev_desktop == 0 && prev_desktop != 0) ||
-                (cast_other.prev_desktop != 0 && prev_desktop == 0))
-            return false;
-
-        if ((cast_other.next_desktop == 0 && next_desktop != 0) ||
-                (cast_other.next_desktop != 0 && next_desktop == 0))
-            return false;
-
-        return ((cast_other.prev_desktop == prev_desktop ||
-                 *cast_other.prev_desktop == *prev_desktop) &&
-                (cast_other.next_desktop == next_desktop ||
-                 *cast_other.next_desktop == *next_desktop));
+        return (cast_other.prev_desktop == prev_desktop &&
+                cast_other.next_desktop == next_desktop);
     }
 
-    Desktop * const prev_desktop;
-    Desktop * const next_desktop;
+    const Desktop prev_desktop;
+    const Desktop next_desktop;
 };
 
 static std::ostream &operator<<(std::ostream &out, const ChangeCurrentDesktop &change)
 {
-    out << "[ChangeCurrentDesktop Desktop(" << *change.prev_desktop << "-->" <<
-        *change.next_desktop << ")]";
+    out << "[ChangeCurrentDesktop Desktop(" << change.prev_desktop << "-->" <<
+        change.next_desktop << ")]";
     return out;
 }
 
@@ -354,7 +367,7 @@ static std::ostream &operator<<(std::ostream &out, const ChangeSize &change)
 /// Indicates that a client has been removed from the model
 struct DestroyChange : Change
 {
-    DestroyChange(Window win, Desktop *old_desktop, Layer old_layer) :
+    DestroyChange(Window win, Desktop old_desktop, Layer old_layer) :
         window(win), desktop(old_desktop), layer(old_layer)
     {};
 
@@ -369,13 +382,12 @@ struct DestroyChange : Change
         const DestroyChange &cast_other =
             dynamic_cast<const DestroyChange&>(other);
         return (cast_other.window == window &&
-                (cast_other.desktop == desktop ||
-                 *cast_other.desktop == *desktop) &&
+                cast_other.desktop == desktop &&
                 cast_other.layer == layer);
     }
 
     const Window window;
-    Desktop * const desktop;
+    const Desktop desktop;
     const Layer layer;
 };
 
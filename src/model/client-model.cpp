@@ -14,28 +14,15 @@ bool ClientModel::is_client(Window client)
  */
 bool ClientModel::is_visible(Window client)
 {
-    Desktop* desktop_of = m_desktops.get_category_of(client);
-    if (desktop_of->is_all_desktop())
-        return true;
-
-    if (desktop_of->is_user_desktop())
-        return *desktop_of == *m_current_desktop;
-
-    return false;
+    return is_visible_desktop(m_desktops.get_category_of(client));
 }
 
 /**
  * Returns whether a particular desktop as a whole is visible.
  */
-bool ClientModel::is_visible_desktop(Desktop* desktop)
+bool ClientModel::is_visible_desktop(Desktop desktop)
 {
-    if (desktop->is_all_desktop())
-        return true;
-
-    if (desktop->is_user_desktop())
-        return *desktop == *m_current_desktop;
-
-    return false;
+    return desktop.is_all_desktop() || desktop == m_current_desktop;
 }
 
 /**
@@ -49,7 +36,7 @@ bool ClientModel::is_child(Window child)
 /**
  * Gets a list of all of the clients on a desktop.
  */
-void ClientModel::get_clients_of(Desktop *desktop, std::vector<Window> &return_clients)
+void ClientModel::get_clients_of(Desktop desktop, std::vector<Window> &return_clients)
 {
     for (client_iter iter = m_desktops.get_members_of_begin(desktop);
             iter != m_desktops.get_members_of_end(desktop);
@@ -57,6 +44,34 @@ void ClientModel::get_clients_of(Desktop *desktop, std::vector<Window> &return_c
         return_clients.push_back(*iter);
 }
 
+/**
+ * Compares the clients on two desktops. Since each desktop's clients are kept
+ * sorted, this is a single pass over both of them.
+ *
+ * @param old_desktop The desktop being switched away from.
+ * @param new_desktop The desktop being switched to.
+ * @param[out] only_old The clients on the old desktop, but not the new one.
+ * @param[out] only_new The clients on the new desktop, but not the old one.
+ */
+void ClientModel::get_desktop_diff(Desktop old_desktop, Desktop new_desktop,
+                                   std::vector<Window> &only_old,
+                                   std::vector<Window> &only_new)
+{
+    std::set_difference(
+        m_desktops.get_members_of_begin(old_desktop),
+        m_desktops.get_members_of_end(old_desktop),
+        m_desktops.get_members_of_begin(new_desktop),
+        m_desktops.get_members_of_end(new_desktop),
+        std::back_inserter(only_old));
+
+    std::set_difference(
+        m_desktops.get_members_of_begin(new_desktop),
+        m_desktops.get_members_of_end(new_desktop),
+        m_desktops.get_members_of_begin(old_desktop),
+        m_desktops.get_members_of_end(old_desktop),
+        std::back_inserter(only_new));
+}
+
 /**
  * Gets a list of all of the visible clients.
  */
@@ -73,6 +88,23 @@ void ClientModel::get_visible_clients(std::vector<Window> &return_clients)
         return_clients.push_back(*iter);
 }
 
+/**
+ * Gets a list of every client, along with every child of every client, no
+ * matter whether they are visible or not.
+ */
+void ClientModel::get_all_clients(std::vector<Window> &return_clients)
+{
+    for (std::map<Window, Dimension2D>::iterator iter = m_location.begin();
+            iter != m_location.end();
+            iter++)
+        return_clients.push_back(iter->first);
+
+    for (std::map<Window, Window>::iterator iter = m_parents.begin();
+            iter != m_parents.end();
+            iter++)
+        return_clients.push_back(iter->first);
+}
+
 /**
  * Gets all of the visible windows, but sorted by layer from bottom to
  * top.
@@ -129,12 +161,13 @@ void ClientModel::add_client(Window client, InitialState state,
     {
         case IS_VISIBLE:
             m_desktops.add_member(m_current_desktop, client);
-            m_changes.push(new ChangeClientDesktop(client, 0,
+            m_changes.push(new ChangeClientDesktop(client, Desktop(),
                         m_current_desktop));
             break;
         case IS_HIDDEN:
             m_desktops.add_member(ICON_DESKTOP, client);
-            m_changes.push(new ChangeClientDesktop(client, 0, ICON_DESKTOP));
+            m_changes.push(new ChangeClientDesktop(client, Desktop(),
+                        ICON_DESKTOP));
             break;
     }
 
@@ -146,23 +179,11 @@ void ClientModel::add_client(Window client, InitialState state,
     m_location[client] = location;
     m_size[client] = size;
     m_cps_mode[client] = CPS_FLOATING;
-
-    Crt *current_screen = m_crt_manager.screen_of_coord(DIM2D_X(location), DIM2D_Y(location));
-    if (!current_screen)
-    {
-        // No monitor ever contains a negative screen
-        const Box invalid_box(-1, -1, 0, 0);
-        m_screen.insert(std::pair<Window, const Box>(client, invalid_box));
-    }
-    else
-    {
-        const Box &screen_box = m_crt_manager.box_of_screen(current_screen);
-        m_screen.insert(std::pair<Window, const Box>(client, screen_box));
-    }
+    set_initial_screen(client);
 
     if (autofocus)
     {
-        m_current_desktop->focus_cycle.add(client);
+        m_focus_cycles[m_current_desktop.index()].add(client);
 
         set_autofocus(client, true);
         focus(client);
@@ -190,18 +211,16 @@ void ClientModel::remove_client(Window client)
     // keep a copy of each of the categories so we can pass it on to notify
     // that the window was destroyed (don't copy the size/location though,
     // since they will most likely be invalid, and of no use anyway)
-    Desktop *desktop = find_desktop(client);
+    Desktop desktop = find_desktop(client);
     Layer layer = find_layer(client);
 
-    if (desktop->is_user_desktop())
-    {
-        UserDesktop *user_desktop = dynamic_cast<UserDesktop*>(desktop);
-        user_desktop->focus_cycle.remove(client, true);
-        sync_focus_to_cycle();
-    }
-    else if (desktop->is_all_desktop())
+    drop_focus_preview(client);
+    forget_focus_history(client);
+
+    FocusCycle *cycle = get_focus_cycle(desktop);
+    if (cycle)
     {
-        dynamic_cast<AllDesktops*>(ALL_DESKTOPS)->focus_cycle.remove(client, true);
+        cycle->remove(client, true);
         sync_focus_to_cycle();
     }
 
@@ -242,29 +261,15 @@ void ClientModel::remap_client(Window client)
     std::vector<Window> children;
     get_children_of(client, children);
 
-    Desktop *desktop = find_desktop(client);
-    if (desktop->is_user_desktop())
-    {
-        UserDesktop *user_desktop = dynamic_cast<UserDesktop*>(desktop);
-        user_desktop->focus_cycle.add(client);
-        for (std::vector<Window>::iterator child = children.begin();
-             child != children.end();
-             child++)
-        {
-            user_desktop->focus_cycle.add(*child);
-        }
-
-        focus(client);
-    }
-    else if (desktop->is_all_desktop())
+    FocusCycle *cycle = get_focus_cycle(find_desktop(client));
+    if (cycle)
     {
-        AllDesktops *all_desktop = dynamic_cast<AllDesktops*>(ALL_DESKTOPS);
-        all_desktop->focus_cycle.add(client);
+        cycle->add(client);
         for (std::vector<Window>::iterator child = children.begin();
              child != children.end();
              child++)
         {
-            all_desktop->focus_cycle.add(*child);
+            cycle->add(*child);
         }
 
         focus(client);
@@ -288,31 +293,19 @@ void ClientModel::unmap_client(Window client)
     std::vector<Window> children;
     get_children_of(client, children);
 
-    Desktop *desktop = find_desktop(client);
-    if (desktop->is_user_desktop())
-    {
-        UserDesktop *user_desktop = dynamic_cast<UserDesktop*>(desktop);
-        for (std::vector<Window>::iterator child = children.begin();
-             child != children.end();
-             child++)
-        {
-            user_desktop->focus_cycle.remove(*child, false);
-        }
+    drop_focus_preview(client);
 
-        user_desktop->focus_cycle.remove(client, false);
-        sync_focus_to_cycle();
-    }
-    else if (desktop->is_all_desktop())
+    FocusCycle *cycle = get_focus_cycle(find_desktop(client));
+    if (cycle)
     {
-        AllDesktops *all_desktop = dynamic_cast<AllDesktops*>(ALL_DESKTOPS);
         for (std::vector<Window>::iterator child = children.begin();
              child != children.end();
              child++)
         {
-            all_desktop->focus_cycle.remove(*child, false);
+            cycle->remove(*child, false);
         }
 
-        all_desktop->focus_cycle.remove(client, false);
+        cycle->remove(client, false);
         sync_focus_to_cycle();
     }
 
@@ -337,7 +330,7 @@ void ClientModel::add_child(Window client, Window child)
 
     if (is_autofocusable(client))
     {
-        m_current_desktop->focus_cycle.add_after(child, client);
+        m_focus_cycles[m_current_desktop.index()].add_after(child, client);
         focus(child);
     }
 }
@@ -350,6 +343,9 @@ void ClientModel::remove_child(Window child, bool focus_parent)
     if (!is_child(child))
         return;
 
+    drop_focus_preview(child);
+    forget_focus_history(child);
+
     Window parent = m_parents[child];
     m_children[parent]->erase(child);
     m_parents.erase(child);
@@ -362,14 +358,9 @@ void ClientModel::remove_child(Window child, bool focus_parent)
             unfocus();
     }
 
-    Desktop *desktop = find_desktop(parent);
-    if (desktop->is_user_desktop())
-    {
-        UserDesktop *user_desktop = dynamic_cast<UserDesktop*>(desktop);
-        user_desktop->focus_cycle.remove(child, false);
-    }
-    else if (desktop->is_all_desktop())
-        dynamic_cast<AllDesktops*>(ALL_DESKTOPS)->focus_cycle.remove(child, false);
+    FocusCycle *cycle = get_focus_cycle(find_desktop(parent));
+    if (cycle)
+        cycle->remove(child, false);
 
     m_changes.push(new ChildRemoveChange(parent, child));
 }
@@ -496,7 +487,7 @@ void ClientModel::repack_corner(PackCorner corner)
  */
 void ClientModel::cycle_focus_forward()
 {
-    m_current_desktop->focus_cycle.forward();
+    m_focus_cycles[m_current_desktop.index()].forward();
     sync_focus_to_cycle();
 }
 
@@ -505,10 +496,69 @@ void ClientModel::cycle_focus_forward()
  */
 void ClientModel::cycle_focus_backward()
 {
-    m_current_desktop->focus_cycle.backward();
+    m_focus_cycles[m_current_desktop.index()].backward();
     sync_focus_to_cycle();
 }
 
+/**
+ * Previews the window which was focused before the one that is currently
+ * previewed (or focused, if this starts a new cycle), without focusing it.
+ */
+void ClientModel::preview_focus_forward()
+{
+    preview_focus(true);
+}
+
+/**
+ * Previews the window which was focused after the one that is currently
+ * previewed, without focusing it.
+ */
+void ClientModel::preview_focus_backward()
+{
+    preview_focus(false);
+}
+
+/**
+ * Gets the window which is being previewed.
+ *
+ * @return The previewed window, or None if the user isn't cycling.
+ */
+Window ClientModel::get_focus_preview() const
+{
+    return m_focus_preview;
+}
+
+/**
+ * Ends the current cycle through the focus history, and focuses the window
+ * which was previewed last.
+ */
+void ClientModel::commit_focus_preview()
+{
+    if (m_focus_preview == None)
+        return;
+
+    Window chosen = m_focus_preview;
+    m_focus_preview = None;
+    m_changes.push(new ChangeFocusPreview(chosen, None));
+
+    if (chosen != m_focused)
+        focus(chosen);
+}
+
+/**
+ * Ends the current cycle through the focus history, leaving the focus where
+ * it is.
+ */
+void ClientModel::cancel_focus_preview()
+{
+    if (m_focus_preview == None)
+        return;
+
+    Window old_preview = m_focus_preview;
+    m_focus_preview = None;
+    m_changes.push(new ChangeFocusPreview(old_preview, None));
+}
+
 /**
  * Gets  the position/scale mode of a client.
  */
@@ -580,6 +630,42 @@ void ClientModel::update_size(Window client, Dimension width, Dimension height)
         m_size[client] = Dimension2D(width, height);
 }
 
+/**
+ * Updates the location of a client without causing a change.
+ *
+ * Like update_size, this is for when the client moved itself.
+ */
+void ClientModel::update_location(Window client, Dimension x, Dimension y)
+{
+    m_location[client] = Dimension2D(x, y);
+}
+
+/**
+ * Gets the last known location of a client, or (0, 0) if the client isn't
+ * known.
+ */
+Dimension2D ClientModel::get_location(Window client) const
+{
+    std::map<Window, Dimension2D>::const_iterator location =
+        m_location.find(client);
+    if (location == m_location.end())
+        return Dimension2D(0, 0);
+
+    return location->second;
+}
+
+/**
+ * Gets the last known size of a client, or (0, 0) if the client isn't known.
+ */
+Dimension2D ClientModel::get_size(Window client) const
+{
+    std::map<Window, Dimension2D>::const_iterator size = m_size.find(client);
+    if (size == m_size.end())
+        return Dimension2D(0, 0);
+
+    return size->second;
+}
+
 /**
  * Gets the currently focused window.
  */
@@ -633,10 +719,15 @@ void ClientModel::focus(Window client)
     if (!m_autofocus[parent])
         return;
 
+    // Focusing anything while the user is cycling means that they've gone
+    // somewhere else
+    cancel_focus_preview();
+
     Window old_focus = m_focused;
     m_focused = client;
 
-    m_current_desktop->focus_cycle.set(client);
+    m_focus_cycles[m_current_desktop.index()].set(client);
+    m_focus_histories[m_current_desktop.index()].touch(client);
     m_changes.push(new ChangeFocus(old_focus, client));
 }
 
@@ -652,10 +743,13 @@ void ClientModel::force_focus(Window client)
     if (!is_visible(parent))
         return;
 
+    cancel_focus_preview();
+
     Window old_focus = m_focused;
     m_focused = client;
 
-    m_current_desktop->focus_cycle.set(client);
+    m_focus_cycles[m_current_desktop.index()].set(client);
+    m_focus_histories[m_current_desktop.index()].touch(client);
     m_changes.push(new ChangeFocus(old_focus, client));
 }
 
@@ -683,7 +777,7 @@ void ClientModel::unfocus(bool invalidate_cycle)
         m_focused = None;
 
         if (invalidate_cycle)
-            m_current_desktop->focus_cycle.unset();
+            m_focus_cycles[m_current_desktop.index()].unset();
 
         m_changes.push(new ChangeFocus(old_focus, None));
     }
@@ -705,24 +799,120 @@ void ClientModel::unfocus_if_focused(Window client)
  */
 void ClientModel::sync_focus_to_cycle()
 {
-    FocusCycle &cycle = m_current_desktop->focus_cycle;
+    FocusCycle &cycle = m_focus_cycles[m_current_desktop.index()];
     if (!cycle.valid())
         unfocus();
     else if (cycle.get() != m_focused)
         focus(cycle.get());
 }
 
+/**
+ * Moves the focus preview one step through the current desktop's focus
+ * history, skipping over windows which can't be focused right now.
+ *
+ * @param older true to move towards less recently focused windows, false to
+ *              move towards more recently focused ones.
+ */
+void ClientModel::preview_focus(bool older)
+{
+    FocusHistory &history = m_focus_histories[m_current_desktop.index()];
+    Window candidate =
+        m_focus_preview != None ? m_focus_preview : m_focused;
+
+    // Each window is tried at most once, wrapping around at either end of the
+    // history
+    Window next_preview = None;
+    for (size_t tries = 0; tries < history.size(); tries++)
+    {
+        if (older)
+            candidate = history.after(candidate);
+        else
+            candidate = history.before(candidate);
+
+        if (candidate == None)
+            candidate = older ? history.front() : history.back();
+
+        if (can_preview(candidate))
+        {
+            next_preview = candidate;
+            break;
+        }
+    }
+
+    if (next_preview == None || next_preview == m_focus_preview)
+        return;
+
+    m_changes.push(new ChangeFocusPreview(m_focus_preview, next_preview));
+    m_focus_preview = next_preview;
+}
+
+/**
+ * Checks whether a window from the focus history could be focused right now.
+ */
+bool ClientModel::can_preview(Window window)
+{
+    Window parent = window;
+    if (is_child(window))
+        parent = get_parent_of(window);
+
+    return is_client(parent) && is_visible(parent) && m_autofocus[parent];
+}
+
+/**
+ * Ends the current cycle through the focus history if it is previewing
+ * either the given client, or one of its children.
+ */
+void ClientModel::drop_focus_preview(Window client)
+{
+    if (m_focus_preview == None)
+        return;
+
+    if (m_focus_preview == client ||
+            (is_child(m_focus_preview) &&
+             get_parent_of(m_focus_preview) == client))
+        cancel_focus_preview();
+}
+
+/**
+ * Removes a window from the focus history of every desktop.
+ */
+void ClientModel::forget_focus_history(Window window)
+{
+    for (std::vector<FocusHistory>::iterator history =
+             m_focus_histories.begin();
+         history != m_focus_histories.end();
+         history++)
+        history->remove(window);
+}
+
+/**
+ * Gets the focus cycle that the clients on a desktop belong to.
+ *
+ * @return The cycle, or NULL if the desktop doesn't have one (because
+ *         nothing on it can be focused).
+ */
+FocusCycle *ClientModel::get_focus_cycle(Desktop desktop)
+{
+    if (desktop.is_user_desktop())
+        return &m_focus_cycles[desktop.index()];
+    else if (desktop.is_all_desktop())
+        return &m_all_focus_cycle;
+    else
+        return NULL;
+}
+
 /**
  * Gets the current desktop which the client inhabits.
  *
- * You should _NEVER_ free the value returned by this function.
+ * @return The desktop, which is the DK_NONE desktop if the window isn't a
+ *         client.
  */
-Desktop* ClientModel::find_desktop(Window client)
+Desktop ClientModel::find_desktop(Window client)
 {
     if (m_desktops.is_member(client))
         return m_desktops.get_category_of(client);
     else
-        return static_cast<Desktop*>(0);
+        return Desktop();
 }
 
 /**
@@ -786,8 +976,8 @@ void ClientModel::toggle_stick(Window client)
     if (!is_visible(client))
         return;
 
-    Desktop* old_desktop = m_desktops.get_category_of(client);
-    if (old_desktop->is_user_desktop())
+    Desktop old_desktop = m_desktops.get_category_of(client);
+    if (old_desktop.is_user_desktop())
         move_to_desktop(client, ALL_DESKTOPS, false);
     else
         move_to_desktop(client, m_current_desktop, false);
@@ -803,8 +993,8 @@ void ClientModel::toggle_stick(Window client)
  */
 void ClientModel::client_reset_desktop(Window client)
 {
-    Desktop* old_desktop = m_desktops.get_category_of(client);
-    if (!old_desktop->is_user_desktop())
+    Desktop old_desktop = m_desktops.get_category_of(client);
+    if (!old_desktop.is_user_desktop())
         return;
 
     move_to_desktop(client, m_current_desktop, false);
@@ -815,12 +1005,11 @@ void ClientModel::client_reset_desktop(Window client)
  */
 void ClientModel::client_next_desktop(Window client)
 {
-    Desktop* old_desktop = m_desktops.get_category_of(client);
-    if (!old_desktop->is_user_desktop())
+    Desktop old_desktop = m_desktops.get_category_of(client);
+    if (!old_desktop.is_user_desktop())
         return;
 
-    UserDesktop* user_desktop = dynamic_cast<UserDesktop*>(old_desktop);
-    unsigned long long desktop_index = user_desktop->desktop;
+    unsigned long long desktop_index = old_desktop.index();
     desktop_index  = (desktop_index + 1) % m_max_desktops;
     move_to_desktop(client, USER_DESKTOPS[desktop_index], true);
 }
@@ -830,12 +1019,11 @@ void ClientModel::client_next_desktop(Window client)
  */
 void ClientModel::client_prev_desktop(Window client)
 {
-    Desktop* old_desktop = m_desktops.get_category_of(client);
-    if (!old_desktop->is_user_desktop())
+    Desktop old_desktop = m_desktops.get_category_of(client);
+    if (!old_desktop.is_user_desktop())
         return;
 
-    UserDesktop* user_desktop = dynamic_cast<UserDesktop*>(old_desktop);
-    unsigned long long desktop_index = user_desktop->desktop;
+    unsigned long long desktop_index = old_desktop.index();
     desktop_index = (desktop_index - 1 + m_max_desktops)
         % m_max_desktops;
     move_to_desktop(client, USER_DESKTOPS[desktop_index], true);
@@ -847,14 +1035,16 @@ void ClientModel::client_prev_desktop(Window client)
 void ClientModel::next_desktop()
 {
     unsigned long long desktop_index =
-        (m_current_desktop->desktop + 1) % m_max_desktops;
+        (m_current_desktop.index() + 1) % m_max_desktops;
 
     // We can't change while a window is being moved or resized
     if (m_desktops.count_members_of(MOVING_DESKTOP) > 0 ||
             m_desktops.count_members_of(RESIZING_DESKTOP) > 0)
         return;
 
-    UserDesktop* old_desktop = m_current_desktop;
+    cancel_focus_preview();
+
+    Desktop old_desktop = m_current_desktop;
     m_current_desktop = USER_DESKTOPS[desktop_index];
 
     Window old_focus = m_focused;
@@ -872,7 +1062,10 @@ void ClientModel::next_desktop()
     // If we can still focus the window we were focused on before, then do so
     // Otherwise, figure out the next logical window in the focus cycle
     if (m_focused != None && m_focused == old_focus)
-        m_current_desktop->focus_cycle.set(m_focused);
+    {
+        m_focus_cycles[m_current_desktop.index()].set(m_focused);
+        m_focus_histories[m_current_desktop.index()].touch(m_focused);
+    }
     else
         sync_focus_to_cycle();
 }
@@ -885,7 +1078,7 @@ void ClientModel::prev_desktop()
     // We have to add the maximum desktops back in, since C++ doesn't
     // guarantee what will happen with a negative modulus
     unsigned long long desktop_index =
-        (m_current_desktop->desktop - 1 + m_max_desktops)
+        (m_current_desktop.index() - 1 + m_max_desktops)
         % m_max_desktops;
 
     // We can't change while a window is being moved or resized
@@ -893,7 +1086,9 @@ void ClientModel::prev_desktop()
             m_desktops.count_members_of(RESIZING_DESKTOP) > 0)
         return;
 
-    UserDesktop* old_desktop = m_current_desktop;
+    cancel_focus_preview();
+
+    Desktop old_desktop = m_current_desktop;
     m_current_desktop = USER_DESKTOPS[desktop_index];
 
     Window old_focus = m_focused;
@@ -911,7 +1106,10 @@ void ClientModel::prev_desktop()
     // If we can still focus the window we were focused on before, then do so
     // Otherwise, figure out the next logical window in the focus cycle
     if (m_focused != None && m_focused == old_focus)
-        m_current_desktop->focus_cycle.set(m_focused);
+    {
+        m_focus_cycles[m_current_desktop.index()].set(m_focused);
+        m_focus_histories[m_current_desktop.index()].touch(m_focused);
+    }
     else
         sync_focus_to_cycle();
 }
@@ -921,14 +1119,14 @@ void ClientModel::prev_desktop()
  */
 void ClientModel::iconify(Window client)
 {
-    Desktop* old_desktop = m_desktops.get_category_of(client);
+    Desktop old_desktop = m_desktops.get_category_of(client);
 
-    if (old_desktop->is_icon_desktop())
+    if (old_desktop.is_icon_desktop())
         return;
     else if (!is_visible(client))
         return;
 
-    m_was_stuck[client] = old_desktop->is_all_desktop();
+    m_was_stuck[client] = old_desktop.is_all_desktop();
 
     move_to_desktop(client, ICON_DESKTOP, true);
 }
@@ -938,8 +1136,8 @@ void ClientModel::iconify(Window client)
  */
 void ClientModel::deiconify(Window client)
 {
-    Desktop* old_desktop = m_desktops.get_category_of(client);
-    if (!old_desktop->is_icon_desktop())
+    Desktop old_desktop = m_desktops.get_category_of(client);
+    if (!old_desktop.is_icon_desktop())
         return;
 
     // If the client was stuck before it was iconified, then respect that
@@ -960,7 +1158,7 @@ void ClientModel::start_moving(Window client)
     if (!is_visible(client))
         return;
 
-    Desktop* old_desktop = m_desktops.get_category_of(client);
+    Desktop old_desktop = m_desktops.get_category_of(client);
 
     // Only one window, at max, can be either moved or resized
     if (m_desktops.count_members_of(MOVING_DESKTOP) > 0 ||
@@ -968,7 +1166,7 @@ void ClientModel::start_moving(Window client)
         return;
 
     change_mode(client, CPS_FLOATING);
-    m_was_stuck[client] = old_desktop->is_all_desktop();
+    m_was_stuck[client] = old_desktop.is_all_desktop();
     move_to_desktop(client, MOVING_DESKTOP, true);
 }
 
@@ -977,8 +1175,8 @@ void ClientModel::start_moving(Window client)
  */
 void ClientModel::stop_moving(Window client, Dimension2D location)
 {
-    Desktop* old_desktop = m_desktops.get_category_of(client);
-    if (!old_desktop->is_moving_desktop())
+    Desktop old_desktop = m_desktops.get_category_of(client);
+    if (!old_desktop.is_moving_desktop())
         return;
 
     if (m_was_stuck[client])
@@ -999,7 +1197,7 @@ void ClientModel::start_resizing(Window client)
     if (!is_visible(client))
         return;
 
-    Desktop* old_desktop = m_desktops.get_category_of(client);
+    Desktop old_desktop = m_desktops.get_category_of(client);
 
     // Only one window, at max, can be either moved or resized
     if (m_desktops.count_members_of(MOVING_DESKTOP) > 0 ||
@@ -1007,7 +1205,7 @@ void ClientModel::start_resizing(Window client)
         return;
 
     change_mode(client, CPS_FLOATING);
-    m_was_stuck[client] = old_desktop->is_all_desktop();
+    m_was_stuck[client] = old_desktop.is_all_desktop();
     move_to_desktop(client, RESIZING_DESKTOP, true);
 }
 
@@ -1016,8 +1214,8 @@ void ClientModel::start_resizing(Window client)
  */
 void ClientModel::stop_resizing(Window client, Dimension2D size)
 {
-    Desktop* old_desktop = m_desktops.get_category_of(client);
-    if (!old_desktop->is_resizing_desktop())
+    Desktop old_desktop = m_desktops.get_category_of(client);
+    if (!old_desktop.is_resizing_desktop())
         return;
 
     if (m_was_stuck[client])
@@ -1167,123 +1365,197 @@ void ClientModel::update_screens(std::vector<Box> &bounds)
 }
 
 /**
- * Converts the client model to a textual representation, which is written to
- * an output stream.
+ * Changes the width of the clients' borders, which the packer uses to space
+ * out the packed clients.
  */
-void ClientModel::dump(std::ostream &output)
+void ClientModel::set_border_width(Dimension border_width)
 {
-    output << "Current Desktop: " << std::dec
-           << m_current_desktop->desktop << "\n";
+    if (border_width == m_border_width)
+        return;
 
-    output << "Current Focus: " << std::hex << m_focused << "\n";
+    m_border_width = border_width;
 
-    std::vector<Window> windows;
-    output << "Icon Desktop\n";
-    get_clients_of(ICON_DESKTOP, windows);
-    for (std::vector<Window>::iterator winiter = windows.begin();
-         winiter != windows.end();
-         winiter++)
+    repack_corner(PACK_NORTHEAST);
+    repack_corner(PACK_NORTHWEST);
+    repack_corner(PACK_SOUTHEAST);
+    repack_corner(PACK_SOUTHWEST);
+}
+
+/**
+ * Gets the index of the user desktop which is currently visible.
+ */
+unsigned long long ClientModel::get_current_desktop() const
+{
+    return m_current_desktop.index();
+}
+
+/**
+ * Gets everything that is known about a client, so that it can be restored
+ * later by restore_client().
+ *
+ * Clients which are being moved or resized are saved as they were before
+ * the move or resize started, on the current desktop.
+ */
+void ClientModel::get_client_state(Window client, ClientState &state)
+{
+    Desktop desktop = m_desktops.get_category_of(client);
+
+    state.client = client;
+    state.desktop = m_current_desktop.index();
+    state.iconified = desktop.is_icon_desktop();
+
+    if (desktop.is_user_desktop())
     {
-        dump_client_info(*winiter, output);
+        state.desktop = desktop.index();
+        state.stuck = false;
     }
-    windows.clear();
+    else if (desktop.is_all_desktop())
+        state.stuck = true;
+    else
+        state.stuck = m_was_stuck[client];
+
+    state.layer = m_layers.get_category_of(client);
+    state.location = m_location[client];
+    state.size = m_size[client];
+    state.mode = m_cps_mode[client];
+    state.autofocus = m_autofocus[client];
 
-    output << "Moving Desktop\n";
-    get_clients_of(MOVING_DESKTOP, windows);
-    for (std::vector<Window>::iterator winiter = windows.begin();
-         winiter != windows.end();
-         winiter++)
+    state.packed = is_packed_client(client);
+    if (state.packed)
     {
-        dump_client_info(*winiter, output);
+        state.pack_corner = m_pack_corners[client];
+        state.pack_priority = m_pack_priority[client];
     }
-    windows.clear();
 
-    output << "Resizing Desktop\n";
-    get_clients_of(RESIZING_DESKTOP, windows);
-    for (std::vector<Window>::iterator winiter = windows.begin();
-         winiter != windows.end();
-         winiter++)
+    state.children.assign(m_children[client]->begin(),
+                          m_children[client]->end());
+}
+
+/**
+ * Adds a client whose state was saved by get_client_state().
+ *
+ * Unlike add_client(), this doesn't focus the client, and the only changes
+ * that are pushed are the ones that are needed to set up the client's window
+ * and its icon - everything else (the location, size and mode) is assumed to
+ * already be in effect on the server.
+ */
+void ClientModel::restore_client(const ClientState &state)
+{
+    Window client = state.client;
+    if (is_client(client) || is_child(client))
+        return;
+
+    if (DIM2D_WIDTH(state.size) <= 0 || DIM2D_HEIGHT(state.size) <= 0)
+        return;
+
+    // The number of desktops may have changed since the state was saved
+    Desktop desktop;
+    if (state.iconified)
     {
-        dump_client_info(*winiter, output);
+        desktop = ICON_DESKTOP;
+        m_was_stuck[client] = state.stuck;
     }
-    windows.clear();
+    else if (state.stuck)
+        desktop = ALL_DESKTOPS;
+    else
+        desktop = USER_DESKTOPS[state.desktop % m_max_desktops];
 
-    for (int desktop = 0; desktop < USER_DESKTOPS.size(); desktop++)
-    {
-        output << "User Desktop " << desktop << "\n";
-        get_clients_of(USER_DESKTOPS[desktop], windows);
-        for (std::vector<Window>::iterator winiter = windows.begin();
-            winiter != windows.end();
-            winiter++)
-        {
-            dump_client_info(*winiter, output);
-        }
-        windows.clear();
+    FocusCycle *cycle = get_focus_cycle(desktop);
+    m_desktops.add_member(desktop, client);
+    m_changes.push(new ChangeClientDesktop(client, Desktop(), desktop));
+
+    Layer layer = state.layer;
+    if (!m_layers.is_category(layer))
+        layer = DEF_LAYER;
+
+    m_layers.add_member(layer, client);
+    m_changes.push(new ChangeLayer(client, layer));
+
+    m_location[client] = state.location;
+    m_size[client] = state.size;
+    m_cps_mode[client] = state.mode;
+    set_initial_screen(client);
+
+    m_autofocus[client] = state.autofocus;
+    if (!state.autofocus)
+        cycle = 0;
 
-        USER_DESKTOPS[desktop]->focus_cycle.dump(output, 0);
+    if (cycle)
+        cycle->add(client);
+
+    if (state.packed)
+    {
+        m_pack_corners[client] = state.pack_corner;
+        m_pack_priority[client] = state.pack_priority;
     }
 
-    output << "All Desktop\n";
-    get_clients_of(ALL_DESKTOPS, windows);
-    for (std::vector<Window>::iterator winiter = windows.begin();
-         winiter != windows.end();
-         winiter++)
+    m_children[client] = new std::set<Window>();
+    for (std::vector<Window>::const_iterator child = state.children.begin();
+            child != state.children.end();
+            child++)
     {
-        dump_client_info(*winiter, output);
+        if (is_client(*child) || is_child(*child))
+            continue;
+
+        m_children[client]->insert(*child);
+        m_parents[*child] = client;
+        m_changes.push(new ChildAddChange(client, *child));
+
+        if (cycle)
+            cycle->add_after(*child, client);
     }
-    windows.clear();
+}
+
+/**
+ * Switches to a desktop which was saved by get_current_desktop(). This is
+ * meant to be used before any clients are restored, since it doesn't
+ * remap anything.
+ */
+void ClientModel::restore_current_desktop(unsigned long long desktop)
+{
+    m_current_desktop = USER_DESKTOPS[desktop % m_max_desktops];
+
+    // Both sides of the change are the same, since the clients on the new
+    // desktop are already visible and nothing has to be remapped - this is
+    // only for anyone who is keeping track of the current desktop
+    m_changes.push(new ChangeCurrentDesktop(m_current_desktop,
+                                            m_current_desktop));
 }
 
 /**
  * Moves a client between two desktops and fires the resulting event.
  */
-void ClientModel::move_to_desktop(Window client, Desktop* new_desktop, bool should_unfocus)
+void ClientModel::move_to_desktop(Window client, Desktop new_desktop, bool should_unfocus)
 {
-    Desktop* old_desktop = m_desktops.get_category_of(client);
-    if (*old_desktop == *new_desktop)
+    Desktop old_desktop = m_desktops.get_category_of(client);
+    if (old_desktop == new_desktop)
         return;
 
+    drop_focus_preview(client);
+
     bool can_focus = m_autofocus[client];
     m_desktops.move_member(client, new_desktop);
 
-    if (can_focus && old_desktop->is_user_desktop())
-    {
-        UserDesktop *user_desktop = dynamic_cast<UserDesktop*>(old_desktop);
-        user_desktop->focus_cycle.remove(client, false);
-
-        for (std::set<Window>::iterator child = m_children[client]->begin();
-                child != m_children[client]->end();
-                child++)
-            user_desktop->focus_cycle.remove(*child, false);
-    }
-    else if (can_focus && old_desktop->is_all_desktop())
+    FocusCycle *old_cycle = get_focus_cycle(old_desktop);
+    if (can_focus && old_cycle)
     {
-        dynamic_cast<AllDesktops*>(ALL_DESKTOPS)->focus_cycle.remove(client, false);
+        old_cycle->remove(client, false);
 
         for (std::set<Window>::iterator child = m_children[client]->begin();
                 child != m_children[client]->end();
                 child++)
-            dynamic_cast<AllDesktops*>(ALL_DESKTOPS)->focus_cycle.remove(*child, false);
+            old_cycle->remove(*child, false);
     }
 
-    if (can_focus && new_desktop->is_user_desktop())
-    {
-        UserDesktop *user_desktop = dynamic_cast<UserDesktop*>(new_desktop);
-        user_desktop->focus_cycle.add(client);
-
-        for (std::set<Window>::iterator child = m_children[client]->begin();
-                child != m_children[client]->end();
-                child++)
-            user_desktop->focus_cycle.add_after(*child, client);
-    }
-    else if (can_focus && new_desktop->is_all_desktop())
+    FocusCycle *new_cycle = get_focus_cycle(new_desktop);
+    if (can_focus && new_cycle)
     {
-        dynamic_cast<AllDesktops*>(ALL_DESKTOPS)->focus_cycle.add(client);
+        new_cycle->add(client);
 
         for (std::set<Window>::iterator child = m_children[client]->begin();
                 child != m_children[client]->end();
                 child++)
-            dynamic_cast<AllDesktops*>(ALL_DESKTOPS)->focus_cycle.add_after(*child, client);
+            new_cycle->add_after(*child, client);
     }
 
     if (should_unfocus)
@@ -1298,99 +1570,28 @@ void ClientModel::move_to_desktop(Window client, Desktop* new_desktop, bool shou
         }
     }
     // Make sure that the focus is transferred properly into the new cycle
-    else if (can_focus && new_desktop->is_user_desktop())
-    {
-        UserDesktop *user_desktop = dynamic_cast<UserDesktop*>(new_desktop);
-        user_desktop->focus_cycle.set(client);
-    }
-    else if (can_focus && new_desktop->is_all_desktop())
-        dynamic_cast<AllDesktops*>(ALL_DESKTOPS)->focus_cycle.set(client);
+    else if (can_focus && new_cycle)
+        new_cycle->set(client);
 
     m_changes.push(new ChangeClientDesktop(client, old_desktop, new_desktop));
 }
 
 /**
- * Converts all the information about a client window to a textual
- * representation, which is written to the output stream.
+ * Finds the screen that a client is on, when it is first added.
  */
-void ClientModel::dump_client_info(Window client, std::ostream &output)
+void ClientModel::set_initial_screen(Window client)
 {
-    output << "  Window: " << std::hex << client << "\n";
-    output << "    Screen: " << std::dec << m_screen[client] << "\n";
-    output << "    Layer: " << std::dec <<
-        static_cast<int>(m_layers.get_category_of(client)) << "\n";
-
-    Dimension2D &location = m_location[client];
-    output << "    Location: X=" << DIM2D_X(location) <<
-        " Y=" << DIM2D_Y(location) << "\n";
-
-    Dimension2D &size = m_size[client];
-    output << "    Size: W=" << DIM2D_WIDTH(size) <<
-        " H=" << DIM2D_HEIGHT(size) << "\n";
-
-    ClientPosScale mode = m_cps_mode[client];
-    output << "    Mode: ";
-    switch (mode)
-    {
-    case CPS_FLOATING:
-        output << "floating";
-        break;
-    case CPS_SPLIT_LEFT:
-        output << "left-split";
-        break;
-    case CPS_SPLIT_RIGHT:
-        output << "right-split";
-        break;
-    case CPS_SPLIT_TOP:
-        output << "top-split";
-        break;
-    case CPS_SPLIT_BOTTOM:
-        output << "bottom-split";
-        break;
-    case CPS_MAX:
-        output << "maximized";
-        break;
-    }
-    output << "\n";
-
-    output << "    Can autofocus? " <<
-        (m_autofocus[client] ? "yes" : "no") << "\n";
-
-    output << "    Packing info: ";
-    if (m_pack_corners.count(client) == 0)
+    const Dimension2D &location = m_location[client];
+    Crt *current_screen = m_crt_manager.screen_of_coord(DIM2D_X(location), DIM2D_Y(location));
+    if (!current_screen)
     {
-        output << "not packed";
+        // No monitor ever contains a negative screen
+        const Box invalid_box(-1, -1, 0, 0);
+        m_screen.insert(std::pair<Window, const Box>(client, invalid_box));
     }
     else
     {
-        output << "Dir=";
-        switch (m_pack_corners[client])
-        {
-        case PACK_NORTHEAST:
-            output << "NE";
-            break;
-        case PACK_NORTHWEST:
-            output << "NW";
-            break;
-        case PACK_SOUTHEAST:
-            output << "SE";
-            break;
-        case PACK_SOUTHWEST:
-            output << "SW";
-            break;
-        }
-
-        output << " Priority=" << m_pack_priority[client];
-    }
-    output << "\n";
-
-    std::vector<Window> children;
-    output << "    Children\n";
-    get_children_of(client, children);
-    for (std::vector<Window>::iterator childiter = children.begin();
-         childiter != children.end();
-         childiter++)
-    {
-        output << "      " << std::hex << *childiter << "\n";
+        const Box &screen_box = m_crt_manager.box_of_screen(current_screen);
+        m_screen.insert(std::pair<Window, const Box>(client, screen_box));
     }
 }
@@ -5,11 +5,15 @@
 #include "changes.h"
 #include "common.h"
 #include "desktop-type.h"
+#include "focus-cycle.h"
+#include "focus-history.h"
 #include "screen.h"
 #include "unique-multimap.h"
+#include "utils.h"
 
 #include <algorithm>
 #include <ios>
+#include <iterator>
 #include <map>
 #include <set>
 #include <utility>
@@ -21,6 +25,42 @@ enum InitialState
     IS_HIDDEN,
 };
 
+/**
+ * Everything that the ClientModel knows about a single client, which is
+ * enough to put the client back into another ClientModel (for example, after
+ * SmallWM restarts itself).
+ */
+struct ClientState
+{
+    ClientState() :
+        client(None), desktop(0), stuck(false), iconified(false),
+        layer(DEF_LAYER), mode(CPS_FLOATING), autofocus(false),
+        packed(false), pack_corner(PACK_NORTHEAST), pack_priority(0)
+    {}
+
+    Window client;
+
+    /// The user desktop that the client is on, if it isn't stuck or iconified
+    unsigned long long desktop;
+
+    /** Whether the client is on all desktops - for iconified clients, this is
+     * whether it goes back onto all desktops when it is deiconified */
+    bool stuck;
+    bool iconified;
+
+    Layer layer;
+    Dimension2D location;
+    Dimension2D size;
+    ClientPosScale mode;
+    bool autofocus;
+
+    bool packed;
+    PackCorner pack_corner;
+    unsigned long pack_priority;
+
+    std::vector<Window> children;
+};
+
 /**
  * This defines the data model used for the client.
  *
@@ -33,13 +73,13 @@ private:
     typedef Change const * change_ptr;
 
 public:
-    Desktop* ALL_DESKTOPS;
-    Desktop* ICON_DESKTOP;
-    Desktop* MOVING_DESKTOP;
-    Desktop* RESIZING_DESKTOP;
-    std::vector<UserDesktop*> USER_DESKTOPS;
+    Desktop ALL_DESKTOPS;
+    Desktop ICON_DESKTOP;
+    Desktop MOVING_DESKTOP;
+    Desktop RESIZING_DESKTOP;
+    std::vector<Desktop> USER_DESKTOPS;
 
-    typedef UniqueMultimap<Desktop*,Window>::member_iter client_iter;
+    typedef UniqueMultimap<Desktop,Window>::member_iter client_iter;
 
     /**
      * Initializes all of the categories in the maps
@@ -53,23 +93,27 @@ public:
         m_max_desktops(max_desktops),
         m_border_width(border_width),
         m_focused(None),
+        m_focus_preview(None),
         // Initialize all the desktops
-        ALL_DESKTOPS(new AllDesktops()),
-        ICON_DESKTOP(new IconDesktop()),
-        MOVING_DESKTOP(new MovingDesktop()),
-        RESIZING_DESKTOP(new ResizingDesktop())
+        ALL_DESKTOPS(AllDesktops()),
+        ICON_DESKTOP(IconDesktop()),
+        MOVING_DESKTOP(MovingDesktop()),
+        RESIZING_DESKTOP(ResizingDesktop()),
+        m_focus_cycles(max_desktops),
+        m_focus_histories(max_desktops)
     {
         m_desktops.add_category(ALL_DESKTOPS);
         m_desktops.add_category(ICON_DESKTOP);
         m_desktops.add_category(MOVING_DESKTOP);
         m_desktops.add_category(RESIZING_DESKTOP);
 
-        FocusCycle &all_cycle = dynamic_cast<AllDesktops*>(ALL_DESKTOPS)->focus_cycle;
+        // The cycles never move after this, since the number of desktops
+        // never changes, so they can all point at the same subcycle
         for (unsigned long long desktop = 0; desktop < max_desktops;
                 desktop++)
         {
-            USER_DESKTOPS.push_back(new UserDesktop(desktop));
-            USER_DESKTOPS[desktop]->focus_cycle.set_subcycle(all_cycle);
+            USER_DESKTOPS.push_back(UserDesktop(desktop));
+            m_focus_cycles[desktop].set_subcycle(m_all_focus_cycle);
             m_desktops.add_category(USER_DESKTOPS[desktop]);
         }
 
@@ -86,11 +130,14 @@ public:
 
     bool is_client(Window);
     bool is_visible(Window);
-    bool is_visible_desktop(Desktop*);
+    bool is_visible_desktop(Desktop);
     bool is_child(Window);
 
-    void get_clients_of(Desktop*, std::vector<Window>&);
+    void get_clients_of(Desktop, std::vector<Window>&);
+    void get_desktop_diff(Desktop, Desktop,
+                          std::vector<Window>&, std::vector<Window>&);
     void get_visible_clients(std::vector<Window>&);
+    void get_all_clients(std::vector<Window>&);
     void get_visible_in_layer_order(std::vector<Window>&);
     Window get_parent_of(Window);
     void get_children_of(Window, std::vector<Window>&);
@@ -111,12 +158,21 @@ public:
     void cycle_focus_forward();
     void cycle_focus_backward();
 
+    void preview_focus_forward();
+    void preview_focus_backward();
+    Window get_focus_preview() const;
+    void commit_focus_preview();
+    void cancel_focus_preview();
+
     ClientPosScale get_mode(Window);
     void change_mode(Window, ClientPosScale);
 
     void change_location(Window, Dimension, Dimension);
     void change_size(Window, Dimension, Dimension);
     void update_size(Window, Dimension, Dimension);
+    void update_location(Window, Dimension, Dimension);
+    Dimension2D get_location(Window) const;
+    Dimension2D get_size(Window) const;
 
     Window get_focused();
     bool is_autofocusable(Window);
@@ -127,7 +183,7 @@ public:
     void unfocus();
     void unfocus_if_focused(Window);
 
-    Desktop* find_desktop(Window);
+    Desktop find_desktop(Window);
     Layer find_layer(Window);
 
     void up_layer(Window);
@@ -155,19 +211,28 @@ public:
     void to_screen_box(Window, Box);
 
     void update_screens(std::vector<Box>&);
+    void set_border_width(Dimension);
 
-    void dump(std::ostream&);
+    unsigned long long get_current_desktop() const;
+    void get_client_state(Window, ClientState&);
+    void restore_client(const ClientState&);
+    void restore_current_desktop(unsigned long long);
 
 protected:
     void unfocus(bool);
 
-    void move_to_desktop(Window, Desktop*, bool);
+    void move_to_desktop(Window, Desktop, bool);
 
     void to_screen_crt(Window, Crt*);
+    void set_initial_screen(Window);
 
     void sync_focus_to_cycle();
+    FocusCycle *get_focus_cycle(Desktop);
 
-    void dump_client_info(Window, std::ostream&);
+    void preview_focus(bool);
+    bool can_preview(Window);
+    void drop_focus_preview(Window);
+    void forget_focus_history(Window);
 
 private:
     // The screen manager, used to map positions to screens
@@ -183,8 +248,7 @@ private:
     Dimension m_border_width;
 
     /// A mapping between clients and their desktops
-    UniqueMultimap<Desktop*, Window,
-        PointerLess<Desktop>> m_desktops;
+    UniqueMultimap<Desktop, Window> m_desktops;
     /// A mapping between clients and the layers they inhabit
     UniqueMultimap<Layer, Window> m_layers;
     /// A mapping between clients and their locations
@@ -225,10 +289,26 @@ private:
     std::map<Window, Window> m_parents;
 
     /// The currently visible desktop
-    UserDesktop * m_current_desktop;
+    Desktop m_current_desktop;
+
+    /** The focus cycle of each user desktop. When the user returns to a
+     * desktop, this is what lets the focus go back to the window they were
+     * on. */
+    std::vector<FocusCycle> m_focus_cycles;
+
+    /// The focus cycle of the windows which are on all desktops
+    FocusCycle m_all_focus_cycle;
+
+    /** Which windows were focused most recently on each user desktop
+     * (including stuck windows), for alt-tab style switching */
+    std::vector<FocusHistory> m_focus_histories;
 
     /// The currently focused client
     Window m_focused;
+
+    /** The window that will be focused once the user stops cycling through
+     * the focus history, or None if they aren't cycling */
+    Window m_focus_preview;
 };
 
 #endif
@@ -3,21 +3,21 @@
 #define __SMALLWM_DESKTOP_TYPE__
 
 #include <ostream>
+#include <stdint.h>
 
-#include "model/focus-cycle.h"
-#include "utils.h"
-
-/*
- * These constants are used to make sure that different instances of
- * desktop classes with the same parameters are equal, and are stored in
- * the same place in an std::map
+/**
+ * The different kinds of desktops. Desktops sort in this order, so all the
+ * user desktops come after the virtual ones.
  */
-const unsigned long long DESKTOP_SORT_KEY = 1,
-      ALL_DESKTOP_SORT_KEY = 2,
-      ICON_DESKTOP_SORT_KEY = 3,
-      MOVING_DESKTOP_SORT_KEY = 4,
-      RESIZING_DESKTOP_SORT_KEY = 5,
-      USER_DESKTOP_SORT_KEY = 6;
+enum DesktopKind
+{
+    DK_NONE, //< Not a desktop - for example, where a new client came from
+    DK_ALL, //< Windows which are visible on all user desktops
+    DK_ICON, //< Windows which are currently hidden
+    DK_MOVING, //< The window currently being moved
+    DK_RESIZING, //< The window currently being resized
+    DK_USER //< A desktop which the user switches between
+};
 
 /**
  * This describes both 'real' desktops that the user interacts with, and
@@ -27,187 +27,138 @@ const unsigned long long DESKTOP_SORT_KEY = 1,
  * to which a window must belong exclusively - it cannot be on two desktops
  * at once. This causes some issues (hence `AllDesktops`) but it works well
  * in practice.
+ *
+ * A desktop is only an ID - its kind is stored in the upper half, and (for
+ * user desktops) its number in the lower half. Desktops are passed around by
+ * value, and checking what kind a desktop is, or comparing two of them, is
+ * done on that one integer. Anything that is kept for each desktop (like
+ * its focus cycle) is stored by the ClientModel, indexed by desktop number.
+ *
+ * The default desktop is the DK_NONE desktop.
  */
 struct Desktop
 {
-    Desktop(const unsigned long long _sort_key) : sort_key(_sort_key)
+    Desktop() : id(0)
     {};
 
-    Desktop() : sort_key(DESKTOP_SORT_KEY)
+    Desktop(DesktopKind kind, unsigned long long index) :
+        id((static_cast<uint64_t>(kind) << 32) | (index & 0xffffffff))
     {};
 
-    virtual ~Desktop()
-    {};
+    /// Gets what kind of desktop this is
+    DesktopKind kind() const
+    { return static_cast<DesktopKind>(id >> 32); }
 
-    virtual bool is_user_desktop() const
-    { return false; }
+    /// Gets the number of a user desktop
+    unsigned long long index() const
+    { return id & 0xffffffff; }
 
-    virtual bool is_all_desktop() const
-    { return false; }
+    bool is_valid() const
+    { return kind() != DK_NONE; }
 
-    virtual bool is_icon_desktop() const
-    { return false; }
+    bool is_user_desktop() const
+    { return kind() == DK_USER; }
+
+    bool is_all_desktop() const
+    { return kind() == DK_ALL; }
+
+    bool is_icon_desktop() const
+    { return kind() == DK_ICON; }
 
-    virtual bool is_moving_desktop() const
-    { return false; }
+    bool is_moving_desktop() const
+    { return kind() == DK_MOVING; }
 
-    virtual bool is_resizing_desktop() const
-    { return false; }
+    bool is_resizing_desktop() const
+    { return kind() == DK_RESIZING; }
 
     bool operator<(const Desktop &other) const
-    { return sort_key < other.sort_key; }
+    { return id < other.id; }
 
     bool operator==(const Desktop &other) const
-    { return sort_key == other.sort_key; }
+    { return id == other.id; }
+
+    bool operator!=(const Desktop &other) const
+    { return id != other.id; }
 
-    const unsigned long long sort_key;
+    uint64_t id;
 };
 
+/*
+ * These name the desktops of each kind. They don't add anything to Desktop,
+ * so they can be passed anywhere that a Desktop can.
+ */
+
 /**
  * A 'real' desktop which the user directly interacts with.
- *
- * Note that this has a special artifact that other desktops do not - it keeps
- * track of its focus history, so that when the user returns to it, their
- * focus is preserved to the last window they were on.
  */
 struct UserDesktop : public Desktop
 {
-    UserDesktop(const unsigned long long _desktop) :
-        desktop(_desktop), Desktop(_desktop + USER_DESKTOP_SORT_KEY)
+    UserDesktop(const unsigned long long desktop) :
+        Desktop(DK_USER, desktop)
     {};
-
-    bool is_user_desktop() const
-    { return true; }
-
-    const unsigned long long desktop;
-    FocusCycle focus_cycle;
 };
 
-static std::ostream &operator<<(std::ostream &out, const UserDesktop &desktop)
-{
-    out << "[UserDesktop " << desktop.desktop << "]";
-    return out;
-}
-
 /**
  * A virtual desktop describing windows which are visible on all 'real'
  * desktops.
  */
 struct AllDesktops : public Desktop
 {
-    AllDesktops() : Desktop(ALL_DESKTOP_SORT_KEY)
+    AllDesktops() : Desktop(DK_ALL, 0)
     {};
-
-    bool is_all_desktop() const
-    { return true; }
-
-    FocusCycle focus_cycle;
 };
 
-static std::ostream &operator<<(std::ostream &out, const AllDesktops &desktop)
-{
-    out << "[All Desktops]";
-    return out;
-}
-
 /**
  * A virtual desktop describing windows which are currently hidden.
  */
 struct IconDesktop : public Desktop
 {
-    IconDesktop() : Desktop(ICON_DESKTOP_SORT_KEY)
+    IconDesktop() : Desktop(DK_ICON, 0)
     {};
-
-    bool is_icon_desktop() const
-    { return true; }
 };
 
-static std::ostream &operator<<(std::ostream &out, const IconDesktop &desktop)
-{
-    out << "[Icon Desktop]";
-    return out;
-}
-
 /**
  * A virtual desktop for a window which is currently being moved.
  */
 struct MovingDesktop : public Desktop
 {
-    MovingDesktop() : Desktop(MOVING_DESKTOP_SORT_KEY)
+    MovingDesktop() : Desktop(DK_MOVING, 0)
     {};
-
-    bool is_moving_desktop() const
-    { return true; }
 };
 
-static std::ostream &operator<<(std::ostream &out, const MovingDesktop &desktop)
-{
-    out << "[Moving Desktop]";
-    return out;
-}
-
 /**
  * A virtual desktop for a window which is currently being resized.
  */
 struct ResizingDesktop : public Desktop
 {
-    ResizingDesktop() : Desktop(RESIZING_DESKTOP_SORT_KEY)
+    ResizingDesktop() : Desktop(DK_RESIZING, 0)
     {};
-
-    bool is_resizing_desktop() const
-    { return true; }
 };
 
-static std::ostream &operator<<(std::ostream &out, const ResizingDesktop &desktop)
-{
-    out << "[Resizing Desktop]";
-    return out;
-}
-
 static std::ostream &operator<<(std::ostream &out, const Desktop &desktop)
 {
-    if (desktop.is_user_desktop())
-        out << dynamic_cast<const UserDesktop&>(desktop);
-    else if (desktop.is_all_desktop())
-        out << dynamic_cast<const AllDesktops&>(desktop);
-    else if (desktop.is_icon_desktop())
-        out << dynamic_cast<const IconDesktop&>(desktop);
-    else if (desktop.is_moving_desktop())
-        out << dynamic_cast<const MovingDesktop&>(desktop);
-    else if (desktop.is_resizing_desktop())
-        out << dynamic_cast<const ResizingDesktop&>(desktop);
-    else
+    switch (desktop.kind())
+    {
+    case DK_USER:
+        out << "[UserDesktop " << desktop.index() << "]";
+        break;
+    case DK_ALL:
+        out << "[All Desktops]";
+        break;
+    case DK_ICON:
+        out << "[Icon Desktop]";
+        break;
+    case DK_MOVING:
+        out << "[Moving Desktop]";
+        break;
+    case DK_RESIZING:
+        out << "[Resizing Desktop]";
+        break;
+    default:
         out << "[Desktop]";
+    }
 
     return out;
 }
 
-/**
- * Like std::less<T>, but for pointers.
- */
-template <typename T>
-struct PointerLess
-{
-    /**
-     * Compares a pair of Desktop pointers. This is used because Desktop must be
-     * stored in structures as a pointer, due to the need for downcasting to
-     * access appropriate members.
-     *
-     * Note that this also handles NULL pointers, by saying that a NULL pointer
-     * is less than any other pointer, with the exception of other null
-     * pointers.
-     */
-    bool operator()(const T *a, const T* b) const
-    {
-        if (!a && !b)
-            return false;
-        else if (!a)
-            return true;
-        else if (!b)
-            return false;
-        else
-            return *a < *b;
-    }
-};
-
 #endif
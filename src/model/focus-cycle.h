@@ -39,8 +39,6 @@ public:
     bool forward();
     bool backward();
 
-    void dump(std::ostream&, int depth);
-
 private:
     /// Whether or not the current focus is actually on any window
     bool m_currently_focused;
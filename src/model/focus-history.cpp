@@ -0,0 +1,134 @@
+/** @file */
+#include "focus-history.h"
+
+/**
+ * Records that a window was just focused, moving it to the front of the
+ * history (and adding it, if it wasn't there before).
+ */
+void FocusHistory::touch(Window window)
+{
+    std::unordered_map<Window, std::list<Window>::iterator>::iterator position =
+        m_positions.find(window);
+
+    if (position == m_positions.end())
+    {
+        m_windows.push_front(window);
+        m_positions[window] = m_windows.begin();
+    }
+    else
+        m_windows.splice(m_windows.begin(), m_windows, position->second);
+}
+
+/**
+ * Forgets about a window.
+ *
+ * @return true if the window was in the history, false otherwise.
+ */
+bool FocusHistory::remove(Window window)
+{
+    std::unordered_map<Window, std::list<Window>::iterator>::iterator position =
+        m_positions.find(window);
+
+    if (position == m_positions.end())
+        return false;
+
+    m_windows.erase(position->second);
+    m_positions.erase(position);
+    return true;
+}
+
+/**
+ * Checks whether a window is in the history.
+ */
+bool FocusHistory::contains(Window window) const
+{
+    return m_positions.count(window) > 0;
+}
+
+/**
+ * Checks whether the history has no windows in it.
+ */
+bool FocusHistory::empty() const
+{
+    return m_windows.empty();
+}
+
+/**
+ * Gets the number of windows in the history.
+ */
+size_t FocusHistory::size() const
+{
+    return m_positions.size();
+}
+
+/**
+ * Gets the most recently focused window, or None if the history is empty.
+ */
+Window FocusHistory::front() const
+{
+    if (m_windows.empty())
+        return None;
+
+    return m_windows.front();
+}
+
+/**
+ * Gets the least recently focused window, or None if the history is empty.
+ */
+Window FocusHistory::back() const
+{
+    if (m_windows.empty())
+        return None;
+
+    return m_windows.back();
+}
+
+/**
+ * Gets the window which was focused just before the given one.
+ *
+ * @return The older window, or None if the given window is the oldest (or
+ *         isn't in the history).
+ */
+Window FocusHistory::after(Window window) const
+{
+    std::unordered_map<Window, std::list<Window>::iterator>::const_iterator
+        position = m_positions.find(window);
+
+    if (position == m_positions.end())
+        return None;
+
+    std::list<Window>::const_iterator next = position->second;
+    next++;
+    if (next == m_windows.end())
+        return None;
+
+    return *next;
+}
+
+/**
+ * Gets the window which was focused just after the given one.
+ *
+ * @return The newer window, or None if the given window is the newest (or
+ *         isn't in the history).
+ */
+Window FocusHistory::before(Window window) const
+{
+    std::unordered_map<Window, std::list<Window>::iterator>::const_iterator
+        position = m_positions.find(window);
+
+    if (position == m_positions.end() ||
+            position->second == m_windows.begin())
+        return None;
+
+    std::list<Window>::const_iterator previous = position->second;
+    previous--;
+    return *previous;
+}
+
+/**
+ * Gets every window in the history, most recently focused first.
+ */
+void FocusHistory::get_windows(std::vector<Window> &windows) const
+{
+    windows.insert(windows.end(), m_windows.begin(), m_windows.end());
+}
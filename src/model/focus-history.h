@@ -0,0 +1,44 @@
+/** @file */
+#ifndef __SMALLWM_FOCUS_HISTORY__
+#define __SMALLWM_FOCUS_HISTORY__
+
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+#include "common.h"
+
+/**
+ * Remembers the order in which windows were focused, most recent first.
+ *
+ * Unlike a FocusCycle (which keeps the order that windows were added in),
+ * this is what alt-tab style switching walks through - the first step goes
+ * back to the window that was focused before the current one. Moving a
+ * window to the front and removing it are both constant time, since each
+ * window's place in the list is looked up by hashing.
+ */
+class FocusHistory
+{
+public:
+    void touch(Window);
+    bool remove(Window);
+
+    bool contains(Window) const;
+    bool empty() const;
+    size_t size() const;
+
+    Window front() const;
+    Window back() const;
+    Window after(Window) const;
+    Window before(Window) const;
+    void get_windows(std::vector<Window>&) const;
+
+private:
+    /// The windows, with the most recently focused first
+    std::list<Window> m_windows;
+
+    /// Where each window is in m_windows
+    std::unordered_map<Window, std::list<Window>::iterator> m_positions;
+};
+
+#endif
@@ -53,8 +53,9 @@ Crt *CrtManager::screen_of_box(const Box &box)
  */
 void CrtManager::rebuild_graph(std::vector<Box> &screens)
 {
-    // The destructor for Crt traverses the entire graph
-    delete m_root;
+    // None of the old screens are linked to from anywhere but each other, so
+    // they can all go at once
+    m_crts.clear();
     m_boxes.clear();
 
     // Make sure that each box is accessible by its root coordinates
@@ -65,32 +66,37 @@ void CrtManager::rebuild_graph(std::vector<Box> &screens)
         origin_to_box[Dimension2D(iter->x, iter->y)] = *iter;
 
     // Start building the screen hierarchy at (0, 0) - the root screen
-    m_root = new Crt(0);
+    m_root = create_crt(0);
     m_boxes[m_root] = origin_to_box[Dimension2D(0, 0)];
 
     build_node(m_root, origin_to_box, 1);
 }
 
 /**
- * Converts all the information about the screen geometry to a textual
- * representation, which is written to the output stream.
+ * Gets the bounding box of every screen in the graph, which can be given back
+ * to rebuild_graph() to build the same graph again. The root screen comes
+ * first, followed by the screens further away from it.
  */
-void CrtManager::dump(std::ostream &output)
+void CrtManager::get_screen_boxes(std::vector<Box> &screens) const
 {
-    output << "Screens\n";
+    if (!m_root)
+        return;
 
     std::map<int, Crt*> crts_by_id;
     build_id_map(m_root, crts_by_id);
-    for (int id = 0; id < crts_by_id.size(); id++)
-    {
-        Crt *crt = crts_by_id[id];
-        Box &bounds = m_boxes[crt];
-
-        output << "  Screen " << std::dec << id << "\n";
-        output << "    " << bounds << "\n";
-    }
+    for (std::map<int, Crt*>::iterator crt = crts_by_id.begin();
+            crt != crts_by_id.end();
+            crt++)
+        screens.push_back(m_boxes.find(crt->second)->second);
 }
 
+/**
+ * Creates a screen which isn't linked to any others yet.
+ */
+Crt *CrtManager::create_crt(int id)
+{
+    return m_crts.get(m_crts.create(id));
+}
 
 /**
  * Builds up the screen graph starting from a particular screen.
@@ -112,7 +118,7 @@ int CrtManager::build_node(Crt *screen, std::map<Dimension2D, Box> &boxes, int n
         Crt *below = screen_of_box(complete_below_box);
         if (!below)
         {
-            below = new Crt(next_id++);
+            below = create_crt(next_id++);
             m_boxes[below] = complete_below_box;
         }
 
@@ -129,7 +135,7 @@ int CrtManager::build_node(Crt *screen, std::map<Dimension2D, Box> &boxes, int n
         Crt *right = screen_of_box(Box(complete_right_box));
         if (!right)
         {
-            right = new Crt(next_id++);
+            right = create_crt(next_id++);
             m_boxes[right] = complete_right_box;
         }
 
@@ -143,10 +149,9 @@ int CrtManager::build_node(Crt *screen, std::map<Dimension2D, Box> &boxes, int n
 }
 
 /**
- * Builds up a map that relates each Crt to its ID. Used only for dumping
- * purposes.
+ * Builds up a map that relates each Crt to its ID.
  */
-void CrtManager::build_id_map(Crt *base, std::map<int, Crt*> &id_map)
+void CrtManager::build_id_map(Crt *base, std::map<int, Crt*> &id_map) const
 {
     id_map[base->id] = base;
 
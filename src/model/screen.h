@@ -3,6 +3,7 @@
 #define __SMALLWM_SCREEN_MODEL__
 
 #include "common.h"
+#include "slab.h"
 
 #include <ios>
 #include <map>
@@ -20,12 +21,15 @@
  * Note that these are ephemeral - any time there is a change of screens, all
  * windows should update their current screen. Thankfully, however, screens
  * don't change themselves all the time.
+ *
+ * Every Crt is owned by the CrtManager, which frees the whole graph at once -
+ * so the links between them never point outside of the current graph.
  */
 struct Crt {
     Crt *left, *right, *top, *bottom;
 
     /**
-     * An identifier assigned to the screen, used only for dumped output
+     * An identifier assigned to the screen, used to order the screens
      *
      * The only rule is that this must be least on the root screen, and
      * greater on values away from the root - this ensures a readable ordering
@@ -34,41 +38,8 @@ struct Crt {
     int id;
 
     Crt(int _id) :
-        left(NULL), right(NULL), top(NULL), bottom(NULL), id(_id),
-        m_deleting(false)
+        left(NULL), right(NULL), top(NULL), bottom(NULL), id(_id)
     {}
-
-    ~Crt()
-    {
-        m_deleting = true;
-
-        // Note that we have to break all links when deleting the screen, since
-        // we don't want to get trapped in a cycle
-        if (left && !left->m_deleting)
-        {
-            left->right = NULL;
-            delete left;
-        }
-        if (right && !right->m_deleting)
-        {
-            right->left = NULL;
-            delete right;
-        }
-        if (top && !top->m_deleting)
-        {
-            top->bottom = NULL;
-            delete top;
-        }
-        if (bottom && !bottom->m_deleting)
-        {
-            bottom->top = NULL;
-            delete bottom;
-        }
-    }
-
-private:
-    /// This is used to avoid cycles when deleting a Crt
-    bool m_deleting;
 };
 
 /**
@@ -80,9 +51,6 @@ public:
     CrtManager() : m_root(NULL)
     {}
 
-    ~CrtManager()
-    { delete m_root; }
-
     Crt *root() const
     { return m_root; }
 
@@ -91,12 +59,16 @@ public:
     Crt *screen_of_box(const Box &box);
 
     void rebuild_graph(std::vector<Box>&);
-
-    void dump(std::ostream&);
+    void get_screen_boxes(std::vector<Box>&) const;
 
 private:
+    Crt *create_crt(int);
     int build_node(Crt*, std::map<Dimension2D, Box>&, int);
-    void build_id_map(Crt*, std::map<int, Crt*>&);
+    void build_id_map(Crt*, std::map<int, Crt*>&) const;
+
+    /** Every screen in the graph - the storage is kept between rebuilds, so
+     * that a rebuild doesn't have to allocate anything */
+    Slab<Crt> m_crts;
 
     /// The root screen is located at (0, 0). Guaranteed not to be NULL
     Crt *m_root;
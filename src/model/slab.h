@@ -0,0 +1,222 @@
+/** @file */
+#ifndef __SMALLWM_SLAB__
+#define __SMALLWM_SLAB__
+
+#include <deque>
+#include <new>
+#include <stdint.h>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/**
+ * Refers to an object stored in a Slab. Besides the object's slot, a handle
+ * remembers which generation of the slot it was given out for - once the
+ * object is destroyed, the slot moves on to the next generation, and any
+ * handles to the old object stop working instead of pointing at whatever
+ * takes its place.
+ *
+ * The default handle never refers to anything.
+ */
+template <typename T>
+struct SlabHandle
+{
+    SlabHandle() :
+        index(0), generation(0)
+    {}
+
+    SlabHandle(uint32_t _index, uint32_t _generation) :
+        index(_index), generation(_generation)
+    {}
+
+    bool operator==(const SlabHandle<T> &other) const
+    { return index == other.index && generation == other.generation; }
+
+    bool operator!=(const SlabHandle<T> &other) const
+    { return !(*this == other); }
+
+    bool operator<(const SlabHandle<T> &other) const
+    {
+        return index < other.index ||
+            (index == other.index && generation < other.generation);
+    }
+
+    /// Which slot the object is stored in
+    uint32_t index;
+
+    /// The generation of the slot when the object was stored in it
+    uint32_t generation;
+};
+
+/**
+ * A pool of objects of a single type, which are stored next to each other
+ * and addressed by SlabHandles.
+ *
+ * Slots are never given back to the allocator while the Slab exists -
+ * destroying an object only puts its slot on a free list, which the next
+ * object created takes from. Since the slots are kept in a std::deque, an
+ * object never moves once it has been created, so pointers to it stay good
+ * until it is destroyed (but unlike handles, nothing can tell when they
+ * don't).
+ */
+template <typename T>
+class Slab
+{
+public:
+    typedef SlabHandle<T> Handle;
+
+    Slab() :
+        m_live(0)
+    {}
+
+    ~Slab()
+    { clear(); }
+
+    /**
+     * Creates a new object, passing the arguments on to its constructor.
+     *
+     * @return The handle of the new object.
+     */
+    template <typename... Args>
+    Handle create(Args&&... args)
+    {
+        uint32_t index;
+        if (m_free.empty())
+        {
+            index = m_slots.size();
+            m_slots.push_back(Slot());
+        }
+        else
+        {
+            index = m_free.back();
+            m_free.pop_back();
+        }
+
+        Slot &slot = m_slots[index];
+        new (&slot.storage) T(std::forward<Args>(args)...);
+        slot.live = true;
+        m_live++;
+
+        return Handle(index, slot.generation);
+    }
+
+    /**
+     * Gets an object from its handle.
+     *
+     * @return The object, or NULL if it has been destroyed.
+     */
+    T *get(Handle handle) const
+    {
+        if (handle.index >= m_slots.size())
+            return NULL;
+
+        const Slot &slot = m_slots[handle.index];
+        if (!slot.live || slot.generation != handle.generation)
+            return NULL;
+
+        // Like a container of pointers, a const Slab still hands out objects
+        // which can be changed
+        return const_cast<T*>(reinterpret_cast<const T*>(&slot.storage));
+    }
+
+    /**
+     * Destroys an object, and makes its slot available to the next one.
+     *
+     * @return true if the object was destroyed, false if it already had been.
+     */
+    bool destroy(Handle handle)
+    {
+        T *object = get(handle);
+        if (!object)
+            return false;
+
+        release(handle.index, object);
+        m_free.push_back(handle.index);
+        return true;
+    }
+
+    /**
+     * Destroys every object, without giving up any of the slots.
+     */
+    void clear()
+    {
+        m_free.clear();
+
+        // The free list is built so that the lowest slots are reused first,
+        // which keeps new objects at the front of the slab
+        for (uint32_t index = m_slots.size(); index > 0; index--)
+        {
+            T *object = get(Handle(index - 1, m_slots[index - 1].generation));
+            if (object)
+                release(index - 1, object);
+
+            m_free.push_back(index - 1);
+        }
+    }
+
+    /**
+     * Gets the number of objects which haven't been destroyed.
+     */
+    size_t size() const
+    { return m_live; }
+
+    /**
+     * Gets the number of slots, including the ones that are free.
+     */
+    size_t capacity() const
+    { return m_slots.size(); }
+
+private:
+    /**
+     * The storage for a single object, along with the state of the slot.
+     */
+    struct Slot
+    {
+        Slot() :
+            generation(1), live(false)
+        {}
+
+        /// Where the object is constructed
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+        /** Which generation the slot is on - this starts at 1, so that the
+         * default handle doesn't match any slot */
+        uint32_t generation;
+
+        /// Whether an object is stored in the slot
+        bool live;
+    };
+
+    /**
+     * Destroys the object in a slot, and moves the slot on to its next
+     * generation.
+     */
+    void release(uint32_t index, T *object)
+    {
+        object->~T();
+
+        Slot &slot = m_slots[index];
+        slot.live = false;
+        slot.generation++;
+        if (slot.generation == 0)
+            slot.generation = 1;
+
+        m_live--;
+    }
+
+    // Copying would have to copy every live object one at a time, and nothing
+    // needs to
+    Slab(const Slab&);
+    Slab &operator=(const Slab&);
+
+    /// The slots, which never move once they have been added
+    std::deque<Slot> m_slots;
+
+    /// The slots which don't have an object in them
+    std::vector<uint32_t> m_free;
+
+    /// How many of the slots have an object in them
+    size_t m_live;
+};
+
+#endif
@@ -4,8 +4,8 @@
 
 #include <algorithm>
 #include <map>
+#include <set>
 #include <utility>
-#include <vector>
 
 /**
  * Think of a 2-layer tree:
@@ -32,12 +32,15 @@
  *    on this level, and this whole level is made up exclusively of members.
  *    Members are unique to the UniqueMultimap - that is, no member
  *    can belong to more than one category.
+ *
+ * The members of each category are kept sorted, so that two categories can be
+ * compared (with std::set_difference, for example) by walking them directly.
  */
 template <typename category_t, typename member_t, typename category_comparator_t = std::less<category_t>>
 class UniqueMultimap
 {
 public:
-    typedef typename std::vector<member_t>::const_iterator member_iter;
+    typedef typename std::set<member_t>::const_iterator member_iter;
 
     /**
      * Returns whether or not a category value has a category in this object.
@@ -67,7 +70,7 @@ public:
         if (is_category(category))
             return false;
 
-        m_category_members[category] = new std::vector<member_t>();
+        m_category_members[category];
         return true;
     }
 
@@ -88,7 +91,7 @@ public:
      */
     member_iter get_members_of_begin(category_t const &category)
     {
-        return m_category_members[category]->begin();
+        return m_category_members[category].begin();
     }
 
     /**
@@ -97,7 +100,7 @@ public:
      */
     member_iter get_members_of_end(category_t const &category)
     {
-        return m_category_members[category]->end();
+        return m_category_members[category].end();
     }
 
     /**
@@ -107,7 +110,7 @@ public:
      */
     size_t count_members_of(category_t const &category)
     {
-        return m_category_members[category]->size();
+        return m_category_members[category].size();
     }
 
     /**
@@ -121,7 +124,7 @@ public:
         if (is_member(member) || !is_category(category))
             return false;
 
-        m_category_members[category]->push_back(member);
+        m_category_members[category].insert(member);
         m_member_to_category[member] = category;
         return true;
     }
@@ -153,19 +156,13 @@ public:
             return false;
 
         category_t const &old_category = m_member_to_category[member];
-        typename std::vector<member_t>::iterator member_location = std::find(
-            m_category_members[old_category]->begin(),
-            m_category_members[old_category]->end(),
-            member
-        );
-
-        m_category_members[old_category]->erase(member_location);
+        m_category_members[old_category].erase(member);
         m_member_to_category.erase(member);
         return true;
     }
 private:
     /// The 'top-down' mapping from categories to their members
-    std::map<category_t, std::vector<member_t>*, category_comparator_t> m_category_members;
+    std::map<category_t, std::set<member_t>, category_comparator_t> m_category_members;
     /// The 'bottom-up' mapping from members to their categories
     std::map<member_t, category_t> m_member_to_category;
 };
@@ -193,7 +190,9 @@ public:
     }
 
 private:
-    UniqueMultimap<category_t, member_t> m_uniquemultimap;
+    /** The multimap to sort by - this is a reference, since std::sort copies
+     * the comparator many times over */
+    UniqueMultimap<category_t, member_t> &m_uniquemultimap;
 };
 
 #endif
@@ -2,21 +2,61 @@
 #include "x-model.h"
 
 /**
- * Registers a new icon - note that, at this point, XModel takes
- * responsibility for the given icon, and it should not be deleted unless
- * explicitly unregistered.
+ * Creates a new icon, which is owned by the XModel until destroy_icon() is
+ * called. The icon isn't registered - that has to be done once the caller has
+ * set it up.
+ *
+ * @param client The window that the icon stands for.
+ * @param icon_window The icon window itself.
+ * @param gc The graphical context used to draw the icon, which now belongs
+ *           to the icon.
+ * @return The new icon.
+ */
+Icon *XModel::create_icon(Window client, Window icon_window, XGC *gc)
+{
+    IconHandle handle = m_icons.create(client, icon_window, gc);
+
+    Icon *icon = m_icons.get(handle);
+    icon->handle = handle;
+    return icon;
+}
+
+/**
+ * Destroys an icon, along with its graphical context. The icon must already
+ * be unregistered (and not in the pool) - any handles to it are no longer
+ * valid afterwards.
+ */
+void XModel::destroy_icon(Icon *icon)
+{
+    delete icon->gc;
+    m_icons.destroy(icon->handle);
+}
+
+/**
+ * Gets an icon from its handle.
+ *
+ * @return The icon, or NULL if it has been destroyed.
+ */
+Icon *XModel::get_icon(IconHandle handle) const
+{
+    return m_icons.get(handle);
+}
+
+/**
+ * Registers an icon which was created by create_icon(), so that it can be
+ * found from its client or its icon window.
  *
  * @param icon The new icon to register.
  */
 void XModel::register_icon(Icon *icon)
 {
-    m_clients_to_icons[icon->client] = icon;
-    m_icon_windows_to_icons[icon->icon] = icon;
+    m_clients_to_icons[icon->client] = icon->handle;
+    m_icon_windows_to_icons[icon->icon] = icon->handle;
 }
 
 /**
- * Unregisters an icon. This also removes the responsibility of the pointer
- * from the XModel, and it should be deleted later to avoid a memory leak.
+ * Unregisters an icon. The icon still exists afterwards, and has to be either
+ * recycled or destroyed.
  *
  * @param icon The icon to unregister.
  */
@@ -31,10 +71,12 @@ void XModel::unregister_icon(Icon *icon)
  */
 Icon* XModel::find_icon_from_client(Window client) const
 {
-    if (m_clients_to_icons.count(client) == 0)
+    std::map<Window, IconHandle>::const_iterator icon =
+        m_clients_to_icons.find(client);
+    if (icon == m_clients_to_icons.end())
         return NULL;
     else
-        return m_clients_to_icons.find(client)->second;
+        return m_icons.get(icon->second);
 }
 
 /**
@@ -42,10 +84,12 @@ Icon* XModel::find_icon_from_client(Window client) const
  */
 Icon* XModel::find_icon_from_icon_window(Window icon_win) const
 {
-    if (m_icon_windows_to_icons.count(icon_win) == 0)
+    std::map<Window, IconHandle>::const_iterator icon =
+        m_icon_windows_to_icons.find(icon_win);
+    if (icon == m_icon_windows_to_icons.end())
         return NULL;
     else
-        return m_icon_windows_to_icons.find(icon_win)->second;
+        return m_icons.get(icon->second);
 }
 
 /**
@@ -53,15 +97,61 @@ Icon* XModel::find_icon_from_icon_window(Window icon_win) const
  */
 void XModel::get_icons(std::vector<Icon*> &icons)
 {
-    for (std::map<Window,Icon*>::iterator iter = m_clients_to_icons.begin();
+    for (std::map<Window,IconHandle>::iterator iter = m_clients_to_icons.begin();
             iter != m_clients_to_icons.end();
             iter++)
     {
-        if (iter->second != 0)
-            icons.push_back(iter->second);
+        Icon *icon = m_icons.get(iter->second);
+        if (icon)
+            icons.push_back(icon);
     }
 }
 
+/**
+ * Gets all the icons which are in the pool, waiting to be reused.
+ */
+void XModel::get_pooled_icons(std::vector<Icon*> &icons)
+{
+    for (std::vector<IconHandle>::iterator iter = m_icon_pool.begin();
+            iter != m_icon_pool.end();
+            iter++)
+        icons.push_back(m_icons.get(*iter));
+}
+
+/**
+ * Takes an unused icon from the pool, and gives it to a client. The icon
+ * isn't registered - that has to be done once the caller has set it up.
+ *
+ * @return The icon, or NULL if the pool is empty.
+ */
+Icon *XModel::reuse_icon(Window client)
+{
+    if (m_icon_pool.empty())
+        return NULL;
+
+    Icon *icon = m_icons.get(m_icon_pool.back());
+    m_icon_pool.pop_back();
+
+    icon->client = client;
+    return icon;
+}
+
+/**
+ * Puts an icon which isn't needed anymore back into the pool, unless the pool
+ * is already full. The icon must already be unregistered.
+ *
+ * @return true if the icon was pooled, false if the caller must destroy it.
+ */
+bool XModel::recycle_icon(Icon *icon)
+{
+    if (m_icon_pool.size() >= ICON_POOL_SIZE)
+        return false;
+
+    icon->client = None;
+    m_icon_pool.push_back(icon->handle);
+    return true;
+}
+
 /**
  * Registers that a client is being moved, recording the client and the
  * placeholder, and recording the current pointer location.
@@ -72,10 +162,10 @@ void XModel::get_icons(std::vector<Icon*> &icons)
 void XModel::enter_move(Window client, Window placeholder,
     Dimension2D pointer)
 {
-    if (m_moveresize)
+    if (current_move_resize())
         return;
 
-    m_moveresize = new MoveResize(client, placeholder, MR_MOVE);
+    m_moveresize = m_moveresizes.create(client, placeholder, MR_MOVE);
     m_pointer = pointer;
 }
 
@@ -89,10 +179,10 @@ void XModel::enter_move(Window client, Window placeholder,
 void XModel::enter_resize(Window client, Window placeholder,
     Dimension2D pointer)
 {
-    if (m_moveresize)
+    if (current_move_resize())
         return;
 
-    m_moveresize = new MoveResize(client, placeholder, MR_RESIZE);
+    m_moveresize = m_moveresizes.create(client, placeholder, MR_RESIZE);
     m_pointer = pointer;
 }
 
@@ -105,7 +195,7 @@ void XModel::enter_resize(Window client, Window placeholder,
  */
 Dimension2D XModel::update_pointer(Dimension x, Dimension y)
 {
-    if (!m_moveresize)
+    if (!current_move_resize())
         return Dimension2D(0, 0);
 
     Dimension2D diff(x - DIM2D_X(m_pointer),
@@ -123,10 +213,11 @@ Dimension2D XModel::update_pointer(Dimension x, Dimension y)
  */
 Window XModel::get_move_resize_placeholder() const
 {
-    if (!m_moveresize)
+    MoveResize *moveresize = current_move_resize();
+    if (!moveresize)
         return None;
 
-    return m_moveresize->placeholder;
+    return moveresize->placeholder;
 }
 
 /**
@@ -136,10 +227,11 @@ Window XModel::get_move_resize_placeholder() const
  */
 Window XModel::get_move_resize_client() const
 {
-    if (!m_moveresize)
+    MoveResize *moveresize = current_move_resize();
+    if (!moveresize)
         return None;
 
-    return m_moveresize->client;
+    return moveresize->client;
 }
 
 /**
@@ -147,10 +239,11 @@ Window XModel::get_move_resize_client() const
  */
 MoveResizeState XModel::get_move_resize_state() const
 {
-    if (!m_moveresize)
+    MoveResize *moveresize = current_move_resize();
+    if (!moveresize)
         return MR_INVALID;
 
-    return m_moveresize->state;
+    return moveresize->state;
 }
 
 /**
@@ -158,11 +251,200 @@ MoveResizeState XModel::get_move_resize_state() const
  */
 void XModel::exit_move_resize()
 {
-    if (!m_moveresize)
+    m_moveresizes.destroy(m_moveresize);
+    m_moveresize = SlabHandle<MoveResize>();
+}
+
+/**
+ * Sets the geometry of the client that is being moved/resized, which is
+ * changed by move_resize_by as the pointer moves.
+ */
+void XModel::set_move_resize_geometry(const Box &geometry)
+{
+    MoveResize *moveresize = current_move_resize();
+    if (!moveresize)
+        return;
+
+    moveresize->geometry = geometry;
+}
+
+/**
+ * Sets the base size and the size increments of the client that is being
+ * resized, from the client's WM_NORMAL_HINTS. Sizes given by
+ * get_move_resize_geometry are rounded down to these increments.
+ */
+void XModel::set_move_resize_increments(Dimension2D base, Dimension2D increment)
+{
+    MoveResize *moveresize = current_move_resize();
+    if (!moveresize)
+        return;
+
+    moveresize->base_size = base;
+    moveresize->size_increment = increment;
+
+    if (DIM2D_WIDTH(moveresize->size_increment) <= 0)
+        DIM2D_WIDTH(moveresize->size_increment) = 1;
+    if (DIM2D_HEIGHT(moveresize->size_increment) <= 0)
+        DIM2D_HEIGHT(moveresize->size_increment) = 1;
+}
+
+/**
+ * Rounds a size down to the nearest step past the base size, without going
+ * below the base size. Sizes which would be rounded down to nothing are left
+ * alone.
+ */
+static Dimension snap_size(Dimension size, Dimension base, Dimension increment)
+{
+    if (size <= base)
+        return base > 0 ? base : size;
+
+    Dimension snapped = base + ((size - base) / increment) * increment;
+    return snapped > 0 ? snapped : size;
+}
+
+/**
+ * Gets the geometry of the client that is being moved/resized, with its size
+ * rounded to its size increments.
+ *
+ * @return The geometry, or an empty Box if nothing is being moved/resized.
+ */
+Box XModel::get_move_resize_geometry() const
+{
+    MoveResize *moveresize = current_move_resize();
+    if (!moveresize)
+        return Box();
+
+    Box geometry = moveresize->geometry;
+    geometry.width = snap_size(geometry.width,
+        DIM2D_WIDTH(moveresize->base_size),
+        DIM2D_WIDTH(moveresize->size_increment));
+    geometry.height = snap_size(geometry.height,
+        DIM2D_HEIGHT(moveresize->base_size),
+        DIM2D_HEIGHT(moveresize->size_increment));
+    return geometry;
+}
+
+/**
+ * Applies a change in the pointer's position (from update_pointer) to the
+ * geometry of the client which is being moved/resized - moves change the
+ * client's location, and resizes change its size.
+ *
+ * @return The new geometry, as given by get_move_resize_geometry.
+ */
+Box XModel::move_resize_by(Dimension2D change)
+{
+    MoveResize *moveresize = current_move_resize();
+    if (!moveresize)
+        return Box();
+
+    Box &geometry = moveresize->geometry;
+    switch (moveresize->state)
+    {
+    case MR_MOVE:
+        geometry.x += DIM2D_X(change);
+        geometry.y += DIM2D_Y(change);
+        break;
+    case MR_RESIZE:
+        // Don't let the client get a negative size
+        if (geometry.width + DIM2D_X(change) > 0)
+            geometry.width += DIM2D_X(change);
+        if (geometry.height + DIM2D_Y(change) > 0)
+            geometry.height += DIM2D_Y(change);
+        break;
+    }
+
+    return get_move_resize_geometry();
+}
+
+/**
+ * Gets the outline that is drawn on the root for the current move/resize.
+ *
+ * @return true if an outline is drawn, false otherwise.
+ */
+bool XModel::get_move_resize_outline(Box &outline) const
+{
+    MoveResize *moveresize = current_move_resize();
+    if (!moveresize || !moveresize->has_outline)
+        return false;
+
+    outline = moveresize->outline;
+    return true;
+}
+
+/**
+ * Records that an outline was drawn for the current move/resize.
+ */
+void XModel::set_move_resize_outline(const Box &outline)
+{
+    MoveResize *moveresize = current_move_resize();
+    if (!moveresize)
+        return;
+
+    moveresize->has_outline = true;
+    moveresize->outline = outline;
+}
+
+/**
+ * Records that the outline for the current move/resize was erased.
+ */
+void XModel::clear_move_resize_outline()
+{
+    MoveResize *moveresize = current_move_resize();
+    if (!moveresize)
         return;
 
-    delete m_moveresize;
-    m_moveresize = 0;
+    moveresize->has_outline = false;
+}
+
+/**
+ * Checks whether enough time has passed since the client being moved/resized
+ * was last updated, and if so, records that it is being updated now.
+ *
+ * @param now_ns The current time, in nanoseconds.
+ * @param interval_ns How long to wait between updates, in nanoseconds.
+ * @return true if the client should be updated, false otherwise.
+ */
+bool XModel::throttle_move_resize(uint64_t now_ns, uint64_t interval_ns)
+{
+    MoveResize *moveresize = current_move_resize();
+    if (!moveresize)
+        return false;
+
+    if (moveresize->last_update_ns != 0 &&
+            now_ns - moveresize->last_update_ns < interval_ns)
+        return false;
+
+    moveresize->last_update_ns = now_ns;
+    return true;
+}
+
+/**
+ * Gets the data for the current move/resize.
+ *
+ * @return The data, or NULL if nothing is being moved/resized.
+ */
+MoveResize *XModel::current_move_resize() const
+{
+    return m_moveresizes.get(m_moveresize);
+}
+
+/**
+ * Gets the window which is used as the placeholder for moves and resizes,
+ * whether or not anything is being moved or resized.
+ *
+ * @return The placeholder, or None if one hasn't been created yet.
+ */
+Window XModel::get_placeholder() const
+{
+    return m_placeholder;
+}
+
+/**
+ * Stores the window to use as the placeholder for moves and resizes.
+ */
+void XModel::set_placeholder(Window placeholder)
+{
+    m_placeholder = placeholder;
 }
 
 /**
@@ -198,3 +480,20 @@ void XModel::remove_all_effects(Window client)
 {
     m_effects.erase(client);
 }
+
+/**
+ * Gets the last known state of a window, which is empty (everything is
+ * unknown) if the window hasn't been seen before.
+ */
+WindowMirror &XModel::get_mirror(Window window)
+{
+    return m_mirrors[window];
+}
+
+/**
+ * Forgets everything known about a window, after it has been destroyed.
+ */
+void XModel::forget_mirror(Window window)
+{
+    m_mirrors.erase(window);
+}
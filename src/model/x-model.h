@@ -3,10 +3,17 @@
 #define __SMALLWM_X_MODEL__
 #include <map>
 #include <vector>
+#include <stdint.h>
 
 #include "common.h"
+#include "slab.h"
 #include "xdata.h"
 
+struct Icon;
+
+/// Refers to an icon owned by the XModel
+typedef SlabHandle<Icon> IconHandle;
+
 /**
  * Stores the data necessary to handle an icon.
  */
@@ -16,16 +23,23 @@ struct Icon
         client(_client), icon(_icon), gc(_gc)
     {};
 
+    /// The icon's handle in the XModel, which stays valid until it is destroyed
+    IconHandle handle;
+
     /// The window that the icon "stands for"
     Window client;
 
     /// The icon window itself
     Window icon;
 
-    /// The graphical context used to draw the icon
+    /** The graphical context used to draw the icon, which is freed along with
+     * the icon */
     XGC *gc;
 };
 
+/// The most icon windows that are kept around for reuse
+const size_t ICON_POOL_SIZE = 16;
+
 /**
  * The state of the client which is currently being moved or resized.
  */
@@ -42,7 +56,9 @@ enum MoveResizeState
 struct MoveResize
 {
     MoveResize(Window _client, Window _placeholder, MoveResizeState _state) :
-        client(_client), placeholder(_placeholder), state(_state)
+        client(_client), placeholder(_placeholder), state(_state),
+        base_size(0, 0), size_increment(1, 1), has_outline(false),
+        last_update_ns(0)
     {};
 
     /// If this data is for a mover or a resizer
@@ -53,6 +69,25 @@ struct MoveResize
 
     /// The moved/resized client itself
     Window client;
+
+    /** Where the client will be put, and how large it will be, once the
+     * move/resize is over */
+    Box geometry;
+
+    /// The size that the client's size increments are counted from
+    Dimension2D base_size;
+
+    /// The steps that the client's size can change in
+    Dimension2D size_increment;
+
+    /// Whether or not an outline is currently drawn on the root
+    bool has_outline;
+
+    /// The outline that is currently drawn on the root
+    Box outline;
+
+    /// When the client itself was last moved/resized, in nanoseconds
+    uint64_t last_update_ns;
 };
 
 /**
@@ -65,6 +100,45 @@ enum ClientEffect {
 };
 
 
+/**
+ * What SmallWM knows about whether a window is mapped on the X server.
+ */
+enum MirrorMapState
+{
+    MIRROR_UNKNOWN = 0, //< The window's state hasn't been seen yet
+    MIRROR_MAPPED,
+    MIRROR_UNMAPPED,
+};
+
+/**
+ * The last known state of a window on the X server. This is kept so that
+ * requests which wouldn't change anything (mapping an already mapped window,
+ * for example) don't have to be sent at all.
+ */
+struct WindowMirror
+{
+    WindowMirror() :
+        map_state(MIRROR_UNKNOWN), pending_map_events(0),
+        has_border_color(false), border_color(X_BLACK),
+        has_border_width(false), border_width(0)
+    {};
+
+    /// Whether or not the window is mapped
+    MirrorMapState map_state;
+
+    /** How many MapNotify events are still on their way, because of map
+     * requests that SmallWM sent */
+    unsigned int pending_map_events;
+
+    /// The window's border color, if it has been set
+    bool has_border_color;
+    MonoColor border_color;
+
+    /// The window's border width, if it is known
+    bool has_border_width;
+    Dimension border_width;
+};
+
 /**
  * A data store for information about the UI of the window manager (rather than
  * information about the windows which are being managed).
@@ -72,15 +146,23 @@ enum ClientEffect {
 class XModel
 {
 public:
-    XModel() : m_moveresize(0)
+    XModel() : m_placeholder(None)
     {};
 
+    Icon *create_icon(Window, Window, XGC*);
+    void destroy_icon(Icon*);
+    Icon *get_icon(IconHandle) const;
+
     void register_icon(Icon*);
     void unregister_icon(Icon*);
 
     Icon *find_icon_from_client(Window) const;
     Icon *find_icon_from_icon_window(Window) const;
     void get_icons(std::vector<Icon*>&);
+    void get_pooled_icons(std::vector<Icon*>&);
+
+    Icon *reuse_icon(Window);
+    bool recycle_icon(Icon*);
 
     void enter_move(Window, Window, Dimension2D);
     void enter_resize(Window, Window, Dimension2D);
@@ -93,23 +175,60 @@ public:
 
     void exit_move_resize();
 
+    void set_move_resize_geometry(const Box&);
+    void set_move_resize_increments(Dimension2D, Dimension2D);
+    Box get_move_resize_geometry() const;
+    Box move_resize_by(Dimension2D);
+
+    bool get_move_resize_outline(Box&) const;
+    void set_move_resize_outline(const Box&);
+    void clear_move_resize_outline();
+
+    bool throttle_move_resize(uint64_t, uint64_t);
+
+    Window get_placeholder() const;
+    void set_placeholder(Window);
+
     bool has_effect(Window, ClientEffect);
     void set_effect(Window, ClientEffect);
     void clear_effect(Window, ClientEffect);
     void remove_all_effects(Window);
 
+    WindowMirror &get_mirror(Window);
+    void forget_mirror(Window);
+
 private:
+    MoveResize *current_move_resize() const;
+
+    /// Every icon, whether it is registered, pooled or neither
+    Slab<Icon> m_icons;
+
     /// A mapping between clients and their icons
-    std::map<Window, Icon*> m_clients_to_icons;
+    std::map<Window, IconHandle> m_clients_to_icons;
 
     /// A mapping between icon windows and the icon structures
-    std::map<Window, Icon*> m_icon_windows_to_icons;
+    std::map<Window, IconHandle> m_icon_windows_to_icons;
+
+    /** Icons (along with their windows and GCs) which aren't being used, and
+     * can be given to the next client which is iconified */
+    std::vector<IconHandle> m_icon_pool;
 
     /// The effects present on each window
     std::map<Window, ClientEffect> m_effects;
 
-    /// The current data about moving or resizing
-    MoveResize *m_moveresize;
+    /// The last known server-side state of each window
+    std::map<Window, WindowMirror> m_mirrors;
+
+    /** The storage for the current move/resize - there is only ever one, but
+     * its slot is reused from one drag to the next */
+    Slab<MoveResize> m_moveresizes;
+
+    /// The current data about moving or resizing, if anything is being dragged
+    SlabHandle<MoveResize> m_moveresize;
+
+    /** The placeholder window, which is kept around (unmapped) between moves
+     * and resizes so that it doesn't have to be created for each one */
+    Window m_placeholder;
 
     /// The current pointer location
     Dimension2D m_pointer;
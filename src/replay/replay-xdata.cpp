@@ -0,0 +1,214 @@
+/** @file */
+#include "replay/replay-xdata.h"
+
+/// The first ID given out to windows which weren't recorded in the trace
+static const Window FIRST_UNRECORDED_WINDOW = 0x7f000000;
+
+/**
+ * Creates a new ReplayXData, which starts out with the windows and screens
+ * given in the trace's header.
+ */
+ReplayXData::ReplayXData(Stats &stats, TraceReader &reader,
+        const TraceHeader &header) :
+    FakeXData(stats),
+    m_reader(reader), m_has_next(false), m_finished(false),
+    m_events_read(0), m_keysym(NoSymbol),
+    m_next_window(FIRST_UNRECORDED_WINDOW)
+{
+    primary_mod_flag = header.primary_mod_flag;
+    secondary_mod_flag = header.secondary_mod_flag;
+    num_mod_flag = header.num_mod_flag;
+    caps_mod_flag = header.caps_mod_flag;
+    scroll_mod_flag = header.scroll_mod_flag;
+
+    set_screens(header.screens);
+
+    for (std::vector<TraceWindow>::const_iterator window = header.windows.begin();
+            window != header.windows.end();
+            window++)
+        load_window(*window);
+
+    m_start_ns = monotonic_ns();
+}
+
+/**
+ * Drops the events that the fake server produces in response to requests -
+ * the trace already contains the events that the real server produced.
+ */
+void ReplayXData::queue_event(const XEvent &event)
+{
+}
+
+/**
+ * Records that some requests were made.
+ */
+void ReplayXData::count(StatsRequest request, unsigned int requests)
+{
+    FakeXData::count(request, requests);
+    m_requests.push_back(
+        ReplayRequest(monotonic_ns() - m_start_ns, m_events_read, request));
+}
+
+/**
+ * Records that some requests were made, each of which needed a reply.
+ */
+void ReplayXData::count_round_trip(StatsRequest request, unsigned int requests)
+{
+    FakeXData::count_round_trip(request, requests);
+    m_requests.push_back(
+        ReplayRequest(monotonic_ns() - m_start_ns, m_events_read, request));
+}
+
+/**
+ * Makes sure that the next item in the trace has been read.
+ *
+ * @return false if the trace has no more items.
+ */
+bool ReplayXData::peek_item()
+{
+    if (!m_has_next)
+        m_has_next = m_reader.next(m_next);
+
+    return m_has_next;
+}
+
+/**
+ * Puts a window described in the trace onto the fake server.
+ */
+void ReplayXData::load_window(const TraceWindow &desc)
+{
+    FakeWindow window;
+    window.x = desc.x;
+    window.y = desc.y;
+    window.width = desc.width;
+    window.height = desc.height;
+    window.override_redirect = desc.override_redirect;
+    window.input_only = desc.input_only;
+    window.mapped = desc.mapped;
+    window.transient_for = desc.transient_for;
+    window.hint_flags = desc.hint_flags;
+    window.initial_state = desc.initial_state;
+    window.input = desc.input;
+    window.win_class = desc.win_class;
+    window.icon_name = desc.icon_name;
+    add_window(desc.window, window);
+}
+
+/**
+ * Gets the ID for a new window. If SmallWM created a window at this point in
+ * the trace, then the new window gets the same ID, so that the events which
+ * refer to it still make sense.
+ */
+Window ReplayXData::allocate_window()
+{
+    Window window;
+    if (!m_created.empty())
+    {
+        window = m_created.front();
+        m_created.pop_front();
+    }
+    else if (peek_item() && m_next.type == TI_CREATE)
+    {
+        window = m_next.created;
+        m_has_next = false;
+    }
+    else
+        window = m_next_window++;
+
+    return window;
+}
+
+/**
+ * Reads the next event from the trace, and updates the state of the windows
+ * to match it. Once the trace is finished, this produces empty events (which
+ * XEvents ignores).
+ */
+void ReplayXData::next_event(XEvent &event)
+{
+    std::memset(&event, 0, sizeof(event));
+
+    while (peek_item())
+    {
+        TraceItem &item = m_next;
+        m_has_next = false;
+
+        if (item.type == TI_WINDOW)
+        {
+            load_window(item.window);
+            continue;
+        }
+
+        // The window was created before the event was recorded, so it must
+        // be created while the event is being handled
+        if (item.type == TI_CREATE)
+        {
+            m_created.push_back(item.created);
+            continue;
+        }
+
+        event = item.event;
+        m_events_read++;
+
+        switch (event.type)
+        {
+        case TRACE_RRNOTIFY:
+            event.type = randr_event_offset + RRNotify;
+            set_screens(item.screens);
+            break;
+        case KeyPress:
+        case KeyRelease:
+            m_keysym = item.keysym;
+            set_pointer(event.xkey.x_root, event.xkey.y_root);
+            break;
+        case ButtonPress:
+        case ButtonRelease:
+            set_pointer(event.xbutton.x_root, event.xbutton.y_root);
+            break;
+        case MotionNotify:
+            set_pointer(event.xmotion.x_root, event.xmotion.y_root);
+            break;
+        case ConfigureNotify:
+        {
+            FakeWindow *window = lookup(event.xconfigure.window);
+            if (window)
+            {
+                window->x = event.xconfigure.x;
+                window->y = event.xconfigure.y;
+                window->width = event.xconfigure.width;
+                window->height = event.xconfigure.height;
+            }
+            break;
+        }
+        case MapNotify:
+            set_mapped(event.xmap.window, true);
+            break;
+        case UnmapNotify:
+            set_mapped(event.xunmap.window, false);
+            break;
+        case DestroyNotify:
+            remove_window(event.xdestroywindow.window);
+            break;
+        }
+
+        return;
+    }
+
+    m_finished = true;
+}
+
+/**
+ * Events are recorded after MotionNotify events have been compressed, so
+ * there is never a later event to skip ahead to.
+ */
+void ReplayXData::get_latest_event(XEvent &data, int type)
+{
+}
+
+/**
+ * Gets the keysym of the most recent key event - this is the only time that
+ * XEvents looks up keysyms.
+ */
+KeySym ReplayXData::get_keysym(int keycode)
+{
+    return m_keysym;
+}
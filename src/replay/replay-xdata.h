@@ -0,0 +1,101 @@
+/** @file */
+#ifndef __SMALLWM_REPLAY_XDATA__
+#define __SMALLWM_REPLAY_XDATA__
+
+#include <deque>
+#include <vector>
+
+#include "common.h"
+#include "fake/fake-xdata.h"
+#include "stats.h"
+#include "trace.h"
+
+/**
+ * A request that was made while replaying a trace, and when it was made.
+ */
+struct ReplayRequest
+{
+    ReplayRequest(uint64_t _time_ns, uint64_t _event, StatsRequest _request) :
+        time_ns(_time_ns), event(_event), request(_request)
+    {}
+
+    /// When the request was made, relative to the start of the replay
+    uint64_t time_ns;
+
+    /// How many events had been read when this request was made
+    uint64_t event;
+
+    /// The XData method that made the request
+    StatsRequest request;
+};
+
+/**
+ * A fake X server which feeds events from a trace, rather than from the test
+ * code. The windows described in the trace are loaded onto the fake server,
+ * and their state is kept up to date with the events in the trace.
+ *
+ * Every request that a real XData would have sent is counted (using the
+ * same counters as the real XData) and timestamped.
+ */
+class ReplayXData : public FakeXData
+{
+public:
+    ReplayXData(Stats &stats, TraceReader &reader, const TraceHeader &header);
+
+    bool is_finished() const
+    { return m_finished; }
+
+    uint64_t events_read() const
+    { return m_events_read; }
+
+    const std::vector<ReplayRequest> &get_requests() const
+    { return m_requests; }
+
+    void queue_event(const XEvent&);
+
+    void next_event(XEvent&);
+    void get_latest_event(XEvent&, int);
+
+    KeySym get_keysym(int);
+
+protected:
+    Window allocate_window();
+    void count(StatsRequest, unsigned int);
+    void count_round_trip(StatsRequest, unsigned int);
+
+private:
+    bool peek_item();
+    void load_window(const TraceWindow&);
+
+    /// Where the events are read from
+    TraceReader &m_reader;
+
+    /// The item after the current event, if m_has_next is set
+    TraceItem m_next;
+
+    /// Whether m_next has been read from the trace, but not yet used
+    bool m_has_next;
+
+    /// Windows which were created while handling the current event
+    std::deque<Window> m_created;
+
+    /// Whether the last event in the trace has been read
+    bool m_finished;
+
+    /// How many events have been read from the trace
+    uint64_t m_events_read;
+
+    /// Every request that has been made, in order
+    std::vector<ReplayRequest> m_requests;
+
+    /// When the replay started
+    uint64_t m_start_ns;
+
+    /// The keysym of the most recent KeyPress event
+    KeySym m_keysym;
+
+    /// The ID to give to the next window that isn't in the trace
+    Window m_next_window;
+};
+
+#endif
@@ -0,0 +1,207 @@
+/** @file */
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <unistd.h>
+
+#include "clientmodel-events.h"
+#include "configparse.h"
+#include "common.h"
+#include "deferred-work.h"
+#include "event-stream.h"
+#include "ewmh.h"
+#include "fake/fake-launcher.h"
+#include "logging/logging.h"
+#include "logging/stream.h"
+#include "mirrored-xdata.h"
+#include "model/changes.h"
+#include "model/client-model.h"
+#include "model/screen.h"
+#include "model/x-model.h"
+#include "replay/replay-xdata.h"
+#include "stats.h"
+#include "trace.h"
+#include "x-events.h"
+
+/**
+ * A WMConfig which reads from a given configuration file, instead of the
+ * user's configuration file.
+ */
+class ReplayWMConfig : public WMConfig
+{
+public:
+    ReplayWMConfig(const std::string &path) :
+        m_path(path)
+    {};
+
+protected:
+    std::string get_config_path() const
+    {
+        return m_path;
+    };
+
+private:
+    /// The configuration file to read
+    std::string m_path;
+};
+
+/**
+ * Prints out the usage message and exits.
+ */
+void usage(const char *program)
+{
+    std::cerr << "Usage: " << program <<
+        " [-c CONFIG] [-r REQUEST-LOG] [-s] TRACE\n"
+        "\n"
+        "Replays a trace recorded by SmallWM (see the trace-file option)\n"
+        "without an X server, and reports how long it took.\n"
+        "\n"
+        "  -c CONFIG       Use the given configuration file, instead of\n"
+        "                  $HOME/.config/smallwm\n"
+        "  -r REQUEST-LOG  Write every X request that would have been made,\n"
+        "                  with its timestamp, into REQUEST-LOG\n"
+        "  -s              Print the handler and request statistics as JSON\n";
+
+    std::exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    std::string config_path;
+    std::string request_log;
+    bool print_stats = false;
+
+    int option;
+    while ((option = getopt(argc, argv, "c:r:s")) != -1)
+    {
+        switch (option)
+        {
+        case 'c':
+            config_path = optarg;
+            break;
+        case 'r':
+            request_log = optarg;
+            break;
+        case 's':
+            print_stats = true;
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+
+    if (optind != argc - 1)
+        usage(argv[0]);
+
+    WMConfig default_config;
+    ReplayWMConfig custom_config(config_path);
+    WMConfig &config = config_path.size() > 0 ? custom_config : default_config;
+    config.load();
+
+    // The replay is meant to be silent, apart from its results
+    std::ofstream null_stream("/dev/null");
+    StreamLog logger(null_stream);
+
+    TraceReader reader;
+    TraceHeader header;
+    if (!reader.open(argv[optind], header))
+    {
+        std::cerr << "Could not read trace '" << argv[optind] << "'\n";
+        return 1;
+    }
+
+    Stats stats;
+    ReplayXData xdata(stats, reader, header);
+
+    CrtManager crt_manager;
+    std::vector<Box> screens;
+    xdata.get_screen_boxes(screens);
+    crt_manager.rebuild_graph(screens);
+
+    ChangeStream changes;
+    ClientModel clients(changes, crt_manager, config.num_desktops, config.border_width);
+
+    // The replay is never itself recorded, so this is never opened
+    TraceWriter trace(xdata);
+
+    XModel xmodel;
+    MirroredXData mirrored_xdata(xdata, xmodel, stats);
+    GrabManager grabs(mirrored_xdata);
+    DeferredWork work;
+    EwmhPublisher ewmh(mirrored_xdata, clients, FAKE_ROOT,
+                       config.num_desktops);
+    EventStream events;
+    // Replaying a launch shouldn't start anything
+    FakeLauncher launcher;
+    XEvents x_events(config, stats, trace, mirrored_xdata, grabs, work,
+                     launcher, clients, xmodel);
+
+    uint64_t start_ns = monotonic_ns();
+
+    for (std::vector<TraceWindow>::iterator window = header.windows.begin();
+         window != header.windows.end();
+         window++)
+        x_events.add_window(window->window);
+
+    ClientModelEvents client_events(config, logger, stats, changes,
+                                    mirrored_xdata, grabs, work, ewmh,
+                                    events, clients, xmodel);
+
+    client_events.handle_queued_changes();
+
+    while (!xdata.is_finished())
+    {
+        if (!x_events.step())
+            break;
+
+        do
+            client_events.handle_queued_changes();
+        while (!work.empty());
+    }
+
+    uint64_t elapsed_ns = monotonic_ns() - start_ns;
+
+    uint64_t total_requests = 0, total_round_trips = 0, total_suppressed = 0;
+    for (int request = 0; request < SR_COUNT; request++)
+    {
+        total_requests += stats.requests(static_cast<StatsRequest>(request));
+        total_round_trips += stats.round_trips(static_cast<StatsRequest>(request));
+        total_suppressed += stats.suppressed(static_cast<StatsRequest>(request));
+    }
+
+    std::cout << "events: " << xdata.events_read() << "\n"
+              << "elapsed_ns: " << elapsed_ns << "\n"
+              << "events_per_sec: " <<
+                    (elapsed_ns > 0 ?
+                     xdata.events_read() * 1000000000.0 / elapsed_ns : 0) << "\n"
+              << "requests: " << total_requests << "\n"
+              << "round_trips: " << total_round_trips << "\n"
+              << "suppressed: " << total_suppressed << "\n";
+
+    if (print_stats)
+    {
+        stats.dump(std::cout);
+        std::cout << "\n";
+    }
+
+    if (request_log.size() > 0)
+    {
+        std::ofstream log_file(request_log.c_str());
+        if (!log_file)
+        {
+            std::cerr << "Could not open request log '" << request_log << "'\n";
+            return 1;
+        }
+
+        const std::vector<ReplayRequest> &requests = xdata.get_requests();
+        for (std::vector<ReplayRequest>::const_iterator request = requests.begin();
+             request != requests.end();
+             request++)
+        {
+            log_file << request->time_ns << " " << request->event << " "
+                     << Stats::request_name(request->request) << "\n";
+        }
+    }
+
+    return 0;
+}
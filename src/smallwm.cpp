@@ -1,25 +1,40 @@
 #include <csignal>
-#include <fstream>
+#include <cstdlib>
 #include <iostream>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <unistd.h>
 
 #include "actions.h"
 #include "clientmodel-events.h"
+#include "config-reloader.h"
 #include "configparse.h"
 #include "common.h"
+#include "control.h"
+#include "deferred-work.h"
+#include "event-stream.h"
+#include "ewmh.h"
+#include "launcher.h"
 #include "logging/logging.h"
 #include "logging/file.h"
 #include "logging/syslog.h"
+#include "mirrored-xdata.h"
 #include "model/changes.h"
 #include "model/client-model.h"
 #include "model/screen.h"
 #include "model/x-model.h"
-#include "xdata.h"
+#include "snapshot.h"
+#include "state-dump.h"
+#include "stats.h"
+#include "trace.h"
+#include "xlib-data.h"
 #include "x-events.h"
 
 bool should_execute_dump = false;
 
+/// Reads the configuration file again in the background, on SIGHUP
+ConfigReloader *config_reloader = NULL;
+
 /**
  * Triggers a model state dump after the current batch of events has been processed.
  */
@@ -28,6 +43,16 @@ void enable_dump(int signal)
     should_execute_dump = true;
 }
 
+/**
+ * Starts re-reading the configuration file, which is swapped in once it has
+ * been parsed.
+ */
+void request_reload(int signal)
+{
+    if (config_reloader)
+        config_reloader->request();
+}
+
 /**
  * Prints out X errors to enable diagnosis, but doesn't kill us.
  * @param display The display the error occurred on
@@ -48,8 +73,56 @@ int x_error_handler(Display *display, XErrorEvent *event)
     return 0;
 }
 
-int main()
+/**
+ * Saves the state of every client, and starts SmallWM again so that it can
+ * pick that state back up. This only returns if SmallWM couldn't be started.
+ *
+ * @param argv The arguments that SmallWM was originally started with.
+ * @param snapshot The state to carry over to the new SmallWM.
+ * @param logger Where to report errors.
+ */
+void restart(char **argv, const Snapshot &snapshot, Log &logger)
+{
+    char snapshot_file[] = "/tmp/smallwm-snapshot-XXXXXX";
+    int fd = mkstemp(snapshot_file);
+    if (fd == -1)
+    {
+        logger.log(LOG_ERR) <<
+            "Could not create a snapshot file for restarting" << Log::endl;
+        return;
+    }
+    close(fd);
+
+    SnapshotWriter writer;
+    if (!writer.write(snapshot_file, snapshot))
+    {
+        logger.log(LOG_ERR) <<
+            "Could not write snapshot file '" << snapshot_file << "'" <<
+            Log::endl;
+        unlink(snapshot_file);
+        return;
+    }
+
+    logger.log(LOG_NOTICE) << "Restarting" << Log::endl;
+
+    // argv[0] is used rather than /proc/self/exe, so that a SmallWM which
+    // was just upgraded starts up the new binary instead of the old one
+    char restore_flag[] = "--restore";
+    char *restart_argv[] = { argv[0], restore_flag, snapshot_file, NULL };
+    execvp(argv[0], restart_argv);
+
+    logger.log(LOG_ERR) <<
+        "Could not restart '" << argv[0] << "'" << Log::endl;
+    unlink(snapshot_file);
+}
+
+int main(int argc, char **argv)
 {
+    // The launch helper is another copy of SmallWM, which only starts
+    // programs for the SmallWM that started it
+    if (argc == 2 && std::string(argv[1]) == "--launch-helper")
+        return Launcher::run_helper(STDIN_FILENO);
+
     // Make sure that child processes don't generate zombies. This is an
     // alternative to the wait() reaping loop under POSIX 2001
     signal(SIGCHLD, SIG_IGN);
@@ -60,6 +133,17 @@ int main()
     WMConfig config;
     config.load();
 
+    // A SmallWM which restarted itself passes on the state it had before
+    Snapshot snapshot;
+    bool has_snapshot = argc == 3 && std::string(argv[1]) == "--restore";
+    bool is_restoring = false;
+    if (has_snapshot)
+    {
+        SnapshotReader reader;
+        is_restoring = reader.read(argv[2], snapshot);
+        unlink(argv[2]);
+    }
+
     Log* logger;
     if (config.log_file == std::string("syslog"))
     {
@@ -75,6 +159,15 @@ int main()
         logger = new FileLog(config.log_file, config.log_mask);
     }
 
+    // The helper is started before anything else is opened, while SmallWM
+    // is as small as it will ever be. /proc/self/exe is used (rather than
+    // argv[0]) since the helper has to be the same binary as this one.
+    Launcher launcher;
+    if (config.launch_helper && !launcher.start_helper("/proc/self/exe"))
+        logger->log(LOG_ERR) <<
+            "Could not start the launch helper - launching programs " <<
+            "directly" << Log::endl;
+
     Display *display = XOpenDisplay(NULL);
     if (!display)
     {
@@ -87,16 +180,25 @@ int main()
     }
 
     Window default_root = DefaultRootWindow(display);
-    XData xdata(*logger, display, default_root, DefaultScreen(display));
+    Stats stats;
+    XlibData xdata(*logger, stats, display, default_root, DefaultScreen(display));
     xdata.select_input(default_root,
                        PointerMotionMask |
                        StructureNotifyMask |
                        SubstructureNotifyMask |
                        SubstructureRedirectMask);
 
+    if (has_snapshot && !is_restoring)
+        logger->log(LOG_WARNING) <<
+            "Could not read snapshot file '" << argv[2] <<
+            "' - starting from scratch" << Log::endl;
+
     CrtManager crt_manager;
     std::vector<Box> screens;
-    xdata.get_screen_boxes(screens);
+    if (is_restoring && !snapshot.screens.empty())
+        screens = snapshot.screens;
+    else
+        xdata.get_screen_boxes(screens);
     crt_manager.rebuild_graph(screens);
 
     ChangeStream changes;
@@ -105,55 +207,159 @@ int main()
     std::vector<Window> existing_windows;
     xdata.get_windows(existing_windows);
 
+    TraceWriter trace(xdata);
+    if (config.trace_file.size() > 0)
+    {
+        std::vector<Window> traced_windows;
+        for (std::vector<Window>::iterator win_iter = existing_windows.begin();
+             win_iter != existing_windows.end();
+             win_iter++)
+        {
+            if (*win_iter != default_root)
+                traced_windows.push_back(*win_iter);
+        }
+
+        if (trace.open(config.trace_file, traced_windows))
+        {
+            xdata.record_to(&trace);
+        }
+        else
+        {
+            logger->log(LOG_ERR) <<
+                "Could not open trace file '" << config.trace_file <<
+                "' for writing" << Log::endl;
+        }
+    }
+
     XModel xmodel;
-    XEvents x_events(config, xdata, clients, xmodel);
+    MirroredXData mirrored_xdata(xdata, xmodel, stats);
+    GrabManager grabs(mirrored_xdata);
+    DeferredWork work;
+    EwmhPublisher ewmh(mirrored_xdata, clients, default_root,
+                       config.num_desktops);
+    EventStream events;
+    XEvents x_events(config, stats, trace, mirrored_xdata, grabs, work,
+                     launcher, clients, xmodel);
 
-    for (std::vector<Window>::iterator win_iter = existing_windows.begin();
-         win_iter != existing_windows.end();
-         win_iter++)
+    if (is_restoring)
     {
-        if (*win_iter != default_root)
-            x_events.add_window(*win_iter);
+        x_events.restore(snapshot, existing_windows);
+    }
+    else
+    {
+        for (std::vector<Window>::iterator win_iter = existing_windows.begin();
+             win_iter != existing_windows.end();
+             win_iter++)
+        {
+            if (*win_iter != default_root)
+                x_events.add_window(*win_iter);
+        }
     }
 
 
-    ClientModelEvents client_events(config, *logger, changes,
-                                    xdata, clients, xmodel);
+    ClientModelEvents client_events(config, *logger, stats, changes,
+                                    mirrored_xdata, grabs, work, ewmh,
+                                    events, clients, xmodel);
 
     // Make sure to process all the changes produced by the class actions for
     // the first set of windows
     client_events.handle_queued_changes();
 
-    while (x_events.step())
+    DumpWriter dump_writer;
+
+    ConfigReloader reloader;
+    config_reloader = &reloader;
+    signal(SIGHUP, request_reload);
+
+    ControlServer control(config, x_events, clients, crt_manager, events);
+    if (config.control_socket.size() > 0 &&
+            !control.open(config.control_socket))
+        logger->log(LOG_ERR) <<
+            "Could not open control socket '" << config.control_socket <<
+            "'" << Log::endl;
+
+    std::vector<struct pollfd> wait_fds;
+    while (true)
     {
+        wait_fds.clear();
+
+        struct pollfd reload_fd;
+        reload_fd.fd = reloader.wakeup_fd();
+        reload_fd.events = POLLIN;
+        wait_fds.push_back(reload_fd);
+        control.get_poll_fds(wait_fds);
+
+        // Waiting here, rather than inside of XNextEvent, means that a
+        // finished reload (or a control request) doesn't have to wait for the
+        // next X event
+        bool has_event = xdata.wait_for_event(wait_fds);
+
+        WMConfig *new_config = reloader.poll();
+        if (new_config)
+        {
+            logger->log(LOG_NOTICE) <<
+                "Reloaded the configuration file" << Log::endl;
+
+            x_events.reload_config(*new_config);
+            delete new_config;
+        }
+
+        if (has_event && !x_events.step())
+            break;
+
+        // Every request that came in is run before the changes are handled,
+        // so that a batch of commands only costs a single pass
+        control.handle(wait_fds);
+        if (x_events.is_done())
+            break;
+
         if (should_execute_dump)
         {
             should_execute_dump = false;
 
+            if (dump_writer.take_failure())
+                logger->log(LOG_ERR) <<
+                    "Could not write the last dump to '" <<
+                    config.dump_file << "'" << Log::endl;
+
             logger->log(LOG_NOTICE) <<
                 "Executing dump to target file '" << config.dump_file << 
                 "'" << Log::endl;
 
-            std::fstream dump_file(config.dump_file.c_str(),
-                                   std::fstream::out | std::fstream::app);
-
-            if (dump_file)
-            {
-                dump_file << "#BEGIN DUMP\n";
-                crt_manager.dump(dump_file);
-                clients.dump(dump_file);
-                dump_file << "#END DUMP\n";
-                dump_file.close();
-            }
-            else
-            {
-                logger->log(LOG_ERR) <<
-                    "Could not open dump file '" << config.dump_file << 
-                    "' for writing" << Log::endl;
-            }
+            // Only the copy is done here - formatting and writing the dump
+            // are left to the writer's thread
+            StateDump *dump = new StateDump();
+            dump->take(clients, crt_manager, stats);
+            dump_writer.write(config.dump_file, dump);
         }
 
-        client_events.handle_queued_changes();
+        // Work that was asked for again after it ran is held for the next
+        // batch, which is run now rather than after the next event
+        do
+            client_events.handle_queued_changes();
+        while (!work.empty());
+    }
+
+    signal(SIGHUP, SIG_IGN);
+    config_reloader = NULL;
+
+    // The socket is removed here, since a restart doesn't run destructors -
+    // the new SmallWM binds it again
+    control.close();
+
+    if (x_events.should_restart())
+    {
+        snapshot.take(clients, crt_manager);
+        trace.close();
+
+        // The grabs and icons that belong to this connection have to be gone
+        // before the new SmallWM sets up its own
+        XCloseDisplay(display);
+        restart(argv, snapshot, *logger);
+
+        logger->stop();
+        delete logger;
+        return 1;
     }
 
     logger->stop();
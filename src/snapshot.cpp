@@ -0,0 +1,280 @@
+/** @file */
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "snapshot.h"
+#include "varint.h"
+
+static const char SNAPSHOT_MAGIC[8] = {'S', 'W', 'M', 'S', 'T', 'A', 'T', 'E'};
+
+/**
+ * Captures the state of the client model and the screens.
+ */
+void Snapshot::take(ClientModel &clients, const CrtManager &crt_manager)
+{
+    current_desktop = clients.get_current_desktop();
+    focused = clients.get_focused();
+
+    screens.clear();
+    crt_manager.get_screen_boxes(screens);
+
+    // Children are saved along with their parents, so only the clients
+    // themselves are needed here
+    std::vector<Window> windows;
+    clients.get_all_clients(windows);
+
+    this->clients.clear();
+    for (std::vector<Window>::iterator window = windows.begin();
+         window != windows.end();
+         window++)
+    {
+        if (!clients.is_client(*window))
+            continue;
+
+        this->clients.push_back(ClientState());
+        clients.get_client_state(*window, this->clients.back());
+    }
+}
+
+/**
+ * Writes out a snapshot.
+ *
+ * @param filename Where to store the snapshot.
+ * @param snapshot The snapshot to store.
+ * @return true if the snapshot was written, false otherwise.
+ */
+bool SnapshotWriter::write(const std::string &filename,
+        const Snapshot &snapshot)
+{
+    m_buffer.clear();
+    m_buffer.append(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    write_uint(SNAPSHOT_VERSION);
+
+    write_uint(snapshot.current_desktop);
+    write_uint(snapshot.focused);
+
+    write_uint(snapshot.screens.size());
+    for (std::vector<Box>::const_iterator box = snapshot.screens.begin();
+         box != snapshot.screens.end();
+         box++)
+    {
+        write_int(box->x);
+        write_int(box->y);
+        write_int(box->width);
+        write_int(box->height);
+    }
+
+    write_uint(snapshot.clients.size());
+    for (std::vector<ClientState>::const_iterator state =
+             snapshot.clients.begin();
+         state != snapshot.clients.end();
+         state++)
+    {
+        write_uint(state->client);
+        write_uint(state->desktop);
+
+        unsigned int flags =
+            (state->stuck ? 1 : 0) |
+            (state->iconified ? 2 : 0) |
+            (state->autofocus ? 4 : 0) |
+            (state->packed ? 8 : 0);
+        write_uint(flags);
+
+        write_uint(state->layer);
+        write_int(DIM2D_X(state->location));
+        write_int(DIM2D_Y(state->location));
+        write_int(DIM2D_WIDTH(state->size));
+        write_int(DIM2D_HEIGHT(state->size));
+        write_uint(state->mode);
+        write_uint(state->pack_corner);
+        write_uint(state->pack_priority);
+
+        write_uint(state->children.size());
+        for (std::vector<Window>::const_iterator child =
+                 state->children.begin();
+             child != state->children.end();
+             child++)
+            write_uint(*child);
+    }
+
+    int fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd == -1)
+        return false;
+
+    const char *data = m_buffer.data();
+    size_t remaining = m_buffer.size();
+    while (remaining > 0)
+    {
+        ssize_t written = ::write(fd, data, remaining);
+        if (written <= 0)
+        {
+            close(fd);
+            return false;
+        }
+
+        data += written;
+        remaining -= written;
+    }
+
+    close(fd);
+    return true;
+}
+
+/**
+ * Writes an unsigned integer as a LEB128 varint.
+ */
+void SnapshotWriter::write_uint(uint64_t value)
+{
+    append_varint(m_buffer, value);
+}
+
+/**
+ * Writes a zig-zag encoded signed integer.
+ */
+void SnapshotWriter::write_int(int64_t value)
+{
+    write_uint(zigzag_encode(value));
+}
+
+/**
+ * Reads a snapshot.
+ *
+ * @param filename The snapshot to read.
+ * @param[out] snapshot Where to store the snapshot. If the snapshot isn't
+ *                      valid, this may be partially filled in.
+ * @return true if the snapshot was valid, false otherwise.
+ */
+bool SnapshotReader::read(const std::string &filename, Snapshot &snapshot)
+{
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+
+    std::string contents;
+    char buffer[4096];
+    ssize_t count;
+    while ((count = ::read(fd, buffer, sizeof(buffer))) > 0)
+        contents.append(buffer, count);
+
+    close(fd);
+    if (count < 0)
+        return false;
+
+    m_pos = reinterpret_cast<const unsigned char*>(contents.data());
+    m_end = m_pos + contents.size();
+    bool is_valid = read_snapshot(snapshot);
+
+    m_pos = 0;
+    m_end = 0;
+    return is_valid;
+}
+
+/**
+ * Decodes the contents of the snapshot.
+ */
+bool SnapshotReader::read_snapshot(Snapshot &snapshot)
+{
+    if (static_cast<size_t>(m_end - m_pos) < sizeof(SNAPSHOT_MAGIC) ||
+            std::memcmp(m_pos, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0)
+        return false;
+    m_pos += sizeof(SNAPSHOT_MAGIC);
+
+    uint64_t version;
+    if (!read_uint(version) || version != SNAPSHOT_VERSION)
+        return false;
+
+    if (!read_as(snapshot.current_desktop) || !read_as(snapshot.focused))
+        return false;
+
+    uint64_t count;
+    if (!read_uint(count))
+        return false;
+
+    snapshot.screens.clear();
+    for (uint64_t idx = 0; idx < count; idx++)
+    {
+        int64_t x, y, width, height;
+        if (!read_int(x) || !read_int(y) ||
+                !read_int(width) || !read_int(height))
+            return false;
+
+        snapshot.screens.push_back(Box(x, y, width, height));
+    }
+
+    if (!read_uint(count))
+        return false;
+
+    snapshot.clients.clear();
+    for (uint64_t idx = 0; idx < count; idx++)
+    {
+        ClientState state;
+        if (!read_client(state))
+            return false;
+
+        snapshot.clients.push_back(state);
+    }
+
+    // Anything left over means that the snapshot isn't what we think it is
+    return m_pos == m_end;
+}
+
+/**
+ * Decodes the state of a single client.
+ */
+bool SnapshotReader::read_client(ClientState &state)
+{
+    uint64_t flags;
+    int64_t x, y, width, height;
+    uint64_t num_children;
+    if (!read_as(state.client) ||
+            !read_as(state.desktop) ||
+            !read_uint(flags) ||
+            !read_as(state.layer) ||
+            !read_int(x) || !read_int(y) ||
+            !read_int(width) || !read_int(height) ||
+            !read_as(state.mode) ||
+            !read_as(state.pack_corner) ||
+            !read_as(state.pack_priority) ||
+            !read_uint(num_children))
+        return false;
+
+    state.stuck = (flags & 1) != 0;
+    state.iconified = (flags & 2) != 0;
+    state.autofocus = (flags & 4) != 0;
+    state.packed = (flags & 8) != 0;
+    state.location = Dimension2D(x, y);
+    state.size = Dimension2D(width, height);
+
+    for (uint64_t idx = 0; idx < num_children; idx++)
+    {
+        Window child;
+        if (!read_as(child))
+            return false;
+
+        state.children.push_back(child);
+    }
+
+    return true;
+}
+
+/**
+ * Reads a LEB128 varint.
+ */
+bool SnapshotReader::read_uint(uint64_t &value)
+{
+    return decode_varint(m_pos, m_end, value);
+}
+
+/**
+ * Reads a zig-zag encoded signed integer.
+ */
+bool SnapshotReader::read_int(int64_t &value)
+{
+    uint64_t encoded;
+    if (!read_uint(encoded))
+        return false;
+
+    value = zigzag_decode(encoded);
+    return true;
+}
@@ -0,0 +1,92 @@
+/** @file */
+#ifndef __SMALLWM_SNAPSHOT__
+#define __SMALLWM_SNAPSHOT__
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "model/client-model.h"
+#include "model/screen.h"
+#include "common.h"
+
+/// The version of the snapshot format, which is stored in each snapshot
+const uint64_t SNAPSHOT_VERSION = 1;
+
+/**
+ * The state that SmallWM carries across a restart - the screens, what desktop
+ * is visible, what is focused, and the state of every client.
+ *
+ * Everything in the XModel (icons and the move/resize placeholder) belongs to
+ * the old connection to the X server and goes away with it, so it isn't saved
+ * here. Icons are rebuilt from the clients that are iconified.
+ */
+struct Snapshot
+{
+    Snapshot() :
+        current_desktop(0), focused(None)
+    {}
+
+    void take(ClientModel&, const CrtManager&);
+
+    unsigned long long current_desktop;
+    Window focused;
+    std::vector<Box> screens;
+    std::vector<ClientState> clients;
+};
+
+/**
+ * Writes a Snapshot out to a file, encoded as LEB128 varints (see varint.h) in
+ * the same way as traces and configuration caches.
+ */
+class SnapshotWriter
+{
+public:
+    bool write(const std::string&, const Snapshot&);
+
+private:
+    void write_uint(uint64_t);
+    void write_int(int64_t);
+
+    /// The contents of the snapshot, which are written out all at once
+    std::string m_buffer;
+};
+
+/**
+ * Reads back the snapshots written by SnapshotWriter.
+ */
+class SnapshotReader
+{
+public:
+    SnapshotReader() :
+        m_pos(0), m_end(0)
+    {}
+
+    bool read(const std::string&, Snapshot&);
+
+private:
+    bool read_snapshot(Snapshot&);
+    bool read_client(ClientState&);
+    bool read_uint(uint64_t&);
+    bool read_int(int64_t&);
+
+    /// Reads an unsigned integer into a field of some other type
+    template <typename T>
+    bool read_as(T &value)
+    {
+        uint64_t raw;
+        if (!read_uint(raw))
+            return false;
+
+        value = static_cast<T>(raw);
+        return true;
+    }
+
+    /// The next byte to decode
+    const unsigned char *m_pos;
+
+    /// The end of the snapshot
+    const unsigned char *m_end;
+};
+
+#endif
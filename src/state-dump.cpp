@@ -0,0 +1,215 @@
+/** @file */
+#include <fstream>
+
+#include "state-dump.h"
+#include "utils.h"
+
+static const char *CORNER_NAMES[] = {
+    "northeast",
+    "northwest",
+    "southeast",
+    "southwest",
+};
+
+/**
+ * Formats the location and size of a screen as a JSON object.
+ */
+void write_box_json(std::ostream &output, const Box &box)
+{
+    output << "{\"x\":" << box.x
+           << ",\"y\":" << box.y
+           << ",\"width\":" << box.width
+           << ",\"height\":" << box.height << "}";
+}
+
+/**
+ * Formats the state of a single client as a JSON object.
+ */
+void write_client_json(std::ostream &output, const ClientState &state)
+{
+    output << "{\"window\":" << state.client << ",\"desktop\":";
+    if (state.stuck || state.iconified)
+        output << "null";
+    else
+        output << state.desktop;
+
+    output << ",\"stuck\":" << (state.stuck ? "true" : "false")
+           << ",\"iconified\":" << (state.iconified ? "true" : "false")
+           << ",\"layer\":" << static_cast<int>(state.layer)
+           << ",\"x\":" << DIM2D_X(state.location)
+           << ",\"y\":" << DIM2D_Y(state.location)
+           << ",\"width\":" << DIM2D_WIDTH(state.size)
+           << ",\"height\":" << DIM2D_HEIGHT(state.size)
+           << ",\"mode\":\"" << CPS_NAMES[state.mode] << "\""
+           << ",\"autofocus\":" << (state.autofocus ? "true" : "false")
+           << ",\"pack\":";
+
+    if (state.packed)
+        output << "{\"corner\":\"" << CORNER_NAMES[state.pack_corner]
+               << "\",\"priority\":" << state.pack_priority << "}";
+    else
+        output << "null";
+
+    output << ",\"children\":[";
+    for (std::vector<Window>::const_iterator child =
+             state.children.begin();
+         child != state.children.end();
+         child++)
+    {
+        if (child != state.children.begin())
+            output << ",";
+        output << *child;
+    }
+
+    output << "]}";
+}
+
+/**
+ * Copies the state of the model and the statistics.
+ */
+void StateDump::take(ClientModel &clients, const CrtManager &crt_manager,
+        const Stats &stats)
+{
+    time = std::time(NULL);
+    model.take(clients, crt_manager);
+    this->stats = stats;
+}
+
+/**
+ * Formats the dump as a single line of JSON (without the trailing newline).
+ */
+void StateDump::write_json(std::ostream &output) const
+{
+    output << std::dec;
+    output << "{\"version\":" << STATE_DUMP_VERSION
+           << ",\"time\":" << time
+           << ",\"current_desktop\":" << model.current_desktop
+           << ",\"focused\":" << model.focused;
+
+    output << ",\"screens\":[";
+    for (std::vector<Box>::const_iterator box = model.screens.begin();
+         box != model.screens.end();
+         box++)
+    {
+        if (box != model.screens.begin())
+            output << ",";
+
+        write_box_json(output, *box);
+    }
+
+    output << "],\"clients\":[";
+    for (std::vector<ClientState>::const_iterator state =
+             model.clients.begin();
+         state != model.clients.end();
+         state++)
+    {
+        if (state != model.clients.begin())
+            output << ",";
+
+        write_client_json(output, *state);
+    }
+
+    output << "],\"stats\":";
+    stats.dump(output);
+    output << "}";
+}
+
+DumpWriter::~DumpWriter()
+{
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+        m_stopping = true;
+    }
+
+    m_wakeup.notify_one();
+
+    // Whatever is still pending is written out before the worker stops
+    if (m_worker.joinable())
+        m_worker.join();
+
+    delete m_pending;
+}
+
+/**
+ * Hands a dump to the worker thread to be written out.
+ *
+ * @param filename The file to append the dump to.
+ * @param dump The dump to write, which the DumpWriter takes ownership of.
+ */
+void DumpWriter::write(const std::string &filename, StateDump *dump)
+{
+    {
+        std::lock_guard<std::mutex> guard(m_lock);
+
+        // The worker hasn't gotten to the last dump yet, and this one is
+        // more recent, so there's no point in writing the older one
+        delete m_pending;
+        m_pending = dump;
+        m_pending_filename = filename;
+    }
+
+    if (!m_worker.joinable())
+        m_worker = start_thread_without_signals(&DumpWriter::run, this);
+
+    m_wakeup.notify_one();
+}
+
+/**
+ * Checks whether any dump couldn't be written. The worker thread can't log
+ * anything itself, so this lets the event loop report it instead.
+ *
+ * @return true if a dump failed since the last call, false otherwise.
+ */
+bool DumpWriter::take_failure()
+{
+    std::lock_guard<std::mutex> guard(m_lock);
+    bool failed = m_failed;
+    m_failed = false;
+    return failed;
+}
+
+/**
+ * Appends a dump to the end of a file.
+ *
+ * @return true if the dump was written, false otherwise.
+ */
+bool DumpWriter::output(const std::string &filename, const StateDump &dump)
+{
+    std::ofstream dump_file(filename.c_str(),
+                            std::ofstream::out | std::ofstream::app);
+    if (!dump_file)
+        return false;
+
+    dump.write_json(dump_file);
+    dump_file << "\n";
+    dump_file.close();
+    return !dump_file.fail();
+}
+
+/**
+ * Writes out dumps as they come in. This runs on the worker thread.
+ */
+void DumpWriter::run()
+{
+    std::unique_lock<std::mutex> guard(m_lock);
+    while (true)
+    {
+        while (!m_pending && !m_stopping)
+            m_wakeup.wait(guard);
+
+        if (!m_pending)
+            break;
+
+        StateDump *dump = m_pending;
+        std::string filename = m_pending_filename;
+        m_pending = 0;
+
+        guard.unlock();
+        bool written = output(filename, *dump);
+        delete dump;
+        guard.lock();
+
+        if (!written)
+            m_failed = true;
+    }
+}
@@ -0,0 +1,91 @@
+/** @file */
+#ifndef __SMALLWM_STATE_DUMP__
+#define __SMALLWM_STATE_DUMP__
+
+#include <condition_variable>
+#include <ctime>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+
+#include "model/client-model.h"
+#include "model/screen.h"
+#include "snapshot.h"
+#include "stats.h"
+
+/// The version of the dump format, which is stored in each dump
+const int STATE_DUMP_VERSION = 1;
+
+void write_box_json(std::ostream&, const Box&);
+void write_client_json(std::ostream&, const ClientState&);
+
+/**
+ * A copy of everything that goes into a dump. This is taken on the event
+ * loop, and is never changed afterwards - so that the dump can be formatted
+ * and written out on another thread while the event loop keeps changing the
+ * model.
+ */
+struct StateDump
+{
+    StateDump() :
+        time(0)
+    {}
+
+    void take(ClientModel&, const CrtManager&, const Stats&);
+    void write_json(std::ostream&) const;
+
+    /// When the dump was taken
+    std::time_t time;
+
+    Snapshot model;
+    Stats stats;
+};
+
+/**
+ * Writes out dumps on a separate thread, so that handling SIGUSR1 only costs
+ * the event loop the time it takes to copy the model.
+ *
+ * Each dump is appended to the dump file as a single line of JSON. If dumps
+ * are asked for faster than they can be written, then only the newest dump
+ * that is waiting to be written is kept.
+ */
+class DumpWriter
+{
+public:
+    DumpWriter() :
+        m_pending(0), m_stopping(false), m_failed(false)
+    {}
+
+    ~DumpWriter();
+
+    void write(const std::string&, StateDump*);
+    bool take_failure();
+
+private:
+    bool output(const std::string&, const StateDump&);
+    void run();
+
+    /// The thread doing the writing, once the first dump has been written
+    std::thread m_worker;
+
+    /// Protects everything below, which the worker thread reads and writes
+    std::mutex m_lock;
+
+    /// Signalled when there is a new dump, or the worker should stop
+    std::condition_variable m_wakeup;
+
+    /// The dump which is waiting to be written, if any
+    StateDump *m_pending;
+
+    /// Where the pending dump should be written
+    std::string m_pending_filename;
+
+    /// Whether the worker should stop once it has written the pending dump
+    bool m_stopping;
+
+    /// Whether a dump couldn't be written since the last take_failure()
+    bool m_failed;
+};
+
+#endif
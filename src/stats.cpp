@@ -0,0 +1,393 @@
+/** @file */
+#include "stats.h"
+
+#include <ios>
+
+/// The names of each handler, in the same order as StatsHandler
+static const char *HANDLER_NAMES[SH_COUNT] = {
+    "XEvents::handle_rrnotify",
+    "XEvents::handle_keypress",
+    "XEvents::handle_keyrelease",
+    "XEvents::handle_buttonpress",
+    "XEvents::handle_buttonrelease",
+    "XEvents::handle_motionnotify",
+    "XEvents::handle_configurenotify",
+    "XEvents::handle_mapnotify",
+    "XEvents::handle_unmapnotify",
+    "XEvents::handle_expose",
+    "XEvents::handle_destroynotify",
+    "XEvents::handle_configurerequest",
+    "XEvents::handle_maprequest",
+    "XEvents::handle_circulaterequest",
+    "XEvents::handle_mappingnotify",
+
+    "ClientModelEvents::handle_layer_change",
+    "ClientModelEvents::handle_focus_change",
+    "ClientModelEvents::handle_focus_preview_change",
+    "ClientModelEvents::handle_client_desktop_change",
+    "ClientModelEvents::handle_current_desktop_change",
+    "ClientModelEvents::handle_screen_change",
+    "ClientModelEvents::handle_mode_change",
+    "ClientModelEvents::handle_location_change",
+    "ClientModelEvents::handle_size_change",
+    "ClientModelEvents::handle_destroy_change",
+    "ClientModelEvents::handle_unmap_change",
+};
+
+/// The names of each XData method, in the same order as StatsRequest
+static const char *REQUEST_NAMES[SR_COUNT] = {
+    "XData::init_xrandr",
+    "XData::load_keyboard_mapping",
+    "XData::load_modifier_flags",
+    "XData::create_gc",
+    "XData::create_window",
+    "XData::change_property",
+    "XData::next_event",
+    "XData::add_hotkey",
+    "XData::remove_hotkey",
+    "XData::add_hotkey_mouse",
+    "XData::remove_hotkey_mouse",
+    "XData::clear_hotkeys",
+    "XData::confine_pointer",
+    "XData::stop_confining_pointer",
+    "XData::grab_mouse",
+    "XData::ungrab_mouse",
+    "XData::grab_keyboard",
+    "XData::ungrab_keyboard",
+    "XData::select_input",
+    "XData::get_windows",
+    "XData::get_pointer_location",
+    "XData::get_input_focus",
+    "XData::set_input_focus",
+    "XData::map_win",
+    "XData::unmap_win",
+    "XData::request_close",
+    "XData::destroy_win",
+    "XData::get_attributes",
+    "XData::set_attributes",
+    "XData::set_border_color",
+    "XData::set_border_width",
+    "XData::move_window",
+    "XData::resize_window",
+    "XData::move_resize_window",
+    "XData::raise",
+    "XData::restack",
+    "XData::draw_outline",
+    "XData::get_wm_hints",
+    "XData::get_size_hints",
+    "XData::get_transient_hint",
+    "XData::get_icon_name",
+    "XData::get_class",
+    "XData::get_instance",
+    "XData::get_title",
+    "XData::get_role",
+    "XData::get_window_type",
+    "XData::get_screen_boxes",
+    "XData::forward_configure_request",
+    "XData::forward_circulate_request",
+    "XData::intern_if_needed",
+    "XData::substructure_events",
+    "XGC::clear",
+    "XGC::draw_string",
+    "XGC::copy_pixmap",
+};
+
+/// The names of each counter, in the same order as StatsCounter
+static const char *COUNTER_NAMES[SC_COUNT] = {
+    "icon_pool_hit",
+    "icon_pool_miss",
+};
+
+/**
+ * Removes all the values from the histogram.
+ */
+void Histogram::reset()
+{
+    for (int idx = 0; idx < BUCKET_COUNT; idx++)
+        m_buckets[idx] = 0;
+
+    m_count = 0;
+    m_total = 0;
+    m_min = 0;
+    m_max = 0;
+}
+
+/**
+ * Adds a new value to the histogram.
+ */
+void Histogram::record(uint64_t value)
+{
+    m_buckets[index_of(value)]++;
+
+    if (m_count == 0 || value < m_min)
+        m_min = value;
+    if (value > m_max)
+        m_max = value;
+
+    m_count++;
+    m_total += value;
+}
+
+/**
+ * Finds the bucket that a value belongs in.
+ *
+ * Values below SUB_BUCKET_COUNT each get their own bucket. Above that, the
+ * highest set bit picks the power of two, and the SUB_BUCKET_BITS bits below
+ * it (including the highest bit itself) pick the sub-bucket.
+ */
+int Histogram::index_of(uint64_t value)
+{
+    if (value < static_cast<uint64_t>(SUB_BUCKET_COUNT))
+        return static_cast<int>(value);
+
+    int high_bit = 63 - __builtin_clzll(value);
+    int shift = high_bit - (SUB_BUCKET_BITS - 1);
+    int sub_bucket = static_cast<int>(value >> shift);
+    return SUB_BUCKET_HALF * shift + sub_bucket;
+}
+
+/**
+ * Gets the largest value which would be stored in the given bucket.
+ */
+uint64_t Histogram::highest_equivalent(int index)
+{
+    if (index < SUB_BUCKET_COUNT)
+        return static_cast<uint64_t>(index);
+
+    int shift = index / SUB_BUCKET_HALF - 1;
+    uint64_t sub_bucket = index - SUB_BUCKET_HALF * shift;
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+/**
+ * Gets the value which is at the given percentile (from 0 to 100) of the
+ * recorded values. The result is accurate to within the precision of the
+ * bucket it falls into, and never exceeds the largest recorded value.
+ */
+uint64_t Histogram::percentile(double pct) const
+{
+    if (m_count == 0)
+        return 0;
+
+    uint64_t target = static_cast<uint64_t>(pct / 100.0 * m_count + 0.5);
+    if (target < 1)
+        target = 1;
+    if (target > m_count)
+        target = m_count;
+
+    uint64_t seen = 0;
+    for (int idx = 0; idx < BUCKET_COUNT; idx++)
+    {
+        seen += m_buckets[idx];
+        if (seen >= target)
+        {
+            uint64_t value = highest_equivalent(idx);
+            return value < m_max ? value : m_max;
+        }
+    }
+
+    return m_max;
+}
+
+/**
+ * Writes the histogram out as a JSON object. The non-empty buckets are written
+ * as [highest-equivalent-value, count] pairs.
+ */
+void Histogram::dump(std::ostream &output) const
+{
+    output << "{\"count\":" << m_count
+           << ",\"total_ns\":" << m_total
+           << ",\"min_ns\":" << min()
+           << ",\"max_ns\":" << m_max
+           << ",\"p50_ns\":" << percentile(50)
+           << ",\"p90_ns\":" << percentile(90)
+           << ",\"p99_ns\":" << percentile(99)
+           << ",\"p999_ns\":" << percentile(99.9)
+           << ",\"buckets\":[";
+
+    bool first = true;
+    for (int idx = 0; idx < BUCKET_COUNT; idx++)
+    {
+        if (m_buckets[idx] == 0)
+            continue;
+
+        if (!first)
+            output << ",";
+        first = false;
+
+        output << "[" << highest_equivalent(idx) << "," << m_buckets[idx] << "]";
+    }
+
+    output << "]}";
+}
+
+/**
+ * Clears all the counters and histograms.
+ */
+void Stats::reset()
+{
+    for (int handler = 0; handler < SH_COUNT; handler++)
+        m_handlers[handler].reset();
+
+    for (int request = 0; request < SR_COUNT; request++)
+    {
+        m_requests[request] = 0;
+        m_round_trips[request] = 0;
+        m_suppressed[request] = 0;
+    }
+
+    for (int counter = 0; counter < SC_COUNT; counter++)
+        m_counters[counter] = 0;
+}
+
+/**
+ * Records a single invocation of an event handler, which took the given
+ * number of nanoseconds.
+ */
+void Stats::record_handler(StatsHandler handler, uint64_t elapsed_ns)
+{
+    m_handlers[handler].record(elapsed_ns);
+}
+
+/**
+ * Records that an XData method sent some requests to the X server.
+ */
+void Stats::add_requests(StatsRequest request, unsigned int count)
+{
+    m_requests[request] += count;
+}
+
+/**
+ * Records that an XData method had to wait on the X server for a reply. Note
+ * that round-trips are also counted as requests.
+ */
+void Stats::add_round_trips(StatsRequest request, unsigned int count)
+{
+    m_requests[request] += count;
+    m_round_trips[request] += count;
+}
+
+/**
+ * Records that a call to an XData method was skipped, since the X server
+ * already had the state that it would have set.
+ */
+void Stats::add_suppressed(StatsRequest request, unsigned int count)
+{
+    m_suppressed[request] += count;
+}
+
+/**
+ * Records that one of the counted events happened.
+ */
+void Stats::add_count(StatsCounter counter, unsigned int count)
+{
+    m_counters[counter] += count;
+}
+
+/**
+ * Gets the latency histogram for a handler.
+ */
+const Histogram &Stats::handler(StatsHandler handler) const
+{
+    return m_handlers[handler];
+}
+
+/**
+ * Gets the number of requests that an XData method has sent.
+ */
+uint64_t Stats::requests(StatsRequest request) const
+{
+    return m_requests[request];
+}
+
+/**
+ * Gets the number of round-trips that an XData method has made.
+ */
+uint64_t Stats::round_trips(StatsRequest request) const
+{
+    return m_round_trips[request];
+}
+
+/**
+ * Gets the number of calls to an XData method that were skipped.
+ */
+uint64_t Stats::suppressed(StatsRequest request) const
+{
+    return m_suppressed[request];
+}
+
+/**
+ * Gets the number of times that one of the counted events happened.
+ */
+uint64_t Stats::count(StatsCounter counter) const
+{
+    return m_counters[counter];
+}
+
+/**
+ * Gets the printable name of a handler.
+ */
+const char *Stats::handler_name(StatsHandler handler)
+{
+    return HANDLER_NAMES[handler];
+}
+
+/**
+ * Gets the printable name of an XData method.
+ */
+const char *Stats::request_name(StatsRequest request)
+{
+    return REQUEST_NAMES[request];
+}
+
+/**
+ * Gets the printable name of a counter.
+ */
+const char *Stats::counter_name(StatsCounter counter)
+{
+    return COUNTER_NAMES[counter];
+}
+
+/**
+ * Writes out all of the statistics as a single line of JSON.
+ */
+void Stats::dump(std::ostream &output) const
+{
+    // Don't assume anything about the stream's formatting
+    output << std::dec;
+
+    output << "{\"version\":1,\"handlers\":{";
+    for (int handler = 0; handler < SH_COUNT; handler++)
+    {
+        if (handler > 0)
+            output << ",";
+
+        output << "\"" << HANDLER_NAMES[handler] << "\":";
+        m_handlers[handler].dump(output);
+    }
+
+    output << "},\"requests\":{";
+    for (int request = 0; request < SR_COUNT; request++)
+    {
+        if (request > 0)
+            output << ",";
+
+        output << "\"" << REQUEST_NAMES[request] << "\":{"
+               << "\"requests\":" << m_requests[request]
+               << ",\"round_trips\":" << m_round_trips[request]
+               << ",\"suppressed\":" << m_suppressed[request]
+               << "}";
+    }
+
+    output << "},\"counters\":{";
+    for (int counter = 0; counter < SC_COUNT; counter++)
+    {
+        if (counter > 0)
+            output << ",";
+
+        output << "\"" << COUNTER_NAMES[counter] << "\":"
+               << m_counters[counter];
+    }
+
+    output << "}}";
+}
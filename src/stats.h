@@ -0,0 +1,269 @@
+/** @file */
+#ifndef __SMALLWM_STATS__
+#define __SMALLWM_STATS__
+
+#include <ostream>
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * The event handlers whose invocations are counted and timed. Each of these
+ * corresponds to one of the handle_* methods in either XEvents or
+ * ClientModelEvents.
+ */
+enum StatsHandler
+{
+    SH_RRNOTIFY,
+    SH_KEYPRESS,
+    SH_KEYRELEASE,
+    SH_BUTTONPRESS,
+    SH_BUTTONRELEASE,
+    SH_MOTIONNOTIFY,
+    SH_CONFIGURENOTIFY,
+    SH_MAPNOTIFY,
+    SH_UNMAPNOTIFY,
+    SH_EXPOSE,
+    SH_DESTROYNOTIFY,
+    SH_CONFIGUREREQUEST,
+    SH_MAPREQUEST,
+    SH_CIRCULATEREQUEST,
+    SH_MAPPINGNOTIFY,
+
+    SH_LAYER_CHANGE,
+    SH_FOCUS_CHANGE,
+    SH_FOCUS_PREVIEW_CHANGE,
+    SH_CLIENT_DESKTOP_CHANGE,
+    SH_CURRENT_DESKTOP_CHANGE,
+    SH_SCREEN_CHANGE,
+    SH_MODE_CHANGE,
+    SH_LOCATION_CHANGE,
+    SH_SIZE_CHANGE,
+    SH_DESTROY_CHANGE,
+    SH_UNMAP_CHANGE,
+
+    SH_COUNT
+};
+
+/**
+ * The XData (and XGC) methods which talk to the X server. Each of these has
+ * a count of the requests it has issued, and the number of those requests
+ * which required a round-trip to the server.
+ */
+enum StatsRequest
+{
+    SR_INIT_XRANDR,
+    SR_LOAD_KEYBOARD_MAPPING,
+    SR_LOAD_MODIFIER_FLAGS,
+    SR_CREATE_GC,
+    SR_CREATE_WINDOW,
+    SR_CHANGE_PROPERTY,
+    SR_NEXT_EVENT,
+    SR_ADD_HOTKEY,
+    SR_REMOVE_HOTKEY,
+    SR_ADD_HOTKEY_MOUSE,
+    SR_REMOVE_HOTKEY_MOUSE,
+    SR_CLEAR_HOTKEYS,
+    SR_CONFINE_POINTER,
+    SR_STOP_CONFINING_POINTER,
+    SR_GRAB_MOUSE,
+    SR_UNGRAB_MOUSE,
+    SR_GRAB_KEYBOARD,
+    SR_UNGRAB_KEYBOARD,
+    SR_SELECT_INPUT,
+    SR_GET_WINDOWS,
+    SR_GET_POINTER_LOCATION,
+    SR_GET_INPUT_FOCUS,
+    SR_SET_INPUT_FOCUS,
+    SR_MAP_WIN,
+    SR_UNMAP_WIN,
+    SR_REQUEST_CLOSE,
+    SR_DESTROY_WIN,
+    SR_GET_ATTRIBUTES,
+    SR_SET_ATTRIBUTES,
+    SR_SET_BORDER_COLOR,
+    SR_SET_BORDER_WIDTH,
+    SR_MOVE_WINDOW,
+    SR_RESIZE_WINDOW,
+    SR_MOVE_RESIZE_WINDOW,
+    SR_RAISE,
+    SR_RESTACK,
+    SR_DRAW_OUTLINE,
+    SR_GET_WM_HINTS,
+    SR_GET_SIZE_HINTS,
+    SR_GET_TRANSIENT_HINT,
+    SR_GET_ICON_NAME,
+    SR_GET_CLASS,
+    SR_GET_INSTANCE,
+    SR_GET_TITLE,
+    SR_GET_ROLE,
+    SR_GET_WINDOW_TYPE,
+    SR_GET_SCREEN_BOXES,
+    SR_FORWARD_CONFIGURE_REQUEST,
+    SR_FORWARD_CIRCULATE_REQUEST,
+    SR_INTERN_ATOM,
+    SR_SUBSTRUCTURE_EVENTS,
+    SR_GC_CLEAR,
+    SR_GC_DRAW_STRING,
+    SR_GC_COPY_PIXMAP,
+
+    SR_COUNT
+};
+
+/**
+ * Events inside of SmallWM which are counted, but which aren't handlers or
+ * requests.
+ */
+enum StatsCounter
+{
+    SC_ICON_POOL_HIT, //< An icon window was reused from the pool
+    SC_ICON_POOL_MISS, //< An icon window had to be created
+
+    SC_COUNT
+};
+
+/**
+ * A latency histogram, in the style of HdrHistogram - each power of two is
+ * split into a fixed number of linear sub-buckets, so that the relative error
+ * of any recorded value is bounded (here, to about 3%) no matter how large
+ * the value is.
+ */
+class Histogram
+{
+public:
+    /// The number of bits used to index the sub-buckets
+    static const int SUB_BUCKET_BITS = 5;
+    static const int SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    static const int SUB_BUCKET_HALF = SUB_BUCKET_COUNT / 2;
+
+    /// Enough buckets to hold any 64-bit value
+    static const int BUCKET_COUNT =
+        SUB_BUCKET_HALF * (64 - SUB_BUCKET_BITS + 2);
+
+    Histogram()
+    { reset(); }
+
+    void reset();
+    void record(uint64_t);
+
+    uint64_t count() const
+    { return m_count; }
+
+    uint64_t total() const
+    { return m_total; }
+
+    uint64_t min() const
+    { return m_count ? m_min : 0; }
+
+    uint64_t max() const
+    { return m_max; }
+
+    uint64_t percentile(double) const;
+
+    static int index_of(uint64_t);
+    static uint64_t highest_equivalent(int);
+
+    void dump(std::ostream&) const;
+
+private:
+    /// The number of values in each bucket
+    uint64_t m_buckets[BUCKET_COUNT];
+
+    /// The number of values recorded
+    uint64_t m_count;
+
+    /// The sum of all values recorded
+    uint64_t m_total;
+
+    /// The smallest value recorded
+    uint64_t m_min;
+
+    /// The largest value recorded
+    uint64_t m_max;
+};
+
+/**
+ * Collects counts and latencies for event handlers, as well as the number of
+ * requests (and round-trips) sent to the X server.
+ */
+class Stats
+{
+public:
+    Stats()
+    { reset(); }
+
+    void reset();
+
+    void record_handler(StatsHandler, uint64_t);
+    void add_requests(StatsRequest, unsigned int);
+    void add_round_trips(StatsRequest, unsigned int);
+    void add_suppressed(StatsRequest, unsigned int);
+    void add_count(StatsCounter, unsigned int);
+
+    const Histogram &handler(StatsHandler) const;
+    uint64_t requests(StatsRequest) const;
+    uint64_t round_trips(StatsRequest) const;
+    uint64_t suppressed(StatsRequest) const;
+    uint64_t count(StatsCounter) const;
+
+    void dump(std::ostream&) const;
+
+    static const char *handler_name(StatsHandler);
+    static const char *request_name(StatsRequest);
+    static const char *counter_name(StatsCounter);
+
+private:
+    /// The latency of each of the event handlers
+    Histogram m_handlers[SH_COUNT];
+
+    /// How many requests each XData method has sent to the X server
+    uint64_t m_requests[SR_COUNT];
+
+    /// How many of the requests in m_requests needed a reply
+    uint64_t m_round_trips[SR_COUNT];
+
+    /** How many calls to each XData method were skipped, because they
+     * wouldn't have changed anything (these aren't in m_requests) */
+    uint64_t m_suppressed[SR_COUNT];
+
+    /// How many times each of the counted events has happened
+    uint64_t m_counters[SC_COUNT];
+};
+
+/**
+ * Gets the current value of the monotonic clock, in nanoseconds.
+ */
+static inline uint64_t monotonic_ns()
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<uint64_t>(now.tv_sec) * 1000000000ULL + now.tv_nsec;
+}
+
+/**
+ * Times the scope it is declared in, and records the result in the histogram
+ * for a particular handler when it goes out of scope.
+ */
+class StatsTimer
+{
+public:
+    StatsTimer(Stats &stats, StatsHandler handler) :
+        m_stats(stats), m_handler(handler), m_start(monotonic_ns())
+    {}
+
+    ~StatsTimer()
+    {
+        m_stats.record_handler(m_handler, monotonic_ns() - m_start);
+    }
+
+private:
+    /// Where to record the elapsed time
+    Stats &m_stats;
+
+    /// Which handler is being timed
+    StatsHandler m_handler;
+
+    /// When the timer was started
+    uint64_t m_start;
+};
+
+#endif
@@ -0,0 +1,680 @@
+/** @file */
+#include "trace.h"
+#include "varint.h"
+
+/// The bytes that every trace starts with
+static const char TRACE_MAGIC[8] = {'S', 'W', 'M', 'T', 'R', 'A', 'C', 'E'};
+
+/**
+ * Opens a trace file and writes out its header.
+ *
+ * @param filename The file to write the trace into.
+ * @param existing The windows which exist before SmallWM starts managing.
+ * @return true if the file could be opened, false otherwise.
+ */
+bool TraceWriter::open(const std::string &filename,
+        const std::vector<Window> &existing)
+{
+    m_output.open(filename.c_str(),
+                  std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+    if (!m_output)
+        return false;
+
+    m_output.write(TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    write_uint(TRACE_VERSION);
+
+    write_uint(m_xdata.primary_mod_flag);
+    write_uint(m_xdata.secondary_mod_flag);
+    write_uint(m_xdata.num_mod_flag);
+    write_uint(m_xdata.caps_mod_flag);
+    write_uint(m_xdata.scroll_mod_flag);
+
+    std::vector<Box> screens;
+    m_xdata.get_screen_boxes(screens);
+    write_screens(screens);
+
+    // The existing windows are described in the header, since there isn't
+    // any event which introduces them
+    std::vector<TraceWindow> descriptions;
+    for (std::vector<Window>::const_iterator win_iter = existing.begin();
+            win_iter != existing.end();
+            win_iter++)
+        describe(*win_iter, descriptions);
+
+    write_uint(descriptions.size());
+    for (std::vector<TraceWindow>::iterator desc = descriptions.begin();
+            desc != descriptions.end();
+            desc++)
+        write_window(*desc);
+
+    m_last_ns = monotonic_ns();
+    flush();
+    return true;
+}
+
+/**
+ * Returns whether or not a trace is currently being recorded.
+ */
+bool TraceWriter::is_open() const
+{
+    return m_output.is_open();
+}
+
+/**
+ * Writes out any buffered items.
+ */
+void TraceWriter::flush()
+{
+    m_output.flush();
+    m_unflushed = 0;
+}
+
+/**
+ * Stops recording, and writes out whatever is still buffered.
+ */
+void TraceWriter::close()
+{
+    if (is_open())
+        m_output.close();
+
+    m_unflushed = 0;
+}
+
+/**
+ * Records an event, after SmallWM has finished handling it.
+ *
+ * @param event The event to record.
+ * @param received_ns When the event was received from the X server.
+ */
+void TraceWriter::record_event(const XEvent &event, uint64_t received_ns)
+{
+    // Windows have to be described before the event that introduces them,
+    // since a replay will ask about them while handling that event
+    std::vector<TraceWindow> descriptions;
+    switch (event.type)
+    {
+    case MapNotify:
+        describe(event.xmap.window, descriptions);
+        break;
+    case MapRequest:
+        describe(event.xmaprequest.window, descriptions);
+        break;
+    case ConfigureRequest:
+        describe(event.xconfigurerequest.window, descriptions);
+        break;
+    }
+
+    for (std::vector<TraceWindow>::iterator desc = descriptions.begin();
+            desc != descriptions.end();
+            desc++)
+    {
+        m_output.put(static_cast<char>(TI_WINDOW));
+        write_window(*desc);
+    }
+
+    int type = event.type;
+    if (type == m_xdata.randr_event_offset + RRNotify)
+        type = TRACE_RRNOTIFY;
+
+    m_output.put(static_cast<char>(TI_EVENT));
+
+    // Events are handled in order, but the clock is allowed to go backwards
+    // as far as the delta encoding is concerned
+    uint64_t delta = received_ns > m_last_ns ? received_ns - m_last_ns : 0;
+    write_uint(delta);
+    m_last_ns += delta;
+
+    write_uint(type);
+
+    switch (type)
+    {
+    case TRACE_RRNOTIFY:
+    {
+        std::vector<Box> screens;
+        m_xdata.get_screen_boxes(screens);
+        write_screens(screens);
+        break;
+    }
+    case KeyPress:
+    case KeyRelease:
+        write_uint(event.xkey.window);
+        write_uint(event.xkey.subwindow);
+        write_uint(event.xkey.state);
+        write_uint(event.xkey.keycode);
+        write_int(event.xkey.x_root);
+        write_int(event.xkey.y_root);
+        write_uint(m_xdata.get_keysym(event.xkey.keycode));
+        break;
+    case ButtonPress:
+    case ButtonRelease:
+        write_uint(event.xbutton.window);
+        write_uint(event.xbutton.subwindow);
+        write_uint(event.xbutton.state);
+        write_uint(event.xbutton.button);
+        write_int(event.xbutton.x_root);
+        write_int(event.xbutton.y_root);
+        break;
+    case MotionNotify:
+        write_uint(event.xmotion.window);
+        write_uint(event.xmotion.state);
+        write_int(event.xmotion.x_root);
+        write_int(event.xmotion.y_root);
+        break;
+    case ConfigureNotify:
+        write_uint(event.xconfigure.window);
+        write_int(event.xconfigure.x);
+        write_int(event.xconfigure.y);
+        write_int(event.xconfigure.width);
+        write_int(event.xconfigure.height);
+        break;
+    case MapNotify:
+        write_uint(event.xmap.window);
+        break;
+    case UnmapNotify:
+        write_uint(event.xunmap.window);
+        break;
+    case Expose:
+        write_uint(event.xexpose.window);
+        break;
+    case DestroyNotify:
+        write_uint(event.xdestroywindow.window);
+
+        // The window's ID may be reused by the server, in which case the
+        // new window has to get its own description
+        m_described.erase(event.xdestroywindow.window);
+        break;
+    case ConfigureRequest:
+        write_uint(event.xconfigurerequest.window);
+        write_uint(event.xconfigurerequest.value_mask);
+        write_int(event.xconfigurerequest.x);
+        write_int(event.xconfigurerequest.y);
+        write_int(event.xconfigurerequest.width);
+        write_int(event.xconfigurerequest.height);
+        write_int(event.xconfigurerequest.border_width);
+        write_uint(event.xconfigurerequest.above);
+        write_uint(event.xconfigurerequest.detail);
+        break;
+    case MapRequest:
+        write_uint(event.xmaprequest.window);
+        break;
+    case CirculateRequest:
+        write_uint(event.xcirculaterequest.window);
+        write_uint(event.xcirculaterequest.place);
+        break;
+    case MappingNotify:
+        write_uint(event.xmapping.request);
+        write_uint(event.xmapping.first_keycode);
+        write_uint(event.xmapping.count);
+        break;
+    }
+
+    if (++m_unflushed >= FLUSH_INTERVAL)
+        flush();
+}
+
+/**
+ * Records that SmallWM created a window, so that a replay can give its own
+ * window the same ID.
+ */
+void TraceWriter::record_created(Window window)
+{
+    m_output.put(static_cast<char>(TI_CREATE));
+    write_uint(window);
+
+    // Anything SmallWM creates is already known about
+    m_described.insert(window);
+}
+
+/**
+ * Gets a description of a window, if it hasn't already been described. Any
+ * windows that it is transient for are described before it.
+ *
+ * @param window The window to describe.
+ * @param[out] descriptions Where to add the window's description.
+ */
+void TraceWriter::describe(Window window, std::vector<TraceWindow> &descriptions)
+{
+    if (window == None || m_described.count(window) > 0)
+        return;
+
+    m_described.insert(window);
+
+    TraceWindow desc;
+    desc.window = window;
+
+    XWindowAttributes attr;
+    m_xdata.get_attributes(window, attr);
+    desc.x = attr.x;
+    desc.y = attr.y;
+    desc.width = attr.width;
+    desc.height = attr.height;
+    desc.override_redirect = attr.override_redirect;
+    desc.input_only = attr.c_class == InputOnly;
+    desc.mapped = attr.map_state != IsUnmapped;
+
+    desc.transient_for = m_xdata.get_transient_hint(window);
+
+    // The parent is queried when the child is added, so it has to come first
+    describe(desc.transient_for, descriptions);
+
+    XWMHints hints;
+    if (m_xdata.get_wm_hints(window, hints))
+    {
+        desc.hint_flags = hints.flags & (StateHint | InputHint);
+        desc.initial_state = hints.initial_state;
+        desc.input = hints.input;
+    }
+
+    m_xdata.get_class(window, desc.win_class);
+    m_xdata.get_icon_name(window, desc.icon_name);
+
+    descriptions.push_back(desc);
+}
+
+/**
+ * Writes out the description of a window.
+ */
+void TraceWriter::write_window(const TraceWindow &window)
+{
+    write_uint(window.window);
+    write_int(window.x);
+    write_int(window.y);
+    write_int(window.width);
+    write_int(window.height);
+
+    unsigned int flags =
+        (window.override_redirect ? 1 : 0) |
+        (window.input_only ? 2 : 0) |
+        (window.mapped ? 4 : 0) |
+        (window.input ? 8 : 0);
+    write_uint(flags);
+
+    write_uint(window.transient_for);
+    write_uint(window.hint_flags);
+    write_uint(window.initial_state);
+    write_string(window.win_class);
+    write_string(window.icon_name);
+}
+
+/**
+ * Writes out a list of screens.
+ */
+void TraceWriter::write_screens(const std::vector<Box> &screens)
+{
+    write_uint(screens.size());
+    for (std::vector<Box>::const_iterator box = screens.begin();
+            box != screens.end();
+            box++)
+    {
+        write_int(box->x);
+        write_int(box->y);
+        write_int(box->width);
+        write_int(box->height);
+    }
+}
+
+/**
+ * Writes an unsigned integer as a LEB128 varint.
+ */
+void TraceWriter::write_uint(uint64_t value)
+{
+    char bytes[VARINT_MAX_BYTES];
+    m_output.write(bytes, encode_varint(value, bytes));
+}
+
+/**
+ * Writes a zig-zag encoded signed integer.
+ */
+void TraceWriter::write_int(int64_t value)
+{
+    write_uint(zigzag_encode(value));
+}
+
+/**
+ * Writes a length-prefixed string.
+ */
+void TraceWriter::write_string(const std::string &text)
+{
+    write_uint(text.size());
+    m_output.write(text.data(), text.size());
+}
+
+/**
+ * Opens a trace file and reads its header.
+ *
+ * @param filename The trace file to read.
+ * @param[out] header Where to store the trace's header.
+ * @return true if the header could be read, false otherwise.
+ */
+bool TraceReader::open(const std::string &filename, TraceHeader &header)
+{
+    m_input.open(filename.c_str(), std::ifstream::in | std::ifstream::binary);
+    if (!m_input)
+        return false;
+
+    char magic[sizeof(TRACE_MAGIC)];
+    m_input.read(magic, sizeof(magic));
+    if (!m_input || std::memcmp(magic, TRACE_MAGIC, sizeof(magic)) != 0)
+        return false;
+
+    uint64_t version;
+    if (!read_uint(version) || version != TRACE_VERSION)
+        return false;
+
+    uint64_t mod_flags[5];
+    for (int idx = 0; idx < 5; idx++)
+    {
+        if (!read_uint(mod_flags[idx]))
+            return false;
+    }
+
+    header.primary_mod_flag = mod_flags[0];
+    header.secondary_mod_flag = mod_flags[1];
+    header.num_mod_flag = mod_flags[2];
+    header.caps_mod_flag = mod_flags[3];
+    header.scroll_mod_flag = mod_flags[4];
+
+    if (!read_screens(header.screens))
+        return false;
+
+    uint64_t num_windows;
+    if (!read_uint(num_windows))
+        return false;
+
+    header.windows.clear();
+    for (uint64_t idx = 0; idx < num_windows; idx++)
+    {
+        TraceWindow window;
+        if (!read_window(window))
+            return false;
+
+        header.windows.push_back(window);
+    }
+
+    m_timestamp_ns = 0;
+    return true;
+}
+
+/**
+ * Reads the next item from the trace.
+ *
+ * @param[out] item Where to store the item.
+ * @return true if an item was read, or false if the trace is finished (or
+ *         was truncated). In the latter case, the item's type is TI_END.
+ */
+bool TraceReader::next(TraceItem &item)
+{
+    item.type = TI_END;
+
+    int type = m_input.get();
+    if (!m_input)
+        return false;
+
+    switch (type)
+    {
+    case TI_WINDOW:
+        if (!read_window(item.window))
+            return false;
+        break;
+    case TI_CREATE:
+    {
+        uint64_t window;
+        if (!read_uint(window))
+            return false;
+
+        item.created = window;
+        break;
+    }
+    case TI_EVENT:
+    {
+        uint64_t delta, event_type;
+        if (!read_uint(delta) || !read_uint(event_type))
+            return false;
+
+        m_timestamp_ns += delta;
+        item.timestamp_ns = m_timestamp_ns;
+
+        std::memset(&item.event, 0, sizeof(item.event));
+        item.event.type = event_type;
+        item.keysym = NoSymbol;
+        item.screens.clear();
+
+        switch (event_type)
+        {
+        case TRACE_RRNOTIFY:
+            if (!read_screens(item.screens))
+                return false;
+            break;
+        case KeyPress:
+        case KeyRelease:
+        {
+            uint64_t window, subwindow, state, keycode, keysym;
+            int64_t x_root, y_root;
+            if (!read_uint(window) || !read_uint(subwindow) ||
+                    !read_uint(state) || !read_uint(keycode) ||
+                    !read_int(x_root) || !read_int(y_root) ||
+                    !read_uint(keysym))
+                return false;
+
+            item.event.xkey.window = window;
+            item.event.xkey.subwindow = subwindow;
+            item.event.xkey.state = state;
+            item.event.xkey.keycode = keycode;
+            item.event.xkey.x_root = x_root;
+            item.event.xkey.y_root = y_root;
+            item.keysym = keysym;
+            break;
+        }
+        case ButtonPress:
+        case ButtonRelease:
+        {
+            uint64_t window, subwindow, state, button;
+            int64_t x_root, y_root;
+            if (!read_uint(window) || !read_uint(subwindow) ||
+                    !read_uint(state) || !read_uint(button) ||
+                    !read_int(x_root) || !read_int(y_root))
+                return false;
+
+            item.event.xbutton.window = window;
+            item.event.xbutton.subwindow = subwindow;
+            item.event.xbutton.state = state;
+            item.event.xbutton.button = button;
+            item.event.xbutton.x_root = x_root;
+            item.event.xbutton.y_root = y_root;
+            break;
+        }
+        case MotionNotify:
+        {
+            uint64_t window, state;
+            int64_t x_root, y_root;
+            if (!read_uint(window) || !read_uint(state) ||
+                    !read_int(x_root) || !read_int(y_root))
+                return false;
+
+            item.event.xmotion.window = window;
+            item.event.xmotion.state = state;
+            item.event.xmotion.x_root = x_root;
+            item.event.xmotion.y_root = y_root;
+            break;
+        }
+        case ConfigureNotify:
+        {
+            uint64_t window;
+            int64_t x, y, width, height;
+            if (!read_uint(window) || !read_int(x) || !read_int(y) ||
+                    !read_int(width) || !read_int(height))
+                return false;
+
+            item.event.xconfigure.window = window;
+            item.event.xconfigure.x = x;
+            item.event.xconfigure.y = y;
+            item.event.xconfigure.width = width;
+            item.event.xconfigure.height = height;
+            break;
+        }
+        case MapNotify:
+        case UnmapNotify:
+        case Expose:
+        case DestroyNotify:
+        case MapRequest:
+        {
+            uint64_t window;
+            if (!read_uint(window))
+                return false;
+
+            if (event_type == MapNotify)
+                item.event.xmap.window = window;
+            else if (event_type == UnmapNotify)
+                item.event.xunmap.window = window;
+            else if (event_type == Expose)
+                item.event.xexpose.window = window;
+            else if (event_type == DestroyNotify)
+                item.event.xdestroywindow.window = window;
+            else
+                item.event.xmaprequest.window = window;
+            break;
+        }
+        case ConfigureRequest:
+        {
+            uint64_t window, value_mask, above, detail;
+            int64_t x, y, width, height, border_width;
+            if (!read_uint(window) || !read_uint(value_mask) ||
+                    !read_int(x) || !read_int(y) ||
+                    !read_int(width) || !read_int(height) ||
+                    !read_int(border_width) ||
+                    !read_uint(above) || !read_uint(detail))
+                return false;
+
+            item.event.xconfigurerequest.window = window;
+            item.event.xconfigurerequest.value_mask = value_mask;
+            item.event.xconfigurerequest.x = x;
+            item.event.xconfigurerequest.y = y;
+            item.event.xconfigurerequest.width = width;
+            item.event.xconfigurerequest.height = height;
+            item.event.xconfigurerequest.border_width = border_width;
+            item.event.xconfigurerequest.above = above;
+            item.event.xconfigurerequest.detail = detail;
+            break;
+        }
+        case CirculateRequest:
+        {
+            uint64_t window, place;
+            if (!read_uint(window) || !read_uint(place))
+                return false;
+
+            item.event.xcirculaterequest.window = window;
+            item.event.xcirculaterequest.place = place;
+            break;
+        }
+        case MappingNotify:
+        {
+            uint64_t request, first_keycode, count;
+            if (!read_uint(request) || !read_uint(first_keycode) ||
+                    !read_uint(count))
+                return false;
+
+            item.event.xmapping.request = request;
+            item.event.xmapping.first_keycode = first_keycode;
+            item.event.xmapping.count = count;
+            break;
+        }
+        default:
+            return false;
+        }
+        break;
+    }
+    default:
+        return false;
+    }
+
+    item.type = static_cast<TraceItemType>(type);
+    return true;
+}
+
+/**
+ * Reads the body of a TI_WINDOW item.
+ */
+bool TraceReader::read_window(TraceWindow &window)
+{
+    uint64_t id, flags, transient_for, hint_flags, initial_state;
+    int64_t x, y, width, height;
+    if (!read_uint(id) || !read_int(x) || !read_int(y) ||
+            !read_int(width) || !read_int(height) || !read_uint(flags) ||
+            !read_uint(transient_for) || !read_uint(hint_flags) ||
+            !read_uint(initial_state) ||
+            !read_string(window.win_class) || !read_string(window.icon_name))
+        return false;
+
+    window.window = id;
+    window.x = x;
+    window.y = y;
+    window.width = width;
+    window.height = height;
+    window.override_redirect = (flags & 1) != 0;
+    window.input_only = (flags & 2) != 0;
+    window.mapped = (flags & 4) != 0;
+    window.input = (flags & 8) != 0;
+    window.transient_for = transient_for;
+    window.hint_flags = hint_flags;
+    window.initial_state = initial_state;
+    return true;
+}
+
+/**
+ * Reads a list of screens.
+ */
+bool TraceReader::read_screens(std::vector<Box> &screens)
+{
+    uint64_t count;
+    if (!read_uint(count))
+        return false;
+
+    screens.clear();
+    for (uint64_t idx = 0; idx < count; idx++)
+    {
+        int64_t x, y, width, height;
+        if (!read_int(x) || !read_int(y) || !read_int(width) || !read_int(height))
+            return false;
+
+        screens.push_back(Box(x, y, width, height));
+    }
+
+    return true;
+}
+
+/**
+ * Reads a LEB128 varint.
+ */
+bool TraceReader::read_uint(uint64_t &value)
+{
+    return read_varint(m_input, value);
+}
+
+/**
+ * Reads a zig-zag encoded signed integer.
+ */
+bool TraceReader::read_int(int64_t &value)
+{
+    uint64_t encoded;
+    if (!read_uint(encoded))
+        return false;
+
+    value = zigzag_decode(encoded);
+    return true;
+}
+
+/**
+ * Reads a length-prefixed string.
+ */
+bool TraceReader::read_string(std::string &text)
+{
+    uint64_t size;
+    if (!read_uint(size))
+        return false;
+
+    text.resize(size);
+    if (size > 0)
+        m_input.read(&text[0], size);
+
+    return static_cast<bool>(m_input);
+}
@@ -0,0 +1,198 @@
+/** @file */
+#ifndef __SMALLWM_TRACE__
+#define __SMALLWM_TRACE__
+
+#include <fstream>
+#include <set>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#include "common.h"
+#include "stats.h"
+#include "xdata.h"
+
+/// The version of the trace format, which is stored in each trace's header
+const uint64_t TRACE_VERSION = 1;
+
+/**
+ * The event type that XRandR notifications are stored under. The real event
+ * type depends upon the offset the X server gives to XRandR, so it can't be
+ * stored directly. (Core event types start at 2, so this never conflicts.)
+ */
+const int TRACE_RRNOTIFY = 0;
+
+/**
+ * The different kinds of items that can appear in a trace after the header.
+ */
+enum TraceItemType
+{
+    TI_END, //< The end of the trace (never actually stored)
+    TI_EVENT, //< An X event that SmallWM handled
+    TI_WINDOW, //< A description of a window that some later event refers to
+    TI_CREATE, //< A window that SmallWM created for its own use
+};
+
+/**
+ * Everything about a window that SmallWM asks the X server for when it first
+ * sees the window. This is recorded so that a replay doesn't need a server
+ * to answer these queries.
+ */
+struct TraceWindow
+{
+    TraceWindow() :
+        window(None), x(0), y(0), width(1), height(1),
+        override_redirect(false), input_only(false), mapped(false),
+        transient_for(None), hint_flags(0), initial_state(NormalState),
+        input(true)
+    {}
+
+    Window window;
+
+    Dimension x, y;
+    Dimension width, height;
+
+    bool override_redirect;
+    bool input_only;
+    bool mapped;
+
+    Window transient_for;
+
+    /// Only the StateHint and InputHint flags are recorded
+    long hint_flags;
+    int initial_state;
+    bool input;
+
+    std::string win_class;
+    std::string icon_name;
+};
+
+/**
+ * The information stored at the start of a trace, describing the state of
+ * the X server when recording started.
+ */
+struct TraceHeader
+{
+    unsigned int primary_mod_flag;
+    unsigned int secondary_mod_flag;
+    unsigned int num_mod_flag;
+    unsigned int caps_mod_flag;
+    unsigned int scroll_mod_flag;
+
+    /// The screens that were present when recording started
+    std::vector<Box> screens;
+
+    /// The windows that existed before SmallWM started
+    std::vector<TraceWindow> windows;
+};
+
+/**
+ * A single item read back from a trace. Which fields are filled in depends
+ * upon the item's type.
+ */
+struct TraceItem
+{
+    TraceItemType type;
+
+    /// (TI_EVENT) When the event was received, relative to the trace's start
+    uint64_t timestamp_ns;
+
+    /// (TI_EVENT) The event itself - only the fields SmallWM uses are set
+    XEvent event;
+
+    /// (TI_EVENT) The keysym of the key, for KeyPress and KeyRelease events
+    KeySym keysym;
+
+    /// (TI_EVENT) The new screen layout, for XRandR events
+    std::vector<Box> screens;
+
+    /// (TI_WINDOW) The window being described
+    TraceWindow window;
+
+    /// (TI_CREATE) The window which was created
+    Window created;
+};
+
+/**
+ * Records the X events that SmallWM handles into a compact binary file.
+ *
+ * The file starts with a header, and is followed by a sequence of items -
+ * each is a one-byte type followed by a series of LEB128-encoded integers.
+ * Event timestamps are stored as the difference from the previous event, so
+ * most of them fit in two or three bytes.
+ *
+ * Anything that SmallWM would have to ask the X server for while handling an
+ * event (the attributes of new windows, keysyms, screen layouts) is
+ * recorded alongside the event. Note that this means that recording does
+ * make a few extra round-trips to the X server.
+ */
+class TraceWriter
+{
+public:
+    TraceWriter(XData &xdata) :
+        m_xdata(xdata), m_last_ns(0), m_unflushed(0)
+    {};
+
+    bool open(const std::string&, const std::vector<Window>&);
+    bool is_open() const;
+    void flush();
+    void close();
+
+    void record_event(const XEvent&, uint64_t);
+    void record_created(Window);
+
+private:
+    void describe(Window, std::vector<TraceWindow>&);
+    void write_window(const TraceWindow&);
+    void write_screens(const std::vector<Box>&);
+    void write_uint(uint64_t);
+    void write_int(int64_t);
+    void write_string(const std::string&);
+
+    /// How many items to buffer before flushing them out to the file
+    static const int FLUSH_INTERVAL = 64;
+
+    /// Where to get information about windows and screens
+    XData &m_xdata;
+
+    /// The file being written
+    std::ofstream m_output;
+
+    /// The windows which already have a TI_WINDOW item in the trace
+    std::set<Window> m_described;
+
+    /// The timestamp of the most recently recorded event
+    uint64_t m_last_ns;
+
+    /// How many items have been written since the last flush
+    int m_unflushed;
+};
+
+/**
+ * Reads back the traces that are written by TraceWriter.
+ */
+class TraceReader
+{
+public:
+    TraceReader() :
+        m_timestamp_ns(0)
+    {};
+
+    bool open(const std::string&, TraceHeader&);
+    bool next(TraceItem&);
+
+private:
+    bool read_window(TraceWindow&);
+    bool read_screens(std::vector<Box>&);
+    bool read_uint(uint64_t&);
+    bool read_int(int64_t&);
+    bool read_string(std::string&);
+
+    /// The file being read
+    std::ifstream m_input;
+
+    /// The timestamp of the most recently read event
+    uint64_t m_timestamp_ns;
+};
+
+#endif
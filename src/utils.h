@@ -6,6 +6,10 @@
 #include <cstdlib>
 #include <cstring>
 #include <map>
+#include <pthread.h>
+#include <signal.h>
+#include <thread>
+#include <utility>
 
 unsigned long try_parse_ulong(const char *string, unsigned long default_);
 unsigned long try_parse_ulong_nonzero(const char *string, unsigned long default_);
@@ -36,4 +40,25 @@ public:
 private:
     std::map<Key, Value> m_map;
 };
+
+/**
+ * Starts a thread with every signal blocked. Signals should go to the event
+ * loop, since their handlers expect it to wake up - the thread inherits this
+ * mask, and keeps it.
+ *
+ * The arguments are the same as std::thread's.
+ */
+template <typename Function, typename... Args>
+std::thread start_thread_without_signals(Function &&function, Args&&... args)
+{
+    sigset_t all_signals, old_signals;
+    sigfillset(&all_signals);
+    pthread_sigmask(SIG_SETMASK, &all_signals, &old_signals);
+
+    std::thread thread(std::forward<Function>(function),
+                       std::forward<Args>(args)...);
+
+    pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+    return thread;
+}
 #endif
@@ -0,0 +1,80 @@
+/** @file */
+#include "varint.h"
+
+/**
+ * Encodes an unsigned integer as a varint.
+ *
+ * @param value The integer to encode.
+ * @param[out] output Where to store the encoded bytes - this must have room
+ *                    for at least VARINT_MAX_BYTES.
+ * @return The number of bytes that were stored.
+ */
+size_t encode_varint(uint64_t value, char *output)
+{
+    size_t count = 0;
+    while (value >= 0x80)
+    {
+        output[count++] = static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+
+    output[count++] = static_cast<char>(value);
+    return count;
+}
+
+/**
+ * Encodes an unsigned integer as a varint, at the end of a buffer.
+ */
+void append_varint(std::string &buffer, uint64_t value)
+{
+    char bytes[VARINT_MAX_BYTES];
+    buffer.append(bytes, encode_varint(value, bytes));
+}
+
+/**
+ * Decodes a varint from a range of bytes.
+ *
+ * @param[in,out] pos The first byte of the varint, which is moved past the
+ *                    bytes that were decoded.
+ * @param end The end of the bytes that can be read.
+ * @param[out] value The decoded integer.
+ * @return true if a whole varint was decoded, false if it was cut off or
+ *         too long.
+ */
+bool decode_varint(const unsigned char *&pos, const unsigned char *end,
+        uint64_t &value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < end; shift += 7)
+    {
+        unsigned char byte = *pos++;
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * Reads a varint from a stream.
+ *
+ * @return true if a whole varint was read, false if the stream ended or the
+ *         varint was too long.
+ */
+bool read_varint(std::istream &input, uint64_t &value)
+{
+    unsigned char bytes[VARINT_MAX_BYTES];
+    size_t count = 0;
+    do
+    {
+        int byte = input.get();
+        if (!input)
+            return false;
+
+        bytes[count++] = static_cast<unsigned char>(byte);
+    } while ((bytes[count - 1] & 0x80) && count < VARINT_MAX_BYTES);
+
+    const unsigned char *pos = bytes;
+    return decode_varint(pos, bytes + count, value);
+}
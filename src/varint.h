@@ -0,0 +1,43 @@
+/** @file */
+#ifndef __SMALLWM_VARINT__
+#define __SMALLWM_VARINT__
+
+#include <cstddef>
+#include <istream>
+#include <stdint.h>
+#include <string>
+
+/// The most bytes that a 64-bit integer can take up as a varint
+const size_t VARINT_MAX_BYTES = 10;
+
+/*
+ * Traces, configuration caches and snapshots all store their integers as
+ * LEB128 varints - 7 bits per byte, with the high bit set on every byte
+ * except the last. Signed integers are zig-zag encoded first, so that small
+ * negative values are as short as small positive ones.
+ */
+
+size_t encode_varint(uint64_t, char*);
+void append_varint(std::string&, uint64_t);
+bool decode_varint(const unsigned char*&, const unsigned char*, uint64_t&);
+bool read_varint(std::istream&, uint64_t&);
+
+/**
+ * Zig-zag encodes a signed integer, so that it can be stored as a varint.
+ */
+inline uint64_t zigzag_encode(int64_t value)
+{
+    return (static_cast<uint64_t>(value) << 1) ^
+        static_cast<uint64_t>(value >> 63);
+}
+
+/**
+ * Decodes a zig-zag encoded signed integer.
+ */
+inline int64_t zigzag_decode(uint64_t encoded)
+{
+    return static_cast<int64_t>(encoded >> 1) ^
+        -static_cast<int64_t>(encoded & 1);
+}
+
+#endif
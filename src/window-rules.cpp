@@ -0,0 +1,312 @@
+/** @file */
+#include "window-rules.h"
+
+/// How many DFA states a GlobMatcher keeps before it starts over
+const size_t MAX_DFA_STATES = 1024;
+
+/// The DFA state which every match starts in
+const int DFA_START = 0;
+
+/**
+ * Adds a new pattern.
+ *
+ * @return The index of the pattern, which match() reports.
+ */
+size_t GlobMatcher::add(const std::string &pattern)
+{
+    size_t index = m_patterns.size();
+    m_patterns.push_back(pattern);
+
+    m_offsets.push_back(m_state_patterns.size());
+    m_state_patterns.insert(m_state_patterns.end(), pattern.size() + 1, index);
+
+    // The start state depends upon every pattern, so the DFA is now stale
+    reset_dfa();
+    return index;
+}
+
+/**
+ * Removes all of the patterns.
+ */
+void GlobMatcher::clear()
+{
+    m_patterns.clear();
+    m_offsets.clear();
+    m_state_patterns.clear();
+    reset_dfa();
+}
+
+/**
+ * Finds all the patterns which match a string.
+ *
+ * @param text The string to match.
+ * @param[out] matches Where the indexes of the matching patterns are added.
+ */
+void GlobMatcher::match(const std::string &text, std::vector<size_t> &matches)
+{
+    // States are never removed one at a time - once there are too many (which
+    // can happen if every window has a new title), just start over
+    if (m_dfa.size() > MAX_DFA_STATES)
+        reset_dfa();
+
+    int state = DFA_START;
+    for (std::string::const_iterator chr = text.begin();
+         chr != text.end();
+         chr++)
+    {
+        state = step(state, static_cast<unsigned char>(*chr));
+
+        // Once no pattern can match, there's no point in going on
+        if (m_dfa[state].nfa.empty())
+            return;
+    }
+
+    const std::vector<size_t> &accepts = m_dfa[state].accepts;
+    matches.insert(matches.end(), accepts.begin(), accepts.end());
+}
+
+/**
+ * Throws away all the DFA states, except for the start state.
+ */
+void GlobMatcher::reset_dfa()
+{
+    m_dfa.clear();
+    m_dfa_index.clear();
+
+    NfaSet start;
+    for (std::vector<unsigned int>::iterator offset = m_offsets.begin();
+         offset != m_offsets.end();
+         offset++)
+        start.push_back(*offset);
+
+    closure(start);
+    find_state(start);
+}
+
+/**
+ * Adds every NFA state that can be reached without consuming any input - a
+ * '*' may match nothing, so the state after it is always reachable.
+ */
+void GlobMatcher::closure(NfaSet &states) const
+{
+    for (size_t idx = 0; idx < states.size(); idx++)
+    {
+        unsigned int state = states[idx];
+        size_t pattern = m_state_patterns[state];
+        size_t position = state - m_offsets[pattern];
+
+        if (position < m_patterns[pattern].size() &&
+                m_patterns[pattern][position] == '*')
+            states.push_back(state + 1);
+    }
+
+    std::sort(states.begin(), states.end());
+    states.erase(std::unique(states.begin(), states.end()), states.end());
+}
+
+/**
+ * Gets the DFA state for a set of NFA states, creating it if it doesn't
+ * exist yet.
+ */
+int GlobMatcher::find_state(NfaSet &states)
+{
+    std::map<NfaSet, int>::iterator existing = m_dfa_index.find(states);
+    if (existing != m_dfa_index.end())
+        return existing->second;
+
+    int index = m_dfa.size();
+    m_dfa.push_back(DfaState());
+
+    DfaState &dfa_state = m_dfa.back();
+    dfa_state.nfa = states;
+    std::fill(dfa_state.next, dfa_state.next + 256, -1);
+
+    for (NfaSet::iterator state = states.begin();
+         state != states.end();
+         state++)
+    {
+        size_t pattern = m_state_patterns[*state];
+        if (*state - m_offsets[pattern] == m_patterns[pattern].size())
+            dfa_state.accepts.push_back(pattern);
+    }
+
+    m_dfa_index[states] = index;
+    return index;
+}
+
+/**
+ * Gets the DFA state that follows another, after reading a single byte.
+ */
+int GlobMatcher::step(int from, unsigned char chr)
+{
+    if (m_dfa[from].next[chr] != -1)
+        return m_dfa[from].next[chr];
+
+    NfaSet next;
+    const NfaSet &current = m_dfa[from].nfa;
+    for (NfaSet::const_iterator state = current.begin();
+         state != current.end();
+         state++)
+    {
+        size_t pattern = m_state_patterns[*state];
+        size_t position = *state - m_offsets[pattern];
+        if (position == m_patterns[pattern].size())
+            continue;
+
+        char token = m_patterns[pattern][position];
+        if (token == '*')
+            next.push_back(*state);
+        else if (token == '?' || token == static_cast<char>(chr))
+            next.push_back(*state + 1);
+    }
+
+    closure(next);
+
+    // This has to be looked up before storing it, since adding a new state
+    // can move the existing ones around
+    int to = find_state(next);
+    m_dfa[from].next[chr] = to;
+    return to;
+}
+
+/**
+ * Adds a new rule, which has a lower priority than every rule added before
+ * it. compile() has to be called before the rule is used.
+ */
+void WindowRules::add_rule(const WindowRule &rule)
+{
+    m_rules.push_back(rule);
+}
+
+/**
+ * Removes all of the rules.
+ */
+void WindowRules::clear()
+{
+    m_rules.clear();
+    compile();
+}
+
+/**
+ * Builds the lookup tables for all of the rules which have been added.
+ */
+void WindowRules::compile()
+{
+    m_needed.assign(m_rules.size(), 0);
+    m_hits.assign(m_rules.size(), 0);
+    m_touched.clear();
+
+    // Rules which share a glob share its entry in the GlobMatcher
+    std::map<std::string, size_t> glob_ids[RF_COUNT];
+    for (int field = 0; field < RF_COUNT; field++)
+    {
+        m_uses[field] = false;
+        m_exact[field].clear();
+        m_globs[field].clear();
+        m_glob_rules[field].clear();
+    }
+
+    for (size_t rule = 0; rule < m_rules.size(); rule++)
+    {
+        const WindowRule &current = m_rules[rule];
+        for (std::vector<std::pair<RuleField, std::string> >::const_iterator
+                 pattern = current.patterns.begin();
+             pattern != current.patterns.end();
+             pattern++)
+        {
+            RuleField field = pattern->first;
+            const std::string &text = pattern->second;
+
+            m_uses[field] = true;
+            m_needed[rule]++;
+
+            bool is_glob = !current.literal &&
+                text.find_first_of("*?") != std::string::npos;
+            if (!is_glob)
+            {
+                m_exact[field][text].push_back(rule);
+                continue;
+            }
+
+            std::map<std::string, size_t>::iterator glob =
+                glob_ids[field].find(text);
+            if (glob == glob_ids[field].end())
+            {
+                size_t id = m_globs[field].add(text);
+                glob = glob_ids[field].insert(
+                    std::make_pair(text, id)).first;
+                m_glob_rules[field].push_back(std::vector<size_t>());
+            }
+
+            m_glob_rules[field][glob->second].push_back(rule);
+        }
+    }
+}
+
+/**
+ * Finds all the rules which match a window, and combines their actions. Rules
+ * are applied in the order they were added, so later rules win when two rules
+ * set the same thing.
+ *
+ * @param props The window's properties - only the fields which uses()
+ *              reports as being used have to be filled in.
+ * @param[out] actions The combined actions.
+ * @return Whether any rule matched.
+ */
+bool WindowRules::match(const WindowProperties &props, ClassActions &actions)
+{
+    std::vector<size_t> globs;
+    for (int field = 0; field < RF_COUNT; field++)
+    {
+        if (!m_uses[field])
+            continue;
+
+        const std::string &value = props.values[field];
+
+        std::unordered_map<std::string, std::vector<size_t> >::iterator exact =
+            m_exact[field].find(value);
+        if (exact != m_exact[field].end())
+            add_hits(exact->second);
+
+        globs.clear();
+        m_globs[field].match(value, globs);
+        for (std::vector<size_t>::iterator glob = globs.begin();
+             glob != globs.end();
+             glob++)
+            add_hits(m_glob_rules[field][*glob]);
+    }
+
+    std::vector<size_t> matched;
+    for (std::vector<size_t>::iterator rule = m_touched.begin();
+         rule != m_touched.end();
+         rule++)
+    {
+        if (m_hits[*rule] == m_needed[*rule])
+            matched.push_back(*rule);
+        m_hits[*rule] = 0;
+    }
+    m_touched.clear();
+
+    std::sort(matched.begin(), matched.end());
+    for (std::vector<size_t>::iterator rule = matched.begin();
+         rule != matched.end();
+         rule++)
+        actions.merge(m_rules[*rule].actions);
+
+    return !matched.empty();
+}
+
+/**
+ * Records that one of the fields of each of the given rules has matched.
+ */
+void WindowRules::add_hits(const std::vector<size_t> &rules)
+{
+    for (std::vector<size_t>::const_iterator rule = rules.begin();
+         rule != rules.end();
+         rule++)
+    {
+        if (m_hits[*rule] == 0)
+            m_touched.push_back(*rule);
+        m_hits[*rule]++;
+    }
+}
@@ -0,0 +1,179 @@
+/** @file */
+#ifndef __SMALLWM_WINDOW_RULES__
+#define __SMALLWM_WINDOW_RULES__
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "actions.h"
+#include "common.h"
+
+/**
+ * The properties of a window that a rule can match against.
+ */
+enum RuleField
+{
+    RF_CLASS, //< The class part of WM_CLASS
+    RF_INSTANCE, //< The instance (resource name) part of WM_CLASS
+    RF_TITLE, //< The window's WM_NAME
+    RF_ROLE, //< The window's WM_WINDOW_ROLE
+    RF_TYPE, //< The window's _NET_WM_WINDOW_TYPE, like "dialog" or "normal"
+    RF_COUNT
+};
+
+/**
+ * The values of each RuleField for a single window.
+ */
+struct WindowProperties
+{
+    std::string values[RF_COUNT];
+};
+
+/**
+ * A single rule, which applies some actions to every window whose properties
+ * match all of the rule's patterns.
+ */
+struct WindowRule
+{
+    WindowRule() :
+        literal(false)
+    {}
+
+    /** The patterns which the window must match, along with the field they
+     * apply to. Fields without a pattern match any window. */
+    std::vector<std::pair<RuleField, std::string> > patterns;
+
+    /** Whether the patterns are matched exactly, instead of being treated as
+     * globs (used for the rules that come from the [actions] section) */
+    bool literal;
+
+    /// What to do to the windows which match this rule
+    ClassActions actions;
+};
+
+/**
+ * Matches strings against a set of glob patterns (where '*' matches any
+ * number of characters, and '?' matches any one character) all at once.
+ *
+ * The patterns are combined into a single NFA, which is turned into a DFA as
+ * it is used - each state of the DFA (and each transition out of it) is only
+ * worked out the first time that some string reaches it. A string is then
+ * matched against every pattern in a single pass, at the cost of one table
+ * lookup per character.
+ */
+class GlobMatcher
+{
+public:
+    GlobMatcher()
+    { clear(); }
+
+    size_t add(const std::string&);
+    void clear();
+    void match(const std::string&, std::vector<size_t>&);
+
+    size_t size() const
+    { return m_patterns.size(); }
+
+private:
+    /// A set of NFA states, which is also the identity of a DFA state
+    typedef std::vector<unsigned int> NfaSet;
+
+    /// A single state of the DFA
+    struct DfaState
+    {
+        /// The NFA states this state stands for
+        NfaSet nfa;
+
+        /// The patterns which match a string that ends in this state
+        std::vector<size_t> accepts;
+
+        /// The next state for each byte, or -1 if it isn't known yet
+        int next[256];
+    };
+
+    void reset_dfa();
+    void closure(NfaSet&) const;
+    int find_state(NfaSet&);
+    int step(int, unsigned char);
+
+    /// The patterns, in the order that they were added
+    std::vector<std::string> m_patterns;
+
+    /** The first NFA state of each pattern - a pattern of length n uses the
+     * n + 1 states from this one onwards, and the last of them accepts */
+    std::vector<unsigned int> m_offsets;
+
+    /// Which pattern each NFA state belongs to
+    std::vector<size_t> m_state_patterns;
+
+    /// The DFA states which have been built so far
+    std::vector<DfaState> m_dfa;
+
+    /// Finds the DFA state for a set of NFA states
+    std::map<NfaSet, int> m_dfa_index;
+};
+
+/**
+ * Decides which actions apply to a new window, using all the rules from the
+ * configuration file.
+ *
+ * Rules are added one at a time, and then compile() builds a lookup structure
+ * for each field: exact patterns go into a hash table, and globs go into a
+ * GlobMatcher. Matching a window then looks at each field once, no matter how
+ * many rules there are - the only work that depends upon the rules is
+ * counting up the ones that actually match.
+ */
+class WindowRules
+{
+public:
+    WindowRules()
+    { clear(); }
+
+    void add_rule(const WindowRule&);
+    void clear();
+    void compile();
+
+    bool match(const WindowProperties&, ClassActions&);
+
+    /// Whether any rule looks at the given field
+    bool uses(RuleField field) const
+    { return m_uses[field]; }
+
+    size_t size() const
+    { return m_rules.size(); }
+
+private:
+    void add_hits(const std::vector<size_t>&);
+
+    /// Every rule, in the order they were added
+    std::vector<WindowRule> m_rules;
+
+    /// How many fields each rule has patterns for
+    std::vector<unsigned int> m_needed;
+
+    /// Whether any rule has a pattern for each field
+    bool m_uses[RF_COUNT];
+
+    /// The rules with an exact pattern for each field, by the matched value
+    std::unordered_map<std::string, std::vector<size_t> > m_exact[RF_COUNT];
+
+    /// The glob patterns used for each field
+    GlobMatcher m_globs[RF_COUNT];
+
+    /// The rules which use each of the glob patterns in m_globs
+    std::vector<std::vector<size_t> > m_glob_rules[RF_COUNT];
+
+    /** How many fields of each rule matched the window being matched - this
+     * is kept around between calls, so that it doesn't have to be allocated
+     * each time */
+    std::vector<unsigned int> m_hits;
+
+    /// The rules whose entry in m_hits isn't 0
+    std::vector<size_t> m_touched;
+};
+
+#endif
@@ -10,6 +10,7 @@ bool XEvents::step()
 {
     // Grab the next event from X, and then dispatch upon its type
     m_xdata.next_event(m_event);
+    uint64_t received_ns = monotonic_ns();
 
     if (m_event.type == m_xdata.randr_event_offset + RRNotify)
         handle_rrnotify();
@@ -17,6 +18,9 @@ bool XEvents::step()
     if (m_event.type == KeyPress)
         handle_keypress();
 
+    if (m_event.type == KeyRelease)
+        handle_keyrelease();
+
     if (m_event.type == ButtonPress)
         handle_buttonpress();
 
@@ -50,6 +54,15 @@ bool XEvents::step()
     if (m_event.type == CirculateRequest)
         handle_circulaterequest();
 
+    if (m_event.type == MappingNotify)
+        handle_mappingnotify();
+
+    // This is done after the dispatch so that the event which is recorded is
+    // the one the handler actually used (MotionNotify skips ahead to the
+    // latest event in the queue, for example)
+    if (m_trace.is_open())
+        m_trace.record_event(m_event, received_ns);
+
     return !m_done;
 }
 
@@ -58,6 +71,8 @@ bool XEvents::step()
  */
 void XEvents::handle_rrnotify()
 {
+    StatsTimer timer(m_stats, SH_RRNOTIFY);
+
     std::vector<Box> screens;
     m_xdata.get_screen_boxes(screens);
     m_clients.update_screens(screens);
@@ -68,8 +83,47 @@ void XEvents::handle_rrnotify()
  */
 void XEvents::handle_keypress()
 {
-    KeySym key = m_xdata.get_keysym(m_event.xkey.keycode);
+    StatsTimer timer(m_stats, SH_KEYPRESS);
+
+    // Modifiers pressed during a cycle (such as Control, to go backwards)
+    // don't end it - they only change the keys that come after them
+    if (m_cycling && IsModifierKey(m_xdata.get_keysym(m_event.xkey.keycode)))
+        return;
+
     bool is_using_secondary_action = (m_event.xkey.state & m_xdata.secondary_mod_flag);
+    const KeyActionEntry &entry = find_key_action(m_event.xkey.keycode,
+                                                  is_using_secondary_action);
+
+    bool is_cycle = entry.action == CYCLE_FOCUS ||
+        entry.action == CYCLE_FOCUS_BACK;
+
+    // Any other key ends the cycle, on the window the user had got to
+    if (m_cycling && !is_cycle)
+        finish_cycle();
+
+    // While the keyboard is grabbed, every key comes here - the cycle keys
+    // only move the preview, and the focus moves once the modifier is let go
+    if (is_cycle && m_config.cycle_mode == CYCLE_RECENT)
+    {
+        if (!m_cycling)
+            m_cycling = m_xdata.grab_keyboard();
+
+        if (m_cycling)
+        {
+            if (entry.action == CYCLE_FOCUS)
+                m_clients.preview_focus_forward();
+            else
+                m_clients.preview_focus_backward();
+            return;
+        }
+    }
+
+    if (entry.action == INVALID_ACTION)
+    {
+        if (!entry.command.empty())
+            m_launcher.launch(entry.command);
+        return;
+    }
 
     Window client = None;
     if (m_config.hotkey == HK_MOUSE)
@@ -81,11 +135,48 @@ void XEvents::handle_keypress()
     else if (m_config.hotkey == HK_FOCUS)
         client = m_clients.get_focused();
 
+    run_action(entry.action, client);
+}
+
+/**
+ * Ends a cycle through the focus history, once the primary modifier held
+ * down during the cycle is released. Letting go of any other modifier leaves
+ * the cycle going.
+ */
+void XEvents::handle_keyrelease()
+{
+    StatsTimer timer(m_stats, SH_KEYRELEASE);
+
+    if (!m_cycling)
+        return;
+
+    if (m_xdata.is_primary_modifier(m_event.xkey.keycode))
+        finish_cycle();
+}
+
+/**
+ * Lets go of the keyboard, and focuses the window that the current cycle
+ * through the focus history stopped on.
+ */
+void XEvents::finish_cycle()
+{
+    m_xdata.ungrab_keyboard();
+    m_clients.commit_focus_preview();
+    m_cycling = false;
+}
+
+/**
+ * Carries out a keyboard action. Actions which apply to a single window are
+ * ignored if the window isn't a client (or a child, for closing windows).
+ *
+ * @param action The action to carry out.
+ * @param client The window that the action applies to, if any.
+ */
+void XEvents::run_action(KeyboardAction action, Window client)
+{
     bool is_client = m_clients.is_client(client);
     bool is_child = m_clients.is_child(client);
 
-    KeyBinding binding(key, is_using_secondary_action);
-    KeyboardAction action = m_config.key_commands.binding_to_action[binding];
     switch (action)
     {
     case CLIENT_NEXT_DESKTOP:
@@ -187,16 +278,38 @@ void XEvents::handle_keypress()
 
 #undef LAYER_SET
     case CYCLE_FOCUS:
-        m_clients.cycle_focus_forward();
+        if (m_config.cycle_mode == CYCLE_RECENT)
+        {
+            m_clients.preview_focus_forward();
+            m_clients.commit_focus_preview();
+        }
+        else
+            m_clients.cycle_focus_forward();
         break;
 
     case CYCLE_FOCUS_BACK:
-        m_clients.cycle_focus_backward();
+        if (m_config.cycle_mode == CYCLE_RECENT)
+        {
+            m_clients.preview_focus_backward();
+            m_clients.commit_focus_preview();
+        }
+        else
+            m_clients.cycle_focus_backward();
         break;
 
     case EXIT_WM:
         m_done = true;
         break;
+
+    case RESTART_WM:
+        // The window being dragged is only shown by the placeholder, which
+        // wouldn't survive the restart
+        if (m_xmodel.get_move_resize_state() == MR_INVALID)
+        {
+            m_done = true;
+            m_restart = true;
+        }
+        break;
     }
 }
 
@@ -210,6 +323,8 @@ void XEvents::handle_keypress()
  */
 void XEvents::handle_buttonpress()
 {
+    StatsTimer timer(m_stats, SH_BUTTONPRESS);
+
     // We have to test both the window and the subwindow, because we might want
     // to route to the parent or the child, depending upon the event
     bool is_client = false;
@@ -248,33 +363,7 @@ void XEvents::handle_buttonpress()
             && m_event.xbutton.button == LAUNCH_BUTTON
             && m_event.xbutton.state & m_xdata.primary_mod_flag)
     {
-        if (!fork())
-        {
-            /*
-             * Here's why 'exec' is used in two different ways. First, it is
-             * important to have /bin/sh process the shell command since it
-             * supports argument parsing, which eases our burden dramatically.
-             *
-             * Now, consider the process sequence as depicted below (where 'xterm'
-             * is the user's chosen shell).
-             *
-             * fork()
-             * [creates process] ==> execl(/bin/sh, -c, /bin/sh, exec xterm)
-             * # Somewhere in the /bin/sh source...
-             * [creates process] ==> execl(/usr/bin/xterm, /usr/bin/xterm)
-             *
-             * If we used std::system instead, then the first process after fork()
-             * would stick around to get the return code from the /bin/sh. If 'exec'
-             * were not used in the /bin/sh command line, then /bin/sh would stick
-             * around waiting for /usr/bin/xterm.
-             *
-             * So, to avoid an extra smallwm process sticking around, _or_ an
-             * unnecessary /bin/sh process sticking around, use 'exec' twice.
-             */
-            std::string shell = std::string("exec ") + m_config.shell;
-            execl("/bin/sh", "/bin/sh", "-c", shell.c_str(), NULL);
-            exit(1);
-        }
+        m_launcher.launch(m_config.shell);
     }
     else if (icon)
     {
@@ -309,43 +398,48 @@ void XEvents::handle_buttonpress()
 
 /**
  * Handles the release of a mouse button. This event is only expected when
- * a placeholder is going to be released, so the only possible action is to
- * stop moving/resizing.
+ * a placeholder (or a client being dragged) is going to be released, so the
+ * only possible action is to stop moving/resizing.
  */
 void XEvents::handle_buttonrelease()
 {
-    Window expected_placeholder = m_xmodel.get_move_resize_placeholder();
+    StatsTimer timer(m_stats, SH_BUTTONRELEASE);
 
-    // If this is *not* the current placeholder, then bail
-    if (expected_placeholder != m_event.xbutton.window)
+    MoveResizeState state = m_xmodel.get_move_resize_state();
+    if (state == MR_INVALID)
         return;
 
-    MoveResizeState state = m_xmodel.get_move_resize_state();
+    // The pointer is confined either to the placeholder, or to the client
+    // itself when there is no placeholder - if the release isn't on either,
+    // then bail
+    Window placeholder = m_xmodel.get_move_resize_placeholder();
     Window client = m_xmodel.get_move_resize_client();
+    if (m_event.xbutton.window != placeholder &&
+            m_event.xbutton.window != client)
+        return;
 
-    // Figure out the attributes of the placeholder, so that way we can do
-    // the movements/resizes
-    XWindowAttributes attrs;
-    m_xdata.get_attributes(expected_placeholder, attrs);
+    Box geometry = m_xmodel.get_move_resize_geometry();
 
     switch (state)
     {
     case MR_MOVE:
-        m_clients.stop_moving(client, Dimension2D(attrs.x, attrs.y));
+        m_clients.stop_moving(client, Dimension2D(geometry.x, geometry.y));
         break;
     case MR_RESIZE:
         m_clients.stop_resizing(client,
-                                Dimension2D(attrs.width, attrs.height));
+                                Dimension2D(geometry.width, geometry.height));
         break;
     }
 }
 
 /**
- * Handles ConfigureNotify events, which updates the size of the window, and
- * re-packs the corner it's on if it's packed.
+ * Handles ConfigureNotify events, which updates the size and location of the
+ * window, and re-packs the corner it's on if it's packed.
  */
 void XEvents::handle_configurenotify()
 {
+    StatsTimer timer(m_stats, SH_CONFIGURENOTIFY);
+
     Window client = m_event.xconfigure.window;
     if (!m_clients.is_client(client))
         return;
@@ -353,11 +447,14 @@ void XEvents::handle_configurenotify()
     m_clients.update_size(client,
                           m_event.xconfigure.width,
                           m_event.xconfigure.height);
+    m_clients.update_location(client,
+                              m_event.xconfigure.x,
+                              m_event.xconfigure.y);
 
     if (m_clients.is_packed_client(client))
     {
         PackCorner corner = m_clients.get_pack_corner(client);
-        m_clients.repack_corner(corner);
+        m_work.schedule(DEFER_REPACK_CORNER, corner);
     }
 }
 
@@ -374,6 +471,8 @@ void XEvents::handle_configurenotify()
  */
 void XEvents::handle_mapnotify()
 {
+    StatsTimer timer(m_stats, SH_MAPNOTIFY);
+
     Window being_mapped = m_event.xmap.window;
 
     // This has to bypass the expect check, since this needs to happen to every
@@ -382,7 +481,7 @@ void XEvents::handle_mapnotify()
     if (m_clients.is_packed_client(being_mapped))
     {
         PackCorner corner = m_clients.get_pack_corner(being_mapped);
-        m_clients.repack_corner(corner);
+        m_work.schedule(DEFER_REPACK_CORNER, corner);
     }
 
     if (m_xmodel.has_effect(being_mapped, EXPECT_MAP))
@@ -391,6 +490,12 @@ void XEvents::handle_mapnotify()
         return;
     }
 
+    // The placeholder and icon windows are reused, so they get mapped many
+    // times - there's no need to ask the server whether they should be managed
+    if (being_mapped == m_xmodel.get_placeholder() ||
+            m_xmodel.find_icon_from_icon_window(being_mapped))
+        return;
+
     add_window(being_mapped);
 }
 
@@ -402,6 +507,8 @@ void XEvents::handle_mapnotify()
  */
 void XEvents::handle_unmapnotify()
 {
+    StatsTimer timer(m_stats, SH_UNMAPNOTIFY);
+
     Window being_unmapped = m_event.xmap.window;
 
     if (m_xmodel.has_effect(being_unmapped, EXPECT_UNMAP))
@@ -415,19 +522,16 @@ void XEvents::handle_unmapnotify()
 
 /**
  * Handles the motion of the pointer. The only time that this ever applies is
- * when the user has moved the placeholder window - at all other times, this
+ * when the user is moving or resizing a client - at all other times, this
  * event is ignored.
  */
 void XEvents::handle_motionnotify()
 {
-    // Get the placeholder's current geometry, since we need to modify the
-    // placeholder relative to the way it is now
-    Window placeholder = m_xmodel.get_move_resize_placeholder();
-    if (placeholder == None)
-        return;
+    StatsTimer timer(m_stats, SH_MOTIONNOTIFY);
 
-    XWindowAttributes attr;
-    m_xdata.get_attributes(placeholder, attr);
+    MoveResizeState state = m_xmodel.get_move_resize_state();
+    if (state == MR_INVALID)
+        return;
 
     // Avoid needless updates by getting the most recent version of this
     // event
@@ -438,28 +542,53 @@ void XEvents::handle_motionnotify()
     m_xdata.get_pointer_location(ptr_x, ptr_y);
 
     Dimension2D relative_change = m_xmodel.update_pointer(ptr_x, ptr_y);
+    Box geometry = m_xmodel.move_resize_by(relative_change);
 
-    switch (m_xmodel.get_move_resize_state())
+    switch (m_config.drag_mode)
     {
-    case MR_MOVE:
-        // Update the position of the placeholder
-        m_xdata.move_window(placeholder,
-            attr.x + DIM2D_X(relative_change),
-            attr.y + DIM2D_Y(relative_change));
+    case DRAG_PLACEHOLDER:
+    {
+        Window placeholder = m_xmodel.get_move_resize_placeholder();
+        if (state == MR_MOVE)
+            m_xdata.move_window(placeholder, geometry.x, geometry.y);
+        else
+            m_xdata.resize_window(placeholder, geometry.width, geometry.height);
         break;
-    case MR_RESIZE:
-        // Update the location being careful to avoid making the placeholder
-        // have a negative size
-        if (attr.width + DIM2D_X(relative_change) <= 0)
-            DIM2D_X(relative_change) = 0;
-        if (attr.height + DIM2D_Y(relative_change) <= 0)
-            DIM2D_Y(relative_change) = 0;
-
-        m_xdata.resize_window(placeholder,
-            attr.width + DIM2D_X(relative_change),
-            attr.height + DIM2D_Y(relative_change));
+    }
+    case DRAG_OUTLINE:
+    {
+        // Erase the old outline (by drawing over it again) before drawing
+        // the new one
+        Box outline;
+        if (m_xmodel.get_move_resize_outline(outline))
+        {
+            if (outline == geometry)
+                break;
+
+            m_xdata.draw_outline(outline);
+        }
+
+        m_xdata.draw_outline(geometry);
+        m_xmodel.set_move_resize_outline(geometry);
+        break;
+    }
+    case DRAG_OPAQUE:
+    {
+        // Updating the client more often than the screen is redrawn is just
+        // wasted work for the client - any motion which is skipped here is
+        // caught up on by later motion, or when the button is released
+        uint64_t interval_ns = 1000000000ULL / m_config.drag_refresh_rate;
+        if (!m_xmodel.throttle_move_resize(monotonic_ns(), interval_ns))
+            break;
+
+        Window client = m_xmodel.get_move_resize_client();
+        if (state == MR_MOVE)
+            m_xdata.move_window(client, geometry.x, geometry.y);
+        else
+            m_xdata.resize_window(client, geometry.width, geometry.height);
         break;
     }
+    }
 }
 
 /**
@@ -468,12 +597,23 @@ void XEvents::handle_motionnotify()
  */
 void XEvents::handle_expose()
 {
+    StatsTimer timer(m_stats, SH_EXPOSE);
+
     Icon *the_icon = m_xmodel.find_icon_from_icon_window(
         m_event.xexpose.window);
 
     if (!the_icon)
         return;
 
+    draw_icon(the_icon);
+}
+
+/**
+ * Draws the contents of an icon - the client's icon pixmap (if icons are
+ * enabled and the client has one) followed by its icon name.
+ */
+void XEvents::draw_icon(Icon *the_icon)
+{
     // Avoid drawing over the current contents of the icon
     the_icon->gc->clear();
 
@@ -518,9 +658,12 @@ void XEvents::handle_expose()
  */
 void XEvents::handle_destroynotify()
 {
+    StatsTimer timer(m_stats, SH_DESTROYNOTIFY);
+
     Window destroyed_window = m_event.xdestroywindow.window;
 
     m_xmodel.remove_all_effects(destroyed_window);
+    m_grabs.forget_window(destroyed_window);
 
     if (m_clients.is_client(destroyed_window))
     {
@@ -537,7 +680,7 @@ void XEvents::handle_destroynotify()
         m_clients.remove_client(destroyed_window);
 
         if (should_pack)
-            m_clients.repack_corner(corner);
+            m_work.schedule(DEFER_REPACK_CORNER, corner);
     }
 
     if (m_clients.is_child(destroyed_window))
@@ -551,6 +694,8 @@ void XEvents::handle_destroynotify()
  */
 void XEvents::handle_configurerequest()
 {
+    StatsTimer timer(m_stats, SH_CONFIGUREREQUEST);
+
     Window client = m_event.xconfigurerequest.window;
 
     // If we're not dealing with a window we manage, then allow it to do what
@@ -593,6 +738,8 @@ void XEvents::handle_configurerequest()
  */
 void XEvents::handle_maprequest()
 {
+    StatsTimer timer(m_stats, SH_MAPREQUEST);
+
     m_xdata.map_win(m_event.xmaprequest.window);
 }
 
@@ -602,9 +749,216 @@ void XEvents::handle_maprequest()
  */
 void XEvents::handle_circulaterequest()
 {
+    StatsTimer timer(m_stats, SH_CIRCULATEREQUEST);
+
     m_xdata.forward_circulate_request(m_event);
 }
 
+/**
+ * Handles changes to the keyboard mapping. Since keycodes may now refer to
+ * different keys, every hotkey has to be grabbed again and looked up again.
+ */
+void XEvents::handle_mappingnotify()
+{
+    StatsTimer timer(m_stats, SH_MAPPINGNOTIFY);
+
+    m_xdata.refresh_keyboard_mapping(m_event);
+
+    if (m_event.xmapping.request != MappingKeyboard &&
+            m_event.xmapping.request != MappingModifier)
+        return;
+
+    for (int keycode = 0; keycode < KEYCODE_COUNT; keycode++)
+    {
+        m_key_actions[keycode][0] = KeyActionEntry();
+        m_key_actions[keycode][1] = KeyActionEntry();
+    }
+
+    m_grabs.reset_hotkeys();
+    m_grabs.flush();
+}
+
+/**
+ * Grabs the keyboard shortcut for every action.
+ */
+void XEvents::grab_hotkeys()
+{
+    KeyboardAction actions[] = {
+        CLIENT_NEXT_DESKTOP, CLIENT_PREV_DESKTOP,
+        NEXT_DESKTOP, PREV_DESKTOP,
+        TOGGLE_STICK,
+        ICONIFY,
+        MAXIMIZE,
+        REQUEST_CLOSE, FORCE_CLOSE,
+        K_SNAP_TOP, K_SNAP_BOTTOM, K_SNAP_LEFT, K_SNAP_RIGHT,
+        SCREEN_TOP, SCREEN_BOTTOM, SCREEN_LEFT, SCREEN_RIGHT,
+        LAYER_ABOVE, LAYER_BELOW, LAYER_TOP, LAYER_BOTTOM,
+        LAYER_1, LAYER_2, LAYER_3, LAYER_4, LAYER_5, LAYER_6, LAYER_7, LAYER_8, LAYER_9,
+        CYCLE_FOCUS, CYCLE_FOCUS_BACK, EXIT_WM, RESTART_WM,
+        INVALID_ACTION
+    };
+
+    for (KeyboardAction *action = &actions[0]; *action != INVALID_ACTION; action++)
+    {
+        KeyBinding &binding = m_config.key_commands.action_to_binding[*action];
+        m_grabs.add_hotkey(binding.first, binding.second);
+    }
+
+    for (std::map<KeyBinding, std::string>::iterator launch =
+             m_config.key_commands.launch_bindings.begin();
+         launch != m_config.key_commands.launch_bindings.end();
+         launch++)
+        m_grabs.add_hotkey(launch->first.first, launch->first.second);
+}
+
+/**
+ * Removes the grabs for every key in the current configuration.
+ */
+void XEvents::ungrab_hotkeys()
+{
+    for (std::map<KeyboardAction, KeyBinding>::iterator binding =
+             m_config.key_commands.action_to_binding.begin();
+         binding != m_config.key_commands.action_to_binding.end();
+         binding++)
+        m_grabs.remove_hotkey(binding->second.first, binding->second.second);
+
+    for (std::map<KeyBinding, std::string>::iterator launch =
+             m_config.key_commands.launch_bindings.begin();
+         launch != m_config.key_commands.launch_bindings.end();
+         launch++)
+        m_grabs.remove_hotkey(launch->first.first, launch->first.second);
+}
+
+/**
+ * Switches over to a configuration which has just been read, and applies
+ * only the options that differ from the running configuration - hotkeys that
+ * didn't change aren't grabbed again, and windows aren't touched unless the
+ * border or icon size changed.
+ *
+ * @param fresh The new configuration. Afterwards, this holds the old
+ *              configuration, which the caller can throw away.
+ */
+void XEvents::reload_config(WMConfig &fresh)
+{
+    // The number of desktops is built into the ClientModel, and the log and
+    // trace files (and the control socket and launch helper) are only opened
+    // at startup, so these need a restart
+    fresh.num_desktops = m_config.num_desktops;
+    fresh.log_file = m_config.log_file;
+    fresh.log_mask = m_config.log_mask;
+    fresh.trace_file = m_config.trace_file;
+    fresh.control_socket = m_config.control_socket;
+    fresh.launch_helper = m_config.launch_helper;
+
+    // Switching drag modes would leave a drag which has already started
+    // half-done in the old mode
+    std::vector<Window> dragging;
+    m_clients.get_clients_of(m_clients.MOVING_DESKTOP, dragging);
+    m_clients.get_clients_of(m_clients.RESIZING_DESKTOP, dragging);
+    if (!dragging.empty())
+        fresh.drag_mode = m_config.drag_mode;
+
+    bool hotkeys_changed = fresh.key_commands.action_to_binding !=
+        m_config.key_commands.action_to_binding ||
+        fresh.key_commands.launch_bindings !=
+        m_config.key_commands.launch_bindings;
+    bool border_changed = fresh.border_width != m_config.border_width;
+    bool icons_changed = fresh.icon_width != m_config.icon_width ||
+        fresh.icon_height != m_config.icon_height ||
+        fresh.show_icons != m_config.show_icons;
+
+    if (hotkeys_changed)
+        ungrab_hotkeys();
+
+    std::swap(m_config, fresh);
+
+    if (hotkeys_changed)
+    {
+        for (int keycode = 0; keycode < KEYCODE_COUNT; keycode++)
+        {
+            m_key_actions[keycode][0] = KeyActionEntry();
+            m_key_actions[keycode][1] = KeyActionEntry();
+        }
+
+        // The GrabManager only sends the grabs which are different from the
+        // ones which were installed before
+        grab_hotkeys();
+        m_work.schedule(DEFER_FLUSH_GRABS);
+    }
+
+    if (border_changed)
+    {
+        std::vector<Window> clients;
+        m_clients.get_all_clients(clients);
+        for (std::vector<Window>::iterator client = clients.begin();
+             client != clients.end();
+             client++)
+            m_xdata.set_border_width(*client, m_config.border_width);
+
+        m_clients.set_border_width(m_config.border_width);
+    }
+
+    if (icons_changed)
+    {
+        std::vector<Icon*> icons;
+        m_xmodel.get_icons(icons);
+        size_t visible_icons = icons.size();
+        m_xmodel.get_pooled_icons(icons);
+
+        for (size_t idx = 0; idx < icons.size(); idx++)
+        {
+            m_xdata.resize_window(icons[idx]->icon, m_config.icon_width,
+                                  m_config.icon_height);
+
+            // Shrinking a window doesn't cause an Expose, so the text (which
+            // is drawn relative to the bottom of the icon) has to be redrawn
+            if (idx < visible_icons)
+                draw_icon(icons[idx]);
+        }
+
+        m_work.schedule(DEFER_REPOSITION_ICONS);
+    }
+}
+
+/**
+ * Finds the action (or the command) bound to a key. The first time a key is
+ * pressed, its keysym is looked up in the configuration - after that, this is
+ * a single array access.
+ *
+ * @param keycode The keycode of the key that was pressed.
+ * @param is_using_secondary_action Whether the secondary modifier was held.
+ * @return What the key is bound to - the action is INVALID_ACTION if the key
+ *         isn't bound to one.
+ */
+const KeyActionEntry &XEvents::find_key_action(int keycode, bool is_using_secondary_action)
+{
+    static const KeyActionEntry unbound;
+    if (keycode < 0 || keycode >= KEYCODE_COUNT)
+        return unbound;
+
+    KeyActionEntry &entry = m_key_actions[keycode][is_using_secondary_action];
+    if (!entry.resolved)
+    {
+        KeyBinding binding(m_xdata.get_keysym(keycode), is_using_secondary_action);
+
+        std::map<KeyBinding, KeyboardAction>::const_iterator bound =
+            m_config.key_commands.binding_to_action.find(binding);
+
+        entry.action = bound == m_config.key_commands.binding_to_action.end() ?
+            INVALID_ACTION : bound->second;
+
+        std::map<KeyBinding, std::string>::const_iterator launch =
+            m_config.key_commands.launch_bindings.find(binding);
+        if (entry.action == INVALID_ACTION &&
+                launch != m_config.key_commands.launch_bindings.end())
+            entry.command = launch->second;
+
+        entry.resolved = true;
+    }
+
+    return entry;
+}
+
 /**
  * Adds a window - this is exposed specifically so that smallwm.cpp can
  * access this method when it imports existing windows.
@@ -617,33 +971,31 @@ void XEvents::add_window(Window window)
     // move it onto the current desktop
     if (m_clients.is_client(window))
     {
-        Desktop const *mapped_desktop = m_clients.find_desktop(window);
+        Desktop mapped_desktop = m_clients.find_desktop(window);
 
         // Icons must be uniconified
-        if (mapped_desktop->is_icon_desktop())
+        if (mapped_desktop.is_icon_desktop())
             m_clients.deiconify(window);
 
         // Moving/resizing clients must stop being moved/resized
-        if (mapped_desktop->is_moving_desktop() || mapped_desktop->is_resizing_desktop())
+        if (mapped_desktop.is_moving_desktop() || mapped_desktop.is_resizing_desktop())
         {
-            Window placeholder = m_xmodel.get_move_resize_placeholder();
-            m_xmodel.exit_move_resize();
-
-            XWindowAttributes placeholder_attr;
-            m_xdata.get_attributes(placeholder, placeholder_attr);
+            // Whatever is showing the drag is cleaned up by ClientModelEvents
+            // once the client leaves the moving/resizing desktop
+            Box geometry = m_xmodel.get_move_resize_geometry();
 
-            if (mapped_desktop->is_moving_desktop())
+            if (mapped_desktop.is_moving_desktop())
                 m_clients.stop_moving(window,
-                    Dimension2D(placeholder_attr.x, placeholder_attr.y));
-            else if (mapped_desktop->is_resizing_desktop())
+                    Dimension2D(geometry.x, geometry.y));
+            else if (mapped_desktop.is_resizing_desktop())
                 m_clients.stop_resizing(window,
-                    Dimension2D(placeholder_attr.width, placeholder_attr.height));
+                    Dimension2D(geometry.width, geometry.height));
         }
 
         // Clients which are currently stuck on all desktops don't need to have
         // anything done to them. Everybody else has to be moved onto the
         // current desktop.
-        if (!mapped_desktop->is_all_desktop())
+        if (!mapped_desktop.is_all_desktop())
             m_clients.client_reset_desktop(window);
 
         // Make sure that it can be accessed by the focus cycle again
@@ -702,23 +1054,32 @@ void XEvents::add_window(Window window)
                      hints.initial_state == IconicState)
         init_state = IS_HIDDEN;
 
-    std::string win_class;
-    m_xdata.get_class(window, win_class);
-    bool should_focus = !contains(m_config.no_autofocus.begin(),
-                                  m_config.no_autofocus.end(),
-                                  win_class);
+    // Only the properties that some rule looks at are worth a round-trip
+    WindowProperties props;
+    if (m_config.rules.uses(RF_CLASS))
+        m_xdata.get_class(window, props.values[RF_CLASS]);
+    if (m_config.rules.uses(RF_INSTANCE))
+        m_xdata.get_instance(window, props.values[RF_INSTANCE]);
+    if (m_config.rules.uses(RF_TITLE))
+        m_xdata.get_title(window, props.values[RF_TITLE]);
+    if (m_config.rules.uses(RF_ROLE))
+        m_xdata.get_role(window, props.values[RF_ROLE]);
+    if (m_config.rules.uses(RF_TYPE))
+        m_xdata.get_window_type(window, props.values[RF_TYPE]);
+
+    ClassActions action;
+    bool has_actions = m_config.rules.match(props, action);
+    bool should_focus = !(action.actions & ACT_NOFOCUS);
 
     m_clients.add_client(window, init_state,
             Dimension2D(win_attr.x, win_attr.y),
             Dimension2D(win_attr.width, win_attr.height),
             should_focus);
 
-    // Finally, execute the actions tied to the window's class
+    // Finally, execute the actions from the rules that the window matched
 
-    if (m_config.classactions.count(win_class) > 0 && init_state != IS_HIDDEN)
+    if (has_actions && init_state != IS_HIDDEN)
     {
-        ClassActions &action = m_config.classactions[win_class];
-
         if (action.actions & ACT_STICK)
             m_clients.toggle_stick(window);
 
@@ -775,3 +1136,76 @@ void XEvents::add_window(Window window)
             m_clients.pack_client(window, action.pack_corner, action.pack_priority);
     }
 }
+
+/**
+ * Adds back the clients that were saved before SmallWM restarted itself,
+ * along with any windows that showed up in the meantime.
+ *
+ * The snapshot is only checked against the list of windows that the server
+ * has (which is already needed to find new windows), so restoring a client
+ * doesn't cost any round-trips. Anything that belonged to the old connection
+ * to the server, like grabs, is set up again.
+ *
+ * @param snapshot The state that was saved before the restart.
+ * @param existing_windows Every top-level window on the server.
+ */
+void XEvents::restore(const Snapshot &snapshot,
+                      const std::vector<Window> &existing_windows)
+{
+    std::set<Window> alive(existing_windows.begin(), existing_windows.end());
+    std::set<Window> restored;
+
+    m_clients.restore_current_desktop(snapshot.current_desktop);
+
+    for (std::vector<ClientState>::const_iterator saved =
+             snapshot.clients.begin();
+         saved != snapshot.clients.end();
+         saved++)
+    {
+        // Whatever was destroyed while SmallWM was restarting is forgotten
+        if (!alive.count(saved->client))
+            continue;
+
+        ClientState state = *saved;
+        state.children.clear();
+        for (std::vector<Window>::const_iterator child =
+                 saved->children.begin();
+             child != saved->children.end();
+             child++)
+        {
+            if (alive.count(*child))
+                state.children.push_back(*child);
+        }
+
+        m_clients.restore_client(state);
+        if (!m_clients.is_client(state.client))
+            continue;
+
+        // Nothing is focused yet, so every click has to be captured - the
+        // focused window is ungrabbed once it is focused again
+        restored.insert(state.client);
+        m_grabs.grab_mouse(state.client);
+
+        std::vector<Window> children;
+        m_clients.get_children_of(state.client, children);
+        for (std::vector<Window>::iterator child = children.begin();
+             child != children.end();
+             child++)
+        {
+            restored.insert(*child);
+            m_grabs.grab_mouse(*child);
+        }
+    }
+
+    if (restored.count(snapshot.focused))
+        m_clients.force_focus(snapshot.focused);
+
+    for (std::vector<Window>::const_iterator window =
+             existing_windows.begin();
+         window != existing_windows.end();
+         window++)
+    {
+        if (!restored.count(*window))
+            add_window(*window);
+    }
+}
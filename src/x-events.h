@@ -8,9 +8,37 @@
 #include "model/x-model.h"
 #include "configparse.h"
 #include "common.h"
+#include "deferred-work.h"
+#include "grab-manager.h"
+#include "launcher.h"
+#include "snapshot.h"
+#include "stats.h"
+#include "trace.h"
 #include "utils.h"
 #include "xdata.h"
 
+/// The number of possible keycodes (X sends keycodes as a single byte)
+const int KEYCODE_COUNT = 256;
+
+/**
+ * The action (or command) bound to a key, once the key has been looked up.
+ */
+struct KeyActionEntry
+{
+    KeyActionEntry() :
+        resolved(false), action(INVALID_ACTION)
+    {}
+
+    /// Whether this key has been looked up in the configuration yet
+    bool resolved;
+
+    /// The action bound to this key, or INVALID_ACTION
+    KeyboardAction action;
+
+    /// The command launched by this key, if it isn't bound to an action
+    std::string command;
+};
+
 /**
  * A dispatcher for handling the different type of X events.
  *
@@ -20,35 +48,20 @@
 class XEvents
 {
 public:
-    XEvents(WMConfig &config, XData &xdata, ClientModel &clients,
-        XModel &xmodel) :
-        m_config(config), m_xdata(xdata), m_clients(clients),
-        m_xmodel(xmodel), m_done(false)
+    XEvents(WMConfig &config, Stats &stats, TraceWriter &trace, XData &xdata,
+        GrabManager &grabs, DeferredWork &work, Launcher &launcher,
+        ClientModel &clients, XModel &xmodel) :
+        m_config(config), m_stats(stats), m_trace(trace), m_xdata(xdata),
+        m_grabs(grabs), m_work(work), m_launcher(launcher),
+        m_clients(clients), m_xmodel(xmodel),
+        m_done(false), m_restart(false), m_cycling(false)
     {
-        xdata.add_hotkey_mouse(MOVE_BUTTON);
-        xdata.add_hotkey_mouse(RESIZE_BUTTON);
-        xdata.add_hotkey_mouse(LAUNCH_BUTTON);
-
-        KeyboardAction actions[] = {
-            CLIENT_NEXT_DESKTOP, CLIENT_PREV_DESKTOP,
-            NEXT_DESKTOP, PREV_DESKTOP,
-            TOGGLE_STICK,
-            ICONIFY,
-            MAXIMIZE,
-            REQUEST_CLOSE, FORCE_CLOSE,
-            K_SNAP_TOP, K_SNAP_BOTTOM, K_SNAP_LEFT, K_SNAP_RIGHT,
-            SCREEN_TOP, SCREEN_BOTTOM, SCREEN_LEFT, SCREEN_RIGHT,
-            LAYER_ABOVE, LAYER_BELOW, LAYER_TOP, LAYER_BOTTOM,
-            LAYER_1, LAYER_2, LAYER_3, LAYER_4, LAYER_5, LAYER_6, LAYER_7, LAYER_8, LAYER_9,
-            CYCLE_FOCUS, CYCLE_FOCUS_BACK, EXIT_WM,
-            INVALID_ACTION
-        };
-
-        for (KeyboardAction *action = &actions[0]; *action != INVALID_ACTION; action++)
-        {
-            KeyBinding &binding = config.key_commands.action_to_binding[*action];
-            xdata.add_hotkey(binding.first, binding.second);
-        }
+        grabs.add_hotkey_mouse(MOVE_BUTTON);
+        grabs.add_hotkey_mouse(RESIZE_BUTTON);
+        grabs.add_hotkey_mouse(LAUNCH_BUTTON);
+
+        grab_hotkeys();
+        grabs.flush();
     };
 
     bool step();
@@ -56,10 +69,23 @@ public:
     // Note that this is exposed because smallwm.cpp has to import existing
     // windows when main() runs
     void add_window(Window);
+    void restore(const Snapshot&, const std::vector<Window>&);
+
+    void reload_config(WMConfig&);
+    void run_action(KeyboardAction, Window);
+
+    /// Whether SmallWM should stop, once the current batch is handled
+    bool is_done() const
+    { return m_done; }
+
+    /// Whether SmallWM stopped because the user asked it to restart
+    bool should_restart() const
+    { return m_restart; }
 
 private:
     void handle_rrnotify();
     void handle_keypress();
+    void handle_keyrelease();
     void handle_buttonpress();
     void handle_buttonrelease();
     void handle_motionnotify();
@@ -72,6 +98,13 @@ private:
     void handle_configurerequest();
     void handle_maprequest();
     void handle_circulaterequest();
+    void handle_mappingnotify();
+
+    void finish_cycle();
+    void draw_icon(Icon*);
+    void grab_hotkeys();
+    const KeyActionEntry &find_key_action(int, bool);
+    void ungrab_hotkeys();
 
     /// The currently active event
     XEvent m_event;
@@ -79,12 +112,40 @@ private:
     /// Whether or not the user has terminated SmallWM
     bool m_done;
 
+    /// Whether SmallWM should start itself again once it has stopped
+    bool m_restart;
+
+    /** Whether the user is holding down the modifier while cycling through
+     * the focus history, with the keyboard grabbed */
+    bool m_cycling;
+
+    /** The action bound to each keycode, without (0) and with (1) the
+     * secondary modifier. Each key is looked up the first time it is pressed,
+     * and forgotten when the keyboard mapping changes. */
+    KeyActionEntry m_key_actions[KEYCODE_COUNT][2];
+
     /// The configuration options that were given in the configuration file
     WMConfig &m_config;
 
+    /// Where the latency of each event handler is recorded
+    Stats &m_stats;
+
+    /// Where each event is recorded, if recording is enabled
+    TraceWriter &m_trace;
+
     /// The data required to interface with Xlib
     XData &m_xdata;
 
+    /// The hotkeys and click grabs which are installed on the server
+    GrabManager &m_grabs;
+
+    /** The follow-up work (like repacking) which is done once the changes
+     * made by this event have been handled */
+    DeferredWork &m_work;
+
+    /// What starts the shell, and the programs bound to keys
+    Launcher &m_launcher;
+
     /// The data model which stores the clients and data about them
     ClientModel &m_clients;
 
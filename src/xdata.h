@@ -4,11 +4,11 @@
 
 #include <cstdlib>
 #include <cstring>
-#include <map>
+#include <poll.h>
+#include <string>
 #include <vector>
 
 #include "common.h"
-#include "logging/logging.h"
 
 /**
  * An X graphics context which is used to draw on windows.
@@ -16,32 +16,12 @@
 class XGC
 {
 public:
-    XGC(Display *dpy, Window window) :
-        m_display(dpy), m_window(window)
-    {
-        m_gc = XCreateGC(dpy, window, 0, NULL);
-    };
+    virtual ~XGC()
+    {};
 
-    ~XGC()
-    {
-        XFree(m_gc);
-    };
-
-    void clear();
-    void draw_string(Dimension, Dimension, const std::string&);
-    Dimension2D copy_pixmap(Drawable, Dimension, Dimension);
-
-private:
-    /** The raw X display - this is necessary to have since XData doesn't
-     * expose it. */
-    Display *m_display;
-
-
-    /// The window this graphics context belongs to
-    Window m_window;
-
-    /// The X graphics context this sits above
-    GC m_gc;
+    virtual void clear() = 0;
+    virtual void draw_string(Dimension, Dimension, const std::string&) = 0;
+    virtual Dimension2D copy_pixmap(Drawable, Dimension, Dimension) = 0;
 };
 
 /**
@@ -54,81 +34,121 @@ enum MonoColor
 };
 
 /**
- * This forms a layer above raw Xlib, which stores the X display, root
- * window, etc. and provides the most common operations which use these data.
+ * The atoms which SmallWM uses. These are all interned when SmallWM starts,
+ * so that getting one of them doesn't need a round-trip.
  */
-class XData
+enum KnownAtom
 {
-public:
-    XData(Log &logger, Display *dpy, Window root, int screen) :
-        m_display(dpy), m_logger(logger), m_confined(None),
-        m_old_root_mask(NoEventMask), m_substructure_depth(0)
-    {
-        m_root = DefaultRootWindow(dpy);
-        m_screen = DefaultScreen(dpy);
-
-        init_xrandr();
-        load_modifier_flags();
-    };
-
-    void init_xrandr();
-    void load_modifier_flags();
-
-    XGC *create_gc(Window);
-    Window create_window(bool);
-
-    void change_property(Window, const std::string&, Atom,
-            const unsigned char*, size_t);
-
-    void next_event(XEvent&);
-    void get_latest_event(XEvent&, int);
-
-    void add_hotkey(KeySym, bool);
-    void add_hotkey_mouse(unsigned int);
-
-    void confine_pointer(Window);
-    void stop_confining_pointer();
-    void grab_mouse(Window);
-    void ungrab_mouse(Window);
-
-    void select_input(Window, long);
-
-    void get_windows(std::vector<Window>&);
-    void get_pointer_location(Dimension&, Dimension&);
-
-    Window get_input_focus();
-    bool set_input_focus(Window);
-
-    void map_win(Window);
-    void unmap_win(Window);
-    void request_close(Window);
-    void destroy_win(Window);
-
-    void get_attributes(Window, XWindowAttributes&);
-    void set_attributes(Window, XSetWindowAttributes&,
-        unsigned long);
-    bool is_mapped(Window);
-    void set_border_color(Window, MonoColor);
-    void set_border_width(Window, Dimension);
-
-    void move_window(Window, Dimension, Dimension);
-    void resize_window(Window, Dimension, Dimension);
-    void raise(Window);
-    void restack(const std::vector<Window>&);
-
-    bool get_wm_hints(Window, XWMHints&);
-    void get_size_hints(Window, XSizeHints&);
-    Window get_transient_hint(Window);
-    void get_icon_name(Window, std::string&);
-    void get_class(Window, std::string&);
+    ATOM_WM_PROTOCOLS,
+    ATOM_WM_DELETE_WINDOW,
+    ATOM_WM_STATE,
+    ATOM_WM_WINDOW_ROLE,
+    ATOM_NET_SUPPORTED,
+    ATOM_NET_CLIENT_LIST,
+    ATOM_NET_CLIENT_LIST_STACKING,
+    ATOM_NET_NUMBER_OF_DESKTOPS,
+    ATOM_NET_CURRENT_DESKTOP,
+    ATOM_NET_ACTIVE_WINDOW,
+    ATOM_NET_WORKAREA,
+    ATOM_NET_WM_WINDOW_TYPE,
+    ATOM_NET_WM_WINDOW_TYPE_DESKTOP,
+    ATOM_NET_WM_WINDOW_TYPE_DOCK,
+    ATOM_NET_WM_WINDOW_TYPE_TOOLBAR,
+    ATOM_NET_WM_WINDOW_TYPE_MENU,
+    ATOM_NET_WM_WINDOW_TYPE_UTILITY,
+    ATOM_NET_WM_WINDOW_TYPE_SPLASH,
+    ATOM_NET_WM_WINDOW_TYPE_DIALOG,
+    ATOM_NET_WM_WINDOW_TYPE_NORMAL,
+    ATOM_COUNT
+};
 
-    void get_screen_boxes(std::vector<Box>&);
+/// The names of the known atoms, in the same order as KnownAtom
+extern const char *ATOM_NAMES[ATOM_COUNT];
 
-    KeySym get_keysym(int);
+/**
+ * The interface to the X server, which provides the most common operations
+ * that SmallWM needs to do on the display and its windows.
+ *
+ * XlibData implements this on top of a real Xlib connection, while FakeXData
+ * implements an in-memory server which is used for tests and benchmarks.
+ */
+class XData
+{
+public:
+    virtual ~XData()
+    {};
+
+    virtual XGC *create_gc(Window) = 0;
+    virtual Window create_window(bool) = 0;
+
+    virtual Atom get_atom(KnownAtom) = 0;
+    virtual void change_property(Window, KnownAtom, Atom,
+            const unsigned char*, size_t) = 0;
+
+    virtual void next_event(XEvent&) = 0;
+    virtual void get_latest_event(XEvent&, int) = 0;
+
+    virtual void add_hotkey(KeySym, bool) = 0;
+    virtual void remove_hotkey(KeySym, bool) = 0;
+    virtual void add_hotkey_mouse(unsigned int) = 0;
+    virtual void remove_hotkey_mouse(unsigned int) = 0;
+    virtual void clear_hotkeys() = 0;
+
+    virtual void confine_pointer(Window) = 0;
+    virtual void stop_confining_pointer() = 0;
+    virtual void grab_mouse(Window) = 0;
+    virtual void ungrab_mouse(Window) = 0;
+    virtual bool grab_keyboard() = 0;
+    virtual void ungrab_keyboard() = 0;
+
+    virtual void select_input(Window, long) = 0;
+
+    virtual void get_windows(std::vector<Window>&) = 0;
+    virtual void get_pointer_location(Dimension&, Dimension&) = 0;
+
+    virtual Window get_input_focus() = 0;
+    virtual bool set_input_focus(Window) = 0;
+
+    virtual void map_win(Window) = 0;
+    virtual void unmap_win(Window) = 0;
+    virtual void unmap_wins(const std::vector<Window>&) = 0;
+    virtual void request_close(Window) = 0;
+    virtual void destroy_win(Window) = 0;
+
+    virtual void get_attributes(Window, XWindowAttributes&) = 0;
+    virtual void set_attributes(Window, XSetWindowAttributes&,
+        unsigned long) = 0;
+    virtual bool is_mapped(Window) = 0;
+    virtual void set_border_color(Window, MonoColor) = 0;
+    virtual void set_border_width(Window, Dimension) = 0;
+
+    virtual void move_window(Window, Dimension, Dimension) = 0;
+    virtual void resize_window(Window, Dimension, Dimension) = 0;
+    virtual void move_resize_window(Window, Dimension, Dimension,
+        Dimension, Dimension) = 0;
+    virtual void raise(Window) = 0;
+    virtual void restack(const std::vector<Window>&) = 0;
+    virtual void draw_outline(const Box&) = 0;
+
+    virtual bool get_wm_hints(Window, XWMHints&) = 0;
+    virtual void get_size_hints(Window, XSizeHints&) = 0;
+    virtual Window get_transient_hint(Window) = 0;
+    virtual void get_icon_name(Window, std::string&) = 0;
+    virtual void get_class(Window, std::string&) = 0;
+    virtual void get_instance(Window, std::string&) = 0;
+    virtual void get_title(Window, std::string&) = 0;
+    virtual void get_role(Window, std::string&) = 0;
+    virtual void get_window_type(Window, std::string&) = 0;
+
+    virtual void get_screen_boxes(std::vector<Box>&) = 0;
+
+    virtual KeySym get_keysym(int) = 0;
+    virtual bool is_primary_modifier(int) = 0;
+    virtual void refresh_keyboard_mapping(XEvent&) = 0;
     void keysym_to_string(KeySym, std::string&);
 
-    void forward_configure_request(XEvent&, unsigned int);
-    void forward_circulate_request(XEvent&);
+    virtual void forward_configure_request(XEvent&, unsigned int) = 0;
+    virtual void forward_circulate_request(XEvent&) = 0;
 
     /// The event code X adds to each XRandR event (used by XEvents)
     int randr_event_offset;
@@ -140,38 +160,13 @@ public:
     unsigned int caps_mod_flag;
     unsigned int scroll_mod_flag;
 
-private:
-    Atom intern_if_needed(const std::string&);
-    unsigned long decode_monocolor(MonoColor);
-
-    void enable_substructure_events();
-    void disable_substructure_events();
-
-    /**  We save this to ensure that we can re-enable substructure events if they
-     * were enabled before a call to disable_substructure_events.
-     */
-    long m_old_root_mask;
-
-    /// How deep we are inside of a nested group of enable/disable substruture events
-    int m_substructure_depth;
-
-    /// The logging interface
-    Log &m_logger;
-
-    /// The connection to the X server
-    Display *m_display;
-
-    /// The root window on the display
-    Window m_root;
-
-    /// The default X11 screen
-    int m_screen;
-
-    /// The pre-defined atoms, which are accessible via a string
-    std::map<std::string, Atom> m_atoms;
+protected:
+    XData() :
+        randr_event_offset(0), primary_mod_flag(0), secondary_mod_flag(0),
+        num_mod_flag(0), caps_mod_flag(0), scroll_mod_flag(0)
+    {};
 
-    /// The window the pointer is confined to, or None
-    Window m_confined;
+    static void poll_fds(int, bool, std::vector<struct pollfd>&);
 };
 
 #endif
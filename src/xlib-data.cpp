@@ -0,0 +1,1313 @@
+/** @file */
+#include <cerrno>
+#include <poll.h>
+
+#include "xlib-data.h"
+#include "trace.h"
+
+/**
+ * Clears the window of the graphics context.
+ *
+ * (Although this doesn't *require* the graphics context, this function is
+ * typically used when drawing, so it fits in well with the rest of the
+ * class).
+ */
+void XlibGC::clear()
+{
+    XClearWindow(m_display, m_window);
+    m_stats.add_requests(SR_GC_CLEAR, 1);
+}
+
+/**
+ * Draws a string into the current graphics context.
+ * @param x The X coordinate of the left of the text.
+ * @param y The Y coordinate of the bottom of the text.
+ * @param text The text to draw.
+ */
+void XlibGC::draw_string(Dimension x, Dimension y, const std::string &text)
+{
+    // Although Xlib will handle this for us (passing it a 0 length string
+    // will work), don't bother with it if we know it will do nothing.
+    if (text.size() == 0)
+        return;
+
+    XDrawString(m_display, m_window, m_gc, x, y, text.c_str(), text.size());
+    m_stats.add_requests(SR_GC_DRAW_STRING, 1);
+}
+
+/**
+ * Copies the contents of a pixmap onto this graphics context.
+ * @param pixmap The pixmap to copy.
+ * @param x The X coordinate of the target area.
+ * @param y The Y coordinate of the target area.
+ */
+Dimension2D XlibGC::copy_pixmap(Drawable pixmap, Dimension x, Dimension y)
+{
+    // First, get the size of the pixmap that we're interested in. We need
+    // several other parameters since XGetGeometry is pretty general.
+    Window _u1;
+    int _u2;
+    unsigned int _u3;
+
+    unsigned int pix_width, pix_height;
+    XGetGeometry(m_display, pixmap, &_u1, &_u2, &_u2,
+            &pix_width, &pix_height, &_u3, &_u3);
+
+    XCopyArea(m_display, pixmap, m_window, m_gc, 0, 0, pix_width, pix_height,
+        x, y);
+
+    m_stats.add_round_trips(SR_GC_COPY_PIXMAP, 1);
+    m_stats.add_requests(SR_GC_COPY_PIXMAP, 1);
+
+    // Return the size of the copied pixmap, since there isn't another way in
+    // the XGC definition to get this data
+    return Dimension2D(pix_width, pix_height);
+}
+
+/**
+ * Initializes XRandR on the current display.
+ *
+ * Note that SmallWM *depends* upon XRandR support, so it will die if it is not
+ * present.
+ */
+void XlibData::init_xrandr()
+{
+    int _;
+    bool randr_state = XRRQueryExtension(m_display, &randr_event_offset, &_);
+
+    if (randr_state == false)
+    {
+        m_logger.log(LOG_ERR) <<
+            "Unable to initialize XRandR extension - terminating" << Log::endl;
+
+        std::exit(1);
+    }
+
+    // Version 1.4 is about 2 years, so even though it probably has more
+    // than we require, it seems like a good starting point
+    int major_version = 1, minor_version = 4;
+    XRRQueryVersion(m_display, &major_version, &minor_version);
+
+    // Ensure that we can handle changes to the screen configuration
+    XRRSelectInput(m_display, m_root, RRCrtcChangeNotifyMask);
+
+    m_stats.add_round_trips(SR_INIT_XRANDR, 2);
+    m_stats.add_requests(SR_INIT_XRANDR, 1);
+}
+
+/**
+ * Loads the whole keyboard mapping from the X server, so that keycodes can
+ * be converted into keysyms without asking the server each time.
+ */
+void XlibData::load_keyboard_mapping()
+{
+    int max_keycode;
+    XDisplayKeycodes(m_display, &m_min_keycode, &max_keycode);
+
+    int keycode_count = max_keycode - m_min_keycode + 1;
+    KeySym *key_map = XGetKeyboardMapping(m_display,
+                                          m_min_keycode,
+                                          keycode_count,
+                                          &m_keysyms_per_keycode);
+
+    m_key_map.assign(key_map, key_map + keycode_count * m_keysyms_per_keycode);
+    XFree(key_map);
+
+    // XDisplayKeycodes is answered from the connection setup data, so only
+    // the keyboard mapping goes to the server
+    m_stats.add_round_trips(SR_LOAD_KEYBOARD_MAPPING, 1);
+}
+
+/**
+ * Discovers the flags associated with the primary and secondary modifier,
+ * as well as various modifiers that we ignore.
+ */
+void XlibData::load_modifier_flags()
+{
+    primary_mod_flag = 0;
+    secondary_mod_flag = 0;
+    num_mod_flag = 0;
+    caps_mod_flag = 0;
+    scroll_mod_flag = 0;
+    m_primary_keycodes.clear();
+
+    XModifierKeymap *mod_map = XGetModifierMapping(m_display);
+    for (int mod = 0; mod < 8; mod++)
+    {
+        for (int key = 0; key < mod_map->max_keypermod; key++)
+        {
+            KeyCode code = mod_map->modifiermap[mod * mod_map->max_keypermod + key];
+            int keycode_base = (code - m_min_keycode) * m_keysyms_per_keycode;
+            if (code < m_min_keycode || keycode_base >= m_key_map.size())
+                continue;
+
+            for (int sym_idx = 0; sym_idx < m_keysyms_per_keycode; sym_idx++)
+            {
+                KeySym sym = m_key_map[keycode_base + sym_idx];
+                unsigned int mod_flag = 1 << mod;
+                switch (sym)
+                {
+                case XK_Super_L:
+                case XK_Super_R:
+                    m_logger.log(LOG_INFO) 
+                        << "Binding super key to modifier " 
+                        << mod 
+                        << Log::endl;
+
+                    primary_mod_flag |= mod_flag;
+                    break;
+
+                case XK_Control_L:
+                case XK_Control_R:
+                    m_logger.log(LOG_INFO) 
+                        << "Binding control key to modifier " 
+                        << mod
+                        << Log::endl;
+
+                    secondary_mod_flag |= mod_flag;
+                    break;
+
+                case XK_Num_Lock:
+                    m_logger.log(LOG_INFO) 
+                        << "Binding numlock key to modifier " 
+                        << mod
+                        << Log::endl;
+
+                    num_mod_flag |= mod_flag;
+                    break;
+
+                case XK_Scroll_Lock:
+                    m_logger.log(LOG_INFO) 
+                        << "Binding scroll lock key to modifier " 
+                        << mod
+                        << Log::endl;
+
+                    scroll_mod_flag |= mod_flag;
+                    break;
+
+                case XK_Caps_Lock:
+                    m_logger.log(LOG_INFO) 
+                        << "Binding capslock key to modifier " 
+                        << mod
+                        << Log::endl;
+
+                    caps_mod_flag |= mod_flag;
+                    break;
+                }
+            }
+        }
+    }
+
+    m_logger.log(LOG_INFO)
+        << "primary="
+        << primary_mod_flag
+        << " secondary="
+        << secondary_mod_flag
+        << " num="
+        << num_mod_flag
+        << " caps="
+        << caps_mod_flag
+        << " scroll="
+        << scroll_mod_flag
+        << Log::endl;
+
+    // Any key in the Super keys' modifier slots sets the primary modifier,
+    // even the ones which aren't Super keys themselves
+    for (int mod = 0; mod < 8; mod++)
+    {
+        if (!(primary_mod_flag & (1 << mod)))
+            continue;
+
+        for (int key = 0; key < mod_map->max_keypermod; key++)
+        {
+            KeyCode code = mod_map->modifiermap[mod * mod_map->max_keypermod + key];
+            if (code != 0)
+                m_primary_keycodes.push_back(code);
+        }
+    }
+
+    // Every subset of the lock modifiers that the keyboard has, so that each
+    // hotkey can be grabbed with all of them
+    unsigned int lock_flags[] = { num_mod_flag, caps_mod_flag, scroll_mod_flag };
+    m_lock_masks.assign(1, 0);
+    for (int lock = 0; lock < 3; lock++)
+    {
+        if (!lock_flags[lock])
+            continue;
+
+        size_t existing = m_lock_masks.size();
+        for (size_t mask = 0; mask < existing; mask++)
+            m_lock_masks.push_back(m_lock_masks[mask] | lock_flags[lock]);
+    }
+
+    XFreeModifiermap(mod_map);
+    m_stats.add_round_trips(SR_LOAD_MODIFIER_FLAGS, 1);
+}
+
+/**
+ * Creates a new graphics context for a given window.
+ * @return A new XGC for the given window.
+ */
+XGC *XlibData::create_gc(Window window)
+{
+    return new XlibGC(m_display, window, m_stats);
+}
+
+/**
+ * Creates a new window. Note that it has the following default properties:
+ *
+ *  - Location at -1, -1.
+ *  - Size of 1, 1.
+ *  - Border width of 1.
+ *  - Black border, with a white background.
+ *
+ * @param ignore Whether (true) or not (false) SmallWM should ignore the new
+ *               window and not treat it as a client.
+ * @return The ID of the new window.
+ */
+Window XlibData::create_window(bool ignore)
+{
+    Window win = XCreateSimpleWindow(
+        m_display, m_root,
+        -1, -1, // Location
+        1, 1, // Size
+        1, // Border thickness
+        decode_monocolor(X_BLACK),
+        decode_monocolor(X_WHITE));
+
+    // Setting the `override_redirect` flag is what SmallWM uses to check for
+    // windows it should ignore
+    if (ignore)
+    {
+        XSetWindowAttributes attr;
+        attr.override_redirect = true;
+        set_attributes(win, attr, CWOverrideRedirect);
+    }
+
+    m_stats.add_requests(SR_CREATE_WINDOW, 1);
+
+    if (m_trace)
+        m_trace->record_created(win);
+
+    return win;
+}
+
+/**
+ * Starts recording the windows that SmallWM creates into a trace.
+ * @param trace The trace to record into, or NULL to stop recording.
+ */
+void XlibData::record_to(TraceWriter *trace)
+{
+    m_trace = trace;
+}
+
+/**
+ * Changes the property on a window.
+ * @param window The window to change the property of.
+ * @param prop The property to change.
+ * @param type The type of the property to change.
+ * @param value The raw value of the property.
+ * @param elems The length of the value of the property.
+ */
+void XlibData::change_property(Window window, KnownAtom prop,
+        Atom type, const unsigned char *value, size_t elems)
+{
+    XChangeProperty(m_display, window, m_known_atoms[prop],
+            type, 32, PropModeReplace, value, elems);
+    m_stats.add_requests(SR_CHANGE_PROPERTY, 1);
+}
+
+/**
+ * Gets the next event from the X server.
+ * @param[in] event The place to store the event.
+ */
+void XlibData::next_event(XEvent &data)
+{
+    // This only counts as a round-trip when Xlib has nothing queued up, and
+    // has to flush its output buffer and wait on the server
+    if (XQLength(m_display) == 0)
+        m_stats.add_round_trips(SR_NEXT_EVENT, 1);
+
+    XNextEvent(m_display, &data);
+}
+
+/**
+ * Waits until either the X server has sent an event, or one of the other file
+ * descriptors is ready. This lets the event loop handle things other than X
+ * events (like signals) without waiting for the next X event.
+ *
+ * Note that this also returns early if a signal arrives while waiting.
+ *
+ * @param[in,out] others The other file descriptors to wait on. Their revents
+ *                       are filled in, even if an X event was already queued.
+ * @return Whether an event can be read by next_event() without blocking.
+ */
+bool XlibData::wait_for_event(std::vector<struct pollfd> &others)
+{
+    // XPending flushes the output buffer, so the server sees any requests we
+    // made before we go to sleep
+    bool queued = XPending(m_display) > 0;
+    poll_fds(ConnectionNumber(m_display), queued, others);
+    if (queued)
+        return true;
+
+    // The connection may be readable without there being a whole event. If
+    // there is, then this wait is the round-trip that next_event() would
+    // have counted.
+    if (XPending(m_display) == 0)
+        return false;
+
+    m_stats.add_round_trips(SR_NEXT_EVENT, 1);
+    return true;
+}
+
+/**
+ * Gets the latest event of a given type.
+ * @param[in] event The place to store the event.
+ * @param type The type of the event to iterate through.
+ */
+void XlibData::get_latest_event(XEvent &data, int type)
+{
+    while (XCheckTypedEvent(m_display, type, &data));
+}
+
+/**
+ * Adds a new hotkey - this means that the given key (plus the default
+ * modifier) registers an event no matter where it is pressed.
+ *
+ * The key is grabbed once for every combination of the lock modifiers, so
+ * that the hotkey works regardless of which locks are active.
+ *
+ * @param key The key to bind.
+ */
+void XlibData::add_hotkey(KeySym key, bool use_secondary_action)
+{
+    // X grabs on keycodes, not on KeySyms, so we have to do the conversion
+    int keycode = XKeysymToKeycode(m_display, key);
+
+    unsigned int base_mask = primary_mod_flag;
+    if (use_secondary_action)
+        base_mask |= secondary_mod_flag;
+
+    for (std::vector<unsigned int>::iterator lock_mask = m_lock_masks.begin();
+            lock_mask != m_lock_masks.end();
+            lock_mask++)
+    {
+        XGrabKey(m_display, keycode, base_mask | *lock_mask, m_root, true,
+            GrabModeAsync, GrabModeAsync);
+    }
+
+    m_stats.add_requests(SR_ADD_HOTKEY, m_lock_masks.size());
+}
+
+/**
+ * Removes a key binding which was added by add_hotkey.
+ *
+ * @param key The key to unbind.
+ * @param use_secondary_action Whether the binding used the secondary modifier.
+ */
+void XlibData::remove_hotkey(KeySym key, bool use_secondary_action)
+{
+    int keycode = XKeysymToKeycode(m_display, key);
+
+    unsigned int base_mask = primary_mod_flag;
+    if (use_secondary_action)
+        base_mask |= secondary_mod_flag;
+
+    for (std::vector<unsigned int>::iterator lock_mask = m_lock_masks.begin();
+            lock_mask != m_lock_masks.end();
+            lock_mask++)
+    {
+        XUngrabKey(m_display, keycode, base_mask | *lock_mask, m_root);
+    }
+
+    m_stats.add_requests(SR_REMOVE_HOTKEY, m_lock_masks.size());
+}
+
+/**
+ * Binds a mouse button to raise an event globally.
+ * @param button The button to bind.
+ */
+void XlibData::add_hotkey_mouse(unsigned int button)
+{
+    for (std::vector<unsigned int>::iterator lock_mask = m_lock_masks.begin();
+            lock_mask != m_lock_masks.end();
+            lock_mask++)
+    {
+        XGrabButton(m_display, button, primary_mod_flag | *lock_mask,
+                m_root, true, ButtonPressMask | ButtonReleaseMask,
+                GrabModeAsync, GrabModeAsync, None, None);
+    }
+
+    m_stats.add_requests(SR_ADD_HOTKEY_MOUSE, m_lock_masks.size());
+}
+
+/**
+ * Removes a mouse binding which was added by add_hotkey_mouse.
+ * @param button The button to unbind.
+ */
+void XlibData::remove_hotkey_mouse(unsigned int button)
+{
+    for (std::vector<unsigned int>::iterator lock_mask = m_lock_masks.begin();
+            lock_mask != m_lock_masks.end();
+            lock_mask++)
+    {
+        XUngrabButton(m_display, button, primary_mod_flag | *lock_mask, m_root);
+    }
+
+    m_stats.add_requests(SR_REMOVE_HOTKEY_MOUSE, m_lock_masks.size());
+}
+
+/**
+ * Removes every keyboard hotkey, so that they can be grabbed again after the
+ * keyboard mapping changes.
+ */
+void XlibData::clear_hotkeys()
+{
+    XUngrabKey(m_display, AnyKey, AnyModifier, m_root);
+    m_stats.add_requests(SR_CLEAR_HOTKEYS, 1);
+}
+
+/**
+ * Confines a pointer to a window, allowing ButtonPress and ButtonRelease
+ * events from the window.
+ * @param window The window to confine the pointer to.
+ */
+void XlibData::confine_pointer(Window window)
+{
+    if (m_confined == None)
+    {
+        XGrabPointer(m_display, window, false,
+            PointerMotionMask | ButtonReleaseMask,
+            GrabModeAsync, GrabModeAsync,
+            None, None, CurrentTime);
+        m_confined = window;
+        m_stats.add_round_trips(SR_CONFINE_POINTER, 1);
+    }
+}
+
+/**
+ * Stops confining the pointer to the window.
+ * @param winodw The window to release.
+ */
+void XlibData::stop_confining_pointer()
+{
+    if (m_confined != None)
+    {
+        XUngrabPointer(m_display, CurrentTime);
+        m_confined = None;
+        m_stats.add_requests(SR_STOP_CONFINING_POINTER, 1);
+    }
+}
+
+/**
+ * Captures all the mouse clicks going to a window, rather than sending it off
+ * to the application itself.
+ * @param window The window to intercept clicks from.
+ */
+void XlibData::grab_mouse(Window window)
+{
+    XGrabButton(m_display, AnyButton, AnyModifier, window, true,
+            ButtonPressMask | ButtonReleaseMask,
+            GrabModeAsync, GrabModeAsync, None, None);
+    m_stats.add_requests(SR_GRAB_MOUSE, 1);
+}
+
+/**
+ * Stops grabbing the clicks going to a window and lets the application handle
+ * the clicks itself.
+ * @param window The window to stop intercepting clicks from.
+ */
+void XlibData::ungrab_mouse(Window window)
+{
+    XUngrabButton(m_display, AnyButton, AnyModifier, window);
+    m_stats.add_requests(SR_UNGRAB_MOUSE, 1);
+}
+
+/**
+ * Sends every key press and release to the root window (and thus to SmallWM),
+ * until the keyboard is ungrabbed.
+ * @return true if the keyboard was grabbed, false if some other client had it.
+ */
+bool XlibData::grab_keyboard()
+{
+    int status = XGrabKeyboard(m_display, m_root, false,
+            GrabModeAsync, GrabModeAsync, CurrentTime);
+    m_stats.add_round_trips(SR_GRAB_KEYBOARD, 1);
+    return status == GrabSuccess;
+}
+
+/**
+ * Lets the keys go back to the windows that they would normally go to.
+ */
+void XlibData::ungrab_keyboard()
+{
+    XUngrabKeyboard(m_display, CurrentTime);
+    m_stats.add_requests(SR_UNGRAB_KEYBOARD, 1);
+}
+
+/**
+ * Selects the input mask on a given window.
+ * @param window The window to set the mask of.
+ * @param mask The input mask.
+ */
+void XlibData::select_input(Window window, long mask)
+{
+    if (window == m_root)
+        m_old_root_mask = mask;
+
+    // Only change this for real if we're not playing with the mask ourselves
+    if (m_substructure_depth == 0)
+    {
+        XSelectInput(m_display, window, mask);
+        m_stats.add_requests(SR_SELECT_INPUT, 1);
+    }
+}
+
+/**
+ * Gets a list of top-level windows on the display.
+ * @param[out] windows The vector to put the windows into.
+ */
+void XlibData::get_windows(std::vector<Window> &windows)
+{
+    Window _unused1;
+    Window *children;
+    unsigned int nchildren;
+
+    XQueryTree(m_display, m_root, &_unused1, &_unused1,
+        &children, &nchildren);
+    for (int idx = 0; idx < nchildren; idx++)
+    {
+        if (children[idx] != m_root)
+            windows.push_back(children[idx]);
+    }
+
+    XFree(children);
+    m_stats.add_round_trips(SR_GET_WINDOWS, 1);
+}
+
+/**
+ * Gets the absolute location of the pointer.
+ * @param[out] x The X location of the pointer.
+ * @param[out] y The Y location of the pointer.
+ */
+void XlibData::get_pointer_location(Dimension &x, Dimension &y)
+{
+    Window _u1;
+    int _u2;
+    unsigned int _u3;
+    XQueryPointer(m_display, m_root, &_u1, &_u1,
+            &x, &y, &_u2, &_u2, &_u3);
+    m_stats.add_round_trips(SR_GET_POINTER_LOCATION, 1);
+}
+
+/**
+ * Gets the current input focus.
+ * @return The currently focused window.
+ */
+Window XlibData::get_input_focus()
+{
+    Window new_focus;
+    int _unused;
+
+    XGetInputFocus(m_display, &new_focus, &_unused);
+    m_stats.add_round_trips(SR_GET_INPUT_FOCUS, 1);
+    return new_focus;
+}
+
+/**
+ * Sets the input focus,
+ * @param window The window to set the focus of.
+ * @return true if the change succeeded or false otherwise.
+ */
+bool XlibData::set_input_focus(Window window)
+{
+    // If we're unfocusing, then move the focus to the root so that keyboard
+    // shortcuts work
+    if (window == None)
+        window = m_root;
+
+    XSetInputFocus(m_display, window, RevertToNone, CurrentTime);
+    m_stats.add_requests(SR_SET_INPUT_FOCUS, 1);
+    return get_input_focus() == window;
+}
+
+/**
+ * Maps a window onto the screen, causing it to be displayed.
+ * @param window The window to map.
+ */
+void XlibData::map_win(Window window)
+{
+    XMapWindow(m_display, window);
+    m_stats.add_requests(SR_MAP_WIN, 1);
+}
+
+/**
+ * Unmaps a window, causing it to no longer be displayed.
+ * @param window The window to unmap.
+ */
+void XlibData::unmap_win(Window window)
+{
+    // The unmap handler in x-events assumes that the unmap event was 
+    // triggered by the client itself, and not us. To keep that assumption
+    // intact, we can't raise any UnmapNotify events
+    disable_substructure_events();
+    XUnmapWindow(m_display, window);
+    m_stats.add_requests(SR_UNMAP_WIN, 1);
+    enable_substructure_events();
+}
+
+/**
+ * Unmaps several windows at once. Substructure events only have to be turned
+ * off and on again once for all of them, rather than once for each window.
+ * @param windows The windows to unmap.
+ */
+void XlibData::unmap_wins(const std::vector<Window> &windows)
+{
+    if (windows.empty())
+        return;
+
+    disable_substructure_events();
+    for (std::vector<Window>::const_iterator window = windows.begin();
+         window != windows.end();
+         window++)
+        XUnmapWindow(m_display, *window);
+
+    m_stats.add_requests(SR_UNMAP_WIN, windows.size());
+    enable_substructure_events();
+}
+
+/**
+ * Requests a window to close using the WM_DELETE_WINDOW message, as specified
+ * by the ICCCM.
+ * @param window The window to close.
+ */
+void XlibData::request_close(Window window)
+{
+    XEvent close_event;
+    XClientMessageEvent client_close;
+    client_close.type = ClientMessage;
+    client_close.window = window;
+    client_close.message_type = m_known_atoms[ATOM_WM_PROTOCOLS];
+    client_close.format = 32;
+    client_close.data.l[0] = m_known_atoms[ATOM_WM_DELETE_WINDOW];
+    client_close.data.l[1] = CurrentTime;
+
+    close_event.xclient = client_close;
+    XSendEvent(m_display, window, False, NoEventMask, &close_event);
+    m_stats.add_requests(SR_REQUEST_CLOSE, 1);
+}
+
+/**
+ * Destroys a window.
+ * @param window The window to destroy.
+ */
+void XlibData::destroy_win(Window window)
+{
+    XDestroyWindow(m_display, window);
+    m_stats.add_requests(SR_DESTROY_WIN, 1);
+}
+
+/**
+ * Gets the attributes of a window.
+ * @param window The window to get the attributes of.
+ * @param[out] attr The storage for the attributes.
+ */
+void XlibData::get_attributes(Window window, XWindowAttributes &attr)
+{
+    XGetWindowAttributes(m_display, window, &attr);
+
+    // XGetWindowAttributes needs both the window's attributes and its
+    // geometry, and those are two separate requests
+    m_stats.add_round_trips(SR_GET_ATTRIBUTES, 2);
+}
+
+/**
+ * Sets the attributes of a window.
+ * @param window The window to set the attributes of.
+ * @param attr The values to set as the attributes.
+ * @param flag Which attributes are being changed.
+ */
+void XlibData::set_attributes(Window window, XSetWindowAttributes &attr,
+        unsigned long mask)
+{
+    XChangeWindowAttributes(m_display, window, mask, &attr);
+    m_stats.add_requests(SR_SET_ATTRIBUTES, 1);
+}
+
+/**
+ * Checks to see if a window is visible or not.
+ */
+bool XlibData::is_mapped(Window window)
+{
+    XWindowAttributes attrs;
+    get_attributes(window, attrs);
+    return attrs.map_state != IsUnmapped;
+}
+
+/**
+ * Sets the color of the border of a window.
+ * @param window The window whose border to set.
+ * @param color The border color.
+ */
+void XlibData::set_border_color(Window window, MonoColor color)
+{
+    XSetWindowBorder(m_display, window, decode_monocolor(color));
+    m_stats.add_requests(SR_SET_BORDER_COLOR, 1);
+}
+
+/**
+ * Sets the width of the border of a window.
+ * @param window The window whose border to change.
+ * @param size The size of the window's border.
+ */
+void XlibData::set_border_width(Window window, Dimension size)
+{
+    enable_substructure_events();
+    XSetWindowBorderWidth(m_display, window, size);
+    m_stats.add_requests(SR_SET_BORDER_WIDTH, 1);
+    disable_substructure_events();
+}
+
+/**
+ * Moves a window from its current location to the given location.
+ * @param window The window to move.
+ * @param x The X coordinate of the window's new position.
+ * @param y The Y coordinate of the window's new position.
+ */
+void XlibData::move_window(Window window, int x, int y)
+{
+    disable_substructure_events();
+    XMoveWindow(m_display, window, x, y);
+    m_stats.add_requests(SR_MOVE_WINDOW, 1);
+    enable_substructure_events();
+}
+
+/**
+ * Resizes a window from its current size to the given size.
+ * @param window The window to resize.
+ * @param width The width of the window's new size.
+ * @param height The height of the window's new size.
+ */
+void XlibData::resize_window(Window window, Dimension width, Dimension height)
+{
+    disable_substructure_events();
+    XResizeWindow(m_display, window, width, height);
+    m_stats.add_requests(SR_RESIZE_WINDOW, 1);
+    enable_substructure_events();
+}
+
+/**
+ * Moves and resizes a window using a single request.
+ * @param window The window to reconfigure.
+ * @param x The X coordinate of the window's new position.
+ * @param y The Y coordinate of the window's new position.
+ * @param width The width of the window's new size.
+ * @param height The height of the window's new size.
+ */
+void XlibData::move_resize_window(Window window, Dimension x, Dimension y,
+        Dimension width, Dimension height)
+{
+    disable_substructure_events();
+    XMoveResizeWindow(m_display, window, x, y, width, height);
+    m_stats.add_requests(SR_MOVE_RESIZE_WINDOW, 1);
+    enable_substructure_events();
+}
+
+/**
+ * Raises a window to the top of the stack.
+ * @param window The window to raise.
+ */
+void XlibData::raise(Window window)
+{
+    disable_substructure_events();
+    XRaiseWindow(m_display, window);
+    m_stats.add_requests(SR_RAISE, 1);
+    enable_substructure_events();
+}
+
+/**
+ * Stacks a series of windows.
+ * @param windows The windows to stack, in top-to-bottom order.
+ */
+void XlibData::restack(const std::vector<Window> &windows)
+{
+    disable_substructure_events();
+
+    // We have to do some juggling to get a non-const pointer from a const
+    // iteartor
+    Window *win_ptr = const_cast<Window*>(&(*windows.begin()));
+    XRestackWindows(m_display, win_ptr, windows.size());
+
+    // Xlib implements this as one ConfigureWindow per window after the first
+    if (windows.size() > 1)
+        m_stats.add_requests(SR_RESTACK, windows.size() - 1);
+
+    enable_substructure_events();
+}
+
+/**
+ * Draws the outline of a box onto the root window, over the top of all the
+ * other windows. The outline is drawn using XOR, so drawing the same box
+ * again erases it.
+ * @param box The box to draw the outline of.
+ */
+void XlibData::draw_outline(const Box &box)
+{
+    if (!m_outline_gc)
+    {
+        XGCValues values;
+        values.function = GXxor;
+        values.subwindow_mode = IncludeInferiors;
+        values.foreground =
+            BlackPixel(m_display, m_screen) ^ WhitePixel(m_display, m_screen);
+        values.line_width = 2;
+
+        m_outline_gc = XCreateGC(m_display, m_root,
+            GCFunction | GCSubwindowMode | GCForeground | GCLineWidth,
+            &values);
+        m_stats.add_requests(SR_CREATE_GC, 1);
+    }
+
+    XDrawRectangle(m_display, m_root, m_outline_gc,
+                   box.x, box.y, box.width, box.height);
+    m_stats.add_requests(SR_DRAW_OUTLINE, 1);
+}
+
+/**
+ * Gets the XWMHints structure corresponding to the given window.
+ * @param window The window to get the hints for.
+ * @param[out] hints The storage for the hints.
+ * @return True if the window has hints, False otherwise.
+ */
+bool XlibData::get_wm_hints(Window window, XWMHints &hints)
+{
+    XWMHints *returned_hints = XGetWMHints(m_display, window);
+    m_stats.add_round_trips(SR_GET_WM_HINTS, 1);
+
+    // Since we have to get rid of this later, and it is an unnecessary
+    // complication to return it, we'll just copy it and get rid of the
+    // pointer that was returned to us
+    if (returned_hints)
+    {
+        std::memcpy(&hints, returned_hints, sizeof(XWMHints));
+
+        XFree(returned_hints);
+        return true;
+    }
+    else
+        return false;
+}
+
+/***
+ * Gets the XSizeHints structure corresponding to the given window.
+ * @param window The window to get the hints for.
+ * @param[out] hints The storage for the hints.
+ */
+void XlibData::get_size_hints(Window window, XSizeHints &hints)
+{
+    long _u1;
+    XGetWMNormalHints(m_display, window, &hints, &_u1);
+    m_stats.add_round_trips(SR_GET_SIZE_HINTS, 1);
+}
+
+/**
+ * Gets the transient hint for a window - a window which is transient for
+ * another is assumed to be some form of dialog window.
+ * @param window The window to get the hints for.
+ * @return The window that the given window is transient for.
+ */
+Window XlibData::get_transient_hint(Window window)
+{
+    Window transient = None;
+    XGetTransientForHint(m_display, window, &transient);
+    m_stats.add_round_trips(SR_GET_TRANSIENT_HINT, 1);
+    return transient;
+}
+
+/**
+ * Gets the name of a window. Note that a window can have multiple names,
+ * and thus this function tries to pick the most appropriate one for use as
+ * an icon.
+ * @param window The window to get the name of.
+ * @param[out] name The name of the window.
+ */
+void XlibData::get_icon_name(Window window, std::string &name)
+{
+    char *icon_name;
+    XGetIconName(m_display, window, &icon_name);
+    m_stats.add_round_trips(SR_GET_ICON_NAME, 1);
+    if (icon_name)
+    {
+        name.assign(icon_name);
+        XFree(icon_name);
+        return;
+    }
+
+    XFetchName(m_display, window, &icon_name);
+    m_stats.add_round_trips(SR_GET_ICON_NAME, 1);
+
+    if (icon_name)
+    {
+        name.assign(icon_name);
+        XFree(icon_name);
+        return;
+    }
+
+    name.clear();
+}
+
+/**
+ * Gets the window's "class" (an X term, not mine), a text string which is mean
+ * to uniquely identify what application a window is being created by.
+ * @param windwo The window to get the class of.
+ * @param[out] xclass The X class of the window.
+ */
+void XlibData::get_class(Window win, std::string &xclass)
+{
+    XClassHint *hint = XAllocClassHint();
+    XGetClassHint(m_display, win, hint);
+    m_stats.add_round_trips(SR_GET_CLASS, 1);
+
+    if (hint->res_name)
+        XFree(hint->res_name);
+
+
+    if (hint->res_class)
+    {
+        xclass.assign(hint->res_class);
+        XFree(hint->res_class);
+    }
+    else
+        xclass.clear();
+
+    XFree(hint);
+}
+
+/**
+ * Gets the instance (the resource name) from a window's WM_CLASS.
+ * @param win The window to get the instance of.
+ * @param[out] instance The instance of the window.
+ */
+void XlibData::get_instance(Window win, std::string &instance)
+{
+    XClassHint *hint = XAllocClassHint();
+    XGetClassHint(m_display, win, hint);
+    m_stats.add_round_trips(SR_GET_INSTANCE, 1);
+
+    if (hint->res_name)
+    {
+        instance.assign(hint->res_name);
+        XFree(hint->res_name);
+    }
+    else
+        instance.clear();
+
+    if (hint->res_class)
+        XFree(hint->res_class);
+
+    XFree(hint);
+}
+
+/**
+ * Gets the title (WM_NAME) of a window.
+ * @param win The window to get the title of.
+ * @param[out] title The title of the window.
+ */
+void XlibData::get_title(Window win, std::string &title)
+{
+    char *name;
+    XFetchName(m_display, win, &name);
+    m_stats.add_round_trips(SR_GET_TITLE, 1);
+
+    if (name)
+    {
+        title.assign(name);
+        XFree(name);
+    }
+    else
+        title.clear();
+}
+
+/**
+ * Gets the role (WM_WINDOW_ROLE) of a window.
+ * @param win The window to get the role of.
+ * @param[out] role The role of the window.
+ */
+void XlibData::get_role(Window win, std::string &role)
+{
+    XTextProperty text;
+    Status status = XGetTextProperty(m_display, win, &text,
+                                     m_known_atoms[ATOM_WM_WINDOW_ROLE]);
+    m_stats.add_round_trips(SR_GET_ROLE, 1);
+
+    if (status && text.value)
+    {
+        role.assign(reinterpret_cast<char*>(text.value), text.nitems);
+        XFree(text.value);
+    }
+    else
+        role.clear();
+}
+
+/**
+ * Gets the type (_NET_WM_WINDOW_TYPE) of a window. The types defined by EWMH
+ * are given without their prefix, in lowercase ("dialog" instead of
+ * "_NET_WM_WINDOW_TYPE_DIALOG"), and windows without a type are "normal".
+ * @param win The window to get the type of.
+ * @param[out] type The type of the window.
+ */
+void XlibData::get_window_type(Window win, std::string &type)
+{
+    Atom actual_type;
+    int actual_format;
+    unsigned long nitems, bytes_after;
+    unsigned char *data = NULL;
+
+    int status = XGetWindowProperty(m_display, win,
+        m_known_atoms[ATOM_NET_WM_WINDOW_TYPE], 0, 1, false, XA_ATOM,
+        &actual_type, &actual_format, &nitems, &bytes_after, &data);
+    m_stats.add_round_trips(SR_GET_WINDOW_TYPE, 1);
+
+    type = "normal";
+    if (status != Success || !data)
+        return;
+
+    // Windows may list more than one type, most preferred first, but the
+    // first one is the only one that matters here
+    Atom window_type = None;
+    if (nitems > 0 && actual_format == 32)
+        window_type = reinterpret_cast<Atom*>(data)[0];
+    XFree(data);
+
+    if (window_type == None)
+        return;
+
+    const std::string prefix("_NET_WM_WINDOW_TYPE_");
+    for (int atom = ATOM_NET_WM_WINDOW_TYPE_DESKTOP;
+         atom <= ATOM_NET_WM_WINDOW_TYPE_NORMAL;
+         atom++)
+    {
+        if (m_known_atoms[atom] == window_type)
+        {
+            type.assign(ATOM_NAMES[atom] + prefix.size());
+            std::transform(type.begin(), type.end(), type.begin(), ::tolower);
+            return;
+        }
+    }
+
+    // Types that EWMH doesn't define are given by their full name
+    char *name = XGetAtomName(m_display, window_type);
+    m_stats.add_round_trips(SR_GET_WINDOW_TYPE, 1);
+    if (name)
+    {
+        type.assign(name);
+        XFree(name);
+    }
+}
+
+/**
+ * Gets a list of screen boxes, to update the ClientModel.
+ *
+ * This is the result of my crawling through Xrandr.h rather than any attempt
+ * at processing formal documentation. There aren't any good docs, from what
+ * I can find.
+ *
+ * The AwesomeWM codebase was helpful in finding out a few things, though.
+ */
+void XlibData::get_screen_boxes(std::vector<Box> &box)
+{
+    XRRScreenResources *resources = XRRGetScreenResourcesCurrent(m_display, m_root);
+    m_stats.add_round_trips(SR_GET_SCREEN_BOXES, 1 + resources->ncrtc);
+
+    // XRandR stores things called 'CRTCs', which is apparently a funny way of
+    // spelling 'outputs' (like LVDS1 or VGA2). We have to find out what location
+    // the top-left of the window is in, and then test all the CRTCs to figure
+    // out which contains our position.
+    //
+    // It *seems* like there should be a better way, but this is exactly what
+    // awesome does.
+    //
+    // I may decide to do caching on this later, but I'll have to see how slow
+    // it is.
+    for (int crtc_idx = 0; crtc_idx < resources->ncrtc; crtc_idx++)
+    {
+        RRCrtc crtc_id = resources->crtcs[crtc_idx];
+
+        XRRCrtcInfo *crtc = XRRGetCrtcInfo(m_display, resources, crtc_id);
+        if (!crtc || crtc->width == 0 || crtc->height == 0)
+            continue;
+
+        box.push_back(Box(crtc->x, crtc->y, crtc->width, crtc->height));
+        XRRFreeCrtcInfo(crtc);
+    }
+
+    XRRFreeScreenResources(resources);
+}
+
+/**
+ * Converts from a raw keycode into a KeySym, using the cached keyboard
+ * mapping.
+ * @param keycode The raw keycode given by X.
+ * @return The KeySym represented by that keycode.
+ */
+KeySym XlibData::get_keysym(int keycode)
+{
+    // The man pages don't explicitly say if an empty mapping is a
+    // possibility, so protect against it just in case
+    int keycode_base = (keycode - m_min_keycode) * m_keysyms_per_keycode;
+    if (keycode < m_min_keycode || m_keysyms_per_keycode == 0 ||
+            keycode_base >= m_key_map.size())
+        return NoSymbol;
+
+    return m_key_map[keycode_base];
+}
+
+/**
+ * Checks whether a key is bound to the primary modifier, using the keycodes
+ * found when the modifier flags were loaded.
+ * @param keycode The raw keycode given by X.
+ * @return true if the key sets the primary modifier, false otherwise.
+ */
+bool XlibData::is_primary_modifier(int keycode)
+{
+    return std::find(m_primary_keycodes.begin(), m_primary_keycodes.end(),
+                     keycode) != m_primary_keycodes.end();
+}
+
+/**
+ * Updates the cached keyboard mapping (and the modifier flags, which depend
+ * upon it) after the X server sends a MappingNotify.
+ * @param event The MappingNotify event.
+ */
+void XlibData::refresh_keyboard_mapping(XEvent &event)
+{
+    XRefreshKeyboardMapping(&event.xmapping);
+
+    if (event.xmapping.request == MappingKeyboard)
+        load_keyboard_mapping();
+
+    if (event.xmapping.request == MappingKeyboard ||
+            event.xmapping.request == MappingModifier)
+        load_modifier_flags();
+}
+
+/**
+ * Applies a configure request to a child, while (possibly) modifying so that
+ * only part of it applies.
+ */
+void XlibData::forward_configure_request(XEvent &event, unsigned int allowed_flags)
+{
+    XWindowChanges changes;
+    changes.x = event.xconfigurerequest.x;
+    changes.y = event.xconfigurerequest.y;
+    changes.width = event.xconfigurerequest.width;
+    changes.height = event.xconfigurerequest.height;
+    changes.border_width = event.xconfigurerequest.border_width;
+    changes.sibling = event.xconfigurerequest.above;
+    changes.stack_mode = event.xconfigurerequest.detail;
+
+    unsigned int changes_flag = event.xconfigurerequest.value_mask;
+    if (allowed_flags != 0)
+        changes_flag &= allowed_flags;
+
+    XConfigureWindow(m_display, event.xconfigurerequest.window, changes_flag, &changes);
+    m_stats.add_requests(SR_FORWARD_CONFIGURE_REQUEST, 1);
+}
+
+/**
+ * Applies a configure request to a child, while (possibly) modifying so that
+ * only part of it applies.
+ */
+void XlibData::forward_circulate_request(XEvent &event)
+{
+    int direction = 
+        event.xcirculaterequest.place == PlaceOnTop ?
+        RaiseLowest : 
+        LowerHighest;
+    XCirculateSubwindows(m_display, event.xcirculaterequest.window, direction);
+    m_stats.add_requests(SR_FORWARD_CIRCULATE_REQUEST, 1);
+}
+
+/**
+ * Interns all of the atoms that SmallWM knows about, using a single
+ * round-trip.
+ */
+void XlibData::intern_known_atoms()
+{
+    XInternAtoms(m_display, const_cast<char**>(ATOM_NAMES), ATOM_COUNT,
+                 false, m_known_atoms);
+    m_stats.add_round_trips(SR_INTERN_ATOM, 1);
+}
+
+/**
+ * Interns an string, converting it into an atom and caching it. This is only
+ * needed for atoms which aren't in KnownAtom. On
+ * subsequent calls, the cache is used instead of going through Xlib.
+ * @param atom The name of the atom to convert.
+ * @return The converted atom.
+ */
+Atom XlibData::intern_if_needed(const std::string &atom_name)
+{
+    if (m_atoms.count(atom_name) > 0)
+        return m_atoms[atom_name];
+
+    Atom the_atom = XInternAtom(m_display, atom_name.c_str(), false);
+    m_stats.add_round_trips(SR_INTERN_ATOM, 1);
+    m_atoms[atom_name] = the_atom;
+    return the_atom;
+}
+
+/**
+ * Converts a MonoColor into an Xlib color.
+ * @param color The MonoColor to convert from.
+ * @return The equivalent Xlib color.
+ */
+unsigned long XlibData::decode_monocolor(MonoColor color)
+{
+    switch (color)
+    {
+        case X_BLACK:
+            return BlackPixel(m_display, m_screen);
+        case X_WHITE:
+            return WhitePixel(m_display, m_screen);
+    }
+}
+
+/**
+ * Enables substructure events on the root.
+ */
+void XlibData::enable_substructure_events()
+{
+    m_substructure_depth--;
+
+    // Don't re-enable if we're not out of our chain yet
+    if (m_substructure_depth != 0) return;
+
+    // Don't synthesize the flag if it was never there to start with
+    if (m_old_root_mask & SubstructureNotifyMask == 0)
+        return;
+
+    XSelectInput(m_display, m_root, m_old_root_mask | SubstructureNotifyMask);
+    XFlush(m_display);
+    m_stats.add_requests(SR_SUBSTRUCTURE_EVENTS, 1);
+}
+
+/**
+ * Disables substructure events on the root if they were enabled before.
+ */
+void XlibData::disable_substructure_events()
+{
+    m_substructure_depth++;
+
+    // If we're still in the chain, then there's no reason to do this again
+    if (m_substructure_depth != 1)
+        return;
+
+    if (m_old_root_mask & SubstructureNotifyMask == 0)
+        return;
+
+    XSelectInput(m_display, m_root, m_old_root_mask & ~SubstructureNotifyMask);
+    XFlush(m_display);
+    m_stats.add_requests(SR_SUBSTRUCTURE_EVENTS, 1);
+}
@@ -0,0 +1,224 @@
+/** @file */
+#ifndef __SMALLWM_XLIB_DATA__
+#define __SMALLWM_XLIB_DATA__
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <poll.h>
+#include <vector>
+
+#include "common.h"
+#include "logging/logging.h"
+#include "stats.h"
+#include "xdata.h"
+
+class TraceWriter;
+
+/**
+ * A graphics context which draws on a window using Xlib.
+ */
+class XlibGC : public XGC
+{
+public:
+    XlibGC(Display *dpy, Window window, Stats &stats) :
+        m_display(dpy), m_window(window), m_stats(stats)
+    {
+        m_gc = XCreateGC(dpy, window, 0, NULL);
+        m_stats.add_requests(SR_CREATE_GC, 1);
+    };
+
+    ~XlibGC()
+    {
+        XFree(m_gc);
+    };
+
+    void clear();
+    void draw_string(Dimension, Dimension, const std::string&);
+    Dimension2D copy_pixmap(Drawable, Dimension, Dimension);
+
+private:
+    /** The raw X display - this is necessary to have since XData doesn't
+     * expose it. */
+    Display *m_display;
+
+
+    /// The window this graphics context belongs to
+    Window m_window;
+
+    /// The X graphics context this sits above
+    GC m_gc;
+
+    /// Where to count the requests made while drawing
+    Stats &m_stats;
+};
+
+/**
+ * This forms a layer above raw Xlib, which stores the X display, root
+ * window, etc. and provides the most common operations which use these data.
+ */
+class XlibData : public XData
+{
+public:
+    XlibData(Log &logger, Stats &stats, Display *dpy, Window root, int screen) :
+        m_display(dpy), m_logger(logger), m_stats(stats), m_trace(NULL),
+        m_confined(None), m_old_root_mask(NoEventMask), m_substructure_depth(0),
+        m_min_keycode(0), m_keysyms_per_keycode(0), m_outline_gc(0)
+    {
+        m_root = DefaultRootWindow(dpy);
+        m_screen = DefaultScreen(dpy);
+
+        init_xrandr();
+        intern_known_atoms();
+        load_keyboard_mapping();
+        load_modifier_flags();
+    };
+
+    void init_xrandr();
+    void intern_known_atoms();
+    void load_keyboard_mapping();
+    void load_modifier_flags();
+
+    XGC *create_gc(Window);
+    Window create_window(bool);
+
+    Atom get_atom(KnownAtom atom)
+    { return m_known_atoms[atom]; }
+    void change_property(Window, KnownAtom, Atom,
+            const unsigned char*, size_t);
+
+    void next_event(XEvent&);
+    void get_latest_event(XEvent&, int);
+    bool wait_for_event(std::vector<struct pollfd>&);
+
+    void add_hotkey(KeySym, bool);
+    void remove_hotkey(KeySym, bool);
+    void add_hotkey_mouse(unsigned int);
+    void remove_hotkey_mouse(unsigned int);
+    void clear_hotkeys();
+
+    void confine_pointer(Window);
+    void stop_confining_pointer();
+    void grab_mouse(Window);
+    void ungrab_mouse(Window);
+    bool grab_keyboard();
+    void ungrab_keyboard();
+
+    void select_input(Window, long);
+
+    void get_windows(std::vector<Window>&);
+    void get_pointer_location(Dimension&, Dimension&);
+
+    Window get_input_focus();
+    bool set_input_focus(Window);
+
+    void map_win(Window);
+    void unmap_win(Window);
+    void unmap_wins(const std::vector<Window>&);
+    void request_close(Window);
+    void destroy_win(Window);
+
+    void get_attributes(Window, XWindowAttributes&);
+    void set_attributes(Window, XSetWindowAttributes&,
+        unsigned long);
+    bool is_mapped(Window);
+    void set_border_color(Window, MonoColor);
+    void set_border_width(Window, Dimension);
+
+    void move_window(Window, Dimension, Dimension);
+    void resize_window(Window, Dimension, Dimension);
+    void move_resize_window(Window, Dimension, Dimension, Dimension, Dimension);
+    void raise(Window);
+    void restack(const std::vector<Window>&);
+    void draw_outline(const Box&);
+
+    bool get_wm_hints(Window, XWMHints&);
+    void get_size_hints(Window, XSizeHints&);
+    Window get_transient_hint(Window);
+    void get_icon_name(Window, std::string&);
+    void get_class(Window, std::string&);
+    void get_instance(Window, std::string&);
+    void get_title(Window, std::string&);
+    void get_role(Window, std::string&);
+    void get_window_type(Window, std::string&);
+
+    void get_screen_boxes(std::vector<Box>&);
+
+    KeySym get_keysym(int);
+    bool is_primary_modifier(int);
+    void refresh_keyboard_mapping(XEvent&);
+
+    void forward_configure_request(XEvent&, unsigned int);
+    void forward_circulate_request(XEvent&);
+
+    void record_to(TraceWriter*);
+
+private:
+    Atom intern_if_needed(const std::string&);
+    unsigned long decode_monocolor(MonoColor);
+
+    void enable_substructure_events();
+    void disable_substructure_events();
+
+    /**  We save this to ensure that we can re-enable substructure events if they
+     * were enabled before a call to disable_substructure_events.
+     */
+    long m_old_root_mask;
+
+    /// How deep we are inside of a nested group of enable/disable substruture events
+    int m_substructure_depth;
+
+    /// The logging interface
+    Log &m_logger;
+
+    /// Where to count the requests sent to the X server
+    Stats &m_stats;
+
+    /// Where to record the windows created by SmallWM, or NULL
+    TraceWriter *m_trace;
+
+    /// The connection to the X server
+    Display *m_display;
+
+    /// The root window on the display
+    Window m_root;
+
+    /// The default X11 screen
+    int m_screen;
+
+    /// The atoms in KnownAtom, which are all interned at startup
+    Atom m_known_atoms[ATOM_COUNT];
+
+    /** Any other atoms, which are interned the first time they are used and
+     * are accessible via a string */
+    std::map<std::string, Atom> m_atoms;
+
+    /// The window the pointer is confined to, or None
+    Window m_confined;
+
+    /// The lowest keycode that the keyboard mapping covers
+    int m_min_keycode;
+
+    /// How many keysyms each keycode has in the keyboard mapping
+    int m_keysyms_per_keycode;
+
+    /** The keyboard mapping, which is cached so that looking up the keysym
+     * of a key press doesn't need a round-trip */
+    std::vector<KeySym> m_key_map;
+
+    /** Every keycode bound to the primary modifier, so that releasing one of
+     * them can be told apart from releasing any other modifier */
+    std::vector<KeyCode> m_primary_keycodes;
+
+    /** Every combination of the lock modifiers (NumLock, CapsLock and
+     * ScrollLock), which each hotkey has to be grabbed with */
+    std::vector<unsigned int> m_lock_masks;
+
+    /** The GC used to XOR outlines onto the root window, which is created
+     * the first time that an outline is drawn */
+    GC m_outline_gc;
+};
+
+#endif
@@ -100,8 +100,8 @@ SUITE(ClientModelMemberSuite)
         {
             const ChangeClientDesktop *the_change =
                 dynamic_cast<const ChangeClientDesktop*>(change);
-            Desktop *desktop(new UserDesktop(0));
-            CHECK_EQUAL(ChangeClientDesktop(a, 0, desktop), *the_change);
+            Desktop desktop = UserDesktop(0);
+            CHECK_EQUAL(ChangeClientDesktop(a, Desktop(), desktop), *the_change);
         }
         delete change;
 
@@ -150,7 +150,7 @@ SUITE(ClientModelMemberSuite)
         CHECK(change->is_destroy_change());
         {
             const DestroyChange *the_change = dynamic_cast<const DestroyChange*>(change);
-            Desktop *desktop(new UserDesktop(0));
+            Desktop desktop = UserDesktop(0);
             CHECK_EQUAL(DestroyChange(a, desktop, DEF_LAYER), *the_change);
         }
 
@@ -183,8 +183,8 @@ SUITE(ClientModelMemberSuite)
         {
             const ChangeClientDesktop *the_change =
                 dynamic_cast<const ChangeClientDesktop*>(change);
-            Desktop *desktop(new UserDesktop(0));
-            CHECK_EQUAL(ChangeClientDesktop(a, 0, desktop), *the_change);
+            Desktop desktop = UserDesktop(0);
+            CHECK_EQUAL(ChangeClientDesktop(a, Desktop(), desktop), *the_change);
         }
         delete change;
 
@@ -207,7 +207,7 @@ SUITE(ClientModelMemberSuite)
         CHECK(change->is_destroy_change());
         {
             const DestroyChange *the_change = dynamic_cast<const DestroyChange*>(change);
-            Desktop *desktop(new UserDesktop(0));
+            Desktop desktop = UserDesktop(0);
             CHECK_EQUAL(DestroyChange(a, desktop, DEF_LAYER), *the_change);
         }
 
@@ -338,13 +338,33 @@ SUITE(ClientModelMemberSuite)
         CHECK(!model.is_visible_desktop(model.RESIZING_DESKTOP));
     }
 
+    TEST_FIXTURE(ClientModelFixture, test_desktop_ids)
+    {
+        // Desktops are only IDs, so two desktops made separately are equal
+        // if they're of the same kind (and number)
+        CHECK(model.USER_DESKTOPS[3] == UserDesktop(3));
+        CHECK(model.USER_DESKTOPS[3] != UserDesktop(2));
+        CHECK(model.ICON_DESKTOP == IconDesktop());
+        CHECK(model.ICON_DESKTOP != model.MOVING_DESKTOP);
+
+        CHECK_EQUAL(DK_USER, model.USER_DESKTOPS[3].kind());
+        CHECK_EQUAL(3, model.USER_DESKTOPS[3].index());
+        CHECK(!Desktop().is_valid());
+
+        // The virtual desktops come before all the user desktops, which are
+        // in order of their numbers
+        CHECK(Desktop() < model.ALL_DESKTOPS);
+        CHECK(model.RESIZING_DESKTOP < model.USER_DESKTOPS[0]);
+        CHECK(model.USER_DESKTOPS[0] < model.USER_DESKTOPS[1]);
+    }
+
     TEST_FIXTURE(ClientModelFixture, test_finder_functions)
     {
         // Make sure that the `find_*` functions return the correct results
         model.add_client(a, IS_VISIBLE, Dimension2D(1, 1), Dimension2D(1, 1), true);
 
-        const Desktop *desktop_of = model.find_desktop(a);
-        CHECK(*desktop_of == UserDesktop(0));
+        Desktop desktop_of = model.find_desktop(a);
+        CHECK(desktop_of == UserDesktop(0));
         CHECK(model.find_layer(a) == DEF_LAYER);
     }
 
@@ -851,6 +871,39 @@ SUITE(ClientModelMemberSuite)
         CHECK(!changes.has_more());
     }
 
+    TEST_FIXTURE(ClientModelFixture, test_desktop_diff)
+    {
+        // a is only on the first desktop, c is only on the second, and b is
+        // on all of them
+        model.add_client(a, IS_VISIBLE,
+            Dimension2D(1, 1), Dimension2D(1, 1), true);
+        model.add_client(b, IS_VISIBLE,
+            Dimension2D(1, 1), Dimension2D(1, 1), true);
+        model.toggle_stick(b);
+        model.next_desktop();
+        model.add_client(c, IS_VISIBLE,
+            Dimension2D(1, 1), Dimension2D(1, 1), true);
+        changes.flush();
+
+        std::vector<Window> only_old;
+        std::vector<Window> only_new;
+        model.get_desktop_diff(model.USER_DESKTOPS[0], model.USER_DESKTOPS[1],
+                               only_old, only_new);
+
+        CHECK_EQUAL(1, only_old.size());
+        CHECK_EQUAL(a, only_old[0]);
+        CHECK_EQUAL(1, only_new.size());
+        CHECK_EQUAL(c, only_new[0]);
+
+        // Switching to the same desktop doesn't change anything
+        only_old.clear();
+        only_new.clear();
+        model.get_desktop_diff(model.USER_DESKTOPS[1], model.USER_DESKTOPS[1],
+                               only_old, only_new);
+        CHECK(only_old.empty());
+        CHECK(only_new.empty());
+    }
+
     TEST_FIXTURE(ClientModelFixture, test_desktop_change_child_loses_focus)
     {
         model.add_client(a, IS_VISIBLE,
@@ -2339,7 +2392,7 @@ SUITE(ClientModelMemberSuite)
         CHECK(change->is_destroy_change());
         {
             const DestroyChange *the_change = dynamic_cast<const DestroyChange*>(change);
-            Desktop *desktop(new UserDesktop(0));
+            Desktop desktop = UserDesktop(0);
             CHECK_EQUAL(DestroyChange(a, desktop, DEF_LAYER), *the_change);
         }
         delete change;
@@ -2660,6 +2713,125 @@ SUITE(ClientModelMemberSuite)
         CHECK(!changes.has_more());
     }
 
+    TEST_FIXTURE(ClientModelFixture, test_focus_history_preview)
+    {
+        model.add_client(a, IS_VISIBLE, Dimension2D(20, 20), Dimension2D(10, 10), true);
+        model.add_client(b, IS_VISIBLE, Dimension2D(20, 20), Dimension2D(10, 10), true);
+        model.add_client(c, IS_VISIBLE, Dimension2D(20, 20), Dimension2D(10, 10), true);
+        model.focus(a);
+        changes.flush();
+
+        // The history goes a, c, b - previewing walks back through it without
+        // moving the focus
+        model.preview_focus_forward();
+        CHECK_EQUAL(c, model.get_focus_preview());
+        CHECK_EQUAL(a, model.get_focused());
+
+        const Change *change = changes.get_next();
+        CHECK(change != 0);
+        CHECK(change->is_focus_preview_change());
+        {
+            const ChangeFocusPreview *the_change =
+                dynamic_cast<const ChangeFocusPreview*>(change);
+            CHECK_EQUAL(ChangeFocusPreview(None, c), *the_change);
+        }
+        delete change;
+        CHECK(!changes.has_more());
+
+        model.preview_focus_forward();
+        CHECK_EQUAL(b, model.get_focus_preview());
+        changes.flush();
+
+        // Committing focuses the last window previewed, with a single focus
+        // change
+        model.commit_focus_preview();
+        CHECK_EQUAL(None, model.get_focus_preview());
+        CHECK_EQUAL(b, model.get_focused());
+
+        change = changes.get_next();
+        CHECK(change != 0);
+        CHECK(change->is_focus_preview_change());
+        {
+            const ChangeFocusPreview *the_change =
+                dynamic_cast<const ChangeFocusPreview*>(change);
+            CHECK_EQUAL(ChangeFocusPreview(b, None), *the_change);
+        }
+        delete change;
+
+        change = changes.get_next();
+        CHECK(change != 0);
+        CHECK(change->is_focus_change());
+        {
+            const ChangeFocus *the_change =
+                dynamic_cast<const ChangeFocus*>(change);
+            CHECK_EQUAL(ChangeFocus(a, b), *the_change);
+        }
+        delete change;
+        CHECK(!changes.has_more());
+
+        // b is now the most recent, so the next cycle starts with a
+        model.preview_focus_forward();
+        CHECK_EQUAL(a, model.get_focus_preview());
+
+        // Going backward from there wraps around to the oldest window
+        model.preview_focus_backward();
+        model.preview_focus_backward();
+        CHECK_EQUAL(c, model.get_focus_preview());
+
+        // Focusing something directly abandons the cycle
+        model.focus(a);
+        CHECK_EQUAL(None, model.get_focus_preview());
+        CHECK_EQUAL(a, model.get_focused());
+    }
+
+    TEST_FIXTURE(ClientModelFixture, test_focus_history_removed)
+    {
+        model.add_client(a, IS_VISIBLE, Dimension2D(20, 20), Dimension2D(10, 10), true);
+        model.add_client(b, IS_VISIBLE, Dimension2D(20, 20), Dimension2D(10, 10), true);
+        model.add_client(c, IS_VISIBLE, Dimension2D(20, 20), Dimension2D(10, 10), true);
+        changes.flush();
+
+        model.preview_focus_forward();
+        CHECK_EQUAL(b, model.get_focus_preview());
+        changes.flush();
+
+        // Removing the previewed window ends the cycle, without focusing
+        // anything
+        model.remove_client(b);
+        CHECK_EQUAL(None, model.get_focus_preview());
+        CHECK_EQUAL(c, model.get_focused());
+
+        const Change *change = changes.get_next();
+        CHECK(change != 0);
+        CHECK(change->is_focus_preview_change());
+        {
+            const ChangeFocusPreview *the_change =
+                dynamic_cast<const ChangeFocusPreview*>(change);
+            CHECK_EQUAL(ChangeFocusPreview(b, None), *the_change);
+        }
+        delete change;
+        changes.flush();
+
+        // The removed window is skipped by the next cycle, as are windows
+        // which can't be focused - that only leaves the focused window
+        model.iconify(a);
+        changes.flush();
+
+        model.preview_focus_forward();
+        CHECK_EQUAL(c, model.get_focus_preview());
+        changes.flush();
+
+        // Committing it doesn't change the focus
+        model.commit_focus_preview();
+        CHECK_EQUAL(c, model.get_focused());
+
+        change = changes.get_next();
+        CHECK(change != 0);
+        CHECK(change->is_focus_preview_change());
+        delete change;
+        CHECK(!changes.has_more());
+    }
+
     TEST_FIXTURE(ClientModelFixture, test_unmapped_not_in_cycle)
     {
         model.add_client(a, IS_VISIBLE, Dimension2D(20, 20), Dimension2D(10, 10), true);
@@ -2774,6 +2946,128 @@ SUITE(ClientModelMemberSuite)
     }
 }
 
+SUITE(ClientModelRestoreSuite)
+{
+    TEST_FIXTURE(ClientModelFixture, test_restore_round_trip)
+    {
+        model.add_client(a, IS_VISIBLE, Dimension2D(110, 120), Dimension2D(30, 40), true);
+        model.add_child(a, c);
+        model.client_next_desktop(a);
+        model.client_next_desktop(a);
+        model.set_layer(a, 7);
+        model.change_mode(a, CPS_SPLIT_LEFT);
+
+        model.add_client(b, IS_VISIBLE, Dimension2D(20, 20), Dimension2D(10, 10), false);
+        model.toggle_stick(b);
+        model.pack_client(b, PACK_SOUTHWEST, 3);
+        model.iconify(b);
+        model.next_desktop();
+
+        ClientState a_state, b_state;
+        model.get_client_state(a, a_state);
+        model.get_client_state(b, b_state);
+
+        CHECK_EQUAL(2, a_state.desktop);
+        CHECK(!a_state.stuck);
+        CHECK(!a_state.iconified);
+        CHECK_EQUAL(7, a_state.layer);
+        CHECK_EQUAL(CPS_SPLIT_LEFT, a_state.mode);
+        CHECK(a_state.autofocus);
+        CHECK(!a_state.packed);
+        CHECK_EQUAL(1, a_state.children.size());
+
+        CHECK(b_state.stuck);
+        CHECK(b_state.iconified);
+        CHECK(!b_state.autofocus);
+        CHECK(b_state.packed);
+        CHECK_EQUAL(PACK_SOUTHWEST, b_state.pack_corner);
+        CHECK_EQUAL(3, b_state.pack_priority);
+
+        // Putting the clients into a new model should lead to the same state
+        ChangeStream new_changes;
+        ClientModel restored(new_changes, manager, max_desktops, border_width);
+        restored.restore_current_desktop(model.get_current_desktop());
+        restored.restore_client(a_state);
+        restored.restore_client(b_state);
+
+        CHECK_EQUAL(1, restored.get_current_desktop());
+        CHECK_EQUAL(restored.USER_DESKTOPS[2], restored.find_desktop(a));
+        CHECK_EQUAL(restored.ICON_DESKTOP, restored.find_desktop(b));
+        CHECK_EQUAL(a, restored.get_parent_of(c));
+        CHECK_EQUAL(7, restored.find_layer(a));
+        CHECK_EQUAL(CPS_SPLIT_LEFT, restored.get_mode(a));
+        CHECK(restored.get_location(a) == Dimension2D(110, 120));
+        CHECK(restored.get_size(a) == Dimension2D(30, 40));
+        CHECK(restored.get_screen(a) == Box(100, 100, 100, 100));
+        CHECK(restored.is_packed_client(b));
+        CHECK_EQUAL(PACK_SOUTHWEST, restored.get_pack_corner(b));
+
+        // Since b was stuck before it was iconified, it should be stuck again
+        restored.deiconify(b);
+        CHECK_EQUAL(restored.ALL_DESKTOPS, restored.find_desktop(b));
+    }
+
+    TEST_FIXTURE(ClientModelFixture, test_restore_changes)
+    {
+        ClientState state;
+        state.client = a;
+        state.desktop = 3;
+        state.layer = 2;
+        state.location = Dimension2D(20, 20);
+        state.size = Dimension2D(10, 10);
+        state.autofocus = true;
+        state.children.push_back(c);
+
+        model.restore_client(state);
+
+        // Nothing is focused, and only the desktop, layer and child are
+        // reported
+        const Change *change = changes.get_next();
+        CHECK(change != 0);
+        CHECK(change->is_client_desktop_change());
+        {
+            const ChangeClientDesktop *the_change =
+                dynamic_cast<const ChangeClientDesktop*>(change);
+            CHECK_EQUAL(ChangeClientDesktop(a, Desktop(), model.USER_DESKTOPS[3]),
+                        *the_change);
+        }
+        delete change;
+
+        change = changes.get_next();
+        CHECK(change != 0);
+        CHECK(change->is_layer_change());
+        {
+            const ChangeLayer *the_change =
+                dynamic_cast<const ChangeLayer*>(change);
+            CHECK_EQUAL(ChangeLayer(a, 2), *the_change);
+        }
+        delete change;
+
+        change = changes.get_next();
+        CHECK(change != 0);
+        CHECK(change->is_child_add_change());
+        delete change;
+
+        CHECK(!changes.has_more());
+        CHECK_EQUAL(None, model.get_focused());
+
+        // The client is in the focus cycle of its desktop, followed by its
+        // child
+        model.restore_current_desktop(3);
+        changes.flush();
+
+        model.cycle_focus_forward();
+        CHECK_EQUAL(a, model.get_focused());
+        model.cycle_focus_forward();
+        CHECK_EQUAL(c, model.get_focused());
+
+        // Restoring a client which already exists does nothing
+        changes.flush();
+        model.restore_client(state);
+        CHECK(!changes.has_more());
+    }
+}
+
 int main()
 {
     return UnitTest::RunAllTests();
@@ -0,0 +1,106 @@
+#include <poll.h>
+
+#include <UnitTest++.h>
+#include "config-reloader.h"
+
+/**
+ * A reloader which doesn't read any files, and instead gives out
+ * configurations which count how many times they have been parsed.
+ */
+class CountingReloader : public ConfigReloader
+{
+public:
+    CountingReloader() :
+        parses(0)
+    {}
+
+    /// How many times parse() has been called
+    int parses;
+
+protected:
+    WMConfig *parse()
+    {
+        parses++;
+
+        WMConfig *config = new WMConfig();
+        config->num_desktops = parses;
+        return config;
+    }
+};
+
+/**
+ * Waits for the reloader to wake up the event loop, and then gives back what
+ * it read (or NULL if it didn't finish in time).
+ */
+WMConfig *wait_for_config(ConfigReloader &reloader)
+{
+    for (int attempt = 0; attempt < 50; attempt++)
+    {
+        struct pollfd wakeup;
+        wakeup.fd = reloader.wakeup_fd();
+        wakeup.events = POLLIN;
+        poll(&wakeup, 1, 100);
+
+        WMConfig *config = reloader.poll();
+        if (config)
+            return config;
+    }
+
+    return NULL;
+}
+
+SUITE(ConfigReloaderSuite)
+{
+    TEST(test_no_request)
+    {
+        CountingReloader reloader;
+        CHECK_EQUAL(static_cast<WMConfig*>(NULL), reloader.poll());
+        CHECK_EQUAL(0, reloader.parses);
+    }
+
+    TEST(test_reload)
+    {
+        CountingReloader reloader;
+        reloader.request();
+
+        WMConfig *config = wait_for_config(reloader);
+        CHECK(config != NULL);
+        if (config)
+            CHECK_EQUAL(1, config->num_desktops);
+        delete config;
+
+        // Nothing else was asked for, so nothing else is read
+        CHECK_EQUAL(static_cast<WMConfig*>(NULL), reloader.poll());
+        CHECK_EQUAL(1, reloader.parses);
+    }
+
+    TEST(test_requests_are_merged)
+    {
+        CountingReloader reloader;
+        reloader.request();
+        CHECK_EQUAL(static_cast<WMConfig*>(NULL), reloader.poll());
+
+        // These come in while the first reload is running, so they are
+        // handled by a single reload once it is done
+        reloader.request();
+        reloader.request();
+
+        WMConfig *config = wait_for_config(reloader);
+        CHECK(config != NULL);
+        delete config;
+
+        config = wait_for_config(reloader);
+        CHECK(config != NULL);
+        if (config)
+            CHECK_EQUAL(2, config->num_desktops);
+        delete config;
+
+        CHECK_EQUAL(static_cast<WMConfig*>(NULL), reloader.poll());
+        CHECK_EQUAL(2, reloader.parses);
+    }
+}
+
+int main()
+{
+    return UnitTest::RunAllTests();
+}
@@ -10,6 +10,7 @@
 
 #include <UnitTest++.h>
 #include "actions.h"
+#include "config-cache.h"
 #include "configparse.h"
 
 std::string *config_path = static_cast<std::string*>(0);
@@ -387,6 +388,58 @@ SUITE(WMConfigSuitePlainOptions)
 
         CHECK_EQUAL(std::string("/dev/null"), config.dump_file);
     }
+
+    TEST(test_default_trace_file)
+    {
+        // Ensure that tracing is disabled by default
+        write_config_file(*config_path, "\n");
+        config.load();
+
+        CHECK_EQUAL(std::string(""), config.trace_file);
+    }
+
+    TEST(test_trace_file)
+    {
+        write_config_file(*config_path,
+                          "[smallwm]\ntrace-file=/tmp/smallwm.trace\n");
+        config.load();
+
+        CHECK_EQUAL(std::string("/tmp/smallwm.trace"), config.trace_file);
+    }
+
+    TEST(test_default_control_socket)
+    {
+        // Ensure that the control socket is disabled by default
+        write_config_file(*config_path, "\n");
+        config.load();
+
+        CHECK_EQUAL(std::string(""), config.control_socket);
+    }
+
+    TEST(test_control_socket)
+    {
+        write_config_file(*config_path,
+                          "[smallwm]\ncontrol-socket=/tmp/smallwm.sock\n");
+        config.load();
+
+        CHECK_EQUAL(std::string("/tmp/smallwm.sock"), config.control_socket);
+    }
+
+    TEST(test_default_launch_helper)
+    {
+        write_config_file(*config_path, "\n");
+        config.load();
+
+        CHECK(!config.launch_helper);
+    }
+
+    TEST(test_launch_helper)
+    {
+        write_config_file(*config_path, "[smallwm]\nlaunch-helper=1\n");
+        config.load();
+
+        CHECK(config.launch_helper);
+    }
 };
 
 SUITE(WMConfigSuiteActions)
@@ -398,7 +451,7 @@ SUITE(WMConfigSuiteActions)
         config.load();
 
         CHECK_EQUAL(0, config.classactions.size());
-        CHECK_EQUAL(0, config.no_autofocus.size());
+        CHECK_EQUAL(0, config.rules.size());
     }
 
     TEST(test_default_actions)
@@ -418,8 +471,7 @@ SUITE(WMConfigSuiteActions)
         CHECK_EQUAL(0, action.actions & ACT_MOVE_X);
         CHECK_EQUAL(0, action.actions & ACT_MOVE_Y);
         CHECK_EQUAL(0, action.actions & ACT_PACK);
-
-        CHECK_EQUAL(0, config.no_autofocus.size());
+        CHECK_EQUAL(0, action.actions & ACT_NOFOCUS);
     }
 
     TEST(test_invalid_actions)
@@ -729,9 +781,7 @@ SUITE(WMConfigSuiteActions)
 
         ClassActions &action = config.classactions[
             std::string("test-class")];
-
-        CHECK_EQUAL(1, config.no_autofocus.size());
-        CHECK_EQUAL(std::string("test-class"), config.no_autofocus[0]);
+        CHECK(action.actions & ACT_NOFOCUS);
     }
 
     TEST(test_pack_nw_no_priority)
@@ -979,6 +1029,61 @@ SUITE(WMConfigSuiteActions)
         CHECK_EQUAL(config.hotkey, HK_MOUSE);
     }
 
+    TEST(test_drag_mode_default)
+    {
+        write_config_file(*config_path, "\n");
+        config.load();
+
+        CHECK_EQUAL(config.drag_mode, DRAG_PLACEHOLDER);
+        CHECK_EQUAL(config.drag_refresh_rate, 60);
+    }
+
+    TEST(test_drag_mode_outline)
+    {
+        write_config_file(*config_path,
+            "[smallwm]\ndrag-mode=outline\n");
+        config.load();
+
+        CHECK_EQUAL(config.drag_mode, DRAG_OUTLINE);
+    }
+
+    TEST(test_drag_mode_opaque)
+    {
+        write_config_file(*config_path,
+            "[smallwm]\ndrag-mode=opaque\ndrag-refresh-rate=144\n");
+        config.load();
+
+        CHECK_EQUAL(config.drag_mode, DRAG_OPAQUE);
+        CHECK_EQUAL(config.drag_refresh_rate, 144);
+    }
+
+    TEST(test_invalid_drag_mode)
+    {
+        write_config_file(*config_path,
+            "[smallwm]\ndrag-mode=blargh\ndrag-refresh-rate=0\n");
+        config.load();
+
+        CHECK_EQUAL(config.drag_mode, DRAG_PLACEHOLDER);
+        CHECK_EQUAL(config.drag_refresh_rate, 60);
+    }
+
+    TEST(test_cycle_mode)
+    {
+        write_config_file(*config_path, "\n");
+        config.load();
+        CHECK_EQUAL(config.cycle_mode, CYCLE_ORDER);
+
+        write_config_file(*config_path,
+            "[smallwm]\ncycle-mode=recent\n");
+        config.load();
+        CHECK_EQUAL(config.cycle_mode, CYCLE_RECENT);
+
+        write_config_file(*config_path,
+            "[smallwm]\ncycle-mode=blargh\n");
+        config.load();
+        CHECK_EQUAL(config.cycle_mode, CYCLE_ORDER);
+    }
+
     TEST(test_combiations)
     {
         // Test a few combinations of different comma-separated options
@@ -1020,6 +1125,68 @@ SUITE(WMConfigSuiteActions)
     }
 };
 
+SUITE(WMConfigSuiteRules)
+{
+    TEST(test_rule)
+    {
+        write_config_file(*config_path,
+            "[rules]\nbrowser= class:Fire* role:browser -> maximize, layer:7\n");
+        config.load();
+
+        CHECK_EQUAL(1, config.window_rules.size());
+        WindowRule &rule = config.window_rules[0];
+
+        CHECK_EQUAL(2, rule.patterns.size());
+        CHECK_EQUAL(RF_CLASS, rule.patterns[0].first);
+        CHECK_EQUAL(std::string("Fire*"), rule.patterns[0].second);
+        CHECK_EQUAL(RF_ROLE, rule.patterns[1].first);
+        CHECK_EQUAL(std::string("browser"), rule.patterns[1].second);
+
+        CHECK(rule.actions.actions & ACT_MAXIMIZE);
+        CHECK(rule.actions.actions & ACT_SETLAYER);
+        CHECK_EQUAL(7, rule.actions.layer);
+    }
+
+    TEST(test_invalid_rules)
+    {
+        // Rules need an arrow, at least one pattern, and only known fields
+        write_config_file(*config_path,
+            "[rules]\n"
+            "no-arrow= class:a maximize\n"
+            "no-pattern= -> maximize\n"
+            "bad-field= color:blue -> maximize\n"
+            "bad-pattern= class -> maximize\n");
+        config.load();
+
+        CHECK_EQUAL(0, config.window_rules.size());
+        CHECK_EQUAL(0, config.rules.size());
+    }
+
+    TEST(test_rules_include_actions)
+    {
+        // The [actions] come before the [rules], so that rules can override
+        // them
+        write_config_file(*config_path,
+            "[actions]\nterm=layer:2, nofocus\n"
+            "[rules]\nbig-term= class:term title:*big* -> layer:8\n");
+        config.load();
+
+        CHECK_EQUAL(2, config.rules.size());
+        CHECK(config.rules.uses(RF_CLASS));
+        CHECK(config.rules.uses(RF_TITLE));
+        CHECK(!config.rules.uses(RF_ROLE));
+
+        WindowProperties props;
+        props.values[RF_CLASS] = "term";
+        props.values[RF_TITLE] = "a big window";
+
+        ClassActions action;
+        CHECK(config.rules.match(props, action));
+        CHECK(action.actions & ACT_NOFOCUS);
+        CHECK_EQUAL(8, action.layer);
+    }
+};
+
 struct DefaultBinding
 {
     KeyboardAction action;
@@ -1059,6 +1226,7 @@ DefaultBinding shortcuts[] = {
     { LAYER_8, XK_8, false },
     { LAYER_9, XK_9, false },
     { EXIT_WM, XK_Escape, false },
+    { RESTART_WM, XK_Escape, true },
 };
 
 // Note that all the key bindings tested here used "layer-1" through
@@ -1134,8 +1302,114 @@ SUITE(WMConfigSuiteKeyboardOptions)
         CHECK_EQUAL(LAYER_1,
             config.key_commands.binding_to_action[layer_1_binding]);
     }
+
+    TEST(test_launch_bindings)
+    {
+        write_config_file(*config_path,
+            "[launch]\nt=xterm -e top\n!f=firefox\nnot-a-key=xclock\n"
+            "g=\n");
+        config.load();
+
+        std::map<KeyBinding, std::string> &launch =
+            config.key_commands.launch_bindings;
+        CHECK_EQUAL(2, launch.size());
+        CHECK_EQUAL(std::string("xterm -e top"),
+                    launch[KeyBinding(XK_t, false)]);
+        CHECK_EQUAL(std::string("firefox"), launch[KeyBinding(XK_f, true)]);
+    }
 };
 
+SUITE(WMConfigSuiteCache)
+{
+    /**
+     * Gets the ConfigSource for the current configuration file.
+     */
+    ConfigSource current_source()
+    {
+        ConfigSource source;
+        FILE *config_file = std::fopen(config_path->c_str(), "r");
+        source.read(config_file);
+        std::fclose(config_file);
+        return source;
+    }
+
+    TEST(test_cache_round_trip)
+    {
+        write_config_file(*config_path,
+            "[smallwm]\nshell=cached-terminal\nborder-width=7\n"
+            "cycle-mode=recent\n"
+            "[actions]\nxterm=stick,pack:SE3\n"
+            "[rules]\ndialogs=type:dialog title:*Save* -> layer:8,nofocus\n"
+            "[keyboard]\nlayer-1=!h\n"
+            "[launch]\n!t=xterm -e top\n");
+        config.load();
+
+        // The second load comes from the cache, and has to be the same as
+        // the first
+        std::string cache_path = *config_path + ".cache";
+        std::ifstream cache(cache_path.c_str());
+        CHECK(static_cast<bool>(cache));
+        cache.close();
+
+        config.load();
+        CHECK_EQUAL(std::string("cached-terminal"), config.shell);
+        CHECK_EQUAL(7, config.border_width);
+        CHECK_EQUAL(CYCLE_RECENT, config.cycle_mode);
+
+        CHECK_EQUAL(ACT_STICK | ACT_PACK, config.classactions["xterm"].actions);
+        CHECK_EQUAL(PACK_SOUTHEAST, config.classactions["xterm"].pack_corner);
+        CHECK_EQUAL(3, config.classactions["xterm"].pack_priority);
+
+        CHECK_EQUAL(1, config.window_rules.size());
+        CHECK_EQUAL(2, config.window_rules[0].patterns.size());
+        CHECK_EQUAL(std::string("*Save*"),
+                    config.window_rules[0].patterns[1].second);
+        CHECK_EQUAL(8, config.window_rules[0].actions.layer);
+        CHECK_EQUAL(2, config.rules.size());
+
+        KeyBinding layer_1_binding(XK_h, true);
+        CHECK_EQUAL(layer_1_binding,
+            config.key_commands.action_to_binding[LAYER_1]);
+        CHECK_EQUAL(LAYER_1,
+            config.key_commands.binding_to_action[layer_1_binding]);
+
+        CHECK_EQUAL(1, config.key_commands.launch_bindings.size());
+        CHECK_EQUAL(std::string("xterm -e top"),
+            config.key_commands.launch_bindings[KeyBinding(XK_t, true)]);
+    }
+
+    TEST(test_cache_is_used)
+    {
+        write_config_file(*config_path, "[smallwm]\nshell=parsed\n");
+
+        // If the cache matches the file, then the file isn't parsed at all
+        WMConfig cached;
+        cached.shell = "from-cache";
+        ConfigCacheWriter writer;
+        CHECK(writer.write(*config_path + ".cache", current_source(), cached));
+
+        config.load();
+        CHECK_EQUAL(std::string("from-cache"), config.shell);
+
+        // Changing the file, even without changing its size, makes the cache
+        // stale
+        write_config_file(*config_path, "[smallwm]\nshell=PARSED\n");
+        config.load();
+        CHECK_EQUAL(std::string("PARSED"), config.shell);
+    }
+
+    TEST(test_bad_cache)
+    {
+        write_config_file(*config_path, "[smallwm]\nshell=parsed\n");
+
+        std::string cache_path = *config_path + ".cache";
+        write_config_file(cache_path, "SWMCACHE garbage");
+
+        config.load();
+        CHECK_EQUAL(std::string("parsed"), config.shell);
+    }
+}
+
 int main()
 {
     char *filename = tempnam("/tmp", "smallwm");
@@ -1144,4 +1418,5 @@ int main()
 
     UnitTest::RunAllTests();
     remove(config_path->c_str());
+    remove((*config_path + ".cache").c_str());
 }
@@ -0,0 +1,392 @@
+#include <cstring>
+#include <poll.h>
+#include <sstream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <UnitTest++.h>
+#include "clientmodel-events.h"
+#include "configparse.h"
+#include "control.h"
+#include "deferred-work.h"
+#include "event-stream.h"
+#include "ewmh.h"
+#include "fake/fake-launcher.h"
+#include "fake/fake-xdata.h"
+#include "grab-manager.h"
+#include "logging/logging.h"
+#include "logging/stream.h"
+#include "mirrored-xdata.h"
+#include "model/changes.h"
+#include "model/client-model.h"
+#include "model/screen.h"
+#include "model/x-model.h"
+#include "stats.h"
+#include "trace.h"
+#include "x-events.h"
+
+const char *socket_path = "/tmp/smallwm-test-control";
+
+/**
+ * Runs the whole window manager on top of the fake X server, along with a
+ * control server which drives it.
+ */
+struct ControlFixture
+{
+    ControlFixture() :
+        logger(log_output), xdata(stats),
+        clients(changes, crt_manager, config.num_desktops, config.border_width),
+        trace(xdata), mirrored_xdata(xdata, xmodel, stats),
+        grabs(mirrored_xdata),
+        ewmh(mirrored_xdata, clients, FAKE_ROOT, config.num_desktops),
+        x_events(config, stats, trace, mirrored_xdata, grabs, work, launcher,
+                 clients, xmodel),
+        client_events(config, logger, stats, changes, mirrored_xdata, grabs,
+                      work, ewmh, events, clients, xmodel),
+        control(config, x_events, clients, crt_manager, events)
+    {
+        xdata.select_input(FAKE_ROOT,
+                           PointerMotionMask |
+                           StructureNotifyMask |
+                           SubstructureNotifyMask |
+                           SubstructureRedirectMask);
+
+        std::vector<Box> screens;
+        xdata.get_screen_boxes(screens);
+        crt_manager.rebuild_graph(screens);
+    };
+
+    /**
+     * Handles events until the fake server has nothing left to send.
+     */
+    void run()
+    {
+        client_events.handle_queued_changes();
+        while (xdata.has_events() || !work.empty())
+        {
+            if (xdata.has_events())
+                x_events.step();
+            client_events.handle_queued_changes();
+        }
+    }
+
+    /**
+     * Creates and maps a new client, and lets SmallWM handle it.
+     */
+    Window new_client()
+    {
+        FakeWindow desc;
+        desc.x = 100;
+        desc.y = 100;
+        desc.width = 300;
+        desc.height = 200;
+
+        Window client = xdata.create_client(desc);
+        xdata.client_map(client);
+        run();
+        return client;
+    }
+
+    /**
+     * Runs a request, and returns all of its responses.
+     */
+    std::string execute(const std::string &request)
+    {
+        std::string output;
+        control.execute(-1, request, output);
+        run();
+        return output;
+    }
+
+    /**
+     * Polls the control server once, without blocking.
+     */
+    void poll_control()
+    {
+        std::vector<struct pollfd> fds;
+        control.get_poll_fds(fds);
+        poll(&fds[0], fds.size(), 100);
+        control.handle(fds);
+    }
+
+    /**
+     * Runs one pass of the event loop, in the same way as smallwm.cpp - this
+     * only blocks if there are no X events queued.
+     */
+    void run_loop_once()
+    {
+        std::vector<struct pollfd> fds;
+        control.get_poll_fds(fds);
+
+        if (xdata.wait_for_event(fds))
+            x_events.step();
+
+        control.handle(fds);
+        client_events.handle_queued_changes();
+    }
+
+    /**
+     * Connects to the control server, which has to be open.
+     */
+    int connect_control()
+    {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        struct sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        std::strcpy(address.sun_path, socket_path);
+        connect(fd, reinterpret_cast<struct sockaddr*>(&address),
+                sizeof(address));
+
+        poll_control();
+        return fd;
+    }
+
+    /**
+     * Sends a request over a connection, and lets the control server run it.
+     */
+    void send_request(int fd, const std::string &request)
+    {
+        send(fd, request.data(), request.size(), 0);
+        poll_control();
+    }
+
+    /**
+     * Reads whatever the control server has sent, without waiting for more.
+     */
+    std::string receive(int fd)
+    {
+        std::string output;
+        char buffer[4096];
+        ssize_t count;
+        while ((count = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT)) > 0)
+            output.append(buffer, count);
+
+        return output;
+    }
+
+    std::stringstream log_output;
+    StreamLog logger;
+    WMConfig config;
+    Stats stats;
+    FakeXData xdata;
+    CrtManager crt_manager;
+    ChangeStream changes;
+    ClientModel clients;
+    XModel xmodel;
+    TraceWriter trace;
+    MirroredXData mirrored_xdata;
+    GrabManager grabs;
+    DeferredWork work;
+    FakeLauncher launcher;
+    EwmhPublisher ewmh;
+    EventStream events;
+    XEvents x_events;
+    ClientModelEvents client_events;
+    ControlServer control;
+};
+
+SUITE(ControlSuite)
+{
+    TEST_FIXTURE(ControlFixture, test_queries)
+    {
+        Window first = new_client();
+        Window second = new_client();
+
+        std::stringstream expected;
+        expected << "ok " << second << "\n" <<
+            "ok {\"current\":0,\"count\":" << config.num_desktops << "}\n" <<
+            "ok [" << first << "," << second << "]\n";
+        CHECK_EQUAL(expected.str(), execute("focused; desktops;clients"));
+
+        std::string client = execute("client");
+        std::stringstream client_start;
+        client_start << "ok {\"window\":" << second << ",\"desktop\":0,";
+        CHECK_EQUAL(0, client.find(client_start.str()));
+        CHECK(client.find("\"x\":100,\"y\":100,\"width\":300,\"height\":200")
+              != std::string::npos);
+
+        CHECK_EQUAL(std::string("ok [{\"x\":0,\"y\":0,\"width\":1024,"
+                                "\"height\":768}]\n"),
+                    execute("screens"));
+    }
+
+    TEST_FIXTURE(ControlFixture, test_actions)
+    {
+        Window first = new_client();
+        Window second = new_client();
+
+        // Without a window, actions apply to the focused window
+        CHECK_EQUAL(std::string("ok\n"), execute("iconify"));
+        CHECK(clients.find_desktop(second).is_icon_desktop());
+
+        std::stringstream request;
+        request << "layer-3 " << first << "; snap-left 0x" << std::hex <<
+            first << "; next-desktop";
+        CHECK_EQUAL(std::string("ok\nok\nok\n"), execute(request.str()));
+
+        CHECK_EQUAL(3, clients.find_layer(first));
+        CHECK_EQUAL(CPS_SPLIT_LEFT, clients.get_mode(first));
+        CHECK_EQUAL(1, clients.get_current_desktop());
+        CHECK(!xdata.find_window(first)->mapped);
+    }
+
+    TEST_FIXTURE(ControlFixture, test_errors)
+    {
+        Window client = new_client();
+
+        CHECK_EQUAL(std::string("error unknown command 'frobnicate'\n"),
+                    execute("frobnicate"));
+        CHECK_EQUAL(std::string("error invalid window 'nope'\n"),
+                    execute("maximize nope"));
+        CHECK_EQUAL(std::string("error not a client\n"),
+                    execute("maximize 12345"));
+        CHECK_EQUAL(std::string("error too many arguments to 'maximize'\n"),
+                    execute("maximize 1 2"));
+
+        // A bad command doesn't stop the rest of the batch
+        CHECK_EQUAL(std::string("error not a client\nok\n"),
+                    execute("client 12345;maximize"));
+        CHECK_EQUAL(CPS_MAX, clients.get_mode(client));
+
+        // Actions which don't apply to a window work without any clients
+        execute("iconify");
+        CHECK_EQUAL(std::string("ok null\nerror not a client\nok\n"),
+                    execute("focused;maximize;next-desktop"));
+    }
+
+    TEST_FIXTURE(ControlFixture, test_exit)
+    {
+        CHECK(!x_events.is_done());
+        CHECK_EQUAL(std::string("ok\n"), execute("exit"));
+        CHECK(x_events.is_done());
+        CHECK(!x_events.should_restart());
+    }
+
+    TEST_FIXTURE(ControlFixture, test_socket)
+    {
+        Window client = new_client();
+        CHECK(control.open(socket_path));
+
+        int fd = connect_control();
+
+        // Requests can be split across reads, and aren't run until the
+        // newline arrives
+        send_request(fd, "focu");
+        send_request(fd, "sed\nclients\n");
+
+        std::stringstream expected;
+        expected << "ok " << client << "\nok [" << client << "]\n";
+        CHECK_EQUAL(expected.str(), receive(fd));
+
+        // Once the other end is done sending, the connection is closed
+        shutdown(fd, SHUT_WR);
+        poll_control();
+
+        char buffer[256];
+        CHECK_EQUAL(0, recv(fd, buffer, sizeof(buffer), 0));
+        close(fd);
+
+        control.close();
+        CHECK_EQUAL(-1, access(socket_path, F_OK));
+    }
+
+    TEST_FIXTURE(ControlFixture, test_socket_while_events_queued)
+    {
+        Window client = new_client();
+        CHECK(control.open(socket_path));
+        int fd = connect_control();
+
+        // A client which keeps the X server busy can't hold up requests -
+        // they're answered in the same pass as the next X event
+        for (int offset = 0; offset < 10; offset++)
+            xdata.client_configure(client, 100 + offset, 100, 300, 200);
+
+        std::string request = "focused\n";
+        send(fd, request.data(), request.size(), 0);
+        run_loop_once();
+
+        std::stringstream expected;
+        expected << "ok " << client << "\n";
+        CHECK_EQUAL(expected.str(), receive(fd));
+        CHECK(xdata.has_events());
+
+        close(fd);
+        control.close();
+    }
+
+    TEST_FIXTURE(ControlFixture, test_subscribe)
+    {
+        Window first = new_client();
+        CHECK(control.open(socket_path));
+
+        int subscriber = connect_control();
+        send_request(subscriber, "subscribe focus,layer\n");
+        CHECK_EQUAL(std::string("ok\n"), receive(subscriber));
+
+        std::stringstream request;
+        request << "layer-9 " << first << "\n";
+        send_request(subscriber, request.str());
+        run();
+
+        Window second = new_client();
+
+        // The events are sent when the connection is next writable
+        poll_control();
+
+        // New clients are put onto the default layer, which is an event
+        // of its own
+        std::stringstream expected;
+        expected << "ok\n" <<
+            "event layer " << first << " 9\n" <<
+            "event layer " << second << " 5\n" <<
+            "event focus " << second << "\n";
+        CHECK_EQUAL(expected.str(), receive(subscriber));
+
+        CHECK_EQUAL(std::string("error invalid events 'bogus'\n"),
+                    execute("subscribe bogus"));
+
+        send_request(subscriber, "unsubscribe\n");
+        CHECK_EQUAL(std::string("ok\n"), receive(subscriber));
+
+        execute("cycle-focus");
+        poll_control();
+        CHECK_EQUAL(std::string(""), receive(subscriber));
+
+        close(subscriber);
+    }
+
+    TEST_FIXTURE(ControlFixture, test_subscribe_while_events_queued)
+    {
+        Window first = new_client();
+        Window second = new_client();
+        CHECK(control.open(socket_path));
+
+        int subscriber = connect_control();
+        send_request(subscriber, "subscribe focus\n");
+        CHECK_EQUAL(std::string("ok\n"), receive(subscriber));
+
+        // A subscriber keeps getting events while the X server is busy,
+        // rather than falling behind until it goes quiet
+        execute("cycle-focus");
+        for (int offset = 0; offset < 10; offset++)
+            xdata.client_configure(second, 100 + offset, 100, 300, 200);
+
+        run_loop_once();
+
+        std::stringstream expected;
+        expected << "event focus " << first << "\n";
+        CHECK_EQUAL(expected.str(), receive(subscriber));
+        CHECK(xdata.has_events());
+
+        close(subscriber);
+        control.close();
+    }
+}
+
+int main()
+{
+    return UnitTest::RunAllTests();
+}
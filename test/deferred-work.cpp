@@ -0,0 +1,111 @@
+#include <UnitTest++.h>
+#include "deferred-work.h"
+
+struct DeferredWorkFixture
+{
+    DeferredWork work;
+};
+
+SUITE(DeferredWorkSuite)
+{
+    TEST_FIXTURE(DeferredWorkFixture, test_empty)
+    {
+        DeferredTask task;
+        CHECK(work.empty());
+        CHECK(!work.pop(task));
+    }
+
+    TEST_FIXTURE(DeferredWorkFixture, test_duplicates_run_once)
+    {
+        work.schedule(DEFER_RELAYER);
+        work.schedule(DEFER_RELAYER);
+        work.schedule(DEFER_RELAYER);
+        CHECK(work.is_scheduled(DEFER_RELAYER));
+
+        DeferredTask task;
+        CHECK(work.pop(task));
+        CHECK_EQUAL(DEFER_RELAYER, task.type);
+        CHECK(!work.pop(task));
+        CHECK(!work.is_scheduled(DEFER_RELAYER));
+    }
+
+    TEST_FIXTURE(DeferredWorkFixture, test_arguments_are_distinct)
+    {
+        work.schedule(DEFER_REPACK_CORNER, PACK_NORTHWEST);
+        work.schedule(DEFER_REPACK_CORNER, PACK_SOUTHEAST);
+        work.schedule(DEFER_REPACK_CORNER, PACK_NORTHWEST);
+
+        CHECK(work.is_scheduled(DEFER_REPACK_CORNER, PACK_NORTHWEST));
+        CHECK(work.is_scheduled(DEFER_REPACK_CORNER, PACK_SOUTHEAST));
+        CHECK(!work.is_scheduled(DEFER_REPACK_CORNER, PACK_SOUTHWEST));
+
+        DeferredTask task;
+        int count = 0;
+        while (work.pop(task))
+            count++;
+        CHECK_EQUAL(2, count);
+    }
+
+    TEST_FIXTURE(DeferredWorkFixture, test_priority_order)
+    {
+        // Repacking moves windows around, so it has to come before the
+        // relayering and the grabs are always sent last
+        work.schedule(DEFER_FLUSH_GRABS);
+        work.schedule(DEFER_REPOSITION_ICONS);
+        work.schedule(DEFER_RELAYER);
+        work.schedule(DEFER_REPACK_CORNER, PACK_SOUTHWEST);
+
+        DeferredTask task;
+        CHECK(work.pop(task));
+        CHECK(task == DeferredTask(DEFER_REPACK_CORNER, PACK_SOUTHWEST));
+        CHECK(work.pop(task));
+        CHECK_EQUAL(DEFER_RELAYER, task.type);
+        CHECK(work.pop(task));
+        CHECK_EQUAL(DEFER_REPOSITION_ICONS, task.type);
+        CHECK(work.pop(task));
+        CHECK_EQUAL(DEFER_FLUSH_GRABS, task.type);
+        CHECK(work.empty());
+    }
+
+    TEST_FIXTURE(DeferredWorkFixture, test_once_per_batch)
+    {
+        work.schedule(DEFER_RELAYER);
+        work.schedule(DEFER_REPOSITION_ICONS);
+
+        DeferredTask task;
+        CHECK(work.pop(task));
+        CHECK_EQUAL(DEFER_RELAYER, task.type);
+        CHECK(work.pop(task));
+        CHECK_EQUAL(DEFER_REPOSITION_ICONS, task.type);
+
+        // Repositioning the icons asks for another relayer, which already
+        // ran - it has to wait for the next batch
+        work.schedule(DEFER_RELAYER);
+        CHECK(work.is_scheduled(DEFER_RELAYER));
+        CHECK(!work.empty());
+        CHECK(!work.pop(task));
+
+        work.end_batch();
+        CHECK(work.pop(task));
+        CHECK_EQUAL(DEFER_RELAYER, task.type);
+        CHECK(!work.pop(task));
+
+        // Tasks which haven't run in the batch yet aren't held back
+        work.schedule(DEFER_FLUSH_GRABS);
+        CHECK(work.pop(task));
+        CHECK_EQUAL(DEFER_FLUSH_GRABS, task.type);
+    }
+
+    TEST_FIXTURE(DeferredWorkFixture, test_clear)
+    {
+        work.schedule(DEFER_RELAYER);
+        work.schedule(DEFER_FLUSH_GRABS);
+        work.clear();
+        CHECK(work.empty());
+    }
+}
+
+int main()
+{
+    return UnitTest::RunAllTests();
+}
@@ -0,0 +1,124 @@
+#include <string>
+
+#include <UnitTest++.h>
+#include "event-stream.h"
+#include "model/changes.h"
+#include "model/desktop-type.h"
+
+SUITE(EventStreamSuite)
+{
+    TEST(test_events)
+    {
+        EventStream stream;
+        stream.subscribe(1, EV_ALL);
+
+        UserDesktop first(0), second(1);
+        IconDesktop icons;
+        Box screen(0, 0, 1024, 768);
+
+        stream.observe(ChangeClientDesktop(10, Desktop(), first));
+        stream.observe(ChangeFocus(None, 10));
+        stream.observe(ChangeLayer(10, 9));
+        stream.observe(ChangeCPSMode(10, CPS_SPLIT_LEFT));
+        stream.observe(ChangeScreen(10, screen));
+        stream.observe(ChangeCurrentDesktop(first, second));
+        stream.observe(ChangeClientDesktop(10, first, icons));
+        stream.observe(ChangeFocus(10, None));
+        stream.observe(DestroyChange(10, icons, 9));
+
+        // Changes which subscribers don't care about aren't sent
+        stream.observe(ChangeSize(10, 50, 50));
+
+        CHECK(stream.has_pending(1));
+
+        std::string events;
+        stream.take(1, events);
+        CHECK_EQUAL(std::string(
+                        "event client-desktop 10 0\n"
+                        "event focus 10\n"
+                        "event layer 10 9\n"
+                        "event mode 10 split-left\n"
+                        "event screen 10 0 0 1024 768\n"
+                        "event current-desktop 1\n"
+                        "event client-desktop 10 icon\n"
+                        "event focus null\n"
+                        "event destroy 10\n"),
+                    events);
+
+        CHECK(!stream.has_pending(1));
+    }
+
+    TEST(test_subscriptions)
+    {
+        EventStream stream;
+        CHECK(!stream.has_pending(1));
+
+        unsigned int mask;
+        CHECK(EventStream::parse_kinds("focus,destroy", mask));
+        CHECK_EQUAL(EV_FOCUS | EV_DESTROY, mask);
+        CHECK(!EventStream::parse_kinds("focus,bogus", mask));
+        CHECK(!EventStream::parse_kinds("focus,", mask));
+
+        stream.subscribe(1, EV_FOCUS);
+        stream.subscribe(2, EV_LAYER);
+
+        stream.observe(ChangeFocus(None, 10));
+        stream.observe(ChangeLayer(10, 3));
+
+        std::string first, second;
+        stream.take(1, first);
+        stream.take(2, second);
+        CHECK_EQUAL(std::string("event focus 10\n"), first);
+        CHECK_EQUAL(std::string("event layer 10 3\n"), second);
+
+        // Anything that wasn't taken is thrown away when unsubscribing
+        stream.observe(ChangeFocus(10, None));
+        stream.unsubscribe(1);
+        CHECK(!stream.has_pending(1));
+
+        first.clear();
+        stream.take(1, first);
+        CHECK_EQUAL(std::string(""), first);
+    }
+
+    TEST(test_overflow)
+    {
+        EventStream stream;
+        stream.subscribe(1, EV_FOCUS);
+        stream.subscribe(2, EV_FOCUS);
+
+        std::string fast;
+        for (Window window = 1; window <= 10000; window++)
+        {
+            stream.observe(ChangeFocus(None, window));
+            stream.take(2, fast);
+            fast.clear();
+        }
+
+        // The subscriber that kept up didn't lose anything
+        stream.observe(ChangeFocus(None, 42));
+        stream.take(2, fast);
+        CHECK_EQUAL(std::string("event focus 42\n"), fast);
+
+        // The one that didn't is told that it lost events, after the ones it
+        // didn't lose
+        std::string slow;
+        stream.take(1, slow);
+        CHECK(slow.size() <= EVENT_MAX_PENDING + 20);
+        CHECK_EQUAL(0, slow.find("event focus 1\n"));
+
+        const std::string overflow = "event overflow\n";
+        CHECK_EQUAL(slow.size() - overflow.size(), slow.rfind(overflow));
+
+        // Once it has caught up, it gets new events again
+        stream.observe(ChangeFocus(None, 43));
+        slow.clear();
+        stream.take(1, slow);
+        CHECK_EQUAL(std::string("event focus 43\n"), slow);
+    }
+}
+
+int main()
+{
+    return UnitTest::RunAllTests();
+}
@@ -0,0 +1,191 @@
+#include <algorithm>
+#include <vector>
+
+#include <UnitTest++.h>
+#include "ewmh.h"
+#include "fake/fake-xdata.h"
+#include "model/changes.h"
+#include "model/client-model.h"
+#include "model/screen.h"
+#include "stats.h"
+
+const Window a = 100,
+      b = 101;
+
+const unsigned long long max_desktops = 3;
+
+/**
+ * Feeds the changes from a ClientModel into a publisher, in the same way that
+ * ClientModelEvents does.
+ */
+struct EwmhFixture
+{
+    EwmhFixture() :
+        xdata(stats),
+        clients(changes, crt_manager, max_desktops, 1),
+        ewmh(xdata, clients, FAKE_ROOT, max_desktops)
+    {
+        std::vector<Box> screens;
+        screens.push_back(Box(0, 0, 1000, 800));
+        crt_manager.rebuild_graph(screens);
+    }
+
+    /**
+     * Shows the publisher all the pending changes, and then publishes.
+     */
+    void publish()
+    {
+        const Change *change;
+        while ((change = changes.get_next()) != 0)
+        {
+            ewmh.observe(*change);
+            delete change;
+        }
+
+        ewmh.publish();
+    }
+
+    /**
+     * Gets the contents of a property on the root window.
+     */
+    std::vector<long> property(const std::string &name)
+    {
+        const FakeWindow *root = xdata.find_window(FAKE_ROOT);
+        std::map<std::string, std::vector<long> >::const_iterator prop =
+            root->properties.find(name);
+
+        if (prop == root->properties.end())
+            return std::vector<long>();
+        return prop->second;
+    }
+
+    Stats stats;
+    FakeXData xdata;
+    CrtManager crt_manager;
+    ChangeStream changes;
+    ClientModel clients;
+    EwmhPublisher ewmh;
+};
+
+SUITE(EwmhSuite)
+{
+    TEST_FIXTURE(EwmhFixture, test_initial_properties)
+    {
+        publish();
+
+        CHECK_EQUAL(0, property("_NET_CLIENT_LIST").size());
+        CHECK_EQUAL(1, property("_NET_NUMBER_OF_DESKTOPS").size());
+        CHECK_EQUAL(max_desktops, property("_NET_NUMBER_OF_DESKTOPS")[0]);
+        CHECK_EQUAL(0, property("_NET_CURRENT_DESKTOP")[0]);
+        CHECK_EQUAL(None, property("_NET_ACTIVE_WINDOW")[0]);
+
+        std::vector<long> workarea = property("_NET_WORKAREA");
+        CHECK_EQUAL(max_desktops * 4, workarea.size());
+        CHECK_EQUAL(1000, workarea[2]);
+        CHECK_EQUAL(800, workarea[3]);
+
+        std::vector<long> supported = property("_NET_SUPPORTED");
+        CHECK_EQUAL(EWMH_COUNT, supported.size());
+        CHECK(std::find(supported.begin(), supported.end(),
+                        xdata.get_atom(ATOM_NET_ACTIVE_WINDOW)) !=
+              supported.end());
+
+        CHECK(!ewmh.is_dirty());
+        CHECK_EQUAL(EWMH_COUNT, stats.requests(SR_CHANGE_PROPERTY));
+    }
+
+    TEST_FIXTURE(EwmhFixture, test_only_changes_are_written)
+    {
+        publish();
+        uint64_t writes = stats.requests(SR_CHANGE_PROPERTY);
+
+        // Nothing has changed, so nothing is written
+        ewmh.publish();
+        CHECK_EQUAL(writes, stats.requests(SR_CHANGE_PROPERTY));
+
+        // Focusing a new client changes the client lists and the active
+        // window, but none of the desktop information
+        clients.add_client(a, IS_VISIBLE, Dimension2D(1, 1), Dimension2D(1, 1),
+                           true);
+        publish();
+
+        CHECK_EQUAL(writes + 3, stats.requests(SR_CHANGE_PROPERTY));
+        CHECK_EQUAL(1, property("_NET_CLIENT_LIST").size());
+        CHECK_EQUAL(a, property("_NET_CLIENT_LIST")[0]);
+        CHECK_EQUAL(a, property("_NET_CLIENT_LIST_STACKING")[0]);
+        CHECK_EQUAL(a, property("_NET_ACTIVE_WINDOW")[0]);
+    }
+
+    TEST_FIXTURE(EwmhFixture, test_many_changes_written_once)
+    {
+        publish();
+        uint64_t writes = stats.requests(SR_CHANGE_PROPERTY);
+
+        clients.add_client(a, IS_VISIBLE, Dimension2D(1, 1), Dimension2D(1, 1),
+                           true);
+        clients.add_client(b, IS_VISIBLE, Dimension2D(1, 1), Dimension2D(1, 1),
+                           true);
+        clients.next_desktop();
+        clients.prev_desktop();
+        clients.next_desktop();
+        publish();
+
+        // The focus ends up back where it started, since nothing is focused
+        // on the new desktop
+        CHECK_EQUAL(writes + 3, stats.requests(SR_CHANGE_PROPERTY));
+        CHECK_EQUAL(None, property("_NET_ACTIVE_WINDOW")[0]);
+        CHECK_EQUAL(1, property("_NET_CURRENT_DESKTOP")[0]);
+
+        std::vector<long> client_list = property("_NET_CLIENT_LIST");
+        CHECK_EQUAL(2, client_list.size());
+        CHECK_EQUAL(a, client_list[0]);
+        CHECK_EQUAL(b, client_list[1]);
+    }
+
+    TEST_FIXTURE(EwmhFixture, test_stacking_order)
+    {
+        clients.add_client(a, IS_VISIBLE, Dimension2D(1, 1), Dimension2D(1, 1),
+                           true);
+        clients.add_client(b, IS_VISIBLE, Dimension2D(1, 1), Dimension2D(1, 1),
+                           true);
+
+        std::vector<Window> stacking;
+        stacking.push_back(b);
+        stacking.push_back(a);
+        ewmh.set_stacking(stacking);
+        publish();
+
+        std::vector<long> published = property("_NET_CLIENT_LIST_STACKING");
+        CHECK_EQUAL(2, published.size());
+        CHECK_EQUAL(b, published[0]);
+        CHECK_EQUAL(a, published[1]);
+
+        // Clients which aren't visible are put underneath the visible ones
+        stacking.clear();
+        stacking.push_back(b);
+        ewmh.set_stacking(stacking);
+        publish();
+
+        published = property("_NET_CLIENT_LIST_STACKING");
+        CHECK_EQUAL(a, published[0]);
+        CHECK_EQUAL(b, published[1]);
+    }
+
+    TEST_FIXTURE(EwmhFixture, test_destroyed_client)
+    {
+        clients.add_client(a, IS_VISIBLE, Dimension2D(1, 1), Dimension2D(1, 1),
+                           true);
+        publish();
+
+        clients.remove_client(a);
+        publish();
+
+        CHECK_EQUAL(0, property("_NET_CLIENT_LIST").size());
+        CHECK_EQUAL(None, property("_NET_ACTIVE_WINDOW")[0]);
+    }
+}
+
+int main()
+{
+    return UnitTest::RunAllTests();
+}
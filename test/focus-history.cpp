@@ -0,0 +1,86 @@
+#include <vector>
+
+#include <UnitTest++.h>
+#include "model/focus-history.h"
+
+SUITE(FocusHistorySuite)
+{
+    TEST(history_starts_empty)
+    {
+        FocusHistory history;
+        CHECK(history.empty());
+        CHECK_EQUAL(None, history.front());
+        CHECK_EQUAL(None, history.back());
+        CHECK_EQUAL(None, history.after(1));
+    }
+
+    TEST(touch_moves_to_front)
+    {
+        FocusHistory history;
+        history.touch(1);
+        history.touch(2);
+        history.touch(3);
+
+        // Touching a window that's already there doesn't duplicate it
+        history.touch(1);
+        CHECK_EQUAL(3, history.size());
+
+        std::vector<Window> windows;
+        history.get_windows(windows);
+        CHECK_EQUAL(3, windows.size());
+        CHECK_EQUAL(1, windows[0]);
+        CHECK_EQUAL(3, windows[1]);
+        CHECK_EQUAL(2, windows[2]);
+
+        CHECK_EQUAL(1, history.front());
+        CHECK_EQUAL(2, history.back());
+    }
+
+    TEST(walk_history)
+    {
+        FocusHistory history;
+        history.touch(1);
+        history.touch(2);
+        history.touch(3);
+
+        // Older windows come after newer ones
+        CHECK_EQUAL(2, history.after(3));
+        CHECK_EQUAL(1, history.after(2));
+        CHECK_EQUAL(None, history.after(1));
+
+        CHECK_EQUAL(2, history.before(1));
+        CHECK_EQUAL(3, history.before(2));
+        CHECK_EQUAL(None, history.before(3));
+
+        // Windows that aren't in the history have no neighbors
+        CHECK_EQUAL(None, history.after(42));
+        CHECK_EQUAL(None, history.before(42));
+    }
+
+    TEST(remove_windows)
+    {
+        FocusHistory history;
+        history.touch(1);
+        history.touch(2);
+        history.touch(3);
+
+        CHECK(history.remove(2));
+        CHECK(!history.remove(2));
+        CHECK(!history.contains(2));
+        CHECK_EQUAL(2, history.size());
+        CHECK_EQUAL(1, history.after(3));
+
+        CHECK(history.remove(3));
+        CHECK(history.remove(1));
+        CHECK(history.empty());
+
+        // The history can be used again once it has been emptied
+        history.touch(4);
+        CHECK_EQUAL(4, history.front());
+    }
+}
+
+int main()
+{
+    return UnitTest::RunAllTests();
+}
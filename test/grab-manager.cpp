@@ -0,0 +1,139 @@
+#include <UnitTest++.h>
+#include "fake/fake-xdata.h"
+#include "grab-manager.h"
+#include "stats.h"
+
+struct GrabManagerFixture
+{
+    GrabManagerFixture() :
+        xdata(stats), grabs(xdata)
+    {
+        FakeWindow desc;
+        client = xdata.create_client(desc);
+    }
+
+    Stats stats;
+    FakeXData xdata;
+    GrabManager grabs;
+    Window client;
+};
+
+SUITE(GrabManagerSuite)
+{
+    TEST_FIXTURE(GrabManagerFixture, test_hotkeys_wait_for_flush)
+    {
+        grabs.add_hotkey(XK_h, false);
+        grabs.add_hotkey_mouse(Button1);
+        CHECK(!xdata.has_hotkey(XK_h, false));
+        CHECK(!xdata.has_hotkey_mouse(Button1));
+
+        grabs.flush();
+        CHECK(xdata.has_hotkey(XK_h, false));
+        CHECK(xdata.has_hotkey_mouse(Button1));
+    }
+
+    TEST_FIXTURE(GrabManagerFixture, test_hotkeys_only_sent_once)
+    {
+        grabs.add_hotkey(XK_h, false);
+        grabs.flush();
+        uint64_t requests = stats.requests(SR_ADD_HOTKEY);
+        CHECK(requests > 0);
+
+        grabs.add_hotkey(XK_h, false);
+        grabs.flush();
+        CHECK_EQUAL(requests, stats.requests(SR_ADD_HOTKEY));
+    }
+
+    TEST_FIXTURE(GrabManagerFixture, test_removed_hotkeys)
+    {
+        grabs.add_hotkey(XK_h, false);
+        grabs.add_hotkey(XK_j, true);
+        grabs.add_hotkey_mouse(Button1);
+        grabs.flush();
+        uint64_t requests = stats.requests(SR_ADD_HOTKEY);
+
+        grabs.remove_hotkey(XK_h, false);
+        grabs.remove_hotkey_mouse(Button1);
+        grabs.flush();
+
+        CHECK(!xdata.has_hotkey(XK_h, false));
+        CHECK(xdata.has_hotkey(XK_j, true));
+        CHECK(!xdata.has_hotkey_mouse(Button1));
+
+        // Only the removed hotkey is ungrabbed - the other is left alone
+        CHECK_EQUAL(requests, stats.requests(SR_ADD_HOTKEY));
+        CHECK_EQUAL(requests / 2, stats.requests(SR_REMOVE_HOTKEY));
+    }
+
+    TEST_FIXTURE(GrabManagerFixture, test_reset_hotkeys)
+    {
+        grabs.add_hotkey(XK_h, false);
+        grabs.add_hotkey(XK_j, true);
+        grabs.flush();
+        uint64_t requests = stats.requests(SR_ADD_HOTKEY);
+
+        grabs.reset_hotkeys();
+        CHECK(!xdata.has_hotkey(XK_h, false));
+
+        grabs.flush();
+        CHECK(xdata.has_hotkey(XK_h, false));
+        CHECK(xdata.has_hotkey(XK_j, true));
+        CHECK_EQUAL(requests * 2, stats.requests(SR_ADD_HOTKEY));
+    }
+
+    TEST_FIXTURE(GrabManagerFixture, test_grab_mouse)
+    {
+        grabs.grab_mouse(client);
+        CHECK(grabs.is_mouse_grabbed(client));
+        CHECK(!xdata.find_window(client)->click_grabbed);
+
+        grabs.flush();
+        CHECK(xdata.find_window(client)->click_grabbed);
+
+        grabs.ungrab_mouse(client);
+        CHECK(!grabs.is_mouse_grabbed(client));
+
+        grabs.flush();
+        CHECK(!xdata.find_window(client)->click_grabbed);
+    }
+
+    TEST_FIXTURE(GrabManagerFixture, test_grab_mouse_only_sent_on_change)
+    {
+        // New windows don't have any grabs, so this shouldn't do anything
+        grabs.ungrab_mouse(client);
+        grabs.flush();
+        CHECK_EQUAL(0, stats.requests(SR_UNGRAB_MOUSE));
+
+        grabs.grab_mouse(client);
+        grabs.flush();
+        grabs.grab_mouse(client);
+        grabs.flush();
+        CHECK_EQUAL(1, stats.requests(SR_GRAB_MOUSE));
+
+        // Changes which cancel each other out before a flush are never sent
+        grabs.ungrab_mouse(client);
+        grabs.grab_mouse(client);
+        grabs.flush();
+        CHECK_EQUAL(1, stats.requests(SR_GRAB_MOUSE));
+        CHECK_EQUAL(0, stats.requests(SR_UNGRAB_MOUSE));
+    }
+
+    TEST_FIXTURE(GrabManagerFixture, test_forget_window)
+    {
+        grabs.grab_mouse(client);
+        grabs.flush();
+
+        // If the window's ID is reused, the new window has no grab yet
+        grabs.forget_window(client);
+        CHECK(!grabs.is_mouse_grabbed(client));
+
+        grabs.grab_mouse(client);
+        grabs.flush();
+        CHECK_EQUAL(2, stats.requests(SR_GRAB_MOUSE));
+    }
+}
+
+int main()
+{
+    return UnitTest::RunAllTests();
+}
@@ -0,0 +1,174 @@
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <UnitTest++.h>
+#include "launcher.h"
+
+/**
+ * Waits (for up to a few seconds) for a program to create a file.
+ */
+static bool wait_for_file(const std::string &path)
+{
+    struct stat info;
+    for (int tries = 0; tries < 300; tries++)
+    {
+        if (stat(path.c_str(), &info) == 0)
+            return true;
+        usleep(10000);
+    }
+
+    return false;
+}
+
+/**
+ * Waits (for up to a few seconds) for a program to write a line to a file,
+ * and reads it back.
+ */
+static std::string wait_for_line(const std::string &path)
+{
+    for (int tries = 0; tries < 300; tries++)
+    {
+        std::ifstream file(path.c_str());
+        std::string line;
+        if (std::getline(file, line) && !file.eof())
+            return line;
+        usleep(10000);
+    }
+
+    return "";
+}
+
+/**
+ * Gets a path that nothing exists at yet.
+ */
+static std::string unused_path(const std::string &name)
+{
+    char pid[32];
+    std::snprintf(pid, sizeof(pid), "%d", static_cast<int>(getpid()));
+
+    std::string path = std::string("/tmp/smallwm-launcher-") + pid + "-" + name;
+    unlink(path.c_str());
+    return path;
+}
+
+SUITE(LauncherSuite)
+{
+    TEST(test_split_command)
+    {
+        std::vector<std::string> args;
+
+        CHECK(Launcher::split_command("xterm -e top", args));
+        CHECK_EQUAL(3, args.size());
+        CHECK_EQUAL(std::string("xterm"), args[0]);
+        CHECK_EQUAL(std::string("-e"), args[1]);
+        CHECK_EQUAL(std::string("top"), args[2]);
+
+        CHECK(Launcher::split_command("  /usr/bin/xclock\t-update 1 ", args));
+        CHECK_EQUAL(3, args.size());
+        CHECK_EQUAL(std::string("/usr/bin/xclock"), args[0]);
+
+        // Arguments can have '=' in them, but the program can't
+        CHECK(Launcher::split_command("xterm -geometry=80x24", args));
+        CHECK(!Launcher::split_command("LANG=C xterm", args));
+
+        // Anything the shell would treat specially has to go through it
+        CHECK(!Launcher::split_command("xterm -e 'top -d 1'", args));
+        CHECK(!Launcher::split_command("xclock &", args));
+        CHECK(!Launcher::split_command("xterm -e $SHELL", args));
+        CHECK(!Launcher::split_command("ls | xmessage -file -", args));
+        CHECK(!Launcher::split_command("", args));
+        CHECK(!Launcher::split_command("   ", args));
+    }
+
+    TEST(test_spawn_direct)
+    {
+        std::string path = unused_path("direct");
+
+        pid_t pid = Launcher::spawn("touch " + path);
+        CHECK(pid != -1);
+
+        int status;
+        CHECK_EQUAL(pid, waitpid(pid, &status, 0));
+        CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+        CHECK(wait_for_file(path));
+        unlink(path.c_str());
+    }
+
+    TEST(test_spawn_shell)
+    {
+        std::string path = unused_path("shell");
+
+        pid_t pid = Launcher::spawn("echo 'quoted' > " + path);
+        CHECK(pid != -1);
+
+        int status;
+        CHECK_EQUAL(pid, waitpid(pid, &status, 0));
+        CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+        CHECK(wait_for_file(path));
+        unlink(path.c_str());
+    }
+
+    TEST(test_spawn_missing)
+    {
+        // Programs which can't be found are still handed to the shell, in
+        // case they're builtins - the shell is what fails
+        pid_t pid = Launcher::spawn("smallwm-no-such-program");
+        CHECK(pid != -1);
+
+        int status;
+        CHECK_EQUAL(pid, waitpid(pid, &status, 0));
+        CHECK(WIFEXITED(status) && WEXITSTATUS(status) != 0);
+    }
+
+    TEST(test_helper)
+    {
+        std::string direct = unused_path("helper-direct");
+        std::string shell = unused_path("helper-shell");
+
+        Launcher launcher;
+        CHECK(launcher.start_helper("/proc/self/exe"));
+        CHECK(!launcher.launch(""));
+        CHECK(launcher.launch("touch " + direct));
+        CHECK(launcher.launch("echo launched > " + shell));
+
+        CHECK(wait_for_file(direct));
+        CHECK(wait_for_file(shell));
+        unlink(direct.c_str());
+        unlink(shell.c_str());
+    }
+
+    TEST(test_stdin_is_null)
+    {
+        std::string direct = unused_path("stdin-direct");
+        std::string helper = unused_path("stdin-helper");
+
+        // Programs can't see SmallWM's stdin, or the helper's command socket
+        pid_t pid = Launcher::spawn("readlink /proc/self/fd/0 > " + direct);
+        CHECK(pid != -1);
+        waitpid(pid, NULL, 0);
+        CHECK_EQUAL(std::string("/dev/null"), wait_for_line(direct));
+
+        Launcher launcher;
+        CHECK(launcher.start_helper("/proc/self/exe"));
+        CHECK(launcher.launch("readlink /proc/self/fd/0 > " + helper));
+        CHECK_EQUAL(std::string("/dev/null"), wait_for_line(helper));
+
+        unlink(direct.c_str());
+        unlink(helper.c_str());
+    }
+}
+
+int main(int argc, char **argv)
+{
+    // test_helper runs this binary again as the helper
+    if (argc == 2 && std::string(argv[1]) == "--launch-helper")
+        return Launcher::run_helper(STDIN_FILENO);
+
+    return UnitTest::RunAllTests();
+}
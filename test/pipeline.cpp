@@ -0,0 +1,877 @@
+#include <algorithm>
+#include <sstream>
+
+#include <UnitTest++.h>
+#include "clientmodel-events.h"
+#include "configparse.h"
+#include "deferred-work.h"
+#include "event-stream.h"
+#include "ewmh.h"
+#include "fake/fake-launcher.h"
+#include "fake/fake-xdata.h"
+#include "grab-manager.h"
+#include "logging/logging.h"
+#include "logging/stream.h"
+#include "mirrored-xdata.h"
+#include "model/changes.h"
+#include "model/client-model.h"
+#include "model/screen.h"
+#include "model/x-model.h"
+#include "stats.h"
+#include "trace.h"
+#include "x-events.h"
+
+/**
+ * Runs the whole window manager - XEvents and ClientModelEvents - on top of
+ * the fake X server, in the same way that smallwm.cpp does.
+ */
+struct PipelineFixture
+{
+    PipelineFixture() :
+        logger(log_output), xdata(stats),
+        clients(changes, crt_manager, config.num_desktops, config.border_width),
+        trace(xdata), mirrored_xdata(xdata, xmodel, stats),
+        grabs(mirrored_xdata),
+        ewmh(mirrored_xdata, clients, FAKE_ROOT, config.num_desktops),
+        x_events(config, stats, trace, mirrored_xdata, grabs, work, launcher,
+                 clients, xmodel),
+        client_events(config, logger, stats, changes, mirrored_xdata, grabs,
+                      work, ewmh, events, clients, xmodel)
+    {
+        xdata.select_input(FAKE_ROOT,
+                           PointerMotionMask |
+                           StructureNotifyMask |
+                           SubstructureNotifyMask |
+                           SubstructureRedirectMask);
+
+        std::vector<Box> screens;
+        xdata.get_screen_boxes(screens);
+        crt_manager.rebuild_graph(screens);
+    };
+
+    /**
+     * Handles events until the fake server has nothing left to send.
+     */
+    void run()
+    {
+        client_events.handle_queued_changes();
+        while (xdata.has_events() || !work.empty())
+        {
+            if (xdata.has_events())
+                x_events.step();
+            client_events.handle_queued_changes();
+        }
+    }
+
+    /**
+     * Creates and maps a new client, and lets SmallWM handle it.
+     */
+    Window new_client()
+    {
+        FakeWindow desc;
+        desc.x = 100;
+        desc.y = 100;
+        desc.width = 300;
+        desc.height = 200;
+
+        Window client = xdata.create_client(desc);
+        xdata.client_map(client);
+        run();
+        return client;
+    }
+
+    std::stringstream log_output;
+    StreamLog logger;
+    WMConfig config;
+    Stats stats;
+    FakeXData xdata;
+    CrtManager crt_manager;
+    ChangeStream changes;
+    ClientModel clients;
+    XModel xmodel;
+    TraceWriter trace;
+    MirroredXData mirrored_xdata;
+    GrabManager grabs;
+    DeferredWork work;
+    FakeLauncher launcher;
+    EwmhPublisher ewmh;
+    EventStream events;
+    XEvents x_events;
+    ClientModelEvents client_events;
+};
+
+SUITE(PipelineSuite)
+{
+    TEST_FIXTURE(PipelineFixture, test_hotkeys_grabbed)
+    {
+        CHECK(xdata.has_hotkey(XK_h, false));
+        CHECK(xdata.has_hotkey(XK_Tab, true));
+        CHECK(!xdata.has_hotkey(XK_h, true));
+    }
+
+    TEST_FIXTURE(PipelineFixture, test_map_new_client)
+    {
+        Window client = new_client();
+
+        CHECK(clients.is_client(client));
+        CHECK_EQUAL(client, clients.get_focused());
+
+        const FakeWindow *state = xdata.find_window(client);
+        CHECK(state->mapped);
+        CHECK_EQUAL(config.border_width, state->border_width);
+        CHECK_EQUAL(X_BLACK, state->border_color);
+        CHECK(!state->click_grabbed);
+        CHECK_EQUAL(client, xdata.get_input_focus());
+
+        // The client is only mapped once, in response to its MapRequest
+        CHECK_EQUAL(1, stats.requests(SR_MAP_WIN));
+    }
+
+    TEST_FIXTURE(PipelineFixture, test_focus_moves_to_new_client)
+    {
+        Window first = new_client();
+        Window second = new_client();
+
+        CHECK_EQUAL(second, clients.get_focused());
+        CHECK_EQUAL(second, xdata.get_input_focus());
+
+        // Clicks on the unfocused client have to be grabbed, so that clicking
+        // on it can focus it
+        const FakeWindow *first_state = xdata.find_window(first);
+        CHECK(first_state->click_grabbed);
+        CHECK_EQUAL(X_WHITE, first_state->border_color);
+
+        xdata.press_button(Button1, 0, first, None);
+        run();
+        CHECK_EQUAL(first, clients.get_focused());
+        CHECK_EQUAL(first, xdata.get_input_focus());
+    }
+
+    TEST_FIXTURE(PipelineFixture, test_client_destroyed)
+    {
+        Window client = new_client();
+        xdata.client_destroy(client);
+        run();
+
+        CHECK(!clients.is_client(client));
+        CHECK_EQUAL(None, clients.get_focused());
+    }
+
+    TEST_FIXTURE(PipelineFixture, test_iconify_with_hotkey)
+    {
+        Window client = new_client();
+
+        xdata.press_key(XK_h, xdata.primary_mod_flag, client);
+        run();
+
+        CHECK(!xdata.find_window(client)->mapped);
+
+        Icon *icon = xmodel.find_icon_from_client(client);
+        CHECK(icon != NULL);
+        CHECK(xdata.find_window(icon->icon)->mapped);
+
+        // Clicking on the icon brings back the client
+        xdata.press_button(Button1, 0, icon->icon, None);
+        run();
+
+        CHECK(xdata.find_window(client)->mapped);
+        CHECK(xmodel.find_icon_from_client(client) == NULL);
+    }
+
+    TEST_FIXTURE(PipelineFixture, test_icon_window_reused)
+    {
+        Window client = new_client();
+
+        xdata.press_key(XK_h, xdata.primary_mod_flag, client);
+        run();
+        Icon *icon = xmodel.find_icon_from_client(client);
+        Window icon_window = icon->icon;
+
+        // Bringing back the client only hides its icon
+        xdata.press_button(Button1, 0, icon_window, None);
+        run();
+        CHECK(xdata.find_window(icon_window) != NULL);
+        CHECK(!xdata.find_window(icon_window)->mapped);
+
+        uint64_t creates = stats.requests(SR_CREATE_WINDOW);
+        uint64_t attrs = stats.round_trips(SR_GET_ATTRIBUTES);
+
+        xdata.press_key(XK_h, xdata.primary_mod_flag, client);
+        run();
+
+        icon = xmodel.find_icon_from_client(client);
+        CHECK(icon != NULL);
+        CHECK_EQUAL(icon_window, icon->icon);
+        CHECK(xdata.find_window(icon_window)->mapped);
+        CHECK_EQUAL(creates, stats.requests(SR_CREATE_WINDOW));
+        CHECK_EQUAL(attrs, stats.round_trips(SR_GET_ATTRIBUTES));
+
+        CHECK_EQUAL(1, stats.count(SC_ICON_POOL_MISS));
+        CHECK_EQUAL(1, stats.count(SC_ICON_POOL_HIT));
+    }
+
+    TEST_FIXTURE(PipelineFixture, test_hotkeys_after_mapping_change)
+    {
+        Window first = new_client();
+        Window second = new_client();
+
+        // Looking up a hotkey shouldn't need to talk to the server
+        stats.reset();
+        xdata.press_key(XK_h, xdata.primary_mod_flag, second);
+        run();
+        CHECK(!xdata.find_window(second)->mapped);
+        CHECK_EQUAL(0, stats.round_trips(SR_LOAD_KEYBOARD_MAPPING));
+
+        // Once the keyboard is remapped, the hotkeys should be grabbed again
+        // and the old keycodes forgotten
+        xdata.change_keyboard_mapping();
+        run();
+        CHECK_EQUAL(1, stats.requests(SR_CLEAR_HOTKEYS));
+        CHECK(xdata.has_hotkey(XK_h, false));
+
+        xdata.press_key(XK_h, xdata.primary_mod_flag, first);
+        run();
+        CHECK(!xdata.find_window(first)->mapped);
+    }
+
+    TEST_FIXTURE(PipelineFixture, test_redundant_requests_suppressed)
+    {
+        Window client = new_client();
+
+        uint64_t maps = stats.requests(SR_MAP_WIN);
+        uint64_t colors = stats.requests(SR_SET_BORDER_COLOR);
+        uint64_t widths = stats.requests(SR_SET_BORDER_WIDTH);
+
+        mirrored_xdata.map_win(client);
+        mirrored_xdata.set_border_color(client, X_BLACK);
+        mirrored_xdata.set_border_width(client, config.border_width);
+
+        CHECK_EQUAL(maps, stats.requests(SR_MAP_WIN));
+        CHECK_EQUAL(colors, stats.requests(SR_SET_BORDER_COLOR));
+        CHECK_EQUAL(widths, stats.requests(SR_SET_BORDER_WIDTH));
+        CHECK_EQUAL(1, stats.suppressed(SR_MAP_WIN));
+        CHECK_EQUAL(1, stats.suppressed(SR_SET_BORDER_COLOR));
+        CHECK_EQUAL(1, stats.suppressed(SR_SET_BORDER_WIDTH));
+
+        // Actual changes still have to go through
+        mirrored_xdata.set_border_color(client, X_WHITE);
+        CHECK_EQUAL(colors + 1, stats.requests(SR_SET_BORDER_COLOR));
+        CHECK_EQUAL(X_WHITE, xdata.find_window(client)->border_color);
+    }
+
+    TEST_FIXTURE(PipelineFixture, test_client_unmap_is_mirrored)
+    {
+        Window client = new_client();
+
+        // The client unmapping itself isn't something that SmallWM asked for,
+        // so SmallWM has to notice it to be able to map the window again
+        xdata.client_unmap(client);
+        run();
+
+        mirrored_xdata.map_win(client);
+        CHECK(xdata.find_window(client)->mapped);
+        CHECK_EQUAL(0, stats.suppressed(SR_MAP_WIN));
+    }
+
+    TEST_FIXTURE(PipelineFixture, test_client_remap_after_desktop_changes)
+    {
+        Window client = new_client();
+
+        // SmallWM's own unmaps don't produce any events, so they can't leave
+        // the mirror waiting for any
+        for (int round = 0; round < 2; round++)
+        {
+            xdata.press_key(XK_period, xdata.primary_mod_flag, None);
+            run();
+            xdata.press_key(XK_comma, xdata.primary_mod_flag, None);
+            run();
+        }
+
+        CHECK_EQUAL(0, xmodel.get_mirror(client).pending_map_events);
+
+        xdata.client_unmap(client);
+        run();
+        xdata.client_map(client);
+        run();
+
+        CHECK(xdata.find_window(client)->mapped);
+        CHECK(clients.is_visible(client));
+    }
+
+    TEST_FIXTURE(PipelineFixture, test_change_desktop)
+    {
+        Window client = new_client();
+
+        xdata.press_key(XK_period, xdata.primary_mod_flag, None);
+        run();
+        CHECK(!xdata.find_window(client)->mapped);
+        CHECK(!clients.is_visible(client));
+
+        xdata.press_key(XK_comma, xdata.primary_mod_flag, None);
+        run();
+        CHECK(xdata.find_window(client)->mapped);
+        CHECK(clients.is_visible(client));
+    }
+
+    TEST_FIXTURE(PipelineFixture, test_change_desktop_batch)
+    {
+        Window first = new_client();
+        Window second = new_client();
+
+        // The old desktop's windows are unmapped together, with substructure
+        // events turned off and on only once around all of them
+        uint64_t toggles = stats.requests(SR_SUBSTRUCTURE_EVENTS);
+
+        xdata.press_key(XK_period, xdata.primary_mod_flag, None);
+        run();
+        CHECK_EQUAL(toggles + 2, stats.requests(SR_SUBSTRUCTURE_EVENTS));
+        CHECK(!xdata.find_window(first)->mapped);
+        CHECK(!xdata.find_window(second)->mapped);
+
+        Window third = new_client();
+
+        // Only the windows which actually change get a request - each one
+        // exactly once
+        uint64_t maps = stats.requests(SR_MAP_WIN);
+        uint64_t unmaps = stats.requests(SR_UNMAP_WIN);
+
+        xdata.press_key(XK_comma, xdata.primary_mod_flag, None);
+        run();
+
+        CHECK_EQUAL(maps + 2, stats.requests(SR_MAP_WIN));
+        CHECK_EQUAL(unmaps + 1, stats.requests(SR_UNMAP_WIN));
+        CHECK(xdata.find_window(first)->mapped);
+        CHECK(xdata.find_window(second)->mapped);
+        CHECK(!xdata.find_window(third)->mapped);
+    }
+
+    TEST_FIXTURE(PipelineFixture, test_relayer_once_per_batch)
+    {
+        Window first = new_client();
+        Window second = new_client();
+        Window third = new_client();
+
+        // Every one of these asks for a relayer, but they're all handled in
+        // the same batch - so each client is only raised once
+        uint64_t raises = stats.requests(SR_RAISE);
+        clients.focus(first);
+        clients.focus(second);
+        clients.up_layer(third);
+        clients.focus(third);
+        run();
+
+        CHECK_EQUAL(raises + 3, stats.requests(SR_RAISE));
+        CHECK(work.empty());
+    }
+
+    TEST_FIXTURE(PipelineFixture, test_placeholder_reused)
+    {
+        Window client = new_client();
+
+        xdata.press_button(MOVE_BUTTON, xdata.primary_mod_flag, None, client);
+        run();
+
+        Window placeholder = xmodel.get_move_resize_placeholder();
+        CHECK(placeholder != None);
+        CHECK(xdata.find_window(placeholder)->mapped);
+        CHECK(!xdata.find_window(client)->mapped);
+
+        // The placeholder takes the client's geometry from the model
+        const FakeWindow *state = xdata.find_window(placeholder);
+        CHECK_EQUAL(100, state->x);
+        CHECK_EQUAL(100, state->y);
+        CHECK_EQUAL(300, state->width);
+        CHECK_EQUAL(200, state->height);
+
+        xdata.release_button(MOVE_BUTTON, 0, placeholder);
+        run();
+        CHECK(xdata.find_window(client)->mapped);
+        CHECK(xdata.find_window(placeholder) != NULL);
+        CHECK(!xdata.find_window(placeholder)->mapped);
+
+        // The second move uses the same placeholder, and only needs a single
+        // request to put it into place
+        uint64_t creates = stats.requests(SR_CREATE_WINDOW);
+        uint64_t moves = stats.requests(SR_MOVE_WINDOW);
+        uint64_t resizes = stats.requests(SR_RESIZE_WINDOW);
+        uint64_t attrs = stats.round_trips(SR_GET_ATTRIBUTES);
+
+        xdata.press_button(RESIZE_BUTTON, xdata.primary_mod_flag, None, client);
+        run();
+
+        CHECK_EQUAL(placeholder, xmodel.get_move_resize_placeholder());
+        CHECK(xdata.find_window(placeholder)->mapped);
+        CHECK_EQUAL(creates, stats.requests(SR_CREATE_WINDOW));
+        CHECK_EQUAL(moves, stats.requests(SR_MOVE_WINDOW));
+        CHECK_EQUAL(resizes, stats.requests(SR_RESIZE_WINDOW));
+        CHECK_EQUAL(attrs, stats.round_trips(SR_GET_ATTRIBUTES));
+        CHECK_EQUAL(2, stats.requests(SR_MOVE_RESIZE_WINDOW));
+    }
+
+    TEST_FIXTURE(PipelineFixture, test_outline_drag)
+    {
+        config.drag_mode = DRAG_OUTLINE;
+        Window client = new_client();
+        uint64_t creates = stats.requests(SR_CREATE_WINDOW);
+
+        xdata.press_button(MOVE_BUTTON, xdata.primary_mod_flag, None, client);
+        run();
+
+        // No placeholder is needed - the client stays where it is, and an
+        // outline is drawn around it
+        CHECK_EQUAL(creates, stats.requests(SR_CREATE_WINDOW));
+        CHECK_EQUAL(None, xmodel.get_move_resize_placeholder());
+        CHECK(xdata.find_window(client)->mapped);
+        CHECK_EQUAL(client, xdata.get_confined());
+        CHECK_EQUAL(1, xdata.get_outlines().size());
+        CHECK_EQUAL(Box(100, 100, 300, 200), xdata.get_outlines()[0]);
+
+        xdata.move_pointer(50, 30);
+        run();
+        CHECK_EQUAL(1, xdata.get_outlines().size());
+        CHECK_EQUAL(Box(150, 130, 300, 200), xdata.get_outlines()[0]);
+        CHECK_EQUAL(100, xdata.find_window(client)->x);
+
+        xdata.release_button(MOVE_BUTTON, 0, client);
+        run();
+        CHECK_EQUAL(0, xdata.get_outlines().size());
+        CHECK_EQUAL(None, xdata.get_confined());
+        CHECK_EQUAL(150, xdata.find_window(client)->x);
+        CHECK_EQUAL(130, xdata.find_window(client)->y);
+        CHECK(xdata.find_window(client)->mapped);
+        CHECK_EQUAL(MR_INVALID, xmodel.get_move_resize_state());
+    }
+
+    TEST_FIXTURE(PipelineFixture, test_opaque_resize)
+    {
+        config.drag_mode = DRAG_OPAQUE;
+
+        FakeWindow desc;
+        desc.x = 100;
+        desc.y = 100;
+        desc.width = 300;
+        desc.height = 200;
+        desc.width_inc = 10;
+        desc.height_inc = 20;
+
+        Window client = xdata.create_client(desc);
+        xdata.client_map(client);
+        run();
+
+        xdata.press_button(RESIZE_BUTTON, xdata.primary_mod_flag, None, client);
+        run();
+        CHECK(xdata.find_window(client)->mapped);
+        CHECK_EQUAL(client, xdata.get_confined());
+
+        // The client itself is resized as the pointer moves, in steps of its
+        // size increments
+        xdata.move_pointer(25, 45);
+        run();
+        CHECK_EQUAL(320, xdata.find_window(client)->width);
+        CHECK_EQUAL(240, xdata.find_window(client)->height);
+        CHECK(xdata.find_window(client)->mapped);
+
+        xdata.release_button(RESIZE_BUTTON, 0, client);
+        run();
+        CHECK_EQUAL(None, xdata.get_confined());
+        CHECK_EQUAL(320, xdata.find_window(client)->width);
+        CHECK_EQUAL(240, xdata.find_window(client)->height);
+        CHECK(xdata.find_window(client)->mapped);
+        CHECK_EQUAL(0, stats.requests(SR_CREATE_WINDOW));
+    }
+
+    TEST_FIXTURE(PipelineFixture, test_ewmh_properties)
+    {
+        Window first = new_client();
+        Window second = new_client();
+
+        const FakeWindow *root = xdata.find_window(FAKE_ROOT);
+        std::vector<long> client_list =
+            root->properties.find("_NET_CLIENT_LIST")->second;
+        CHECK_EQUAL(2, client_list.size());
+        CHECK_EQUAL(first, client_list[0]);
+        CHECK_EQUAL(second, client_list[1]);
+
+        // The stacking list follows the order that the clients were raised in
+        std::vector<long> stacking =
+            root->properties.find("_NET_CLIENT_LIST_STACKING")->second;
+        CHECK_EQUAL(2, stacking.size());
+        CHECK_EQUAL(second, stacking[1]);
+        CHECK_EQUAL(second,
+                root->properties.find("_NET_ACTIVE_WINDOW")->second[0]);
+
+        // Switching desktops changes many things at once, but each property
+        // is only written once
+        uint64_t writes = stats.requests(SR_CHANGE_PROPERTY);
+        xdata.press_key(XK_period, xdata.primary_mod_flag, None);
+        run();
+
+        CHECK_EQUAL(1, root->properties.find("_NET_CURRENT_DESKTOP")->second[0]);
+        CHECK_EQUAL(None, root->properties.find("_NET_ACTIVE_WINDOW")->second[0]);
+        CHECK(stats.requests(SR_CHANGE_PROPERTY) - writes <= 3);
+    }
+
+    TEST_FIXTURE(PipelineFixture, test_configure_request)
+    {
+        Window client = new_client();
+
+        xdata.client_configure(client, 10, 20, 640, 480);
+        run();
+
+        const FakeWindow *state = xdata.find_window(client);
+        CHECK_EQUAL(10, state->x);
+        CHECK_EQUAL(20, state->y);
+        CHECK_EQUAL(640, state->width);
+        CHECK_EQUAL(480, state->height);
+    }
+
+    TEST_FIXTURE(PipelineFixture, test_stacking_follows_focus)
+    {
+        Window first = new_client();
+        Window second = new_client();
+
+        // Both clients are in the same layer, so the one which was mapped
+        // (and focused) last should be on top
+        std::vector<Window> stacking;
+        xdata.get_stacking(stacking);
+        std::vector<Window>::iterator first_pos =
+            std::find(stacking.begin(), stacking.end(), first);
+        std::vector<Window>::iterator second_pos =
+            std::find(stacking.begin(), stacking.end(), second);
+
+        CHECK(first_pos != stacking.end());
+        CHECK(second_pos != stacking.end());
+        CHECK(first_pos < second_pos);
+    }
+
+    TEST_FIXTURE(PipelineFixture, test_cycle_recent)
+    {
+        config.cycle_mode = CYCLE_RECENT;
+
+        Window first = new_client();
+        Window second = new_client();
+        Window third = new_client();
+
+        // Holding the modifier and pressing Tab previews the windows in the
+        // order they were focused, without giving any of them the focus
+        xdata.press_key(XK_Tab, xdata.primary_mod_flag, None);
+        run();
+        CHECK(xdata.is_keyboard_grabbed());
+        CHECK_EQUAL(second, clients.get_focus_preview());
+        CHECK_EQUAL(third, clients.get_focused());
+        CHECK_EQUAL(third, xdata.get_input_focus());
+        CHECK_EQUAL(X_BLACK, xdata.find_window(second)->border_color);
+
+        xdata.press_key(XK_Tab, xdata.primary_mod_flag, None);
+        run();
+        CHECK_EQUAL(first, clients.get_focus_preview());
+        CHECK_EQUAL(X_WHITE, xdata.find_window(second)->border_color);
+        CHECK_EQUAL(X_BLACK, xdata.find_window(first)->border_color);
+        CHECK_EQUAL(third, xdata.get_input_focus());
+
+        // Letting go of a key that isn't a modifier doesn't end the cycle
+        xdata.release_key(XK_Tab, xdata.primary_mod_flag, None);
+        run();
+        CHECK(xdata.is_keyboard_grabbed());
+
+        // Letting go of the modifier focuses the window that was previewed
+        xdata.release_key(XK_Super_L, xdata.primary_mod_flag, None);
+        run();
+        CHECK(!xdata.is_keyboard_grabbed());
+        CHECK_EQUAL(None, clients.get_focus_preview());
+        CHECK_EQUAL(first, clients.get_focused());
+        CHECK_EQUAL(first, xdata.get_input_focus());
+        CHECK_EQUAL(X_WHITE, xdata.find_window(third)->border_color);
+
+        // The next cycle starts from the window that was focused before
+        xdata.press_key(XK_Tab, xdata.primary_mod_flag, None);
+        xdata.release_key(XK_Super_L, xdata.primary_mod_flag, None);
+        run();
+        CHECK_EQUAL(third, clients.get_focused());
+    }
+
+    TEST_FIXTURE(PipelineFixture, test_cycle_recent_secondary_modifier)
+    {
+        config.cycle_mode = CYCLE_RECENT;
+
+        Window first = new_client();
+        Window second = new_client();
+        Window third = new_client();
+        uint64_t focus_changes = stats.handler(SH_FOCUS_CHANGE).count();
+
+        unsigned int both_mods =
+            xdata.primary_mod_flag | xdata.secondary_mod_flag;
+
+        xdata.press_key(XK_Tab, xdata.primary_mod_flag, None);
+        xdata.press_key(XK_Tab, xdata.primary_mod_flag, None);
+        run();
+        CHECK_EQUAL(first, clients.get_focus_preview());
+
+        // Holding Control to go backwards doesn't end the cycle, and neither
+        // does letting go of it again
+        xdata.press_key(XK_Control_L, xdata.primary_mod_flag, None);
+        xdata.press_key(XK_Tab, both_mods, None);
+        xdata.release_key(XK_Control_L, both_mods, None);
+        run();
+        CHECK(xdata.is_keyboard_grabbed());
+        CHECK_EQUAL(second, clients.get_focus_preview());
+        CHECK_EQUAL(third, clients.get_focused());
+
+        // Only letting go of the primary modifier moves the focus
+        xdata.release_key(XK_Super_L, xdata.primary_mod_flag, None);
+        run();
+        CHECK(!xdata.is_keyboard_grabbed());
+        CHECK_EQUAL(second, clients.get_focused());
+        CHECK_EQUAL(second, xdata.get_input_focus());
+        CHECK_EQUAL(focus_changes + 1,
+                    stats.handler(SH_FOCUS_CHANGE).count());
+    }
+
+    TEST_FIXTURE(PipelineFixture, test_reload_config)
+    {
+        Window client = new_client();
+        Window iconified = new_client();
+        xdata.press_key(XK_h, xdata.primary_mod_flag, iconified);
+        run();
+
+        uint64_t grabs = stats.requests(SR_ADD_HOTKEY);
+        uint64_t ungrabs = stats.requests(SR_REMOVE_HOTKEY);
+
+        WMConfig fresh;
+        KeyBinding old_binding =
+            fresh.key_commands.action_to_binding[ICONIFY];
+        KeyBinding new_binding(XK_i, false);
+        fresh.key_commands.binding_to_action.erase(old_binding);
+        fresh.key_commands.binding_to_action[new_binding] = ICONIFY;
+        fresh.key_commands.action_to_binding[ICONIFY] = new_binding;
+        fresh.border_width = config.border_width + 3;
+        fresh.icon_width = config.icon_width * 2;
+        fresh.num_desktops = config.num_desktops + 1;
+
+        x_events.reload_config(fresh);
+        run();
+
+        // Only the hotkey which changed is grabbed again (once for each
+        // combination of lock keys)
+        int lock_mods = (xdata.num_mod_flag != 0) +
+            (xdata.caps_mod_flag != 0) + (xdata.scroll_mod_flag != 0);
+        CHECK_EQUAL(grabs + (1 << lock_mods), stats.requests(SR_ADD_HOTKEY));
+        CHECK_EQUAL(ungrabs + (1 << lock_mods),
+                    stats.requests(SR_REMOVE_HOTKEY));
+        CHECK(xdata.has_hotkey(XK_i, false));
+        CHECK(!xdata.has_hotkey(XK_h, false));
+
+        CHECK_EQUAL(config.border_width, xdata.find_window(client)->border_width);
+        CHECK_EQUAL(config.border_width,
+                    xdata.find_window(iconified)->border_width);
+
+        Icon *icon = xmodel.find_icon_from_client(iconified);
+        CHECK_EQUAL(config.icon_width, xdata.find_window(icon->icon)->width);
+
+        // The number of desktops can't change without a restart
+        CHECK_EQUAL(fresh.num_desktops, config.num_desktops);
+
+        // The new binding is used as soon as the config is swapped in
+        xdata.press_key(XK_i, xdata.primary_mod_flag, client);
+        run();
+        CHECK(!xdata.find_window(client)->mapped);
+    }
+
+    TEST_FIXTURE(PipelineFixture, test_restart_hotkey)
+    {
+        Window client = new_client();
+
+        // A restart isn't allowed in the middle of a drag
+        xdata.press_button(MOVE_BUTTON, xdata.primary_mod_flag, None, client);
+        run();
+        xdata.press_key(XK_Escape,
+            xdata.primary_mod_flag | xdata.secondary_mod_flag, client);
+        CHECK(x_events.step());
+        CHECK(!x_events.should_restart());
+
+        xdata.release_button(MOVE_BUTTON, 0,
+                             xmodel.get_move_resize_placeholder());
+        run();
+        xdata.press_key(XK_Escape,
+            xdata.primary_mod_flag | xdata.secondary_mod_flag, client);
+        CHECK(!x_events.step());
+        CHECK(x_events.should_restart());
+    }
+
+    TEST_FIXTURE(PipelineFixture, test_launch_shell)
+    {
+        Window client = new_client();
+
+        // Clicking on a client doesn't start the shell, only clicking on the
+        // root window does
+        xdata.press_button(LAUNCH_BUTTON, xdata.primary_mod_flag,
+                           client, None);
+        xdata.release_button(LAUNCH_BUTTON, 0, client);
+        run();
+        CHECK(launcher.launched.empty());
+
+        xdata.press_button(LAUNCH_BUTTON, xdata.primary_mod_flag,
+                           FAKE_ROOT, None);
+        run();
+        CHECK_EQUAL(1, launcher.launched.size());
+        CHECK_EQUAL(config.shell, launcher.launched[0]);
+    }
+
+    TEST_FIXTURE(PipelineFixture, test_launch_bindings)
+    {
+        WMConfig fresh;
+        fresh.key_commands.launch_bindings[KeyBinding(XK_t, false)] =
+            "xterm -e top";
+        fresh.key_commands.launch_bindings[KeyBinding(XK_t, true)] =
+            "xclock";
+
+        x_events.reload_config(fresh);
+        run();
+        CHECK(xdata.has_hotkey(XK_t, false));
+        CHECK(xdata.has_hotkey(XK_t, true));
+
+        xdata.press_key(XK_t, xdata.primary_mod_flag, None);
+        run();
+        xdata.press_key(XK_t,
+            xdata.primary_mod_flag | xdata.secondary_mod_flag, None);
+        run();
+
+        CHECK_EQUAL(2, launcher.launched.size());
+        CHECK_EQUAL(std::string("xterm -e top"), launcher.launched[0]);
+        CHECK_EQUAL(std::string("xclock"), launcher.launched[1]);
+
+        // Removing a binding releases its grab
+        WMConfig unbound;
+        x_events.reload_config(unbound);
+        run();
+        CHECK(!xdata.has_hotkey(XK_t, false));
+        CHECK(!xdata.has_hotkey(XK_t, true));
+    }
+
+    TEST_FIXTURE(PipelineFixture, test_restore_snapshot)
+    {
+        // These windows are left over from the SmallWM that restarted
+        FakeWindow desc;
+        desc.x = 100;
+        desc.y = 100;
+        desc.width = 300;
+        desc.height = 200;
+        desc.border_width = config.border_width;
+        desc.mapped = true;
+        Window visible = xdata.create_client(desc);
+        Window stuck = xdata.create_client(desc);
+        Window dialog = xdata.create_client(desc);
+
+        desc.mapped = false;
+        Window hidden = xdata.create_client(desc);
+        Window iconified = xdata.create_client(desc);
+
+        // This one was mapped while no window manager was running
+        desc.mapped = true;
+        desc.border_width = 0;
+        Window fresh = xdata.create_client(desc);
+
+        Snapshot snapshot;
+        snapshot.current_desktop = 1;
+        snapshot.focused = visible;
+
+        ClientState state;
+        state.location = Dimension2D(100, 100);
+        state.size = Dimension2D(300, 200);
+        state.autofocus = true;
+
+        state.client = visible;
+        state.desktop = 1;
+        state.layer = 8;
+        state.children.push_back(dialog);
+        snapshot.clients.push_back(state);
+        state.children.clear();
+        state.layer = DEF_LAYER;
+
+        state.client = stuck;
+        state.stuck = true;
+        snapshot.clients.push_back(state);
+        state.stuck = false;
+
+        state.client = hidden;
+        state.desktop = 2;
+        snapshot.clients.push_back(state);
+
+        state.client = iconified;
+        state.iconified = true;
+        snapshot.clients.push_back(state);
+        state.iconified = false;
+
+        // This client was destroyed during the restart
+        state.client = 0xdead;
+        snapshot.clients.push_back(state);
+
+        std::vector<Window> existing;
+        xdata.get_windows(existing);
+        stats.reset();
+
+        x_events.restore(snapshot, existing);
+        run();
+
+        CHECK_EQUAL(1, clients.get_current_desktop());
+        CHECK_EQUAL(clients.USER_DESKTOPS[1], clients.find_desktop(visible));
+        CHECK_EQUAL(visible, clients.get_parent_of(dialog));
+        CHECK_EQUAL(8, clients.find_layer(visible));
+        CHECK_EQUAL(clients.ALL_DESKTOPS, clients.find_desktop(stuck));
+        CHECK_EQUAL(clients.USER_DESKTOPS[2], clients.find_desktop(hidden));
+        CHECK_EQUAL(clients.ICON_DESKTOP, clients.find_desktop(iconified));
+        CHECK(!clients.is_client(0xdead));
+
+        CHECK(xdata.find_window(visible)->mapped);
+        CHECK(xdata.find_window(stuck)->mapped);
+        CHECK(!xdata.find_window(hidden)->mapped);
+        CHECK(!xdata.find_window(iconified)->mapped);
+        CHECK(xmodel.find_icon_from_client(iconified) != NULL);
+
+        // Clicks have to be grabbed again, since grabs don't outlive the
+        // connection that made them
+        CHECK(xdata.find_window(stuck)->click_grabbed);
+        CHECK(xdata.find_window(dialog)->click_grabbed);
+
+        // Only the window that SmallWM didn't know about before is examined
+        // (getting its attributes takes two round-trips)
+        CHECK(clients.is_client(fresh));
+        CHECK_EQUAL(config.border_width, xdata.find_window(fresh)->border_width);
+        CHECK_EQUAL(2, stats.round_trips(SR_GET_ATTRIBUTES));
+        CHECK_EQUAL(1, stats.requests(SR_SET_BORDER_WIDTH));
+    }
+
+    TEST_FIXTURE(PipelineFixture, test_window_rules)
+    {
+        WindowRule rule;
+        rule.patterns.push_back(
+            std::make_pair(RF_TITLE, std::string("* - Editor")));
+        rule.actions.actions = ACT_SETLAYER | ACT_NOFOCUS;
+        rule.actions.layer = 7;
+        config.rules.add_rule(rule);
+        config.rules.compile();
+
+        Window first = new_client();
+
+        FakeWindow desc;
+        desc.x = 100;
+        desc.y = 100;
+        desc.width = 300;
+        desc.height = 200;
+        desc.title = "notes.txt - Editor";
+
+        Window editor = xdata.create_client(desc);
+        xdata.client_map(editor);
+        run();
+
+        // The rule matched the title, so the new window isn't focused
+        CHECK_EQUAL(7, clients.find_layer(editor));
+        CHECK_EQUAL(first, clients.get_focused());
+        CHECK(clients.find_layer(first) != 7);
+    }
+}
+
+int main()
+{
+    return UnitTest::RunAllTests();
+}
@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+#include <UnitTest++.h>
+#include "model/slab.h"
+
+/// What a Counted's marker is set to while it is alive
+const int MAGIC = 0x5a5a5a5a;
+
+/**
+ * Keeps track of how many of itself exist, so that the tests can tell if a
+ * Slab ever loses or double-frees an object.
+ */
+struct Counted
+{
+    Counted(int _value) :
+        value(_value), alive(MAGIC)
+    { live++; }
+
+    ~Counted()
+    {
+        // A double destroy would see the poisoned marker from the first one
+        CHECK_EQUAL(MAGIC, alive);
+        alive = 0;
+        live--;
+    }
+
+    /// How many Counteds haven't been destroyed
+    static int live;
+
+    int value;
+    int alive;
+};
+
+int Counted::live = 0;
+
+SUITE(SlabSuite)
+{
+    TEST(test_create_and_destroy)
+    {
+        Slab<Counted> slab;
+        CHECK_EQUAL(static_cast<Counted*>(0), slab.get(Slab<Counted>::Handle()));
+
+        Slab<Counted>::Handle first = slab.create(1);
+        Slab<Counted>::Handle second = slab.create(2);
+        CHECK_EQUAL(2, slab.size());
+        CHECK_EQUAL(2, Counted::live);
+        CHECK_EQUAL(1, slab.get(first)->value);
+        CHECK_EQUAL(2, slab.get(second)->value);
+
+        CHECK(slab.destroy(first));
+        CHECK(!slab.destroy(first));
+        CHECK_EQUAL(static_cast<Counted*>(0), slab.get(first));
+        CHECK_EQUAL(1, slab.size());
+        CHECK_EQUAL(1, Counted::live);
+
+        // The new object goes where the old one was, but the old handle
+        // doesn't see it
+        Slab<Counted>::Handle third = slab.create(3);
+        CHECK_EQUAL(first.index, third.index);
+        CHECK(first != third);
+        CHECK_EQUAL(static_cast<Counted*>(0), slab.get(first));
+        CHECK_EQUAL(3, slab.get(third)->value);
+        CHECK_EQUAL(2, slab.capacity());
+    }
+
+    TEST(test_clear)
+    {
+        std::vector<Slab<Counted>::Handle> handles;
+        {
+            Slab<Counted> slab;
+            for (int i = 0; i < 100; i++)
+                handles.push_back(slab.create(i));
+
+            Counted *first = slab.get(handles[0]);
+            slab.clear();
+            CHECK_EQUAL(0, slab.size());
+            CHECK_EQUAL(0, Counted::live);
+
+            for (size_t i = 0; i < handles.size(); i++)
+                CHECK_EQUAL(static_cast<Counted*>(0), slab.get(handles[i]));
+
+            // The storage is kept, and the first slots are used first
+            Slab<Counted>::Handle again = slab.create(42);
+            CHECK_EQUAL(first, slab.get(again));
+            CHECK_EQUAL(100, slab.capacity());
+        }
+
+        // Anything left when the slab goes away is destroyed with it
+        CHECK_EQUAL(0, Counted::live);
+    }
+
+    TEST(test_stress)
+    {
+        // Randomly create and destroy objects, and make sure that no handle
+        // ever sees an object other than its own, and that nothing leaks
+        std::srand(1234);
+
+        {
+            Slab<Counted> slab;
+            std::vector<Slab<Counted>::Handle> live, dead;
+            std::vector<int> values;
+            size_t most_live = 0;
+
+            for (int step = 0; step < 100000; step++)
+            {
+                if (live.empty() || std::rand() % 3 != 0)
+                {
+                    live.push_back(slab.create(step));
+                    values.push_back(step);
+                    most_live = std::max(most_live, live.size());
+                }
+                else
+                {
+                    size_t victim = std::rand() % live.size();
+                    CHECK(slab.destroy(live[victim]));
+                    dead.push_back(live[victim]);
+
+                    live[victim] = live.back();
+                    live.pop_back();
+                    values[victim] = values.back();
+                    values.pop_back();
+                }
+
+                if (step % 1000 == 0)
+                {
+                    for (size_t i = 0; i < live.size(); i++)
+                        CHECK_EQUAL(values[i], slab.get(live[i])->value);
+
+                    for (size_t i = 0; i < dead.size(); i++)
+                        CHECK_EQUAL(static_cast<Counted*>(0),
+                                    slab.get(dead[i]));
+                }
+            }
+
+            CHECK_EQUAL(live.size(), slab.size());
+            CHECK_EQUAL(static_cast<int>(live.size()), Counted::live);
+
+            // Slots are reused, so the slab never gets bigger than the most
+            // objects that were alive at once
+            CHECK_EQUAL(most_live, slab.capacity());
+        }
+
+        CHECK_EQUAL(0, Counted::live);
+    }
+}
+
+int main()
+{
+    return UnitTest::RunAllTests();
+}
@@ -0,0 +1,129 @@
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <UnitTest++.h>
+#include "snapshot.h"
+
+const char *snapshot_path = "/tmp/smallwm-test-snapshot";
+
+struct SnapshotFixture
+{
+    SnapshotFixture() :
+        clients(changes, manager, 3, 1)
+    {
+        std::vector<Box> screens;
+        screens.push_back(Box(0, 0, 100, 100));
+        screens.push_back(Box(100, 0, 100, 100));
+        manager.rebuild_graph(screens);
+    }
+
+    ~SnapshotFixture()
+    {
+        std::remove(snapshot_path);
+    }
+
+    CrtManager manager;
+    ChangeStream changes;
+    ClientModel clients;
+};
+
+SUITE(SnapshotSuite)
+{
+    TEST_FIXTURE(SnapshotFixture, test_round_trip)
+    {
+        clients.add_client(1, IS_VISIBLE, Dimension2D(-5, 10),
+                           Dimension2D(50, 60), true);
+        clients.add_child(1, 3);
+        clients.set_layer(1, MAX_LAYER);
+
+        clients.add_client(2, IS_VISIBLE, Dimension2D(150, 20),
+                           Dimension2D(500, 70), true);
+        clients.pack_client(2, PACK_NORTHWEST, 1000);
+        clients.client_next_desktop(2);
+        clients.next_desktop();
+
+        Snapshot saved;
+        saved.take(clients, manager);
+
+        CHECK_EQUAL(1, saved.current_desktop);
+        CHECK_EQUAL(2, saved.screens.size());
+        CHECK_EQUAL(2, saved.clients.size());
+
+        SnapshotWriter writer;
+        CHECK(writer.write(snapshot_path, saved));
+
+        Snapshot loaded;
+        SnapshotReader reader;
+        CHECK(reader.read(snapshot_path, loaded));
+
+        CHECK_EQUAL(saved.current_desktop, loaded.current_desktop);
+        CHECK_EQUAL(saved.focused, loaded.focused);
+
+        CHECK_EQUAL(saved.screens.size(), loaded.screens.size());
+        for (int idx = 0; idx < saved.screens.size(); idx++)
+            CHECK(saved.screens[idx] == loaded.screens[idx]);
+
+        CHECK_EQUAL(saved.clients.size(), loaded.clients.size());
+        for (int idx = 0; idx < saved.clients.size(); idx++)
+        {
+            const ClientState &expected = saved.clients[idx];
+            const ClientState &actual = loaded.clients[idx];
+
+            CHECK_EQUAL(expected.client, actual.client);
+            CHECK_EQUAL(expected.desktop, actual.desktop);
+            CHECK_EQUAL(expected.stuck, actual.stuck);
+            CHECK_EQUAL(expected.iconified, actual.iconified);
+            CHECK_EQUAL(expected.layer, actual.layer);
+            CHECK(expected.location == actual.location);
+            CHECK(expected.size == actual.size);
+            CHECK_EQUAL(expected.mode, actual.mode);
+            CHECK_EQUAL(expected.autofocus, actual.autofocus);
+            CHECK_EQUAL(expected.packed, actual.packed);
+            CHECK_EQUAL(expected.pack_corner, actual.pack_corner);
+            CHECK_EQUAL(expected.pack_priority, actual.pack_priority);
+            CHECK(expected.children == actual.children);
+        }
+    }
+
+    TEST_FIXTURE(SnapshotFixture, test_bad_snapshot)
+    {
+        Snapshot loaded;
+        SnapshotReader reader;
+        CHECK(!reader.read(snapshot_path, loaded));
+
+        std::ofstream garbage(snapshot_path);
+        garbage << "SWMSTATE but not really";
+        garbage.close();
+        CHECK(!reader.read(snapshot_path, loaded));
+
+        // A snapshot that was cut short can't be used either
+        clients.add_client(1, IS_VISIBLE, Dimension2D(0, 0),
+                           Dimension2D(50, 60), true);
+
+        Snapshot saved;
+        saved.take(clients, manager);
+
+        SnapshotWriter writer;
+        CHECK(writer.write(snapshot_path, saved));
+
+        std::string contents;
+        {
+            std::ifstream input(snapshot_path, std::ifstream::binary);
+            contents.assign(std::istreambuf_iterator<char>(input),
+                            std::istreambuf_iterator<char>());
+        }
+
+        std::ofstream truncated(snapshot_path,
+                                std::ofstream::binary | std::ofstream::trunc);
+        truncated << contents.substr(0, contents.size() - 1);
+        truncated.close();
+        CHECK(!reader.read(snapshot_path, loaded));
+    }
+}
+
+int main()
+{
+    return UnitTest::RunAllTests();
+}
@@ -0,0 +1,149 @@
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include <UnitTest++.h>
+#include "state-dump.h"
+
+const char *dump_path = "/tmp/smallwm-test-dump";
+
+struct StateDumpFixture
+{
+    StateDumpFixture() :
+        clients(changes, manager, 3, 1)
+    {
+        std::vector<Box> screens;
+        screens.push_back(Box(0, 0, 100, 100));
+        screens.push_back(Box(100, 0, 100, 100));
+        manager.rebuild_graph(screens);
+
+        std::remove(dump_path);
+    }
+
+    ~StateDumpFixture()
+    {
+        std::remove(dump_path);
+    }
+
+    CrtManager manager;
+    ChangeStream changes;
+    ClientModel clients;
+    Stats stats;
+};
+
+SUITE(StateDumpSuite)
+{
+    TEST_FIXTURE(StateDumpFixture, test_json)
+    {
+        clients.add_client(1, IS_VISIBLE, Dimension2D(-5, 10),
+                           Dimension2D(50, 60), true);
+        clients.add_child(1, 3);
+        clients.change_mode(1, CPS_MAX);
+
+        clients.add_client(2, IS_VISIBLE, Dimension2D(150, 20),
+                           Dimension2D(50, 70), true);
+        clients.toggle_stick(2);
+        clients.pack_client(2, PACK_SOUTHEAST, 9);
+        stats.add_count(SC_ICON_POOL_HIT, 3);
+
+        StateDump dump;
+        dump.take(clients, manager, stats);
+
+        std::stringstream output;
+        output << std::hex;
+        dump.write_json(output);
+
+        std::string json = output.str();
+        CHECK(json.find('\n') == std::string::npos);
+        CHECK_EQUAL(0, json.find("{\"version\":1,"));
+        CHECK(json.find("\"current_desktop\":0,\"focused\":2,") !=
+              std::string::npos);
+        CHECK(json.find("\"screens\":[{\"x\":0,\"y\":0,\"width\":100,"
+                        "\"height\":100},{\"x\":100,\"y\":0,\"width\":100,"
+                        "\"height\":100}]") != std::string::npos);
+
+        CHECK(json.find("{\"window\":1,\"desktop\":0,\"stuck\":false,"
+                        "\"iconified\":false,\"layer\":5,\"x\":-5,\"y\":10,"
+                        "\"width\":50,\"height\":60,\"mode\":\"max\","
+                        "\"autofocus\":true,\"pack\":null,\"children\":[3]}")
+              != std::string::npos);
+        CHECK(json.find("{\"window\":2,\"desktop\":null,\"stuck\":true,")
+              != std::string::npos);
+        CHECK(json.find("\"pack\":{\"corner\":\"southeast\",\"priority\":9}")
+              != std::string::npos);
+
+        CHECK(json.find("\"stats\":{\"version\":1,") != std::string::npos);
+        CHECK(json.find("\"icon_pool_hit\":3") != std::string::npos);
+    }
+
+    TEST_FIXTURE(StateDumpFixture, test_writer)
+    {
+        clients.add_client(1, IS_VISIBLE, Dimension2D(0, 0),
+                           Dimension2D(50, 60), true);
+
+        {
+            DumpWriter writer;
+
+            StateDump *dump = new StateDump();
+            dump->take(clients, manager, stats);
+            writer.write(dump_path, dump);
+
+            // The dump was copied, so changing the model now doesn't change
+            // what gets written
+            clients.remove_client(1);
+
+            dump = new StateDump();
+            dump->take(clients, manager, stats);
+            writer.write(dump_path, dump);
+
+            // The writer finishes everything it was given before it stops
+        }
+
+        std::ifstream input(dump_path);
+        std::vector<std::string> lines;
+        std::string line;
+        while (std::getline(input, line))
+            lines.push_back(line);
+
+        // The second dump might have replaced the first, if the writer
+        // didn't get to the first one in time - either way, the newest dump
+        // is always written
+        CHECK(lines.size() == 1 || lines.size() == 2);
+        if (lines.size() == 2)
+            CHECK(lines[0].find("{\"window\":1,") != std::string::npos);
+
+        if (!lines.empty())
+            CHECK(lines.back().find("\"clients\":[]") != std::string::npos);
+    }
+
+    TEST(test_writer_failure)
+    {
+        DumpWriter writer;
+        CHECK(!writer.take_failure());
+
+        {
+            StateDump *dump = new StateDump();
+            writer.write("/nonexistent/smallwm-dump", dump);
+        }
+
+        // Wait for the worker to get to it
+        bool failed = false;
+        for (int attempt = 0; attempt < 50 && !failed; attempt++)
+        {
+            failed = writer.take_failure();
+            if (!failed)
+                usleep(10000);
+        }
+
+        CHECK(failed);
+        CHECK(!writer.take_failure());
+    }
+}
+
+int main()
+{
+    return UnitTest::RunAllTests();
+}
@@ -0,0 +1,145 @@
+#include <sstream>
+#include <string>
+
+#include <UnitTest++.h>
+#include "stats.h"
+
+SUITE(HistogramSuite)
+{
+    TEST(test_small_values_are_exact)
+    {
+        // Every value below the sub-bucket count has its own bucket
+        for (uint64_t value = 0; value < Histogram::SUB_BUCKET_COUNT; value++)
+        {
+            int index = Histogram::index_of(value);
+            CHECK_EQUAL(value, Histogram::highest_equivalent(index));
+        }
+    }
+
+    TEST(test_bucket_bounds)
+    {
+        // Every value has to fit inside the bucket it is assigned to, and the
+        // bucket cannot be much larger than the value itself
+        uint64_t values[] = {
+            32, 33, 63, 64, 65, 100, 1000, 4095, 4096, 123456, 1000000007,
+            0xffffffffULL, 0x123456789abcULL, 0xffffffffffffffffULL
+        };
+
+        for (unsigned int idx = 0; idx < sizeof(values) / sizeof(*values); idx++)
+        {
+            int index = Histogram::index_of(values[idx]);
+            CHECK(index < Histogram::BUCKET_COUNT);
+
+            uint64_t upper = Histogram::highest_equivalent(index);
+            CHECK(upper >= values[idx]);
+            CHECK(upper - values[idx] <= values[idx] / (Histogram::SUB_BUCKET_HALF - 1));
+
+            if (index > 0)
+                CHECK(Histogram::highest_equivalent(index - 1) < values[idx]);
+        }
+    }
+
+    TEST(test_empty)
+    {
+        Histogram hist;
+        CHECK_EQUAL(0, hist.count());
+        CHECK_EQUAL(0, hist.min());
+        CHECK_EQUAL(0, hist.max());
+        CHECK_EQUAL(0, hist.percentile(50));
+    }
+
+    TEST(test_record)
+    {
+        Histogram hist;
+        for (uint64_t value = 1; value <= 1000; value++)
+            hist.record(value * 1000);
+
+        CHECK_EQUAL(1000, hist.count());
+        CHECK_EQUAL(1000, hist.min());
+        CHECK_EQUAL(1000000, hist.max());
+        CHECK_EQUAL(500500000, hist.total());
+
+        // Percentiles are only accurate to the precision of their bucket
+        CHECK_CLOSE(500000, hist.percentile(50), 500000 / 15);
+        CHECK_CLOSE(990000, hist.percentile(99), 990000 / 15);
+        CHECK_EQUAL(1000000, hist.percentile(100));
+        CHECK(hist.percentile(99.9) <= hist.max());
+
+        hist.reset();
+        CHECK_EQUAL(0, hist.count());
+        CHECK_EQUAL(0, hist.max());
+    }
+}
+
+SUITE(StatsSuite)
+{
+    TEST(test_counters)
+    {
+        Stats stats;
+        stats.add_requests(SR_MAP_WIN, 2);
+        stats.add_round_trips(SR_MAP_WIN, 1);
+        stats.add_round_trips(SR_GET_ATTRIBUTES, 2);
+
+        CHECK_EQUAL(3, stats.requests(SR_MAP_WIN));
+        CHECK_EQUAL(1, stats.round_trips(SR_MAP_WIN));
+        CHECK_EQUAL(2, stats.requests(SR_GET_ATTRIBUTES));
+        CHECK_EQUAL(2, stats.round_trips(SR_GET_ATTRIBUTES));
+        CHECK_EQUAL(0, stats.requests(SR_UNMAP_WIN));
+
+        // Suppressed requests were never sent, so they aren't requests
+        stats.add_suppressed(SR_UNMAP_WIN, 4);
+        CHECK_EQUAL(4, stats.suppressed(SR_UNMAP_WIN));
+        CHECK_EQUAL(0, stats.requests(SR_UNMAP_WIN));
+
+        stats.add_count(SC_ICON_POOL_MISS, 1);
+        stats.add_count(SC_ICON_POOL_MISS, 1);
+        CHECK_EQUAL(2, stats.count(SC_ICON_POOL_MISS));
+        CHECK_EQUAL(0, stats.count(SC_ICON_POOL_HIT));
+
+        stats.reset();
+        CHECK_EQUAL(0, stats.requests(SR_MAP_WIN));
+        CHECK_EQUAL(0, stats.round_trips(SR_GET_ATTRIBUTES));
+        CHECK_EQUAL(0, stats.suppressed(SR_UNMAP_WIN));
+        CHECK_EQUAL(0, stats.count(SC_ICON_POOL_MISS));
+    }
+
+    TEST(test_timer)
+    {
+        Stats stats;
+        {
+            StatsTimer timer(stats, SH_KEYPRESS);
+        }
+
+        CHECK_EQUAL(1, stats.handler(SH_KEYPRESS).count());
+        CHECK_EQUAL(0, stats.handler(SH_BUTTONPRESS).count());
+    }
+
+    TEST(test_dump)
+    {
+        Stats stats;
+        stats.record_handler(SH_FOCUS_CHANGE, 42);
+        stats.add_round_trips(SR_GET_INPUT_FOCUS, 7);
+        stats.add_count(SC_ICON_POOL_HIT, 3);
+
+        std::stringstream output;
+        output << std::hex;
+        stats.dump(output);
+
+        std::string json = output.str();
+        CHECK(json.find('\n') == std::string::npos);
+        CHECK(json.find("\"ClientModelEvents::handle_focus_change\":"
+                        "{\"count\":1,\"total_ns\":42,\"min_ns\":42,\"max_ns\":42")
+              != std::string::npos);
+        CHECK(json.find("\"XData::get_input_focus\":"
+                        "{\"requests\":7,\"round_trips\":7,\"suppressed\":0}")
+              != std::string::npos);
+        CHECK(json.find("\"counters\":{\"icon_pool_hit\":3,"
+                        "\"icon_pool_miss\":0}")
+              != std::string::npos);
+    }
+}
+
+int main()
+{
+    return UnitTest::RunAllTests();
+}
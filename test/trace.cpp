@@ -0,0 +1,251 @@
+#include <cstdio>
+#include <fstream>
+
+#include <UnitTest++.h>
+#include "fake/fake-xdata.h"
+#include "stats.h"
+#include "trace.h"
+#include "xdata.h"
+
+const Window the_root = 1,
+      the_client = 2,
+      the_parent = 3,
+      the_placeholder = 4;
+
+const char *trace_path = "/tmp/smallwm-test-trace";
+
+/**
+ * An XData which answers the queries made by TraceWriter from fixed data,
+ * without needing an X server.
+ */
+class StubXData : public FakeXData
+{
+public:
+    StubXData(Stats &stats) :
+        FakeXData(stats)
+    {
+        randr_event_offset = 100;
+    };
+
+    void get_attributes(Window window, XWindowAttributes &attr)
+    {
+        std::memset(&attr, 0, sizeof(attr));
+        attr.x = -10;
+        attr.y = window * 100;
+        attr.width = 640;
+        attr.height = 480;
+        attr.override_redirect = false;
+        attr.c_class = InputOutput;
+        attr.map_state = window == the_parent ? IsViewable : IsUnmapped;
+    }
+
+    Window get_transient_hint(Window window)
+    {
+        return window == the_client ? the_parent : None;
+    }
+
+    bool get_wm_hints(Window window, XWMHints &hints)
+    {
+        if (window != the_client)
+            return false;
+
+        hints.flags = StateHint | IconPixmapHint;
+        hints.initial_state = IconicState;
+        hints.input = true;
+        return true;
+    }
+
+    void get_class(Window window, std::string &xclass)
+    {
+        xclass = window == the_client ? "Client" : "Parent";
+    }
+
+    void get_icon_name(Window window, std::string &name)
+    {
+        name = window == the_client ? "client window" : "";
+    }
+
+    void get_screen_boxes(std::vector<Box> &boxes)
+    {
+        boxes.clear();
+        boxes.push_back(Box(0, 0, 1024, 768));
+        boxes.push_back(Box(1024, 0, 800, 600));
+    }
+
+    KeySym get_keysym(int keycode)
+    {
+        return XK_a + keycode;
+    }
+};
+
+struct TraceFixture
+{
+    TraceFixture() :
+        xdata(stats), writer(xdata)
+    {};
+
+    ~TraceFixture()
+    {
+        std::remove(trace_path);
+    };
+
+    Stats stats;
+    StubXData xdata;
+    TraceWriter writer;
+};
+
+SUITE(TraceSuite)
+{
+    TEST_FIXTURE(TraceFixture, test_header)
+    {
+        std::vector<Window> existing;
+        existing.push_back(the_client);
+        CHECK(writer.open(trace_path, existing));
+        writer.flush();
+
+        TraceReader reader;
+        TraceHeader header;
+        CHECK(reader.open(trace_path, header));
+
+        CHECK_EQUAL(Mod4Mask, header.primary_mod_flag);
+        CHECK_EQUAL(ControlMask, header.secondary_mod_flag);
+        CHECK_EQUAL(Mod2Mask, header.num_mod_flag);
+        CHECK_EQUAL(LockMask, header.caps_mod_flag);
+        CHECK_EQUAL(0, header.scroll_mod_flag);
+
+        CHECK_EQUAL(2, header.screens.size());
+        CHECK_EQUAL(Box(1024, 0, 800, 600), header.screens[1]);
+
+        // The client's parent has to be described first, since it is looked
+        // up when the client is added
+        CHECK_EQUAL(2, header.windows.size());
+        CHECK_EQUAL(the_parent, header.windows[0].window);
+        CHECK(header.windows[0].mapped);
+        CHECK_EQUAL(the_client, header.windows[1].window);
+        CHECK_EQUAL(-10, header.windows[1].x);
+        CHECK_EQUAL(200, header.windows[1].y);
+        CHECK_EQUAL(640, header.windows[1].width);
+        CHECK_EQUAL(480, header.windows[1].height);
+        CHECK(!header.windows[1].mapped);
+        CHECK_EQUAL(the_parent, header.windows[1].transient_for);
+        CHECK_EQUAL(StateHint, header.windows[1].hint_flags);
+        CHECK_EQUAL(IconicState, header.windows[1].initial_state);
+        CHECK_EQUAL(std::string("Client"), header.windows[1].win_class);
+        CHECK_EQUAL(std::string("client window"), header.windows[1].icon_name);
+
+        TraceItem item;
+        CHECK(!reader.next(item));
+        CHECK_EQUAL(TI_END, item.type);
+    }
+
+    TEST_FIXTURE(TraceFixture, test_events)
+    {
+        std::vector<Window> existing;
+        CHECK(writer.open(trace_path, existing));
+
+        XEvent event;
+        std::memset(&event, 0, sizeof(event));
+        event.type = MapRequest;
+        event.xmaprequest.window = the_client;
+        writer.record_event(event, monotonic_ns());
+
+        writer.record_created(the_placeholder);
+
+        std::memset(&event, 0, sizeof(event));
+        event.type = KeyPress;
+        event.xkey.window = the_root;
+        event.xkey.subwindow = the_client;
+        event.xkey.state = Mod4Mask;
+        event.xkey.keycode = 3;
+        event.xkey.x_root = -5;
+        event.xkey.y_root = 1000;
+        writer.record_event(event, monotonic_ns());
+
+        std::memset(&event, 0, sizeof(event));
+        event.type = ConfigureRequest;
+        event.xconfigurerequest.window = the_client;
+        event.xconfigurerequest.value_mask = CWX | CWWidth;
+        event.xconfigurerequest.x = -300;
+        event.xconfigurerequest.width = 70000;
+        writer.record_event(event, monotonic_ns());
+
+        std::memset(&event, 0, sizeof(event));
+        event.type = 100 + RRNotify;
+        writer.record_event(event, monotonic_ns());
+        writer.flush();
+
+        TraceReader reader;
+        TraceHeader header;
+        CHECK(reader.open(trace_path, header));
+        CHECK_EQUAL(0, header.windows.size());
+
+        // The MapRequest introduces the client, so it (and its parent) are
+        // described before the event itself
+        TraceItem item;
+        CHECK(reader.next(item));
+        CHECK_EQUAL(TI_WINDOW, item.type);
+        CHECK_EQUAL(the_parent, item.window.window);
+
+        CHECK(reader.next(item));
+        CHECK_EQUAL(TI_WINDOW, item.type);
+        CHECK_EQUAL(the_client, item.window.window);
+
+        CHECK(reader.next(item));
+        CHECK_EQUAL(TI_EVENT, item.type);
+        CHECK_EQUAL(MapRequest, item.event.type);
+        CHECK_EQUAL(the_client, item.event.xmaprequest.window);
+        uint64_t last_timestamp = item.timestamp_ns;
+
+        CHECK(reader.next(item));
+        CHECK_EQUAL(TI_CREATE, item.type);
+        CHECK_EQUAL(the_placeholder, item.created);
+
+        CHECK(reader.next(item));
+        CHECK_EQUAL(TI_EVENT, item.type);
+        CHECK_EQUAL(KeyPress, item.event.type);
+        CHECK_EQUAL(the_root, item.event.xkey.window);
+        CHECK_EQUAL(the_client, item.event.xkey.subwindow);
+        CHECK_EQUAL(Mod4Mask, item.event.xkey.state);
+        CHECK_EQUAL(3, item.event.xkey.keycode);
+        CHECK_EQUAL(-5, item.event.xkey.x_root);
+        CHECK_EQUAL(1000, item.event.xkey.y_root);
+        CHECK_EQUAL(XK_a + 3, item.keysym);
+        CHECK(item.timestamp_ns >= last_timestamp);
+
+        // The client was already described, so it shouldn't be described
+        // again
+        CHECK(reader.next(item));
+        CHECK_EQUAL(TI_EVENT, item.type);
+        CHECK_EQUAL(ConfigureRequest, item.event.type);
+        CHECK_EQUAL(the_client, item.event.xconfigurerequest.window);
+        CHECK_EQUAL(CWX | CWWidth, item.event.xconfigurerequest.value_mask);
+        CHECK_EQUAL(-300, item.event.xconfigurerequest.x);
+        CHECK_EQUAL(70000, item.event.xconfigurerequest.width);
+
+        CHECK(reader.next(item));
+        CHECK_EQUAL(TI_EVENT, item.type);
+        CHECK_EQUAL(TRACE_RRNOTIFY, item.event.type);
+        CHECK_EQUAL(2, item.screens.size());
+        CHECK_EQUAL(Box(0, 0, 1024, 768), item.screens[0]);
+
+        CHECK(!reader.next(item));
+    }
+
+    TEST(test_bad_trace)
+    {
+        std::ofstream bad_trace(trace_path);
+        bad_trace << "not a trace";
+        bad_trace.close();
+
+        TraceReader reader;
+        TraceHeader header;
+        CHECK(!reader.open(trace_path, header));
+
+        std::remove(trace_path);
+    }
+}
+
+int main()
+{
+    return UnitTest::RunAllTests();
+}
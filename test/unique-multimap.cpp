@@ -84,6 +84,29 @@ SUITE(UniqueMultimapTests)
         }
     }
 
+    /**
+     * Ensures that the members of a category come out sorted, no matter what
+     * order they were added in.
+     */
+    TEST_FIXTURE(UniqueMultimapFixture, test_get_members_of_sorted)
+    {
+        multimap.add_member(1, 15);
+        multimap.add_member(1, -3);
+        multimap.add_member(1, 12);
+
+        int expected[] = {-3, 1, 3, 5, 7, 9, 12, 15};
+        int index = 0;
+        for (UniqueMultimap<int,int>::member_iter iter =
+                multimap.get_members_of_begin(1);
+            iter != multimap.get_members_of_end(1);
+            ++iter, index++)
+        {
+            CHECK_EQUAL(*iter, expected[index]);
+        }
+
+        CHECK_EQUAL(index, 8);
+    }
+
     /**
      * Ensures that counting the members of a category returns the correct
      * number of values.
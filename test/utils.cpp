@@ -50,6 +50,29 @@ TEST(test_try_parse_ulong_nonzero)
     CHECK_EQUAL(try_parse_ulong_nonzero("0", 42), 42);
 }
 
+/**
+ * Stores whether SIGHUP is blocked on the current thread.
+ */
+static void check_sighup_blocked(bool *blocked)
+{
+    sigset_t mask;
+    pthread_sigmask(SIG_SETMASK, NULL, &mask);
+    *blocked = sigismember(&mask, SIGHUP);
+}
+
+TEST(test_start_thread_without_signals)
+{
+    bool blocked = false;
+    std::thread worker = start_thread_without_signals(check_sighup_blocked,
+                                                      &blocked);
+    worker.join();
+    CHECK(blocked);
+
+    // The thread which started the worker gets its own mask back
+    check_sighup_blocked(&blocked);
+    CHECK(!blocked);
+}
+
 int main()
 {
     return UnitTest::RunAllTests();
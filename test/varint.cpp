@@ -0,0 +1,75 @@
+#include <sstream>
+#include <string>
+
+#include <UnitTest++.h>
+#include "varint.h"
+
+SUITE(VarintSuite)
+{
+    TEST(test_round_trip)
+    {
+        const uint64_t values[] = {0, 1, 127, 128, 300, 0xffffffff,
+                                   0xffffffffffffffffULL};
+
+        std::string buffer;
+        for (size_t idx = 0; idx < sizeof(values) / sizeof(values[0]); idx++)
+            append_varint(buffer, values[idx]);
+
+        // Small values only take a single byte, and the largest take ten
+        CHECK_EQUAL(1 + 1 + 1 + 2 + 2 + 5 + VARINT_MAX_BYTES, buffer.size());
+
+        const unsigned char *pos =
+            reinterpret_cast<const unsigned char*>(buffer.data());
+        const unsigned char *end = pos + buffer.size();
+
+        std::istringstream stream(buffer);
+        for (size_t idx = 0; idx < sizeof(values) / sizeof(values[0]); idx++)
+        {
+            uint64_t decoded;
+            CHECK(decode_varint(pos, end, decoded));
+            CHECK_EQUAL(values[idx], decoded);
+
+            CHECK(read_varint(stream, decoded));
+            CHECK_EQUAL(values[idx], decoded);
+        }
+
+        CHECK(pos == end);
+    }
+
+    TEST(test_zigzag)
+    {
+        CHECK_EQUAL(0, zigzag_encode(0));
+        CHECK_EQUAL(1, zigzag_encode(-1));
+        CHECK_EQUAL(2, zigzag_encode(1));
+        CHECK_EQUAL(3, zigzag_encode(-2));
+
+        const int64_t values[] = {0, -1, 1, -300, 300, INT64_MIN, INT64_MAX};
+        for (size_t idx = 0; idx < sizeof(values) / sizeof(values[0]); idx++)
+            CHECK_EQUAL(values[idx], zigzag_decode(zigzag_encode(values[idx])));
+    }
+
+    TEST(test_truncated)
+    {
+        std::string buffer;
+        append_varint(buffer, 300);
+        buffer.resize(1);
+
+        const unsigned char *pos =
+            reinterpret_cast<const unsigned char*>(buffer.data());
+        uint64_t decoded;
+        CHECK(!decode_varint(pos, pos + buffer.size(), decoded));
+
+        std::istringstream stream(buffer);
+        CHECK(!read_varint(stream, decoded));
+
+        // Anything longer than ten bytes can't be a 64-bit integer
+        std::string too_long(VARINT_MAX_BYTES + 1, '\x80');
+        std::istringstream long_stream(too_long);
+        CHECK(!read_varint(long_stream, decoded));
+    }
+}
+
+int main()
+{
+    return UnitTest::RunAllTests();
+}
@@ -0,0 +1,222 @@
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <UnitTest++.h>
+#include "window-rules.h"
+
+/**
+ * Matches a string against a GlobMatcher, and gives back the matching
+ * patterns in order.
+ */
+std::vector<size_t> glob_match(GlobMatcher &globs, const std::string &text)
+{
+    std::vector<size_t> matches;
+    globs.match(text, matches);
+    std::sort(matches.begin(), matches.end());
+    return matches;
+}
+
+/**
+ * Creates a rule which matches a single field.
+ */
+WindowRule make_rule(RuleField field, const std::string &pattern,
+                     unsigned int actions)
+{
+    WindowRule rule;
+    rule.patterns.push_back(std::make_pair(field, pattern));
+    rule.actions.actions = actions;
+    return rule;
+}
+
+SUITE(GlobMatcherSuite)
+{
+    TEST(test_literal)
+    {
+        GlobMatcher globs;
+        globs.add("xterm");
+
+        CHECK_EQUAL(1, glob_match(globs, "xterm").size());
+        CHECK_EQUAL(0, glob_match(globs, "xterm2").size());
+        CHECK_EQUAL(0, glob_match(globs, "xter").size());
+        CHECK_EQUAL(0, glob_match(globs, "").size());
+    }
+
+    TEST(test_wildcards)
+    {
+        GlobMatcher globs;
+        size_t prefix = globs.add("Fire*");
+        size_t suffix = globs.add("*fox");
+        size_t single = globs.add("F?refox");
+        size_t any = globs.add("*");
+        globs.add("a*b*c");
+
+        std::vector<size_t> matches = glob_match(globs, "Firefox");
+        CHECK_EQUAL(4, matches.size());
+        CHECK_EQUAL(prefix, matches[0]);
+        CHECK_EQUAL(suffix, matches[1]);
+        CHECK_EQUAL(single, matches[2]);
+        CHECK_EQUAL(any, matches[3]);
+
+        // A '*' can match nothing at all
+        matches = glob_match(globs, "Fire");
+        CHECK_EQUAL(2, matches.size());
+        CHECK_EQUAL(prefix, matches[0]);
+
+        matches = glob_match(globs, "");
+        CHECK_EQUAL(1, matches.size());
+        CHECK_EQUAL(any, matches[0]);
+
+        CHECK_EQUAL(2, glob_match(globs, "abc").size());
+        CHECK_EQUAL(2, glob_match(globs, "axxbyybc").size());
+        CHECK_EQUAL(1, glob_match(globs, "axxbyy").size());
+    }
+
+    TEST(test_repeated_matches)
+    {
+        // The DFA is built up as it goes, so the same string should give the
+        // same answer every time
+        GlobMatcher globs;
+        globs.add("*term*");
+        globs.add("x*");
+
+        for (int repeat = 0; repeat < 3; repeat++)
+        {
+            CHECK_EQUAL(2, glob_match(globs, "xterm").size());
+            CHECK_EQUAL(1, glob_match(globs, "urxvt-terminal").size());
+            CHECK_EQUAL(0, glob_match(globs, "emacs").size());
+        }
+    }
+}
+
+SUITE(WindowRulesSuite)
+{
+    TEST(test_no_rules)
+    {
+        WindowRules rules;
+        rules.compile();
+
+        WindowProperties props;
+        props.values[RF_CLASS] = "xterm";
+
+        ClassActions action;
+        CHECK(!rules.match(props, action));
+        CHECK_EQUAL(0, action.actions);
+        CHECK(!rules.uses(RF_CLASS));
+    }
+
+    TEST(test_all_patterns_must_match)
+    {
+        WindowRules rules;
+
+        WindowRule rule;
+        rule.patterns.push_back(std::make_pair(RF_CLASS, std::string("Fire*")));
+        rule.patterns.push_back(std::make_pair(RF_TYPE, std::string("dialog")));
+        rule.actions.actions = ACT_STICK;
+        rules.add_rule(rule);
+        rules.compile();
+
+        WindowProperties props;
+        props.values[RF_CLASS] = "Firefox";
+        props.values[RF_TYPE] = "normal";
+
+        ClassActions action;
+        CHECK(!rules.match(props, action));
+
+        props.values[RF_TYPE] = "dialog";
+        CHECK(rules.match(props, action));
+        CHECK(action.actions & ACT_STICK);
+    }
+
+    TEST(test_literal_rules)
+    {
+        // Literal rules don't treat '*' as a wildcard
+        WindowRules rules;
+        WindowRule rule = make_rule(RF_CLASS, "odd*", ACT_STICK);
+        rule.literal = true;
+        rules.add_rule(rule);
+        rules.compile();
+
+        WindowProperties props;
+        ClassActions action;
+
+        props.values[RF_CLASS] = "oddity";
+        CHECK(!rules.match(props, action));
+
+        props.values[RF_CLASS] = "odd*";
+        CHECK(rules.match(props, action));
+    }
+
+    TEST(test_later_rules_win)
+    {
+        WindowRules rules;
+
+        WindowRule low = make_rule(RF_CLASS, "*", ACT_SETLAYER | ACT_PACK);
+        low.actions.layer = 2;
+        rules.add_rule(low);
+
+        WindowRule high = make_rule(RF_CLASS, "term", ACT_SETLAYER | ACT_MOVE_X);
+        high.actions.layer = 8;
+        high.actions.relative_x = 0.5;
+        rules.add_rule(high);
+        rules.compile();
+
+        WindowProperties props;
+        props.values[RF_CLASS] = "term";
+
+        ClassActions action;
+        CHECK(rules.match(props, action));
+        CHECK_EQUAL(8, action.layer);
+
+        // Moving the window cancels out the packing from the earlier rule
+        CHECK(action.actions & ACT_MOVE_X);
+        CHECK(!(action.actions & ACT_PACK));
+
+        // Other windows only get the catch-all rule
+        props.values[RF_CLASS] = "other";
+        action = ClassActions();
+        CHECK(rules.match(props, action));
+        CHECK_EQUAL(2, action.layer);
+        CHECK(action.actions & ACT_PACK);
+    }
+
+    TEST(test_many_rules)
+    {
+        // Only the rules which match should apply, no matter how many others
+        // there are
+        WindowRules rules;
+        for (int idx = 0; idx < 500; idx++)
+        {
+            char name[32];
+            std::snprintf(name, sizeof(name), "app-%d", idx);
+            rules.add_rule(make_rule(RF_CLASS, name, ACT_STICK));
+
+            std::snprintf(name, sizeof(name), "*-title-%d", idx);
+            rules.add_rule(make_rule(RF_TITLE, name, ACT_MAXIMIZE));
+        }
+        rules.compile();
+        CHECK_EQUAL(1000, rules.size());
+
+        WindowProperties props;
+        props.values[RF_CLASS] = "app-250";
+        props.values[RF_TITLE] = "nothing";
+
+        ClassActions action;
+        CHECK(rules.match(props, action));
+        CHECK(action.actions & ACT_STICK);
+        CHECK(!(action.actions & ACT_MAXIMIZE));
+
+        props.values[RF_CLASS] = "none";
+        props.values[RF_TITLE] = "some-title-499";
+        action = ClassActions();
+        CHECK(rules.match(props, action));
+        CHECK(!(action.actions & ACT_STICK));
+        CHECK(action.actions & ACT_MAXIMIZE);
+    }
+}
+
+int main()
+{
+    return UnitTest::RunAllTests();
+}
@@ -28,7 +28,7 @@ SUITE(XModelMemberSuite)
     {
         // Ensure that using the getters on a registered icon return expected
         // results
-        Icon *icon_data = new Icon(the_client, the_icon, NULL_OF(XGC));
+        Icon *icon_data = model.create_icon(the_client, the_icon, NULL_OF(XGC));
         model.register_icon(icon_data);
 
         CHECK_EQUAL(model.find_icon_from_client(the_client), icon_data);
@@ -38,18 +38,16 @@ SUITE(XModelMemberSuite)
         model.get_icons(icons);
         CHECK_EQUAL(icons.size(), 1);
         CHECK_EQUAL(icons[0], icon_data);
-
-        delete icon_data;
     }
 
     TEST_FIXTURE(XModelFixture, test_icon_list_with_multiple_icons)
     {
-        Icon *icon_data = new Icon(the_client, the_icon, NULL_OF(XGC));
+        Icon *icon_data = model.create_icon(the_client, the_icon, NULL_OF(XGC));
         model.register_icon(icon_data);
 
         const Window the_other_client = 4,
               the_other_icon = 5;
-        Icon *icon_data2 = new Icon(the_other_client, the_other_icon, NULL_OF(XGC));
+        Icon *icon_data2 = model.create_icon(the_other_client, the_other_icon, NULL_OF(XGC));
         model.register_icon(icon_data2);
 
         std::vector<Icon*> icons;
@@ -64,7 +62,7 @@ SUITE(XModelMemberSuite)
     TEST_FIXTURE(XModelFixture, test_icon_getters_with_removed_icon)
     {
         // First, add an icon and ensure that data from the icon is produced
-        Icon *icon_data = new Icon(the_client, the_icon, NULL_OF(XGC));
+        Icon *icon_data = model.create_icon(the_client, the_icon, NULL_OF(XGC));
         model.register_icon(icon_data);
 
         CHECK_EQUAL(model.find_icon_from_client(the_client), icon_data);
@@ -73,7 +71,7 @@ SUITE(XModelMemberSuite)
         // Lastly, ensure that the unregistered icon provides the same results
         // as when no client was registered at all
         model.unregister_icon(icon_data);
-        delete icon_data;
+        model.destroy_icon(icon_data);
         CHECK_EQUAL(model.find_icon_from_client(the_client), NULL_OF(Icon));
         CHECK_EQUAL(model.find_icon_from_icon_window(the_icon), NULL_OF(Icon));
 
@@ -88,6 +86,111 @@ SUITE(XModelMemberSuite)
         CHECK_EQUAL(icons.size(), 0);
     }
 
+    TEST_FIXTURE(XModelFixture, test_icon_pool)
+    {
+        // Nothing can be reused until an icon has been put into the pool
+        CHECK_EQUAL(model.reuse_icon(the_client), NULL_OF(Icon));
+
+        Icon *icon_data = model.create_icon(the_client, the_icon, NULL_OF(XGC));
+        CHECK(model.recycle_icon(icon_data));
+        CHECK_EQUAL(icon_data->client, None);
+
+        Icon *reused = model.reuse_icon(the_client + 1);
+        CHECK_EQUAL(reused, icon_data);
+        CHECK_EQUAL(reused->client, the_client + 1);
+        CHECK_EQUAL(reused->icon, the_icon);
+        CHECK_EQUAL(model.reuse_icon(the_client), NULL_OF(Icon));
+
+        // Once the pool is full, the caller has to get rid of extra icons
+        std::vector<Icon*> icons;
+        for (size_t i = 0; i < ICON_POOL_SIZE; i++)
+        {
+            icons.push_back(model.create_icon(the_client, the_icon + i,
+                                              NULL_OF(XGC)));
+            CHECK(model.recycle_icon(icons.back()));
+        }
+
+        CHECK(!model.recycle_icon(icon_data));
+
+        model.destroy_icon(icon_data);
+        for (size_t i = 0; i < ICON_POOL_SIZE; i++)
+            CHECK(model.reuse_icon(the_client) != NULL_OF(Icon));
+
+        for (size_t i = 0; i < icons.size(); i++)
+            model.destroy_icon(icons[i]);
+    }
+
+    TEST_FIXTURE(XModelFixture, test_stale_icon_handles)
+    {
+        CHECK_EQUAL(model.get_icon(IconHandle()), NULL_OF(Icon));
+
+        Icon *icon_data = model.create_icon(the_client, the_icon, NULL_OF(XGC));
+        IconHandle old_handle = icon_data->handle;
+        CHECK_EQUAL(model.get_icon(old_handle), icon_data);
+
+        model.destroy_icon(icon_data);
+        CHECK_EQUAL(model.get_icon(old_handle), NULL_OF(Icon));
+
+        // The next icon takes over the old one's storage, but the old handle
+        // still doesn't refer to it
+        Icon *new_icon = model.create_icon(the_client + 1, the_icon + 1,
+                                           NULL_OF(XGC));
+        CHECK_EQUAL(new_icon, icon_data);
+        CHECK(new_icon->handle != old_handle);
+        CHECK_EQUAL(model.get_icon(old_handle), NULL_OF(Icon));
+        CHECK_EQUAL(model.get_icon(new_icon->handle), new_icon);
+    }
+
+    TEST_FIXTURE(XModelFixture, test_icon_churn)
+    {
+        // Iconifying and deiconifying over and over, with some icons going
+        // through the pool and some being destroyed, should never leave a
+        // stale icon reachable
+        std::vector<IconHandle> destroyed;
+        std::vector<Icon*> live;
+        for (int round = 0; round < 1000; round++)
+        {
+            Window client = the_client + round;
+
+            Icon *icon = model.reuse_icon(client);
+            if (!icon)
+                icon = model.create_icon(client, the_icon + round,
+                                         NULL_OF(XGC));
+
+            model.register_icon(icon);
+            live.push_back(icon);
+
+            if (round % 50 == 49)
+            {
+                for (size_t i = 0; i < live.size(); i++)
+                {
+                    Icon *old_icon = live[i];
+                    IconHandle handle = old_icon->handle;
+                    model.unregister_icon(old_icon);
+
+                    if (!model.recycle_icon(old_icon))
+                    {
+                        model.destroy_icon(old_icon);
+                        destroyed.push_back(handle);
+                    }
+                }
+
+                live.clear();
+            }
+        }
+
+        // Each batch of 50 fills the pool, and the rest are destroyed
+        CHECK_EQUAL(destroyed.size(), 20 * (50 - ICON_POOL_SIZE));
+        for (size_t i = 0; i < destroyed.size(); i++)
+            CHECK_EQUAL(model.get_icon(destroyed[i]), NULL_OF(Icon));
+
+        std::vector<Icon*> icons;
+        model.get_icons(icons);
+        CHECK_EQUAL(icons.size(), live.size());
+        for (size_t i = 0; i < live.size(); i++)
+            CHECK_EQUAL(model.find_icon_from_client(live[i]->client), live[i]);
+    }
+
     TEST_FIXTURE(XModelFixture, test_move_resize_getters_with_no_client)
     {
         // Ensure that using the getters related to move/resize information
@@ -206,6 +309,67 @@ SUITE(XModelMemberSuite)
 
         model.exit_move_resize();
     }
+
+    TEST_FIXTURE(XModelFixture, test_move_resize_geometry)
+    {
+        model.enter_move(the_client, the_placeholder, Dimension2D(0, 0));
+        model.set_move_resize_geometry(Box(10, 20, 100, 50));
+
+        // Moves only change the location of the client
+        Box geometry = model.move_resize_by(Dimension2D(5, -5));
+        CHECK_EQUAL(Box(15, 15, 100, 50), geometry);
+        model.exit_move_resize();
+
+        model.enter_resize(the_client, the_placeholder, Dimension2D(0, 0));
+        model.set_move_resize_geometry(Box(10, 20, 100, 50));
+        model.set_move_resize_increments(Dimension2D(4, 0), Dimension2D(8, 10));
+
+        // Resizes only change the size, which is rounded down to the
+        // increments (unless that would leave nothing), and can never go
+        // below zero
+        geometry = model.move_resize_by(Dimension2D(7, -45));
+        CHECK_EQUAL(Box(10, 20, 100, 5), geometry);
+
+        geometry = model.move_resize_by(Dimension2D(0, -10));
+        CHECK_EQUAL(Box(10, 20, 100, 5), geometry);
+
+        geometry = model.move_resize_by(Dimension2D(-3, 30));
+        CHECK_EQUAL(Box(10, 20, 100, 30), geometry);
+        model.exit_move_resize();
+
+        CHECK_EQUAL(Box(), model.get_move_resize_geometry());
+    }
+
+    TEST_FIXTURE(XModelFixture, test_move_resize_throttle)
+    {
+        model.enter_move(the_client, the_placeholder, Dimension2D(0, 0));
+
+        CHECK(model.throttle_move_resize(1000, 100));
+        CHECK(!model.throttle_move_resize(1050, 100));
+        CHECK(model.throttle_move_resize(1100, 100));
+
+        model.exit_move_resize();
+        CHECK(!model.throttle_move_resize(5000, 100));
+    }
+
+    TEST_FIXTURE(XModelFixture, test_mirror)
+    {
+        // Nothing is known about a window that hasn't been seen yet
+        WindowMirror &mirror = model.get_mirror(the_client);
+        CHECK_EQUAL(mirror.map_state, MIRROR_UNKNOWN);
+        CHECK(!mirror.has_border_color);
+        CHECK(!mirror.has_border_width);
+
+        mirror.map_state = MIRROR_MAPPED;
+        mirror.has_border_width = true;
+        mirror.border_width = 2;
+        CHECK_EQUAL(model.get_mirror(the_client).map_state, MIRROR_MAPPED);
+        CHECK_EQUAL(model.get_mirror(the_client).border_width, 2);
+
+        model.forget_mirror(the_client);
+        CHECK_EQUAL(model.get_mirror(the_client).map_state, MIRROR_UNKNOWN);
+        CHECK(!model.get_mirror(the_client).has_border_width);
+    }
 };
 
 int main()